@@ -0,0 +1,95 @@
+#include "alignmentindex.h"
+
+qreal AlignmentIndex::coordinate(const QRectF &rect, Edge edge)
+{
+    switch (edge) {
+    case Left:
+        return rect.left();
+    case Right:
+        return rect.right();
+    case Top:
+        return rect.top();
+    case Bottom:
+        return rect.bottom();
+    case CenterX:
+        return rect.center().x();
+    case CenterY:
+        return rect.center().y();
+    default:
+        return 0;
+    }
+}
+
+void AlignmentIndex::update(QGraphicsItem *item, const QRectF &sceneRect)
+{
+    auto it = rects.find(item);
+    if (it != rects.end()) {
+        if (it.value() == sceneRect)
+            return;
+        removeEdges(item, it.value());
+        it.value() = sceneRect;
+    } else {
+        rects.insert(item, sceneRect);
+    }
+
+    for (int e = 0; e < EdgeCount; ++e)
+        edges[e].insert(coordinate(sceneRect, Edge(e)), item);
+}
+
+void AlignmentIndex::remove(QGraphicsItem *item)
+{
+    auto it = rects.find(item);
+    if (it == rects.end())
+        return;
+    removeEdges(item, it.value());
+    rects.erase(it);
+}
+
+void AlignmentIndex::clear()
+{
+    for (int e = 0; e < EdgeCount; ++e)
+        edges[e].clear();
+    rects.clear();
+}
+
+void AlignmentIndex::removeEdges(QGraphicsItem *item, const QRectF &rect)
+{
+    for (int e = 0; e < EdgeCount; ++e)
+        edges[e].remove(coordinate(rect, Edge(e)), item);
+}
+
+AlignmentIndex::Candidate AlignmentIndex::nearest(Edge edge, qreal value, qreal tolerance,
+                                                  const QGraphicsItem *exclude) const
+{
+    Candidate best;
+    best.distance = tolerance;
+
+    const QMultiMap<qreal, QGraphicsItem *> &map = edges[edge];
+    const auto start = map.lowerBound(value);
+
+    // 向坐标增大的方向找第一个候选
+    for (auto it = start; it != map.cend() && it.key() - value < best.distance; ++it) {
+        if (it.value() == exclude)
+            continue;
+        best.item = it.value();
+        best.coordinate = it.key();
+        best.distance = it.key() - value;
+        break;
+    }
+
+    // 向坐标减小的方向找第一个候选，只有更近时才替换
+    for (auto it = start; it != map.cbegin();) {
+        --it;
+        const qreal distance = value - it.key();
+        if (distance >= best.distance)
+            break;
+        if (it.value() == exclude)
+            continue;
+        best.item = it.value();
+        best.coordinate = it.key();
+        best.distance = distance;
+        break;
+    }
+
+    return best;
+}
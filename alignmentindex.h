@@ -0,0 +1,47 @@
+#ifndef ALIGNMENTINDEX_H
+#define ALIGNMENTINDEX_H
+
+#include <QHash>
+#include <QMultiMap>
+#include <QRectF>
+
+QT_BEGIN_NAMESPACE
+class QGraphicsItem;
+QT_END_NAMESPACE
+
+// 对齐吸附用的边索引
+// 按 左/右/上/下/水平中心/垂直中心 六类坐标分别排序保存每个图元的场景边界，
+// 拖动时在有序结构里二分查找最近的候选，不再遍历整个场景（O(log n)）
+class AlignmentIndex
+{
+public:
+    enum Edge { Left, Right, Top, Bottom, CenterX, CenterY, EdgeCount };
+
+    struct Candidate {
+        QGraphicsItem *item = nullptr;  // 命中的图元，没有候选时为 nullptr
+        qreal coordinate = 0;           // 候选边的场景坐标
+        qreal distance = 0;             // 与查询值的距离
+    };
+
+    void update(QGraphicsItem *item, const QRectF &sceneRect);  // 插入或更新
+    void remove(QGraphicsItem *item);
+    void clear();
+
+    bool contains(QGraphicsItem *item) const { return rects.contains(item); }
+    int size() const { return rects.size(); }
+    QRectF rectOf(QGraphicsItem *item) const { return rects.value(item); }
+
+    // 查找 edge 类坐标中距离 value 最近且距离小于 tolerance 的图元，exclude 为正在拖动的图元
+    Candidate nearest(Edge edge, qreal value, qreal tolerance,
+                      const QGraphicsItem *exclude = nullptr) const;
+
+    static qreal coordinate(const QRectF &rect, Edge edge);
+
+private:
+    void removeEdges(QGraphicsItem *item, const QRectF &rect);
+
+    QMultiMap<qreal, QGraphicsItem *> edges[EdgeCount];
+    QHash<QGraphicsItem *, QRectF> rects;   // 每个图元当前登记的边界，用于增量删除旧的边
+};
+
+#endif // ALIGNMENTINDEX_H
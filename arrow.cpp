@@ -16,6 +16,31 @@ Arrow::Arrow(DiagramItem *startItem, DiagramItem *endItem, QGraphicsItem *parent
 {
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setPen(QPen(myColor, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    // 登记到两端图元，端点几何变化时由图元通知重算
+    myStartItem->addArrow(this);
+    myEndItem->addArrow(this);
+    updatePosition();
+}
+
+Arrow::~Arrow()
+{
+    if (myStartItem)
+        myStartItem->removeArrow(this);
+    if (myEndItem)
+        myEndItem->removeArrow(this);
+}
+
+void Arrow::detachItem(DiagramItem *item)
+{
+    if (myStartItem == item)
+        myStartItem = nullptr;
+    if (myEndItem == item)
+        myEndItem = nullptr;
+    // 端点已失去，不再重算（updatePosition 直接返回）；清掉旧的线段和箭头，不再绘制和命中
+    if (!myStartItem || !myEndItem) {
+        arrowHead.clear();
+        setLine(QLineF());
+    }
 }
 //! [0]
 
@@ -43,52 +68,65 @@ QPainterPath Arrow::shape() const
 //! [3]
 void Arrow::updatePosition()
 {
-    QLineF line(mapFromItem(myStartItem, 0, 0), mapFromItem(myEndItem, 0, 0));
-    setLine(line);
-}
-//! [3]
+    // 端点图元析构后箭头可能还在场景中
+    if (!myStartItem || !myEndItem)
+        return;
+
+    overlapping = myStartItem->collidesWithItem(myEndItem);
+
+    // 中心线与终点图元轮廓求交；轮廓取自共享的几何缓存（曲线图形也有展开后的多边形），
+    // 并按图元的完整变换映射到箭头坐标，旋转、缩放后同样正确
+    const QPointF startPos = mapFromItem(myStartItem, 0, 0);
+    const QPointF endPos = mapFromItem(myEndItem, 0, 0);
+    const QLineF centerLine(startPos, endPos);
+    const QPolygonF endPolygon = mapFromItem(myEndItem, myEndItem->polygon());
+
+    // 取离起点最近的交点，即箭头实际碰到的那条边
+    QPointF head = endPos;
+    qreal bestDistance = -1;
+    for (int i = 0; i < endPolygon.count(); ++i) {
+        const QLineF polyLine(endPolygon.at(i), endPolygon.at((i + 1) % endPolygon.count()));
+        QPointF intersectPoint;
+        if (polyLine.intersects(centerLine, &intersectPoint) != QLineF::BoundedIntersection)
+            continue;
+        const qreal distance = QLineF(startPos, intersectPoint).length();
+        if (bestDistance < 0 || distance < bestDistance) {
+            bestDistance = distance;
+            head = intersectPoint;
+        }
+    }
 
+    const QLineF clipped(head, startPos);
+    if (clipped != line())
+        setLine(clipped);   // setLine 内部会 prepareGeometryChange
+//! [3] //! [4]
+
+    const qreal arrowSize = 20;
+    double angle = std::atan2(-clipped.dy(), clipped.dx());
+
+    QPointF arrowP1 = clipped.p1() + QPointF(sin(angle + M_PI / 3) * arrowSize,
+                                     cos(angle + M_PI / 3) * arrowSize);
+    QPointF arrowP2 = clipped.p1() + QPointF(sin(angle + M_PI - M_PI / 3) * arrowSize,
+                                     cos(angle + M_PI - M_PI / 3) * arrowSize);
+
+    arrowHead.clear();
+    arrowHead << clipped.p1() << arrowP1 << arrowP2;
+    update();
+}
 //! [4]
+
+//! [5]
 void Arrow::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
                   QWidget *)
 {
-    if (myStartItem->collidesWithItem(myEndItem))
+    if (overlapping || !myStartItem || !myEndItem)
         return;
 
     QPen myPen = pen();
     myPen.setColor(myColor);
-    qreal arrowSize = 20;
     painter->setPen(myPen);
     painter->setBrush(myColor);
-//! [4] //! [5]
-
-    QLineF centerLine(myStartItem->pos(), myEndItem->pos());
-    QPolygonF endPolygon = myEndItem->polygon();
-    QPointF p1 = endPolygon.first() + myEndItem->pos();
-    QPointF intersectPoint;
-    for (int i = 1; i < endPolygon.count(); ++i) {
-        QPointF p2 = endPolygon.at(i) + myEndItem->pos();
-        QLineF polyLine = QLineF(p1, p2);
-        QLineF::IntersectionType intersectionType =
-            polyLine.intersects(centerLine, &intersectPoint);
-        if (intersectionType == QLineF::BoundedIntersection)
-            break;
-        p1 = p2;
-    }
-
-    setLine(QLineF(intersectPoint, myStartItem->pos()));
-//! [5] //! [6]
-
-    double angle = std::atan2(-line().dy(), line().dx());
 
-    QPointF arrowP1 = line().p1() + QPointF(sin(angle + M_PI / 3) * arrowSize,
-                                    cos(angle + M_PI / 3) * arrowSize);
-    QPointF arrowP2 = line().p1() + QPointF(sin(angle + M_PI - M_PI / 3) * arrowSize,
-                                    cos(angle + M_PI - M_PI / 3) * arrowSize);
-
-    arrowHead.clear();
-    arrowHead << line().p1() << arrowP1 << arrowP2;
-//! [6] //! [7]
     painter->drawLine(line());
     painter->drawPolygon(arrowHead);
     if (isSelected()) {
@@ -100,4 +138,4 @@ void Arrow::paint(QPainter *painter, const QStyleOptionGraphicsItem *,
         painter->drawLine(myLine);
     }
 }
-//! [7]
+//! [5]
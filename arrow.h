@@ -16,15 +16,19 @@ public:
 
     Arrow(DiagramItem *startItem, DiagramItem *endItem,
           QGraphicsItem *parent = nullptr);
+    ~Arrow();
 
     int type() const override { return Type; }
     QRectF boundingRect() const override;
     QPainterPath shape() const override;
-    void setColor(const QColor &color) { myColor = color; }
+    void setColor(const QColor &color) { myColor = color; update(); }
     DiagramItem *startItem() const { return myStartItem; }
     DiagramItem *endItem() const { return myEndItem; }
 
+    // 端点图元移动、缩放、旋转后由图元调用，重算裁剪后的线段和箭头；paint() 只负责绘制
     void updatePosition();
+    void detachItem(DiagramItem *item);   // 端点图元析构时调用
+    QPolygonF arrowHeadPolygon() const { return arrowHead; }
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
@@ -34,6 +38,7 @@ private:
     DiagramItem *myStartItem;
     DiagramItem *myEndItem;
     QPolygonF arrowHead;
+    bool overlapping = false;   // 两端图元相交时不画
     QColor myColor = Qt::black;
 };
 //! [0]
@@ -0,0 +1,224 @@
+#include "connectorlayer.h"
+#include "diagrampath.h"
+#include "levelofdetail.h"
+
+#include <QPainter>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+
+ConnectorLayer::ConnectorLayer(qreal cellSize)
+    : cell(cellSize)
+{
+}
+
+QPoint ConnectorLayer::cellOf(const QPointF &pos) const
+{
+    return QPoint(int(std::floor(pos.x() / cell)), int(std::floor(pos.y() / cell)));
+}
+
+// 线段的外接矩形与 rect 是否相交（含边界），水平、竖直线段的外接矩形面积为 0，不能用 QRectF::intersects
+static bool touches(const QLineF &line, const QRectF &rect)
+{
+    return qMin(line.x1(), line.x2()) <= rect.right() && qMax(line.x1(), line.x2()) >= rect.left()
+           && qMin(line.y1(), line.y2()) <= rect.bottom() && qMax(line.y1(), line.y2()) >= rect.top();
+}
+
+static qreal distanceTo(const QLineF &line, const QPointF &pos)
+{
+    const QPointF d = line.p2() - line.p1();
+    const qreal lengthSq = d.x() * d.x() + d.y() * d.y();
+    qreal t = 0;
+    if (lengthSq > 0)
+        t = qBound(0.0, QPointF::dotProduct(pos - line.p1(), d) / lengthSq, 1.0);
+    return QLineF(line.p1() + t * d, pos).length();
+}
+
+void ConnectorLayer::update(DiagramPath *path)
+{
+    const auto old = entries.constFind(path);
+    if (old != entries.cend())
+        removeFromGrid(path, old.value());
+
+    // path() 中主干之后的元素是箭头（lineTo / moveTo / lineTo）
+    Entry entry;
+    const QPainterPath full = path->path();
+    const int bodyCount = path->bodyPath().elementCount();
+    for (int i = 1; i < full.elementCount(); ++i) {
+        const QPainterPath::Element e = full.elementAt(i);
+        if (!e.isLineTo())
+            continue;
+        const QLineF line(full.elementAt(i - 1), e);
+        (i < bodyCount ? entry.body : entry.head).append(line);
+    }
+
+    const qreal halfPen = qMax<qreal>(path->pen().widthF(), 1) / 2;
+    entry.bounds = full.boundingRect().adjusted(-halfPen, -halfPen, halfPen, halfPen);
+
+    QSet<QPoint> cells;
+    auto addLines = [&](const QList<QLineF> &lines) {
+        for (const QLineF &line : lines) {
+            const QPoint from = cellOf(QPointF(qMin(line.x1(), line.x2()), qMin(line.y1(), line.y2())));
+            const QPoint to = cellOf(QPointF(qMax(line.x1(), line.x2()), qMax(line.y1(), line.y2())));
+            for (int cy = from.y(); cy <= to.y(); ++cy) {
+                for (int cx = from.x(); cx <= to.x(); ++cx) {
+                    grid[QPoint(cx, cy)].append(Segment{ path, line });
+                    cells.insert(QPoint(cx, cy));
+                }
+            }
+        }
+    };
+    addLines(entry.body);
+    addLines(entry.head);
+    entry.cells = cells.values();
+    entries.insert(path, entry);
+}
+
+void ConnectorLayer::removeFromGrid(DiagramPath *path, const Entry &entry)
+{
+    for (const QPoint &c : entry.cells) {
+        auto cellIt = grid.find(c);
+        if (cellIt == grid.end())
+            continue;
+        cellIt->removeIf([path](const Segment &s) { return s.path == path; });
+        if (cellIt->isEmpty())
+            grid.erase(cellIt);
+    }
+}
+
+void ConnectorLayer::remove(DiagramPath *path)
+{
+    const auto it = entries.constFind(path);
+    if (it == entries.cend())
+        return;
+    removeFromGrid(path, it.value());
+    entries.erase(it);
+}
+
+void ConnectorLayer::clear()
+{
+    grid.clear();
+    entries.clear();
+}
+
+QRectF ConnectorLayer::boundsOf(DiagramPath *path) const
+{
+    return entries.value(path).bounds;
+}
+
+DiagramPath *ConnectorLayer::pathAt(const QPointF &pos, qreal tolerance) const
+{
+    const QRectF probe(pos.x() - tolerance, pos.y() - tolerance, 2 * tolerance, 2 * tolerance);
+    const QPoint from = cellOf(probe.topLeft());
+    const QPoint to = cellOf(probe.bottomRight());
+    DiagramPath *best = nullptr;
+    qreal bestDistance = tolerance;
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx) {
+            const auto cellIt = grid.constFind(QPoint(cx, cy));
+            if (cellIt == grid.cend())
+                continue;
+            for (const Segment &s : cellIt.value()) {
+                const qreal distance = distanceTo(s.line, pos);
+                if (distance <= bestDistance) {
+                    bestDistance = distance;
+                    best = s.path;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+QList<DiagramPath *> ConnectorLayer::pathsIn(const QRectF &rect) const
+{
+    QSet<DiagramPath *> hits;
+    const QPoint from = cellOf(rect.topLeft());
+    const QPoint to = cellOf(rect.bottomRight());
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx) {
+            const auto cellIt = grid.constFind(QPoint(cx, cy));
+            if (cellIt == grid.cend())
+                continue;
+            for (const Segment &s : cellIt.value()) {
+                if (!hits.contains(s.path) && touches(s.line, rect))
+                    hits.insert(s.path);
+            }
+        }
+    }
+    return hits.values();
+}
+
+void ConnectorLayer::paint(QPainter *painter, const QRectF &exposed, qreal lod)
+{
+    stats = PaintStats();
+    if (entries.isEmpty())
+        return;
+
+    // 暴露区域覆盖的格子比已用格子还多时（整体缩小查看），直接遍历全部连线
+    QList<DiagramPath *> visible;
+    const QPoint from = cellOf(exposed.topLeft());
+    const QPoint to = cellOf(exposed.bottomRight());
+    const qint64 exposedCells = qint64(to.x() - from.x() + 1) * (to.y() - from.y() + 1);
+    if (exposedCells >= grid.size()) {
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            if (it->bounds.intersects(exposed))
+                visible.append(it.key());
+        }
+    } else {
+        QSet<DiagramPath *> seen;
+        for (int cy = from.y(); cy <= to.y(); ++cy) {
+            for (int cx = from.x(); cx <= to.x(); ++cx) {
+                const auto cellIt = grid.constFind(QPoint(cx, cy));
+                if (cellIt == grid.cend())
+                    continue;
+                for (const Segment &s : cellIt.value()) {
+                    if (!seen.contains(s.path) && entries.value(s.path).bounds.intersects(exposed)) {
+                        seen.insert(s.path);
+                        visible.append(s.path);
+                    }
+                }
+            }
+        }
+    }
+    if (visible.isEmpty())
+        return;
+
+    // 按画笔分组，画笔种类很少，线性查找即可
+    const bool decorations = !LevelOfDetail::hiddenDecorations(lod);
+    QList<QPair<QPen, QList<QLineF>>> batches;
+    QList<QRectF> selectedBounds;
+    for (DiagramPath *path : std::as_const(visible)) {
+        const Entry &entry = entries[path];
+        const QPen pen = path->pen();
+        auto batch = std::find_if(batches.begin(), batches.end(),
+                                  [&pen](const QPair<QPen, QList<QLineF>> &b) { return b.first == pen; });
+        if (batch == batches.end()) {
+            batches.append(qMakePair(pen, QList<QLineF>()));
+            batch = batches.end() - 1;
+        }
+        batch->second.append(entry.body);
+        if (decorations) {
+            batch->second.append(entry.head);
+            if (path->isSelected())
+                selectedBounds.append(entry.bounds);
+        }
+    }
+
+    painter->save();
+    painter->setBrush(Qt::NoBrush);
+    for (const auto &batch : std::as_const(batches)) {
+        painter->setPen(batch.first);
+        painter->drawLines(batch.second);
+        stats.lines += batch.second.size();
+    }
+    if (!selectedBounds.isEmpty()) {
+        painter->setPen(QPen(Qt::black, 0, Qt::DashLine));
+        painter->drawRects(selectedBounds);
+    }
+    painter->restore();
+
+    stats.paths = visible.size();
+    stats.batches = batches.size();
+}
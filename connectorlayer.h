@@ -0,0 +1,68 @@
+#ifndef CONNECTORLAYER_H
+#define CONNECTORLAYER_H
+
+#include <QHash>
+#include <QLineF>
+#include <QList>
+#include <QPoint>
+#include <QRectF>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+QT_END_NAMESPACE
+
+class DiagramPath;
+
+// 连线批量绘制层
+// 开启后场景不再逐条绘制、命中测试 DiagramPath，而是由这里统一处理：
+// 每条连线拆成线段放进均匀网格（线段空间索引），绘制时只取暴露区域内的连线，
+// 按画笔分组后每组一次 drawLines；点选和框选也在网格里查找
+class ConnectorLayer
+{
+public:
+    struct PaintStats {
+        int paths = 0;     // 本次绘制的连线数
+        int batches = 0;   // drawLines 调用次数（每种画笔一次）
+        int lines = 0;     // 线段总数
+    };
+
+    explicit ConnectorLayer(qreal cellSize = 200);
+
+    void update(DiagramPath *path);   // 按连线当前几何重新登记
+    void remove(DiagramPath *path);
+    void clear();
+
+    bool contains(DiagramPath *path) const { return entries.contains(path); }
+    int size() const { return entries.size(); }
+    QRectF boundsOf(DiagramPath *path) const;   // 场景坐标，含画笔宽度
+
+    // pos 附近 tolerance 内最近的连线，没有时返回 nullptr
+    DiagramPath *pathAt(const QPointF &pos, qreal tolerance) const;
+    QList<DiagramPath *> pathsIn(const QRectF &rect) const;   // 有线段与 rect 相交的连线
+
+    // lod 为当前缩放下的细节层级，缩得很小时不画箭头和选中框
+    void paint(QPainter *painter, const QRectF &exposed, qreal lod);
+    const PaintStats &lastPaintStats() const { return stats; }
+
+private:
+    struct Segment {
+        DiagramPath *path;
+        QLineF line;
+    };
+    struct Entry {
+        QList<QLineF> body;   // 主干
+        QList<QLineF> head;   // 箭头
+        QRectF bounds;
+        QList<QPoint> cells;  // 登记过的网格，用于增量删除
+    };
+
+    QPoint cellOf(const QPointF &pos) const;
+    void removeFromGrid(DiagramPath *path, const Entry &entry);
+
+    qreal cell;
+    QHash<QPoint, QList<Segment>> grid;   // 网格 -> 经过该格的线段
+    QHash<DiagramPath *, Entry> entries;
+    PaintStats stats;
+};
+
+#endif // CONNECTORLAYER_H
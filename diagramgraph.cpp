@@ -0,0 +1,92 @@
+#include "diagramgraph.h"
+
+DiagramGraph::NodeId DiagramGraph::addNode(DiagramItem *item)
+{
+    NodeId node;
+    if (!freeNodes.isEmpty()) {
+        node = freeNodes.takeLast();
+    } else {
+        node = nodes.size();
+        nodes.append(Node());
+    }
+    Node &slot = nodes[node];
+    slot.item = item;
+    slot.alive = true;
+    ++liveNodes;
+    return node;
+}
+
+void DiagramGraph::removeNode(NodeId node)
+{
+    if (!hasNode(node))
+        return;
+    // removeEdge 会改动这两个数组，先复制
+    const EdgeList out = nodes.at(node).out;
+    const EdgeList in = nodes.at(node).in;
+    for (EdgeId edge : out)
+        removeEdge(edge);
+    for (EdgeId edge : in)
+        removeEdge(edge);
+
+    Node &slot = nodes[node];
+    slot = Node();
+    freeNodes.append(node);
+    --liveNodes;
+}
+
+DiagramGraph::EdgeId DiagramGraph::addEdge(NodeId from, NodeId to, DiagramItem::TransformState fromPort,
+                                           DiagramItem::TransformState toPort, DiagramPath *path)
+{
+    Q_ASSERT(hasNode(from) && hasNode(to));
+    EdgeId edge;
+    if (!freeEdges.isEmpty()) {
+        edge = freeEdges.takeLast();
+    } else {
+        edge = edges.size();
+        edges.append(Edge());
+    }
+    Edge &slot = edges[edge];
+    slot.from = from;
+    slot.to = to;
+    slot.fromPort = quint8(fromPort);
+    slot.toPort = quint8(toPort);
+    slot.path = path;
+    nodes[from].out.append(edge);
+    nodes[to].in.append(edge);
+    ++liveEdges;
+    return edge;
+}
+
+void DiagramGraph::removeId(EdgeList &list, EdgeId edge)
+{
+    // 邻接顺序无意义，与末尾交换后删除
+    for (qsizetype i = 0; i < list.size(); ++i) {
+        if (list.at(i) == edge) {
+            list[i] = list.last();
+            list.removeLast();
+            return;
+        }
+    }
+}
+
+void DiagramGraph::removeEdge(EdgeId edge)
+{
+    if (!hasEdge(edge))
+        return;
+    const Edge &slot = edges.at(edge);
+    removeId(nodes[slot.from].out, edge);
+    removeId(nodes[slot.to].in, edge);
+    edges[edge] = Edge();
+    freeEdges.append(edge);
+    --liveEdges;
+}
+
+void DiagramGraph::clear()
+{
+    nodes.clear();
+    edges.clear();
+    freeNodes.clear();
+    freeEdges.clear();
+    liveNodes = 0;
+    liveEdges = 0;
+}
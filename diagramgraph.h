@@ -0,0 +1,69 @@
+#ifndef DIAGRAMGRAPH_H
+#define DIAGRAMGRAPH_H
+
+#include "diagramitem.h"
+
+#include <QList>
+#include <QVarLengthArray>
+
+class DiagramPath;
+
+// 图元与连线的拓扑关系（边表）
+// 节点对应 DiagramItem，边对应 DiagramPath，编号在存活期间保持不变，删除后槽位回收再用。
+// 每个节点的出边、入边各存成一段连续数组（少量边时不额外分配内存），按节点查询出入边为 O(1)。
+// 保存、复制时直接读边表中的端点编号和连接点，不再解析字符串
+class DiagramGraph
+{
+public:
+    using NodeId = int;
+    using EdgeId = int;
+    using EdgeList = QVarLengthArray<EdgeId, 4>;
+    static constexpr int InvalidId = -1;
+
+    struct Edge {
+        NodeId from = InvalidId;   // 起点图元
+        NodeId to = InvalidId;     // 终点图元（箭头所在端）
+        quint8 fromPort = DiagramItem::TF_Cen;   // 起点连接点方位
+        quint8 toPort = DiagramItem::TF_Cen;     // 终点连接点方位
+        DiagramPath *path = nullptr;
+    };
+
+    NodeId addNode(DiagramItem *item);
+    void removeNode(NodeId node);   // 同时删除相连的边
+    EdgeId addEdge(NodeId from, NodeId to, DiagramItem::TransformState fromPort,
+                   DiagramItem::TransformState toPort, DiagramPath *path = nullptr);
+    void removeEdge(EdgeId edge);
+    void clear();
+
+    bool hasNode(NodeId node) const { return node >= 0 && node < nodes.size() && nodes.at(node).alive; }
+    bool hasEdge(EdgeId edge) const { return edge >= 0 && edge < edges.size() && edges.at(edge).from != InvalidId; }
+    DiagramItem *item(NodeId node) const { return nodes.at(node).item; }
+    const Edge &edge(EdgeId edge) const { return edges.at(edge); }
+    const EdgeList &outEdges(NodeId node) const { return nodes.at(node).out; }
+    const EdgeList &inEdges(NodeId node) const { return nodes.at(node).in; }
+
+    int nodeCount() const { return liveNodes; }
+    int edgeCount() const { return liveEdges; }
+    // 编号上限（不含），用于按编号直接下标的临时表
+    int nodeCapacity() const { return nodes.size(); }
+    int edgeCapacity() const { return edges.size(); }
+
+private:
+    struct Node {
+        DiagramItem *item = nullptr;
+        EdgeList out;
+        EdgeList in;
+        bool alive = false;
+    };
+
+    static void removeId(EdgeList &list, EdgeId edge);
+
+    QList<Node> nodes;
+    QList<Edge> edges;
+    QList<NodeId> freeNodes;   // 已删除、可重用的槽位
+    QList<EdgeId> freeEdges;
+    int liveNodes = 0;
+    int liveEdges = 0;
+};
+
+#endif // DIAGRAMGRAPH_H
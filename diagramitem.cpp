@@ -9,8 +9,33 @@
 #include <QPainter>
 #include <diagramtextitem.h>
 #include "diagrampath.h"
+#include "shapecache.h"
+#include "levelofdetail.h"
+#include "itemrendercache.h"
+#include "shapeiconatlas.h"
 #include<diagramscene.h>
-
+#include <QAbstractTextDocumentLayout>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QFontMetricsF>
+#include <QGraphicsSceneMouseEvent>
+#include <utility>
+
+namespace {
+// 槽位顺序与原先 QMap 的键顺序一致（按枚举值升序），控制点重叠时取最后一个命中的
+const DiagramItem::TransformState handleStates[] = {
+    DiagramItem::TF_Right, DiagramItem::TF_Left, DiagramItem::TF_Bottom, DiagramItem::TF_BottomR,
+    DiagramItem::TF_BottomL, DiagramItem::TF_Top, DiagramItem::TF_TopR, DiagramItem::TF_TopL
+};
+const DiagramItem::TransformState portStates[] = {
+    DiagramItem::TF_Right, DiagramItem::TF_Left, DiagramItem::TF_Bottom, DiagramItem::TF_Top
+};
+// 以 TransformState 的值（0~10）为下标查槽位，-1 表示没有对应的矩形
+const qint8 handleSlot[11] = { -1, 0, 1, -1, 2, 3, 4, -1, 5, 6, 7 };
+const qint8 portSlot[11] = { -1, 0, 1, -1, 2, -1, -1, -1, 3, -1, -1 };
+const QRectF noRect;
+const qreal labelMargin = 4;   // 与文本框（QTextDocument 默认页边距）一致，编辑前后文字位置不跳动
+}
 
 DiagramItem::DiagramItem(DiagramType diagramType, QMenu *contextMenu, QGraphicsItem *parent)
     : QGraphicsItem(parent),                 // 初始化父类
@@ -28,15 +53,33 @@ DiagramItem::DiagramItem(DiagramType diagramType, QMenu *contextMenu, QGraphicsI
              QGraphicsItem::ItemIsMovable);
     setAcceptHoverEvents(true);
 
-    textItem = new DiagramTextItem(this);
-    textItem->setPlainText("请输入");  // 设置初始文本
-    textItem->setTextInteractionFlags(Qt::TextEditorInteraction);  // 允许文本编辑
-    textItem->setPos(boundingRect().center() - QPointF(textItem->boundingRect().width() / 2, textItem->boundingRect().height() / 2));
+    // 文本框在双击编辑时才创建
+    applySize(m_grapSize);
+}
+
+DiagramItem::~DiagramItem()
+{
+    // 直接 delete（或 scene->clear()）时不会经过 ItemSceneChange，需要在这里把自己从索引中移除
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene())) {
+        diagramScene->removeItemIndex(this);
+        diagramScene->removeGraphNode(this);
+    }
+    // 箭头可能比图元活得久（场景析构顺序不定），断开它对本图元的引用
+    for (Arrow *arrow : std::as_const(arrows))
+        arrow->detachItem(this);
+    for (DiagramPath *path : std::as_const(pathes))
+        path->detachItem(this);
 }
 
 QRectF DiagramItem::boundingRect() const
 {
+    // 超出图形的文字由图元自己绘制，需要包括在内
+    const QRectF frame = frameBounds();
+    return m_labelFits ? frame : frame.united(m_labelRect);
+}
 
+QRectF DiagramItem::frameBounds() const
+{
     QRectF rect(QPointF(-20,-20),m_grapSize+QSize(40,40));
     // QRectF rect(QPointF(0, 0), m_grapSize);
 
@@ -50,490 +93,290 @@ QRectF DiagramItem::boundingRect() const
 void DiagramItem::setBrush(QColor &color){
     m_color = color;
     update();
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+        diagramScene->markNodeChanged(this);
 }
 
 void DiagramItem::setFixedSize(const QSizeF &size) {
-    m_grapSize = size;
     prepareGeometryChange();
+    applySize(size);
     update();
+    sceneGeometryChanged();
 }
 
+void DiagramItem::applySize(const QSizeF &size)
+{
+    // 尺寸只在这里改变：先按类型换算，再取共享几何
+    m_grapSize = ShapeCache::normalizedSize(myDiagramType, size);
+    m_geometry = ShapeCache::geometry(myDiagramType, m_grapSize, m_border);
+    m_renderGeneration = ItemRenderCache::nextGeneration();
+    updateHandleGeometry();
+    centerLabel();
+}
 
-void DiagramItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
-                        QWidget *){
-
-    painter->setRenderHint(QPainter::Antialiasing);
-
-    // 保存当前的绘制状态
-    painter->save();
-
-    // 旋转图元，根据当前的旋转角度
-    painter->rotate(m_rotationAngle);
-    ///////////////////////////////////////////////////////////////////////////
-    qreal  w = m_grapSize.width();
-    qreal  h = m_grapSize.height();
-    qreal  b = m_border;
-
-    QPainterPath path;
-
-    painter->setBrush(m_color);
-
-    switch (myDiagramType) {
-    case StartEnd:
-        path.moveTo(b+(w-2*b)*0.15, b);
-        path.arcTo(QRectF(b,b,(w-2*b)*0.3,h-2*b),90,180);
-        path.lineTo(w-b-(w-2*b)*0.15,h-b);
-        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),270,180);
-        path.closeSubpath();
-
-        painter->drawPath(path);
-        break;
-
-    case Conditional:
-        myPolygon.clear();
-        myPolygon << QPointF(w/2, m_border) << QPointF(m_border,h/2)
-                  << QPointF(w/2, h-m_border) << QPointF(w-m_border, h/2)
-                  << QPointF(w/2, m_border);
-        painter->drawPolygon(myPolygon);
-        break;
-    case Step:
-        path.addRect(QRectF(QPointF(m_border,m_border),m_grapSize-QSizeF(10,10) ) ); //根据给定尺寸绘制图形
-        myPolygon = path.toFillPolygon();
-        painter->drawPolygon(myPolygon);
-        break;
-    case circular:
-        path.addEllipse(m_border,m_border,w-2*m_border,h-2*m_border);
-        myPolygon = path.toFillPolygon();
-        painter->drawPolygon(myPolygon);
-        break;
-    case Document:{
-        // m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 绘制矩形的左、右和上边
-        path.moveTo(QPointF(m_border, m_grapSize.height() - m_border-15));  // 左下角
-        path.lineTo(QPointF(m_border, m_border));  // 左上角
-        path.lineTo(QPointF(m_grapSize.width() - m_border, m_border));  // 右上角
-        path.lineTo(QPointF(m_grapSize.width() - m_border, m_grapSize.height() - m_border-15));  // 右下角
-
-
-        // 获取矩形的底边角点
-        QPointF bottomRight = QPointF(m_grapSize.width() - m_border, m_grapSize.height() - m_border -15);
-        QPointF bottomLeft = QPointF(m_border, m_grapSize.height() - m_border -15);
-
-        // 设置波浪线起始点
-        qreal waveHeight = 10;
-        qreal waveLength = (bottomRight.x() - bottomLeft.x()) / 3;
-
-        // 绘制波浪线的底边，从左下角到右下角
-        path.moveTo(bottomLeft);
-        path.cubicTo(bottomLeft.x() + waveLength  , bottomLeft.y() + waveHeight + waveHeight/2,
-                     bottomLeft.x() + waveLength + waveLength/2, bottomLeft.y() ,
-                     bottomRight.x(), bottomRight.y());
-
-        // 绘制矩形的路径
-        painter->drawPath(path);
-        break;
-    }
-    case PredefinedProcess:{
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-
-        // 绘制矩形的轮廓
-        path.addRect(m_border, m_border, m_grapSize.width() - 2 * m_border, m_grapSize.height() - 2 * m_border);
-
-        // 计算内侧两条竖线的位置
-        qreal innerLineOffset = m_grapSize.width() / 8;
-        QPointF leftLineTop = QPointF(m_border + innerLineOffset, m_border);
-        QPointF leftLineBottom = QPointF(m_border + innerLineOffset, m_grapSize.height() - m_border);
-        QPointF rightLineTop = QPointF(m_grapSize.width() - m_border - innerLineOffset, m_border);
-        QPointF rightLineBottom = QPointF(m_grapSize.width() - m_border - innerLineOffset, m_grapSize.height() - m_border);
-
-        // 绘制左侧内侧竖线
-        path.moveTo(leftLineTop);
-        path.lineTo(leftLineBottom);
-
-        // 绘制右侧内侧竖线
-        path.moveTo(rightLineTop);
-        path.lineTo(rightLineBottom);
-
-        // 绘制矩形和内侧线条
-        painter->drawPath(path);
-        break;
-    }
-
-    case StoredData: {
-        // 设置图形的宽度，确保宽度大于高度
-        // m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        path.moveTo(b+(w-2*b)*0.15, b);
-        path.arcTo(QRectF(b,b,(w-2*b)*0.3,h-2*b),90,180);
-        path.lineTo(w-b-(w-2*b)*0.15,h-b);
-        path.moveTo(b+(w-2*b)*0.15, b);
-        path.lineTo(w-b-(w-2*b)*0.15,b);
-        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),90,180);
-        // path.lineTo(w-b-(w-2*b)*0.15,b);
-        // path.closeSubpath();
-
-        painter->drawPath(path);
-        break;
-    }
-    case Memory: {
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 绘制外部矩形
-        path.addRect(m_border, m_border, m_grapSize.width() - 2 * m_border, m_grapSize.height() - 2 * m_border);
-
-        // 计算线条的位置和宽度
-        qreal lineWidth = (m_grapSize.height() - 2 * m_border) * 0.1; // 设置线条的宽度为高度的10%
-        qreal lineHeight = (m_grapSize.width() - 2 * m_border) * 0.1; // 设置水平线条的高度为宽度的10%
-
-        // 绘制顶部粗线条
-        path.moveTo(QPointF(m_border, m_border + lineWidth));
-        path.lineTo(QPointF(m_grapSize.width() - m_border, m_border + lineWidth));
-
-        // 绘制左侧粗线条
-        path.moveTo(QPointF(m_border + lineHeight, m_border));
-        path.lineTo(QPointF(m_border + lineHeight, m_grapSize.height() - m_border));
-
-        // 完成绘制
-        painter->drawPath(path);
-        break;
-    }
-    case SequentialAccessStorage: {
-        // 设置图形的宽度，确保宽度大于高度
-        // m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        m_grapSize.setWidth(m_grapSize.height());
-        // 定义边距
-        qreal b = m_border;
-
-        // 计算圆的直径和中心位置
-        qreal diameter = m_grapSize.height() - 2 * b;
-        QPointF center(b + diameter / 2, m_grapSize.height() / 2);
-
-        // 绘制大圆
-        path.addEllipse(QRectF(center.x() - diameter / 2, center.y() - diameter / 2, diameter, diameter));
-
-        // 绘制底部水平线
-        path.moveTo(QPointF(center.x() , m_grapSize.height() - b));
-        path.lineTo(QPointF(m_grapSize.width() - b, m_grapSize.height() - b));
-
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
-    case Io:
-        myPolygon.clear();
-        myPolygon << QPointF(b+(w-2*b)*0.2, b) << QPointF(w-b,b)
-                  << QPointF(w-b-(w-2*b)*0.2, h-b) << QPointF(b, h-b)
-                  << QPointF(b+(w-2*b)*0.2,b);
-        painter->drawPolygon(myPolygon);
-        break;
-
-    case DirectAccessStorage: {   //多一条竖线
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 计算圆的直径
-        qreal diameter = m_grapSize.height() - 2 * b;
-
-        // 从右上角开始绘制上半部分的直线
-        path.moveTo(b+diameter / 2, b);
-        // path.lineTo(b + diameter / 2, b);
-
-        // 绘制左侧半圆
-        path.arcTo(QRectF(b, b, diameter, diameter), 90, 180);  // 从左上角逆时针绘制半圆
-
-        // 画下半部分的直线连接左侧半圆和右侧整圆的下顶点
-        path.lineTo(m_grapSize.width() - diameter / 2, m_grapSize.height() - b);
-
-        // 绘制右侧整圆
-        path.arcTo(QRectF(m_grapSize.width() - diameter, b, diameter, diameter), 270, 360);  // 从右上角逆时针绘制整圆
-        // path.arcTo(QRectF(m_grapSize.width() - diameter, b, diameter, diameter), 90, 180);
-        path.arcTo(QRectF(m_grapSize.width() - diameter, b, diameter, diameter), 270, 180);
-        path.closeSubpath();
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
-    case Disk: {
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height());
-
-        // 计算椭圆的长轴和短轴
-        qreal ellipseWidth = m_grapSize.width() - 2 * b;
-        qreal ellipseHeight = ellipseWidth / 2;  // 椭圆的高为宽的一半
-
-        // 绘制顶部椭圆
-        path.moveTo(b, b + ellipseHeight / 2);
-        path.arcTo(QRectF(b, b, ellipseWidth, ellipseHeight), 180, 360);
-
-        // 绘制左侧垂直线
-        path.lineTo(b, m_grapSize.height() - b - ellipseHeight/2);
-
-        // 绘制底部椭圆
-        path.arcTo(QRectF(b, m_grapSize.height() - b - ellipseHeight, ellipseWidth, ellipseHeight), 180, 180);
-
-        // 绘制右侧垂直线
-        path.lineTo(b + ellipseWidth, b + ellipseHeight / 2);
-        // 绘制顶部椭圆的下半部分
-        path.arcTo(QRectF(b, b, ellipseWidth, ellipseHeight), 0, -180);
-
-        // 绘制路径
-        // path.closeSubpath();
-        painter->drawPath(path);
-        break;
+void DiagramItem::centerLabel()
+{
+    // 按文本框的排版计算文字区域：逐行取宽度，四周留出页边距，居中于图形外框，不随图形旋转
+    const QFontMetricsF metrics(m_labelFont);
+    const QStringList lines = m_labelText.split(QLatin1Char('\n'));
+    qreal width = 0;
+    for (const QString &line : lines)
+        width = qMax(width, metrics.horizontalAdvance(line));
+    const QSizeF size(width + 2 * labelMargin, lines.size() * metrics.height() + 2 * labelMargin);
+    const QRectF frame = frameBounds();
+    const QRectF labelRect(frame.center() - QPointF(size.width() / 2, size.height() / 2), size);
+    const bool fits = frame.contains(labelRect);
+    // 文字超出图形时 boundingRect 随文字变化
+    const bool boundsChanged = labelRect != m_labelRect && !(fits && m_labelFits);
+    if (boundsChanged)
+        prepareGeometryChange();
+    m_labelRect = labelRect;
+    m_labelFits = fits;
+    m_labelPos = labelRect.topLeft() + QPointF(labelMargin, labelMargin);
+    if (boundsChanged)
+        sceneGeometryChanged();
+    if (m_labelEditor) {
+        const QRectF editorRect = m_labelEditor->boundingRect();
+        m_labelEditor->setPos(frame.center() - QPointF(editorRect.width() / 2, editorRect.height() / 2));
     }
-    case Card: {
-        // 定义宽度和边界
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 设置左下角的起点
-        path.moveTo(b, h - b);
+    update();
+}
 
-        // 绘制左边缘
-        path.lineTo(b, b + w * 0.15);
+void DiagramItem::setLabelText(const QString &text)
+{
+    if (text == m_labelText)
+        return;
+    m_labelText = text;
+    // 编辑期间由外部修改（如替换）时同步到文本框
+    if (m_labelEditor && m_labelEditor->toPlainText() != text)
+        m_labelEditor->setPlainText(text);
+    labelChanged();
+    centerLabel();
+}
 
-        // 绘制顶部斜边
-        path.lineTo(b + w * 0.15, b );
+void DiagramItem::setLabelFont(const QFont &font)
+{
+    if (font == m_labelFont)
+        return;
+    m_labelFont = font;
+    if (m_labelEditor)
+        m_labelEditor->setFont(font);
+    labelChanged();
+    centerLabel();
+}
 
-        // 绘制顶部直边
-        path.lineTo(w - b, b);
+void DiagramItem::setLabelColor(const QColor &color)
+{
+    if (color == m_labelColor)
+        return;
+    m_labelColor = color;
+    if (m_labelEditor)
+        m_labelEditor->setDefaultTextColor(color);
+    labelChanged();
+}
 
-        // 绘制右边缘
-        path.lineTo(w - b, h - b);
+void DiagramItem::labelChanged()
+{
+    m_labelDirty = true;
+    m_renderGeneration = ItemRenderCache::nextGeneration();
+    update();
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+        diagramScene->markNodeChanged(this);
+}
 
-        // 绘制底部边缘
-        path.lineTo(b, h - b);
+void DiagramItem::refreshLabel()
+{
+    if (!m_labelDirty)
+        return;
+
+    m_labelDirty = false;
+    QString text = m_labelText;
+    text.replace(QLatin1Char('\n'), QChar::LineSeparator);
+    m_label.setTextFormat(Qt::PlainText);
+    m_label.setPerformanceHint(QStaticText::AggressiveCaching);
+    m_label.setText(text);
+    m_label.prepare(QTransform(), m_labelFont);
+}
 
-        // 绘制路径
-        painter->drawPath(path);
-        break;
+void DiagramItem::paintLabel(QPainter *painter, qreal lod)
+{
+    // 编辑期间文字由文本框绘制
+    if (m_labelEditor || LevelOfDetail::hiddenLabel(lod))
+        return;
+    refreshLabel();
+    if (m_label.text().isEmpty())
+        return;
+
+    if (LevelOfDetail::greekedLabel(lod)) {
+        // 缩小后文字不可读，用与文字同色的半透明灰条代替
+        QColor color = m_labelColor;
+        color.setAlpha(110);
+        painter->fillRect(QRectF(m_labelRect.left() + labelMargin, m_labelRect.center().y() - m_labelRect.height() / 6,
+                                 m_labelRect.width() - 2 * labelMargin, m_labelRect.height() / 3), color);
+        return;
     }
-    case ManualInput:{
-        // 定义宽度和边界
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 设置左下角的起点
-        path.moveTo(b, h - b);
-
-        // 绘制左边缘
-        path.lineTo(b, b + w * 0.15);
 
-        // 绘制顶部斜边
-        path.lineTo(w - b, b );
+    painter->save();
+    painter->setFont(m_labelFont);
+    painter->setPen(m_labelColor);
+    painter->drawStaticText(m_labelPos, m_label);
+    painter->restore();
+}
 
-        // 绘制右边缘
-        path.lineTo(w - b, h - b);
+void DiagramItem::beginLabelEdit()
+{
+    if (m_labelEditor)
+        return;
+    m_labelEditor = new DiagramTextItem(this);
+    m_labelEditor->setFont(m_labelFont);
+    m_labelEditor->setDefaultTextColor(m_labelColor);
+    m_labelEditor->setPlainText(m_labelText);
+    m_labelEditor->setTextInteractionFlags(Qt::TextEditorInteraction);
+    // 输入随时写回图元；失去焦点后结束编辑，文字改回由图元绘制
+    QObject::connect(m_labelEditor, &DiagramTextItem::lostFocus, m_labelEditor, [this]() { endLabelEdit(); });
+    QObject::connect(m_labelEditor->document(), &QTextDocument::contentsChanged, m_labelEditor, [this]() {
+        if (m_labelEditor)
+            setLabelText(m_labelEditor->toPlainText());
+    });
+    // 文本框尺寸变化时重新居中
+    QObject::connect(m_labelEditor->document()->documentLayout(), &QAbstractTextDocumentLayout::documentSizeChanged,
+                     m_labelEditor, [this]() { centerLabel(); });
+    centerLabel();
+    m_labelEditor->setFocus(Qt::MouseFocusReason);
+    QTextCursor cursor = m_labelEditor->textCursor();
+    cursor.select(QTextCursor::Document);
+    m_labelEditor->setTextCursor(cursor);
+    // 编辑期间文字由文本框绘制，缓存的位图里不能再带文字
+    m_renderGeneration = ItemRenderCache::nextGeneration();
+    update();
+}
 
-        // 绘制底部边缘
-        path.lineTo(b, h - b);
+void DiagramItem::endLabelEdit()
+{
+    if (!m_labelEditor)
+        return;
+    DiagramTextItem *editor = std::exchange(m_labelEditor, nullptr);
+    // 可能在文本框自己的失去焦点处理中调用，回到事件循环后再删除
+    editor->hide();
+    editor->deleteLater();
+    m_renderGeneration = ItemRenderCache::nextGeneration();
+    update();
+}
 
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
-    case PerforatedTape:{    //填充有问题
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-
-        // 获取矩形的上下边角点
-        QPointF topLeft = QPointF(m_border, m_border+10);
-        QPointF bottomLeft = QPointF(m_border, m_grapSize.height() - m_border-10);
-        QPointF topRight = QPointF(m_grapSize.width() - m_border, m_border+10);
-        QPointF bottomRight = QPointF(m_grapSize.width() - m_border, m_grapSize.height() - m_border-10);
-
-        // 设置波浪线参数
-        qreal waveHeight = 10;
-        qreal waveLength = (bottomRight.x() - bottomLeft.x()) / 3;
-
-        // 1. 从左上角开始绘制左边的竖线
-        path.moveTo(topLeft);
-        path.lineTo(bottomLeft);
-
-        // 2. 从左下角绘制向右的波浪线，先波谷再波峰
-        path.moveTo(bottomLeft);
-        path.cubicTo(bottomLeft.x() + waveLength / 2, bottomLeft.y() + 1.5 * waveHeight,
-                     bottomLeft.x() + waveLength + waveLength / 2, bottomLeft.y() - 1.5 * waveHeight,
-                     bottomRight.x(), bottomRight.y());
-
-        // 3. 从右下角绘制右边的竖线，向上到右上角
-        path.lineTo(topRight);
-
-        // 4. 从右上角往左绘制向左的波浪线，先波谷再波峰
-        path.moveTo(topRight);
-        path.cubicTo(topRight.x() - waveLength / 2, topRight.y() - 1.5 * waveHeight,
-                     topRight.x() - waveLength - waveLength / 2, topRight.y() + 1.5 * waveHeight,
-                     topLeft.x(), topLeft.y());
-
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
-    case Display:{
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        // 绘制左上角的斜线
-        path.moveTo(b + w * 0.15, b);
-        path.lineTo(b, h / 2);  // 第一条斜线
-        path.lineTo(b + w * 0.15, h - b);  // 第二条斜线
-
-        // 绘制底部的水平线
-        path.lineTo(w - b - (w - 2 * b) * 0.15, h - b);
-
-        // 绘制右侧的半圆
-        // path.arcTo(QRectF(w - b - (w - 2 * b) * 0.3, b, (w - 2 * b) * 0.3, h - 2 * b), 90, 180);
-        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),270,180);
-
-        // 绘制顶部的水平线，回到起点
-        path.lineTo(b + w * 0.15, b);
-
-        // 关闭路径
-        path.closeSubpath();
-        painter->drawPath(path);
-        break;
+void DiagramItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton && !m_labelEditor) {
+        beginLabelEdit();
+        event->accept();
+        return;
     }
-    case Preparation: {
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        qreal w = m_grapSize.width();
-        qreal h = m_grapSize.height();
-        qreal b = m_border;
-
-        // 从左上角开始绘制
-        path.moveTo(b + w * 0.15, b);  // 左上角的起点
-        path.lineTo(b, h / 2);  // 左侧斜边
-        path.lineTo(b + w * 0.15, h - b);  // 左侧的第二条斜边
+    QGraphicsItem::mouseDoubleClickEvent(event);
+}
 
-        // 绘制底部水平直线
-        path.lineTo(w - b - w * 0.15, h - b);
+QPolygonF DiagramItem::polygon() const
+{
+    return m_geometry->fillPolygon;
+}
 
-        // 绘制右侧的第二条斜线
-        path.lineTo(w - b, h / 2);
+QPainterPath DiagramItem::outlineShape() const
+{
+    return m_geometry->hitShape;
+}
 
-        // 绘制顶部水平直线，回到起点
-        path.lineTo(w - b - w * 0.15, b);
 
-        // 关闭路径
-        path.closeSubpath();
+void DiagramItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                        QWidget *){
 
-        // 绘制路径
-        painter->drawPath(path);
-        break;
+    // 缩小到只有几个像素时画成纯色矩形，省掉曲线轮廓、抗锯齿和控制点
+    const qreal lod = LevelOfDetail::of(option, painter);
+    if (LevelOfDetail::simplifiedShape(lod)) {
+        painter->save();
+        painter->rotate(m_rotationAngle);
+        painter->setPen(isSelected() ? QPen(QColor(0, 120, 215), 0) : QPen(Qt::NoPen));
+        painter->setBrush(m_color);
+        painter->drawRect(QRectF(QPointF(m_border, m_border), m_grapSize - QSizeF(10, 10)));
+        painter->restore();
+        paintLabel(painter, lod);
+        return;
     }
-    case  ManualOperation: {
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.5);
-        qreal w = m_grapSize.width();
-        qreal h = m_grapSize.height();
-        qreal b = m_border;
-
-        // 从左下角开始绘制
-        path.moveTo(b + w * 0.15, h - b);  // 左下角
-        path.lineTo(b , b);  // 左上角，向右移动一定距离
-        path.lineTo(w - b , b);  // 右上角，向左移动一定距离
-        path.lineTo(w - b - w * 0.15, h - b);  // 右下角
-        path.lineTo(b + w * 0.15, h - b);  // 回到左下角
 
-        // 关闭路径
-        path.closeSubpath();
-
-        // 绘制路径
-        painter->drawPath(path);
-        break;
+    // 缓存绘制：主体按缩放档位贴图，控制点由场景覆盖层实时绘制，选中/悬停不会使位图失效
+    DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene());
+    if (diagramScene && diagramScene->cachedRendering()) {
+        if (m_renderColor != m_color) {
+            m_renderColor = m_color;
+            m_renderGeneration = ItemRenderCache::nextGeneration();
+        }
+        // 文字随主体一起进位图，按档位的缩放决定是否隐去或画成灰条，与位图的分辨率一致
+        const qreal bucketLod = ItemRenderCache::bucketScale(ItemRenderCache::zoomBucket(lod));
+        diagramScene->renderCache().draw(painter, m_renderGeneration, lod, boundingRect(),
+                                         [this, bucketLod](QPainter *p) {
+                                             paintBody(p);
+                                             paintLabel(p, bucketLod);
+                                         });
+        return;
     }
-    case ParallelMode: {
-        // 定义图形的宽度和高度
-        qreal w = m_grapSize.width();
-        qreal h = m_grapSize.height();
-        qreal b = m_border;
-
-        // 绘制上部直线
-        path.moveTo(b, h / 3);
-        path.lineTo(w - b, h / 3);
 
-        // 绘制下部直线
-        path.moveTo(b, 2 * h / 3);
-        path.lineTo(w - b, 2 * h / 3);
+    painter->setRenderHint(QPainter::Antialiasing);
+    paintBody(painter);
+    paintLabel(painter, lod);
 
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
-    case Hexagon: {
-        // 设置图形的宽度，确保宽度大于高度
-        m_grapSize.setWidth(m_grapSize.height() * 1.2); // 宽度稍微大于高度
-        qreal w = m_grapSize.width();
-        qreal h = m_grapSize.height();
-        qreal b = m_border;
-
-        // 从左下角开始绘制
-        path.moveTo(b, h - b);  // 左下角
-        path.lineTo(b, b + h * 0.15);  // 左上斜边的底部
-        path.lineTo(b + w * 0.15, b);  // 左上角的顶点
-        path.lineTo(w - b - w * 0.15, b);  // 右上角的顶点
-        path.lineTo(w - b, b + h * 0.15);  // 右上斜边的底部
-        path.lineTo(w - b, h - b);  // 右下角
-        path.lineTo(b, h - b);  // 回到左下角
-
-        // 关闭路径
-        path.closeSubpath();
-
-        // 绘制路径
-        painter->drawPath(path);
-        break;
-    }
+    if (!LevelOfDetail::hiddenDecorations(lod))
+        paintHandles(painter);
+}
 
-    default:
-        qDebug()<<"this Node does not exist!";
-    }
+void DiagramItem::paintBody(QPainter *painter)
+{
+    // 保存当前的绘制状态
+    painter->save();
 
-    // 仅更新文本框的位置，不旋转文本框
-    textItem->setPos(boundingRect().center() - QPointF(textItem->boundingRect().width() / 2, textItem->boundingRect().height() / 2));
+    // 旋转图元，根据当前的旋转角度
+    painter->rotate(m_rotationAngle);
+    ///////////////////////////////////////////////////////////////////////////
+    // 轮廓取自共享的几何缓存，尺寸不变时不再重建路径
+    painter->setBrush(m_color);
+    if (m_geometry->drawAsPolygon)
+        painter->drawPolygon(m_geometry->fillPolygon);
+    else
+        painter->drawPath(m_geometry->outline);
 
     // 恢复绘制状态
     painter->restore();
+}
+
+void DiagramItem::paintHandles(QPainter *painter)
+{
+    if (!isSelected() || !isHover || !isChange)
+        return;
 
     qreal penW = 1.0 / painter->transform().m11();
     QRectF imgRect =
         QRectF(QPointF(m_border, m_border), m_grapSize - QSizeF(10, 10));
 
-    if (isSelected() && isHover && isChange) {
-        // 保存画笔状态
-        painter->save();
-
-        // 旋转画布与图元同步
-        // painter->translate(boundingRect().center());
-        painter->rotate(m_rotationAngle);
-        // painter->translate(-boundingRect().center());
-
-        QPen borderPen(QColor(0, 120, 215), penW * 2, Qt::DashLine);
-        QPen PointPen(QColor(90, 157, 253), penW, Qt::SolidLine);
+    // 保存画笔状态
+    painter->save();
 
-        // 绘出虚线边框
-        painter->setPen(borderPen);
-        painter->setBrush(Qt::transparent);
-        painter->drawRect(imgRect);
+    // 旋转画布与图元同步
+    painter->rotate(m_rotationAngle);
 
-        // 绘出8个角的控制点
-        painter->setPen(PointPen);
+    QPen borderPen(QColor(0, 120, 215), penW * 2, Qt::DashLine);
+    QPen PointPen(QColor(90, 157, 253), penW, Qt::SolidLine);
 
-        const QMap<TransformState, QRectF> rectMap = rectWhere();
-        const QMap<TransformState,QRectF> linkMap = linkWhere();
-        painter->setBrush(QBrush(Qt::red));
-        for (const TransformState state : rectMap.keys()) {
-            painter->drawRect(rectMap[state]);
-        }
-        painter->setBrush(QBrush(Qt::blue));
-        for(QRectF link : linkMap){
-            painter->drawRect(link);
-        }
+    // 绘出虚线边框
+    painter->setPen(borderPen);
+    painter->setBrush(Qt::transparent);
+    painter->drawRect(imgRect);
 
-        // 恢复画笔状态
-        painter->restore();
-    }
+    // 绘出8个角的控制点
+    painter->setPen(PointPen);
 
-    if(showLink){
-        const QMap<TransformState,QRectF> linkMap = linkWhere();
-        painter->setBrush(QBrush(Qt::blue));
-        for(QRectF link : linkMap){
-            painter->drawRect(link);
-        }
-    }
+    painter->setBrush(QBrush(Qt::red));
+    painter->drawRects(m_handleRects, HandleCount);
+    painter->setBrush(QBrush(Qt::blue));
+    painter->drawRects(m_portRects, PortCount);
 
+    // 恢复画笔状态
+    painter->restore();
 }
 
 
@@ -543,64 +386,53 @@ void DiagramItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event) {
 
     QGraphicsItem::hoverMoveEvent(event);
 
-    bool isHit = false;
+    TransformState hit = TF_Cen;
     if(QRectF(QPointF(0,0),m_grapSize).contains(event->pos() ) ){
-        const QMap<TransformState, QRectF> rectMap = rectWhere();
-        for (const TransformState tsf : rectMap.keys()) {
-            if (rectMap[tsf].contains(event->pos())) {
-                switch (tsf) {
-                case TF_Top:
-                case TF_Bottom: {
-                    setCursor(QCursor(Qt::SizeVerCursor));
-                } break;
-                case TF_Left:
-                case TF_Right: {
-                    setCursor(QCursor(Qt::SizeHorCursor));
-                } break;
-                case TF_TopL:
-                case TF_BottomR: {
-                    setCursor(QCursor(Qt::SizeFDiagCursor));
-                } break;
-                case TF_TopR:
-                case TF_BottomL: {
-                    setCursor(QCursor(Qt::SizeBDiagCursor));
-                } break;
-                default: {
-                    // setCursor(QCursor(Qt::SizeAllCursor));
-                } break;
-                }
-                m_tfState = tsf;
-                isHit = true;
-            }
+        hit = handleAt(event->pos());
+        switch (hit) {
+        case TF_Top:
+        case TF_Bottom:
+            setHoverCursor(Qt::SizeVerCursor);
+            break;
+        case TF_Left:
+        case TF_Right:
+            setHoverCursor(Qt::SizeHorCursor);
+            break;
+        case TF_TopL:
+        case TF_BottomR:
+            setHoverCursor(Qt::SizeFDiagCursor);
+            break;
+        case TF_TopR:
+        case TF_BottomL:
+            setHoverCursor(Qt::SizeBDiagCursor);
+            break;
+        default:
+            break;
         }
+        if (hit != TF_Cen)
+            m_tfState = hit;
     }
     else{
-        const QMap<TransformState,QRectF> linkMap = linkWhere();
-        for(const TransformState tsf : linkMap.keys()){
-            if (linkMap[tsf].contains(event->pos())) {
-
-                switch (tsf) {
-                case TF_Top:
-                case TF_Bottom:
-                case TF_Left:
-                case TF_Right: {
-                    setCursor(QCursor(Qt::CrossCursor));
-                    isInsertPath = true;
-                } break;
-                default:
-                    break;
-                }
-                isHit = true;
-            }
+        hit = portAt(event->pos());
+        if (hit != TF_Cen) {
+            setHoverCursor(Qt::CrossCursor);
+            isInsertPath = true;
         }
     }
-    if (!isHit) {
+    if (hit == TF_Cen) {
         m_tfState = TF_Cen;
-        setCursor(QCursor(Qt::ArrowCursor));
+        setHoverCursor(Qt::ArrowCursor);
         isInsertPath = false;
     }
 }
 
+void DiagramItem::setHoverCursor(Qt::CursorShape shape)
+{
+    // 悬停事件很频繁，光标没变时不重复设置
+    if (!hasCursor() || cursor().shape() != shape)
+        setCursor(QCursor(shape));
+}
+
 void DiagramItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
     if(!isChange) return ;
     if (event->buttons() == Qt::LeftButton) {
@@ -643,7 +475,8 @@ void DiagramItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
             // 界面及时做出反馈
             prepareGeometryChange();
             setPos(x, y);
-            m_grapSize = QSize(w, h);
+            applySize(QSize(w, h));
+            sceneGeometryChanged();
         } else {
             setFlag(QGraphicsItem::ItemIsMovable, true);
         }
@@ -673,120 +506,44 @@ void DiagramItem::removeArrow(Arrow *arrow)
 void DiagramItem::removeArrows()
 {
     const auto arrowsCopy = arrows;
-    for (Arrow *arrow : arrowsCopy) {
-        arrow->startItem()->removeArrow(arrow);
-        arrow->endItem()->removeArrow(arrow);
-        scene()->removeItem(arrow);
-        delete arrow;
-    }
+    for (Arrow *arrow : arrowsCopy)
+        delete arrow;   // ~Arrow 从仍存在的端点图元注销，并离开场景
 }
 
 void DiagramItem::removePath(DiagramPath *path){
-    marks.remove(path);
     pathes.removeAll(path);
     qDebug()<<"deleted";
 }
 
 void DiagramItem::removePathes(){
     const auto pathesCopy = pathes;
-    for(DiagramPath *path : pathesCopy){
-        path->getStartItem()->marks.remove(path);
-        path->getStartItem()->removePath(path);
-        path->getEndItem()->marks.remove(path);
-        path->getEndItem()->removePath(path);
-        scene()->removeItem(path);
-        delete path;
-    }
+    for(DiagramPath *path : pathesCopy)
+        delete path;   // ~DiagramPath 从两端图元注销，并离开场景
 }
 //! [2]
 
 //! [3]
 void DiagramItem::addArrow(Arrow *arrow)
 {
-    arrows.append(arrow);
+    // Arrow 构造时已登记，场景创建箭头时再次调用不重复添加
+    if (!arrows.contains(arrow))
+        arrows.append(arrow);
 }
 //! [3]
 
 //! [4]
 QPixmap DiagramItem::image() const
 {
-    //Step, Conditional, StartEnd, Io,
-    // circular,StoredData,Document,PredefinedProcess,
-    //     Memory,SequentialAccessStorage,DirectAccessStorage,
-    //     Disk,Card,ManualInput
-    QPixmap pixmap(250, 250);
-    switch (myDiagramType) {
-    case Step:
-        pixmap.load(":/images/NodesIcon/Step.png");
-        break;
-    case Conditional:
-        pixmap.load(":/images/NodesIcon/Conditional.png");
-        break;
-    case StartEnd:
-        pixmap.load(":/images/NodesIcon/StartEnd.png");
-        break;
-    case Io:
-        pixmap.load(":/images/NodesIcon/Io.png");
-        break;
-    case circular:
-        pixmap.load(":/images/NodesIcon/Circular.png");
-        break;
-    case StoredData:
-        pixmap.load(":/images/NodesIcon/StoredData.png");
-        break;
-    case Document:
-        pixmap.load(":/images/NodesIcon/Document.png");
-        break;
-    case PredefinedProcess:
-        pixmap.load(":/images/NodesIcon/PredefinedProcess.png");
-        break;
-    case Memory:
-        pixmap.load(":/images/NodesIcon/Memory.png");
-        break;
-    case SequentialAccessStorage:
-        pixmap.load(":/images/NodesIcon/SequentialAccessStorage.png");
-        break;
-    case DirectAccessStorage:
-        pixmap.load(":/images/NodesIcon/DirectAccessStorage.png");
-        break;
-    case Disk:
-        pixmap.load(":/images/NodesIcon/Disk.png");
-        break;
-    case Card:
-        pixmap.load(":/images/NodesIcon/Card.png");
-        break;
-    case ManualInput:
-        pixmap.load(":/images/NodesIcon/ManualInput.png");
-        break;
-    case PerforatedTape:
-        pixmap.load(":/images/NodesIcon/PerforatedTape.png");
-        break;
-    case Display:
-        pixmap.load(":/images/NodesIcon/Display.png");
-        break;
-    case Preparation:
-        pixmap.load(":/images/NodesIcon/Preparation.png");
-        break;
-    case ManualOperation:
-        pixmap.load(":/images/NodesIcon/ManualOperation.png");
-        break;
-    case ParallelMode:
-        pixmap.load(":/images/NodesIcon/ParallelMode.png");
-        break;
-    case Hexagon:
-        pixmap.load(":/images/NodesIcon/Hexgon.png");
-        break;
-    default:
-        break;
-    }
-
-    return pixmap;
+    // 图标由全进程共享的图标集解码，同一类型只解码一次
+    return QPixmap::fromImage(ShapeIconAtlas::instance().image(myDiagramType));
 }
 //! [4]
 
 //! [5]
 void DiagramItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 {
+    if (!myContextMenu)
+        return;
     scene()->clearSelection();
     setSelected(true);
     myContextMenu->popup(event->screenPos());
@@ -796,44 +553,117 @@ void DiagramItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 //! [6]
 QVariant DiagramItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    if (change == QGraphicsItem::ItemPositionChange) {
-        for (Arrow *arrow : std::as_const(arrows))
-            arrow->updatePosition();
-        updatePathes();
+    if (change == QGraphicsItem::ItemPositionHasChanged
+               || change == QGraphicsItem::ItemTransformHasChanged
+               || change == QGraphicsItem::ItemRotationHasChanged
+               || change == QGraphicsItem::ItemScaleHasChanged
+               || change == QGraphicsItem::ItemParentHasChanged
+               || change == QGraphicsItem::ItemSceneHasChanged) {
+        // 控制点边长随变换缩放
+        if (change == QGraphicsItem::ItemTransformHasChanged)
+            updateHandleGeometry();
+        if (change == QGraphicsItem::ItemSceneHasChanged) {
+            if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+                diagramScene->addGraphNode(this);
+        }
+        sceneGeometryChanged();
+    } else if (change == QGraphicsItem::ItemSceneChange) {
+        // 离开旧场景前从旧场景的索引中移除（此时 scene() 仍是旧场景）
+        if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene())) {
+            diagramScene->removeItemIndex(this);
+            diagramScene->removeGraphNode(this);
+        }
     }
     return value;
 }
 //! [6]
-QMap<DiagramItem::TransformState, QRectF> DiagramItem::rectWhere() {
-    static QMap<TransformState, QRectF> rectMap;
+QMap<DiagramItem::TransformState, QRectF> DiagramItem::rectWhere() const {
+    QMap<TransformState, QRectF> rectMap;
+    for (int i = 0; i < HandleCount; ++i)
+        rectMap.insert(handleStates[i], m_handleRects[i]);
+    return rectMap;
+}
 
+void DiagramItem::updateHandleGeometry()
+{
+    qreal borderWH = m_border * 2 / transform().m11();
+
+    // 控制点
     int x1 = 0;
     int x2 = m_grapSize.width() / 2 - m_border;
     int x3 = m_grapSize.width() - m_border * 2;
     int y1 = 0;
     int y2 = m_grapSize.height() / 2 - m_border;
     int y3 = m_grapSize.height() - m_border * 2;
-    qreal borderWH = m_border * 2 / transform().m11();
 
-    rectMap[TF_TopL] = QRectF(x1, y1, borderWH, borderWH);
-    rectMap[TF_Top] = QRectF(x2, y1, borderWH, borderWH);
-    rectMap[TF_TopR] = QRectF(x3, y1, borderWH, borderWH);
-    rectMap[TF_Right] = QRectF(x3, y2, borderWH, borderWH);
-    rectMap[TF_BottomR] = QRectF(x3, y3, borderWH, borderWH);
-    rectMap[TF_Bottom] = QRectF(x2, y3, borderWH, borderWH);
-    rectMap[TF_BottomL] = QRectF(x1, y3, borderWH, borderWH);
-    rectMap[TF_Left] = QRectF(x1, y2, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_TopL]] = QRectF(x1, y1, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_Top]] = QRectF(x2, y1, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_TopR]] = QRectF(x3, y1, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_Right]] = QRectF(x3, y2, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_BottomR]] = QRectF(x3, y3, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_Bottom]] = QRectF(x2, y3, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_BottomL]] = QRectF(x1, y3, borderWH, borderWH);
+    m_handleRects[handleSlot[TF_Left]] = QRectF(x1, y2, borderWH, borderWH);
+
+    // 连接点在边框外 15 像素
+    x1 = -15;
+    x3 = m_grapSize.width() - m_border * 2 + 15;
+    y1 = -15;
+    y3 = m_grapSize.height() - m_border * 2+15;
+
+    m_portRects[portSlot[TF_Top]] = QRectF(x2, y1, borderWH, borderWH);
+    m_portRects[portSlot[TF_Right]] = QRectF(x3, y2, borderWH, borderWH);
+    m_portRects[portSlot[TF_Left]] = QRectF(x1, y2, borderWH, borderWH);
+    m_portRects[portSlot[TF_Bottom]] = QRectF(x2, y3, borderWH, borderWH);
+}
+
+QRectF DiagramItem::frameRect() const
+{
+    return handleRect(TF_TopL).united(handleRect(TF_BottomR));
+}
 
-    return rectMap;
+const QRectF &DiagramItem::handleRect(TransformState state) const
+{
+    const int slot = uint(state) < 11 ? handleSlot[state] : -1;
+    return slot < 0 ? noRect : m_handleRects[slot];
+}
+
+const QRectF &DiagramItem::portRect(TransformState state) const
+{
+    const int slot = uint(state) < 11 ? portSlot[state] : -1;
+    return slot < 0 ? noRect : m_portRects[slot];
+}
+
+DiagramItem::TransformState DiagramItem::handleAt(const QPointF &pos) const
+{
+    for (int i = HandleCount - 1; i >= 0; --i) {
+        if (m_handleRects[i].contains(pos))
+            return handleStates[i];
+    }
+    return TF_Cen;
+}
+
+DiagramItem::TransformState DiagramItem::portAt(const QPointF &pos) const
+{
+    for (int i = PortCount - 1; i >= 0; --i) {
+        if (m_portRects[i].contains(pos))
+            return portStates[i];
+    }
+    return TF_Cen;
 }
 
 void DiagramItem::setRotationAngle(qreal angle)
 {
+    // 旋转会改变 boundingRect
+    prepareGeometryChange();
     // 设置旋转角度
     m_rotationAngle = angle;
+    m_renderGeneration = ItemRenderCache::nextGeneration();
+    centerLabel();
 
     // 重新绘制图元
     update();  // 调用 update() 以重新绘制图元，使其反映新的旋转角度
+    sceneGeometryChanged();
 }
 
 qreal DiagramItem::rotationAngle() const
@@ -842,37 +672,31 @@ qreal DiagramItem::rotationAngle() const
 }
 
 void DiagramItem::setSize(QSizeF size){
-    m_grapSize = size;
+    prepareGeometryChange();
+    applySize(size);
+    sceneGeometryChanged();
 }
 
 void DiagramItem::setWidth(qreal width){
-    m_grapSize.setWidth(width);
+    prepareGeometryChange();
+    applySize(QSizeF(width, m_grapSize.height()));
+    sceneGeometryChanged();
 }
 
 void DiagramItem::setHeight(qreal height){
-    m_grapSize.setHeight(height);
+    prepareGeometryChange();
+    applySize(QSizeF(m_grapSize.width(), height));
+    sceneGeometryChanged();
 }
 
 QSizeF DiagramItem::getSize(){
     return m_grapSize;
 }
 
-QMap<DiagramItem::TransformState, QRectF> DiagramItem :: linkWhere(){
-    static QMap<TransformState, QRectF> linkMap;
-
-    int x1 = -15;
-    int x2 = m_grapSize.width() / 2 - m_border;
-    int x3 = m_grapSize.width() - m_border * 2 + 15;
-    int y1 = -15;
-    int y2 = m_grapSize.height() / 2 - m_border;
-    int y3 = m_grapSize.height() - m_border * 2+15;
-    qreal borderWH = m_border * 2 / transform().m11();
-
-    linkMap[TF_Top] = QRectF(x2, y1, borderWH, borderWH);
-    linkMap[TF_Right] = QRectF(x3, y2, borderWH, borderWH);
-    linkMap[TF_Left] = QRectF(x1, y2, borderWH, borderWH);
-    linkMap[TF_Bottom] = QRectF(x2, y3, borderWH, borderWH);
-
+QMap<DiagramItem::TransformState, QRectF> DiagramItem :: linkWhere() const {
+    QMap<TransformState, QRectF> linkMap;
+    for (int i = 0; i < PortCount; ++i)
+        linkMap.insert(portStates[i], m_portRects[i]);
     return linkMap;
 }
 
@@ -882,7 +706,23 @@ void DiagramItem::addPathes(DiagramPath *path){
 
 void DiagramItem::updatePathes()
 {
+    // 在 DiagramScene 中只标记为脏，由场景在下一次绘制前统一重算，同一连线每帧最多重算一次
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene())) {
+        for (DiagramPath *path : std::as_const(pathes))
+            diagramScene->markPathDirty(path);
+        return;
+    }
     for (DiagramPath *path : std::as_const(pathes)){
         path->updatePath();
     }
 }
+
+void DiagramItem::sceneGeometryChanged()
+{
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+        diagramScene->updateItemIndex(this);
+    updatePathes();
+    // 箭头只在端点几何变化时重算，绘制时不再求交
+    for (Arrow *arrow : std::as_const(arrows))
+        arrow->updatePosition();
+}
@@ -8,6 +8,9 @@
 #include <QList>
 #include<QBrush>
 #include <QJsonObject>
+#include <QSharedPointer>
+#include <QStaticText>
+#include <QFont>
 
 
 
@@ -21,6 +24,8 @@ QT_END_NAMESPACE
 
 class Arrow;
 class DiagramPath;
+class DiagramTextItem;
+struct ShapeGeometry;
 
 //! [0]
 class DiagramItem : public QGraphicsItem
@@ -46,7 +51,9 @@ public:
                        ManualInput,PerforatedTape,Display,Preparation,
                        ManualOperation,ParallelMode,Hexagon};
     DiagramType myDiagramType;
-    DiagramItem(DiagramType diagramType, QMenu *contextMenu, QGraphicsItem *parent = nullptr);
+    // 不需要右键菜单时（模型导入、测试、基准）contextMenu 可以为空
+    explicit DiagramItem(DiagramType diagramType, QMenu *contextMenu = nullptr, QGraphicsItem *parent = nullptr);
+    ~DiagramItem();
     QRectF boundingRect() const override; //重写boundingRect（）虚函数
     void setBrush(QColor &color);
 
@@ -54,7 +61,8 @@ public:
     void removeArrows();
 
     DiagramType diagramType() const { return myDiagramType; }
-    QPolygonF polygon() const { return myPolygon; }
+    QPolygonF polygon() const;           // 填充多边形（来自共享的几何缓存）
+    QPainterPath outlineShape() const;   // 图形轮廓围成的区域
     void addArrow(Arrow *arrow);
 
     QPixmap image() const;
@@ -63,11 +71,9 @@ public:
     void setBrush(QBrush *brush);
     void setFixedSize(const QSizeF &size);
     QColor m_color;
-    QColor text_color;
-    QString textContent ="请输入";
-    QGraphicsTextItem *textItem;  // 添加文本框作为成员变量
     QList<DiagramPath *> pathes;
-    QMap<DiagramPath*,QString> marks;
+    int graphNode = -1;   // 在所属场景拓扑图中的节点编号，不在场景中为 -1
+    int journalKey = -1;  // 在所属场景工程日志中的键，尚未写入日志为 -1
 
     void setRotationAngle(qreal angle);  // 设置旋转角度
     qreal rotationAngle() const;         // 获取当前旋转角度
@@ -80,14 +86,36 @@ public:
     void disableEvents();
     void removePath(DiagramPath *path);
     void removePathes();
-    QMap<TransformState, QRectF> rectWhere(); //绘制点
-    QMap<TransformState,QRectF> linkWhere(); // 绘制连接点
+    QMap<TransformState, QRectF> rectWhere() const; //绘制点
+    QMap<TransformState,QRectF> linkWhere() const; // 绘制连接点
 
-    bool showLink=false;
+    // 控制点与连接点矩形（图元坐标），只在尺寸或变换改变时重算，读取和命中测试不分配内存
+    const QRectF &handleRect(TransformState state) const;
+    const QRectF &portRect(TransformState state) const;
+    TransformState handleAt(const QPointF &pos) const;   // 命中的控制点，未命中返回 TF_Cen
+    TransformState portAt(const QPointF &pos) const;     // 命中的连接点，未命中返回 TF_Cen
+    QRectF frameRect() const;   // 控制点围成的外框（图元坐标），连线避让时作为障碍物
 
     void addPathes(DiagramPath *path);
     void updatePathes();
 
+    // 文字、字体、颜色保存在图元上，平时用 QStaticText 画在图元里；
+    // 双击时才创建文本框编辑，编辑结束后销毁
+    QString labelText() const { return m_labelText; }
+    void setLabelText(const QString &text);
+    QFont labelFont() const { return m_labelFont; }
+    void setLabelFont(const QFont &font);
+    QColor labelColor() const { return m_labelColor; }
+    void setLabelColor(const QColor &color);
+    void beginLabelEdit();
+    void endLabelEdit();
+    bool isEditingLabel() const { return m_labelEditor != nullptr; }
+    DiagramTextItem *labelEditor() const { return m_labelEditor; }   // 编辑期间的文本框，其余时间为空
+
+    // 选中边框和控制点（图元坐标）；缓存绘制模式下由场景覆盖层调用
+    void paintHandles(QPainter *painter);
+    quint64 renderGeneration() const { return m_renderGeneration; }
+
 
 protected:
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
@@ -95,14 +123,28 @@ protected:
     void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override; //重载悬停函数
 
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override; //重载移动函数
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override; // 双击编辑文字
 
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                QWidget *) override; // 重载绘画函数
 
 
 private:
+    void sceneGeometryChanged();   // 通知场景刷新该图元的索引
+    void applySize(const QSizeF &size);   // 按类型换算尺寸并更新共享几何
+    QRectF frameBounds() const;           // 图形（含控制点边距、旋转）的外框，不含超出的文字
+    void centerLabel();                   // 文字居中，只在尺寸、文字、字体变化时调用
+    void labelChanged();                  // 文字、字体或颜色变化：重建静态文本，通知场景
+    void refreshLabel();                  // 按需重建静态文本
+    void paintLabel(QPainter *painter, qreal lod);
+    void paintBody(QPainter *painter);    // 图形主体，不含控制点
+    void updateHandleGeometry();          // 重算控制点与连接点矩形
+    void setHoverCursor(Qt::CursorShape shape);
+
     qreal m_rotationAngle;  // 用于存储当前图元的旋转角度
-    QPolygonF myPolygon;
+    QSharedPointer<const ShapeGeometry> m_geometry;  // 当前类型与尺寸对应的几何，paint() 只读
+    quint64 m_renderGeneration = 0;   // 外观代号，变化后位图缓存不再命中
+    QColor m_renderColor;             // 生成当前代号时的填充色（m_color 可被外部直接修改）
     QMenu *myContextMenu;
     QList<Arrow *> arrows;
 
@@ -110,6 +152,20 @@ private:
     QSizeF m_grapSize;   //boundingrect尺寸
     QSizeF m_minSize;    //最小尺寸
 
+    enum { HandleCount = 8, PortCount = 4 };
+    QRectF m_handleRects[HandleCount];   // 8 个缩放控制点
+    QRectF m_portRects[PortCount];       // 4 个连接点
+
+    QString m_labelText = QStringLiteral("请输入");
+    QFont m_labelFont;
+    QColor m_labelColor = Qt::black;
+    QStaticText m_label;          // 非编辑状态下绘制的文字
+    bool m_labelDirty = true;     // 文字、字体或颜色变化后需要重建 m_label
+    QPointF m_labelPos;           // 文字左上角（图元坐标）
+    QRectF m_labelRect;           // 文字连同页边距占据的区域（图元坐标），与文本框一致
+    bool m_labelFits = true;      // 文字是否在图形外框内，超出时 boundingRect 把它包括进来
+    DiagramTextItem *m_labelEditor = nullptr;
+
     bool isHover=true;
     bool isChange=true;
 
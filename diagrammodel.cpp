@@ -0,0 +1,267 @@
+#include "diagrammodel.h"
+
+#include <QDataStream>
+#include <QTextStream>
+
+// 与 DiagramItem 的枚举保持一致；模型不依赖图元头文件
+static const int diagramTypeCount = 20;   // DiagramItem::DiagramType 的个数
+
+static bool isPortState(int port)
+{
+    // 只有上下左右四个连接点（TF_Top / TF_Bottom / TF_Left / TF_Right）
+    return port == 0x08 || port == 0x04 || port == 0x02 || port == 0x01;
+}
+
+void DiagramModel::clear()
+{
+    types.clear();
+    positions.clear();
+    sizes.clear();
+    fills.clear();
+    texts.clear();
+    textStyles.clear();
+    styles.clear();
+    connectors.clear();
+}
+
+void DiagramModel::reserve(int nodes, int connectorCount)
+{
+    types.reserve(nodes);
+    positions.reserve(nodes);
+    sizes.reserve(nodes);
+    fills.reserve(nodes);
+    texts.reserve(nodes);
+    textStyles.reserve(nodes);
+    connectors.reserve(connectorCount);
+}
+
+int DiagramModel::styleIndex(const TextStyle &style)
+{
+    // 一张图里的文字样式通常只有几种，线性查找即可
+    const qsizetype index = styles.indexOf(style);
+    if (index >= 0)
+        return int(index);
+    styles.append(style);
+    return styles.size() - 1;
+}
+
+int DiagramModel::addNode(const Node &node)
+{
+    types.append(qint8(node.type));
+    positions.append(node.pos);
+    sizes.append(node.size);
+    fills.append(node.fill);
+    texts.append(node.text);
+    textStyles.append(styleIndex(node.style));
+    return types.size() - 1;
+}
+
+void DiagramModel::addConnector(const Connector &connector)
+{
+    connectors.append(connector);
+}
+
+void DiagramModel::setNode(int index, const Node &node)
+{
+    types[index] = qint8(node.type);
+    positions[index] = node.pos;
+    sizes[index] = node.size;
+    fills[index] = node.fill;
+    texts[index] = node.text;
+    textStyles[index] = styleIndex(node.style);
+}
+
+void DiagramModel::setConnector(int index, const Connector &connector)
+{
+    connectors[index] = connector;
+}
+
+DiagramModel::Node DiagramModel::node(int index) const
+{
+    Node node;
+    node.type = types.at(index);
+    node.pos = positions.at(index);
+    node.size = sizes.at(index);
+    node.fill = fills.at(index);
+    node.text = texts.at(index);
+    node.style = styles.at(textStyles.at(index));
+    return node;
+}
+
+QList<int> DiagramModel::find(const QString &text, Qt::CaseSensitivity cs) const
+{
+    QList<int> hits;
+    for (int i = 0; i < texts.size(); ++i) {
+        if (texts.at(i).contains(text, cs))
+            hits.append(i);
+    }
+    return hits;
+}
+
+QStringList DiagramModel::validate() const
+{
+    QStringList problems;
+    for (int i = 0; i < types.size(); ++i) {
+        if (types.at(i) < 0 || types.at(i) >= diagramTypeCount)
+            problems.append(QStringLiteral("图元 %1 的类型 %2 无效").arg(i).arg(int(types.at(i))));
+        if (sizes.at(i).width() <= 0 || sizes.at(i).height() <= 0)
+            problems.append(QStringLiteral("图元 %1 的尺寸无效").arg(i));
+    }
+    for (int i = 0; i < connectors.size(); ++i) {
+        const Connector &c = connectors.at(i);
+        if (c.from < 0 || c.from >= types.size() || c.to < 0 || c.to >= types.size())
+            problems.append(QStringLiteral("连线 %1 的端点图元不存在").arg(i));
+        if (!isPortState(c.fromPort) || !isPortState(c.toPort))
+            problems.append(QStringLiteral("连线 %1 的连接点无效").arg(i));
+    }
+    return problems;
+}
+
+// 颜色按 r b g a 的顺序写入，与旧版本的工程文件一致
+static void writeColor(QTextStream &out, QRgb rgb)
+{
+    out << qRed(rgb) << " " << qBlue(rgb) << " " << qGreen(rgb) << " " << qAlpha(rgb) << " ";
+}
+
+static QRgb readColor(QTextStream &in)
+{
+    int r = 0, b = 0, g = 0, a = 0;
+    in >> r >> b >> g >> a;
+    return qRgba(r, g, b, a);
+}
+
+void DiagramModel::writeText(QTextStream &out) const
+{
+    out << "DT_Size_" << types.size() << "\n";
+    for (int i = 0; i < types.size(); ++i) {
+        const TextStyle &style = styles.at(textStyles.at(i));
+        // 坐标和尺寸按整数保存；第五列是旧格式里的保留字段，写入图形类型
+        out << int(positions.at(i).x()) << " "
+            << int(positions.at(i).y()) << " "
+            << int(sizes.at(i).width()) << " "
+            << int(sizes.at(i).height()) << " "
+            << int(types.at(i)) << " ";
+        writeColor(out, fills.at(i));
+        // 文字以空白分隔，空格替换为星号
+        out << QString(texts.at(i)).replace(" ", "*") << " "
+            << int(types.at(i)) << " "
+            << QString(style.family).replace(" ", "*") << " "
+            << style.pointSize << " "
+            << int(style.bold) << " "
+            << int(style.italic) << " ";
+        writeColor(out, style.color);
+        out << "\n";
+    }
+    // 没有连线时不写 LN 段
+    if (connectors.isEmpty())
+        return;
+    out << "LN_Size_" << connectors.size() << "\n";
+    for (const Connector &c : connectors) {
+        // 文件中的图元编号从 1 开始
+        out << c.from + 1 << " " << c.fromPort << " " << c.to + 1 << " " << c.toPort << "\n";
+    }
+}
+
+static bool readFlag(QTextStream &in)
+{
+    QString value;
+    in >> value;
+    return value == QLatin1String("1") || value == QLatin1String("true");
+}
+
+bool DiagramModel::readText(QTextStream &in, QString *error)
+{
+    clear();
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    QString sizeString;
+    in >> sizeString;
+    if (!sizeString.startsWith("DT_Size_"))
+        return fail(QStringLiteral("缺少 DT_Size_ 段"));
+    const int nodeTotal = sizeString.mid(8).toInt();
+    reserve(nodeTotal, 0);
+    for (int i = 0; i < nodeTotal; ++i) {
+        Node node;
+        int x = 0, y = 0, width = 0, height = 0, reserved = 0;
+        in >> x >> y >> width >> height >> reserved;
+        node.pos = QPointF(x, y);
+        node.size = QSizeF(width, height);
+        node.fill = readColor(in);
+        in >> node.text;
+        node.text.replace("*", " ");
+        in >> node.type;
+        in >> node.style.family;
+        node.style.family.replace("*", " ");
+        in >> node.style.pointSize;
+        node.style.bold = readFlag(in);
+        node.style.italic = readFlag(in);
+        node.style.color = readColor(in);
+        if (in.status() != QTextStream::Ok)
+            return fail(QStringLiteral("第 %1 个图元数据不完整").arg(i + 1));
+        addNode(node);
+    }
+
+    in >> sizeString;
+    if (sizeString.isEmpty())
+        return true;   // 没有连线
+    if (!sizeString.startsWith("LN_Size_"))
+        return fail(QStringLiteral("缺少 LN_Size_ 段"));
+    const int connectorTotal = sizeString.mid(8).toInt();
+    connectors.reserve(connectorTotal);
+    for (int i = 0; i < connectorTotal; ++i) {
+        Connector c;
+        in >> c.from >> c.fromPort >> c.to >> c.toPort;
+        if (in.status() != QTextStream::Ok)
+            return fail(QStringLiteral("第 %1 条连线数据不完整").arg(i + 1));
+        --c.from;
+        --c.to;
+        connectors.append(c);
+    }
+    return true;
+}
+
+QDataStream &operator<<(QDataStream &out, const DiagramModel &model)
+{
+    out << qint32(model.types.size());
+    for (int i = 0; i < model.types.size(); ++i) {
+        const DiagramModel::TextStyle &style = model.styles.at(model.textStyles.at(i));
+        out << qint32(model.types.at(i)) << model.positions.at(i) << model.sizes.at(i)
+            << quint32(model.fills.at(i)) << model.texts.at(i)
+            << style.family << qint32(style.pointSize) << style.bold << style.italic << quint32(style.color);
+    }
+    out << qint32(model.connectors.size());
+    for (const DiagramModel::Connector &c : model.connectors)
+        out << qint32(c.from) << qint32(c.to) << qint32(c.fromPort) << qint32(c.toPort);
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, DiagramModel &model)
+{
+    model.clear();
+    qint32 nodeTotal = 0;
+    in >> nodeTotal;
+    for (qint32 i = 0; i < nodeTotal && in.status() == QDataStream::Ok; ++i) {
+        DiagramModel::Node node;
+        qint32 type = 0, pointSize = 0;
+        quint32 fill = 0, color = 0;
+        in >> type >> node.pos >> node.size >> fill >> node.text
+           >> node.style.family >> pointSize >> node.style.bold >> node.style.italic >> color;
+        node.type = type;
+        node.fill = fill;
+        node.style.pointSize = pointSize;
+        node.style.color = color;
+        model.addNode(node);
+    }
+    qint32 connectorTotal = 0;
+    in >> connectorTotal;
+    for (qint32 i = 0; i < connectorTotal && in.status() == QDataStream::Ok; ++i) {
+        qint32 from = 0, to = 0, fromPort = 0, toPort = 0;
+        in >> from >> to >> fromPort >> toPort;
+        model.connectors.append(DiagramModel::Connector{ from, to, fromPort, toPort });
+    }
+    return in;
+}
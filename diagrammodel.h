@@ -0,0 +1,103 @@
+#ifndef DIAGRAMMODEL_H
+#define DIAGRAMMODEL_H
+
+#include <QList>
+#include <QPointF>
+#include <QRgb>
+#include <QSizeF>
+#include <QString>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QDataStream;
+class QTextStream;
+QT_END_NAMESPACE
+
+// 无界面的文档模型
+// 图元、连线、文字和文字样式按列存放在连续数组里，只依赖 QtCore / QtGui 的值类型，
+// 不需要 QApplication，也可以在工作线程里读写、校验和搜索。
+// 场景是它的视图：DiagramScene::toModel 从图元取出模型，DiagramScene::addModel 按模型创建图元
+class DiagramModel
+{
+public:
+    struct TextStyle {
+        QString family;
+        int pointSize = -1;
+        bool bold = false;
+        bool italic = false;
+        QRgb color = 0xff000000;
+
+        bool operator==(const TextStyle &other) const
+        {
+            return family == other.family && pointSize == other.pointSize && bold == other.bold
+                   && italic == other.italic && color == other.color;
+        }
+    };
+    struct Node {
+        int type = 0;          // DiagramItem::DiagramType
+        QPointF pos;           // 场景坐标
+        QSizeF size;           // 图形尺寸（不含控制点边框）
+        QRgb fill = 0xffffffff;
+        QString text;
+        TextStyle style;
+        bool operator==(const Node &other) const
+        {
+            return type == other.type && pos == other.pos && size == other.size && fill == other.fill
+                   && text == other.text && style == other.style;
+        }
+    };
+    struct Connector {
+        int from = -1;         // 起点图元下标
+        int to = -1;           // 终点图元下标
+        int fromPort = 0;      // DiagramItem::TransformState
+        int toPort = 0;
+    };
+
+    void clear();
+    void reserve(int nodes, int connectors);
+
+    int addNode(const Node &node);   // 返回图元下标
+    void addConnector(const Connector &connector);
+    void setNode(int index, const Node &node);   // 整体替换，样式仍按值去重
+    void setConnector(int index, const Connector &connector);
+
+    int nodeCount() const { return types.size(); }
+    int connectorCount() const { return connectors.size(); }
+    int styleCount() const { return styles.size(); }   // 不同文字样式的个数，相同样式只存一份
+    Node node(int index) const;
+    int nodeType(int index) const { return types.at(index); }
+    QPointF nodePos(int index) const { return positions.at(index); }
+    QSizeF nodeSize(int index) const { return sizes.at(index); }
+    const QString &nodeText(int index) const { return texts.at(index); }
+    const Connector &connector(int index) const { return connectors.at(index); }
+
+    // 文字包含 text 的图元下标，按下标顺序
+    QList<int> find(const QString &text, Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    // 检查连线端点下标、连接点方位和图形类型，返回问题描述，为空表示模型完整
+    QStringList validate() const;
+
+    // .fcproj 文本格式（DT_Size_ / LN_Size_ 两段，空格写成 *）
+    // 打开工程时用 FcprojTextReader 读取，readText 保留作参照实现
+    void writeText(QTextStream &out) const;
+    bool readText(QTextStream &in, QString *error = nullptr);
+
+    // 剪贴板等进程内传递用的二进制格式
+    friend QDataStream &operator<<(QDataStream &out, const DiagramModel &model);
+    friend QDataStream &operator>>(QDataStream &in, DiagramModel &model);
+    friend class ProjectFile;   // .fcproj 第 2 版直接读写各列
+
+private:
+    int styleIndex(const TextStyle &style);
+
+    // 按列存放：遍历某一属性时只触及这一列
+    QList<qint8> types;
+    QList<QPointF> positions;
+    QList<QSizeF> sizes;
+    QList<QRgb> fills;
+    QList<QString> texts;
+    QList<int> textStyles;         // 下标指向 styles
+    QList<TextStyle> styles;
+    QList<Connector> connectors;
+};
+
+#endif // DIAGRAMMODEL_H
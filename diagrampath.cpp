@@ -1,5 +1,8 @@
 #include "diagrampath.h"
+#include "diagramscene.h"
+#include "levelofdetail.h"
 #include<QPainterPath>
+#include <QPainter>
 
 
 DiagramPath::DiagramPath(DiagramItem *startItem,DiagramItem *endItem,
@@ -9,69 +12,186 @@ DiagramPath::DiagramPath(DiagramItem *startItem,DiagramItem *endItem,
     endItem(endItem),startState(startState),endState(endState)
 {
     setFlag(QGraphicsItem::ItemIsSelectable,true);
-    QPointF startpoint = startItem->mapToScene(startItem->linkWhere()[startState].center());
-    QPointF endpoint = endItem->mapToScene(endItem->linkWhere()[endState].center());
-
-    m_quad = quad(startpoint,endpoint);
+}
 
-    m_state = startState*100+endState*10+m_quad;
+DiagramPath::~DiagramPath()
+{
+    // 直接 delete 时从场景的待重算集合中移除，避免刷新时访问已释放的连线
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+        diagramScene->removeDirtyPath(this);
+    // 从仍存在的端点图元注销，图元不再持有悬空的连线指针
+    if (startItem)
+        startItem->removePath(this);
+    if (endItem)
+        endItem->removePath(this);
 }
 
-void DiagramPath::updatePath(){
+void DiagramPath::detachItem(DiagramItem *item)
+{
+    if (startItem == item)
+        startItem = nullptr;
+    if (endItem == item)
+        endItem = nullptr;
+    // 图元析构时已把路由区域内的连线标记为待重算，悬空的连线不再参与
+    if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+        diagramScene->pathDetached(this);
+}
 
-    QPointF startpoint = startItem->mapToScene(startItem->linkWhere()[startState].center());
-    QPointF endpoint = endItem->mapToScene(endItem->linkWhere()[endState].center());
+QVariant DiagramPath::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == QGraphicsItem::ItemSceneChange) {
+        if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+            diagramScene->removeDirtyPath(this);
+    } else if (change == QGraphicsItem::ItemSceneHasChanged) {
+        // 进入场景时登记到拓扑图，并按场景设置切换批量绘制
+        if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene())) {
+            diagramScene->addGraphEdge(this);
+            diagramScene->updateConnector(this);
+        }
+    } else if (change == QGraphicsItem::ItemSelectedHasChanged && m_batched) {
+        // 批量模式下选中框由连线层绘制
+        if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+            diagramScene->updateConnector(this);
+    }
+    return QGraphicsPathItem::itemChange(change, value);
+}
 
-    QPointF startRectPoint = startItem->mapToScene(startItem->rectWhere()[startState].center());
-    QPointF endRectPoint = endItem->mapToScene(endItem->rectWhere()[endState].center());
+void DiagramPath::updatePath(){
+    if (detached())
+        return;
+    const Endpoints ends = endpoints();
+    QList<QPointF> route;
+    DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene());
+    if (diagramScene && diagramScene->pathRouting() == DiagramScene::OrthogonalRouting)
+        route = diagramScene->routePath(this, routeRequest(ends));
+    applyGeometry(buildGeometry(ends, route));
+}
 
-    m_quad = quad(startpoint,endpoint);
+DiagramPath::Endpoints DiagramPath::endpoints() const
+{
+    Endpoints ends;
+    if (startItem) {
+        ends.startPort = startItem->mapToScene(startItem->portRect(startState).center());
+        ends.startHandle = startItem->mapToScene(startItem->handleRect(startState).center());
+    }
+    if (endItem) {
+        ends.endPort = endItem->mapToScene(endItem->portRect(endState).center());
+        ends.endHandle = endItem->mapToScene(endItem->handleRect(endState).center());
+    }
+    ends.startState = startState;
+    ends.endState = endState;
+    return ends;
+}
 
-    m_state = startState*100+endState*10+m_quad;
-    // QPainterPath m_path;
-    m_path.clear();
+DiagramPath::Geometry DiagramPath::buildGeometry(const Endpoints &ends, const QList<QPointF> &route)
+{
+    Geometry geometry;
+    QPainterPath &path = geometry.path;
+    path.moveTo(ends.startHandle);
+    path.lineTo(ends.startPort);
+    if (route.size() >= 2) {
+        // 首尾就是两个连接点
+        for (int i = 1; i < route.size() - 1; ++i)
+            path.lineTo(route.at(i));
+    } else {
+        const int state = ends.startState*100+ends.endState*10+quad(ends.startPort,ends.endPort);
+        drawZig(path,state,ends.startPort,ends.endPort);
+    }
+    path.lineTo(ends.endPort);
+    path.lineTo(ends.endHandle);
+    geometry.body = path;
 
-    m_path.moveTo(startRectPoint);
-    m_path.lineTo(startpoint);
-    drawZig(startpoint,endpoint);
-    m_path.lineTo(endpoint);
-    m_path.lineTo(endRectPoint);
+    drawHead(path,ends.endPort,ends.endHandle);
+    return geometry;
+}
 
+void DiagramPath::applyGeometry(const Geometry &geometry)
+{
+    m_path = geometry.path;
+    m_bodyPath = geometry.body;
+    setPath(m_path);
+    if (m_batched) {
+        if (DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene()))
+            diagramScene->updateConnector(this);
+    }
+}
 
-    drawHead(endpoint,endRectPoint);
+void DiagramPath::setBatched(bool batched)
+{
+    if (batched == m_batched)
+        return;
+    prepareGeometryChange();
+    m_batched = batched;
+    setFlag(QGraphicsItem::ItemHasNoContents, batched);
+}
 
+QRectF DiagramPath::boundingRect() const
+{
+    return m_batched ? QRectF() : QGraphicsPathItem::boundingRect();
+}
 
+QPainterPath DiagramPath::shape() const
+{
+    return m_batched ? QPainterPath() : QGraphicsPathItem::shape();
+}
 
-    // m_path = m_path;
-    setPath(m_path);
+void DiagramPath::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // 缩小时箭头只有一两个像素，只画主干，也不画选中虚框
+    if (LevelOfDetail::hiddenDecorations(LevelOfDetail::of(option, painter))) {
+        painter->setPen(pen());
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(m_bodyPath);
+        return;
+    }
+    QGraphicsPathItem::paint(painter, option, widget);
 }
 
-void DiagramPath::drawHead(QPointF endpoint,QPointF endRectPoint){
+void DiagramPath::drawHead(QPainterPath &path,QPointF endpoint,QPointF endRectPoint){
     if(endpoint.y() == endRectPoint.y()){
         if(endpoint.x() > endRectPoint.x()){
-            m_path.lineTo(QPointF(endpoint.x()-5,endpoint.y()-5));
-            m_path.moveTo(endRectPoint);
-            m_path.lineTo(QPointF(endpoint.x()-5,endpoint.y()+5));
+            path.lineTo(QPointF(endpoint.x()-5,endpoint.y()-5));
+            path.moveTo(endRectPoint);
+            path.lineTo(QPointF(endpoint.x()-5,endpoint.y()+5));
         }
         else if(endpoint.x() < endRectPoint.x()){
-            m_path.lineTo(QPointF(endpoint.x()+5,endpoint.y()-5));
-            m_path.moveTo(endRectPoint);
-            m_path.lineTo(QPointF(endpoint.x()+5,endpoint.y()+5));
+            path.lineTo(QPointF(endpoint.x()+5,endpoint.y()-5));
+            path.moveTo(endRectPoint);
+            path.lineTo(QPointF(endpoint.x()+5,endpoint.y()+5));
         }
     }else if(endpoint.x() == endRectPoint.x()){
         if(endpoint.y() > endRectPoint.y()){
-            m_path.lineTo(QPointF(endpoint.x()-5,endpoint.y()-5));
-            m_path.moveTo(endRectPoint);
-            m_path.lineTo(QPointF(endpoint.x()+5,endpoint.y()-5));
+            path.lineTo(QPointF(endpoint.x()-5,endpoint.y()-5));
+            path.moveTo(endRectPoint);
+            path.lineTo(QPointF(endpoint.x()+5,endpoint.y()-5));
         }
         else if(endpoint.y()<endRectPoint.y()){
-            m_path.lineTo(QPointF(endpoint.x()-5,endpoint.y()+5));
-            m_path.moveTo(endRectPoint);
-            m_path.lineTo(QPointF(endpoint.x()+5,endpoint.y()+5));
+            path.lineTo(QPointF(endpoint.x()-5,endpoint.y()+5));
+            path.moveTo(endRectPoint);
+            path.lineTo(QPointF(endpoint.x()+5,endpoint.y()+5));
         }
     }
 }
 
+// 连接点相对控制点的方向即连线离开（进入）图元的方向，图元旋转后同样成立
+static OrthogonalRouter::Direction stubDirection(const QPointF &port, const QPointF &handle)
+{
+    const QPointF d = port - handle;
+    if (qAbs(d.x()) >= qAbs(d.y()))
+        return d.x() >= 0 ? OrthogonalRouter::East : OrthogonalRouter::West;
+    return d.y() >= 0 ? OrthogonalRouter::South : OrthogonalRouter::North;
+}
+
+OrthogonalRouter::Request DiagramPath::routeRequest(const Endpoints &ends)
+{
+    OrthogonalRouter::Request request;
+    request.start = ends.startPort;
+    request.startDir = stubDirection(ends.startPort, ends.startHandle);
+    request.end = ends.endPort;
+    request.endDir = stubDirection(ends.endPort, ends.endHandle);
+    return request;
+}
+
 int DiagramPath::quad(QPointF startPoint, QPointF endPoint)
 {
     if(startPoint.x()>=endPoint.x() && startPoint.y()>=endPoint.y()){
@@ -85,10 +205,10 @@ int DiagramPath::quad(QPointF startPoint, QPointF endPoint)
     }else{return 0;}
 }
 
-void DiagramPath::drawZig(QPointF startPoint,QPointF endPoint)
+void DiagramPath::drawZig(QPainterPath &path,int state,QPointF startPoint,QPointF endPoint)
 {
     QPointF midPoint((startPoint.x()+endPoint.x())/2,(startPoint.y()+endPoint.y())/2);
-    switch (m_state) {
+    switch (state) {
     case 882:
     case 883:
     case 811:
@@ -113,7 +233,7 @@ void DiagramPath::drawZig(QPointF startPoint,QPointF endPoint)
     case 244:
     case 223:
     case 224:
-        m_path.lineTo(QPointF(endPoint.x(),startPoint.y()));
+        path.lineTo(QPointF(endPoint.x(),startPoint.y()));
         break;
     case 881:
     case 884:
@@ -139,7 +259,7 @@ void DiagramPath::drawZig(QPointF startPoint,QPointF endPoint)
     case 243:
     case 221:
     case 222:
-        m_path.lineTo(startPoint.x(),endPoint.y());
+        path.lineTo(startPoint.x(),endPoint.y());
         break;
     case 842:
     case 843:
@@ -149,8 +269,8 @@ void DiagramPath::drawZig(QPointF startPoint,QPointF endPoint)
     case 484:
     case 213:
     case 214:{
-        m_path.lineTo(midPoint.x(),startPoint.y());
-        m_path.lineTo(midPoint.x(),endPoint.y());
+        path.lineTo(midPoint.x(),startPoint.y());
+        path.lineTo(midPoint.x(),endPoint.y());
         break;
     }
     case 841:
@@ -161,8 +281,8 @@ void DiagramPath::drawZig(QPointF startPoint,QPointF endPoint)
     case 483:
     case 211:
     case 212:{
-        m_path.lineTo(startPoint.x(),midPoint.y());
-        m_path.lineTo(endPoint.x(),midPoint.y());
+        path.lineTo(startPoint.x(),midPoint.y());
+        path.lineTo(endPoint.x(),midPoint.y());
         break;
     }
     default:
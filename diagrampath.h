@@ -4,28 +4,60 @@
 #include<QGraphicsPathItem>
 #include<diagramitem.h>
 #include<QPainterPath>
+#include "orthogonalrouter.h"
 
 class DiagramPath : public QGraphicsPathItem
 {
 public:
-    int start;
-    int end;
-    int startp;
-    int endp;
     enum { Type = UserType +20 };
+    int graphEdge = -1;   // 在所属场景拓扑图中的边编号，不在场景中为 -1
+    int journalKey = -1;  // 在所属场景工程日志中的键，尚未写入日志为 -1
 
 
     DiagramPath(DiagramItem *startItem,DiagramItem *endItem,
                 DiagramItem::TransformState startState,
                 DiagramItem::TransformState endState,QGraphicsItem *parent=nullptr);
 
+    ~DiagramPath();
     int type() const override { return Type; }
 
+    // 连线两端在场景中的位置（连接点与控制点中心），在 GUI 线程取出后可交给工作线程
+    struct Endpoints {
+        QPointF startPort;
+        QPointF startHandle;
+        QPointF endPort;
+        QPointF endHandle;
+        DiagramItem::TransformState startState = DiagramItem::TF_Cen;
+        DiagramItem::TransformState endState = DiagramItem::TF_Cen;
+    };
+    struct Geometry {
+        QPainterPath path;   // 含箭头
+        QPainterPath body;   // 不含箭头
+    };
+
     void updatePath();
+    Endpoints endpoints() const;   // 已析构的一端保持默认值，调用方先检查 detached()
+    // 由端点和正交折线（为空时套用固定折线）生成连线和箭头；不访问图元，可在任意线程调用
+    static Geometry buildGeometry(const Endpoints &ends, const QList<QPointF> &route);
+    static OrthogonalRouter::Request routeRequest(const Endpoints &ends);
+    void applyGeometry(const Geometry &geometry);   // 仅 GUI 线程
+    QPainterPath bodyPath() const { return m_bodyPath; }   // 不含箭头的连线主干
+    // 批量绘制：由场景的 ConnectorLayer 统一绘制和命中测试，自身不绘制、外框为空
+    void setBatched(bool batched);
+    bool isBatched() const { return m_batched; }
+    QRectF boundingRect() const override;
+    QPainterPath shape() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
     DiagramItem * getStartItem();
     DiagramItem * getEndItem();
+    void detachItem(DiagramItem *item);   // 端点图元析构时调用
+    bool detached() const { return !startItem || !endItem; }   // 有端点图元已析构，不再重算几何
+    DiagramItem::TransformState getStartState() const { return startState; }
+    DiagramItem::TransformState getEndState() const { return endState; }
 
 protected:
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
     DiagramItem *startItem;
@@ -39,13 +71,12 @@ private:
     // QPointF endRectPoint;
 
     QPainterPath m_path;
+    QPainterPath m_bodyPath;   // 缩小显示时只画主干
+    bool m_batched = false;
 
-    int m_quad;
-    int m_state;
-
-    void drawHead(QPointF endPoint,QPointF endRectPoint);
-    int quad(QPointF startPoint,QPointF endPoint);
-    void drawZig(QPointF startPoint,QPointF endPoint);
+    static void drawHead(QPainterPath &path,QPointF endPoint,QPointF endRectPoint);
+    static int quad(QPointF startPoint,QPointF endPoint);
+    static void drawZig(QPainterPath &path,int state,QPointF startPoint,QPointF endPoint);
 };
 
 #endif // DIAGRAMPATH_H
@@ -6,17 +6,34 @@
 #include "diagramitem.h"
 #include "qaction.h"
 #include "diagrampath.h"
+#include "virtualdiagram.h"
+#include "levelofdetail.h"
+#include "pathbatchrouter.h"
+#include "projectjournal.h"
 
 #include <QGraphicsSceneMouseEvent>
+#include <QGraphicsView>
 #include <QTextCursor>
 #include <QPainter>
-#include <QTimer>
+#include <QStyleOptionGraphicsItem>
+#include <QCoreApplication>
 
 //! [0]
 bool isInsertPath = false;
 
+// 脏连线刷新事件，以高优先级投递，保证在场景处理重绘区域之前执行
+static QEvent::Type pathFlushEventType()
+{
+    static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+    return type;
+}
+
+const qreal alignThreshold = 50;    // 对齐吸附的距离阈值
+const qreal portMagnet = 25;        // 连接点磁吸范围（以连接点为中心的方形半边长）
+const qreal connectorTolerance = 4; // 批量绘制时点选连线的距离容差
+
 DiagramScene::DiagramScene(QMenu *itemMenu, QObject *parent)
-    : QGraphicsScene(parent)
+    : QGraphicsScene(parent), overlay(this)
 {
     myItemMenu = itemMenu;
     myMode = MoveItem;
@@ -27,6 +44,15 @@ DiagramScene::DiagramScene(QMenu *itemMenu, QObject *parent)
     myTextColor = Qt::black;
     myLineColor = Qt::black;
 }
+
+DiagramScene::~DiagramScene()
+{
+    // 池中的图元不在场景里，基类析构不会删除
+    clearVirtualModel();
+    // 日志的写入任务不引用日志对象，不必等它们写完；基类析构删除图元时不再登记改动
+    delete projectJournal;
+    projectJournal = nullptr;
+}
 //! [0]
 //! [1]
 void DiagramScene::setLineColor(const QColor &color)
@@ -47,7 +73,11 @@ void DiagramScene::setTextColor(const QColor &color)
     if (isItemChange(DiagramTextItem::Type)) {
         DiagramTextItem *item = qgraphicsitem_cast<DiagramTextItem *>(selectedItems().first());
         item->setDefaultTextColor(myTextColor);
-        item->text_color = myTextColor;
+    }
+    // 图元文字平时没有文本框、无法单独选中，随所选图元一起修改
+    for (QGraphicsItem *selected : selectedItems()) {
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(selected))
+            diagramItem->setLabelColor(myTextColor);
     }
 }
 //! [2]
@@ -80,6 +110,10 @@ void DiagramScene::setFont(const QFont &font)
         if (item)
             item->setFont(myFont);
     }
+    for (QGraphicsItem *selected : selectedItems()) {
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(selected))
+            diagramItem->setLabelFont(myFont);
+    }
 }
 //! [4]
 
@@ -181,6 +215,7 @@ void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
             // Shift 键被按下，进入框选模式
             beginpoint = mouseEvent->scenePos();
             ischeckingbox = true;
+            marqueeHits.clear();
         } else {
             // 正常的图元移动逻辑
             movedItem = itemAt(mouseEvent->scenePos(), QTransform());  // 获取当前鼠标下的图元
@@ -195,10 +230,9 @@ void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
         break;
     case InsertPath:{
         setLinkVisible(true);
+        pathStartPort = ports.nearest(mouseEvent->scenePos(), portMagnet);
         pathLine = new QGraphicsLineItem(QLineF(mouseEvent->scenePos(),mouseEvent->scenePos()));
-        QPen *pen = new QPen(Qt::blue);
-        pen->setStyle(Qt::DashLine);
-        pathLine->setPen(*pen);
+        pathLine->setPen(QPen(Qt::blue, 1, Qt::DashLine));
         addItem(pathLine);}
     default:
         break;
@@ -206,6 +240,18 @@ void DiagramScene::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
 
     // 传递事件给父类进行处理
     QGraphicsScene::mousePressEvent(mouseEvent);
+
+    // 批量绘制的连线不参与场景命中测试，点在空白处时再到连线层查找
+    if (batchConnectors && myMode == MoveItem && !ischeckingbox && movedItem == nullptr) {
+        if (DiagramPath *path = connectors.pathAt(mouseEvent->scenePos(), connectorTolerance))
+            path->setSelected(true);
+    }
+
+    // 父类处理完点击后（可能清空了选择）再记录框选前的选择
+    if (ischeckingbox) {
+        const QList<QGraphicsItem *> selected = selectedItems();
+        marqueeBase = QSet<QGraphicsItem *>(selected.cbegin(), selected.cend());
+    }
 }
 //! [9]
 
@@ -216,20 +262,9 @@ void DiagramScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
         QLineF newLine(line->line().p1(), mouseEvent->scenePos());
         line->setLine(newLine);
     } else if (myMode == MoveItem) {
-        if (mouseEvent->modifiers() == Qt::ShiftModifier && ischeckingbox) {
-            // 框选逻辑，保持不变
-            endpoint = mouseEvent->scenePos();
-            qreal width = endpoint.rx() - beginpoint.rx();
-            qreal height = endpoint.ry() - beginpoint.ry();
-
-            if (!rectItem) {
-                QColor semiTransparentBlue(Qt::blue);
-                semiTransparentBlue.setAlpha(50);
-                rectItem = addRect(QRectF(beginpoint, QSizeF(width, height)), QPen(Qt::black, 1, Qt::DashLine), QBrush(semiTransparentBlue));
-            } else {
-                rectItem->setRect(QRectF(beginpoint, QSizeF(width, height)));
-            }
-            update();
+        if (ischeckingbox) {
+            // 框选：矩形画在前景层，选择随拖动实时更新
+            updateMarquee(mouseEvent->scenePos());
         }
         else {
             // 拖拽图元的逻辑
@@ -250,81 +285,69 @@ void DiagramScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 iscenterY = false;  // 清除 Y 方向中心对齐状态
                 alignedItem = nullptr;
 
-                QPointF newPosition = movedItem->pos();
                 QPointF suggestedPosition = movedItem->pos();  // 用来保存潜在的吸附位置，但不立即应用
 
-                // 遍历场景中的所有图元
-                foreach (QGraphicsItem *item, items()) {
-                    // 类型检查和排除当前正在移动的图元
-                    DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem*>(item);
-                    DiagramItem *diagramMovedItem = qgraphicsitem_cast<DiagramItem*>(movedItem);
-
-                    if (diagramItem != nullptr && diagramMovedItem != nullptr && diagramItem != diagramMovedItem) {
-                        QRectF movedRect = diagramMovedItem->sceneBoundingRect();
-                        QRectF itemRect = diagramItem->sceneBoundingRect();
-
-                        // 计算左边界的水平距离
-                        qreal x_distance = movedRect.left() - itemRect.left();
-                        // 计算顶边界的垂直距离
-                        qreal y_distance = movedRect.top() - itemRect.top();
-                        // 计算右边界的水平距离
-                        qreal right_distance = movedRect.right() - itemRect.right();
-                        // 计算底边界的垂直距离
-                        qreal bottom_distance = movedRect.bottom() - itemRect.bottom();
-                        // 计算中心对齐的水平距离（X 方向）
-                        qreal center_x_distance = movedRect.center().x() - itemRect.center().x();
-                        // 计算中心对齐的垂直距离（Y 方向）
-                        qreal center_y_distance = movedRect.center().y() - itemRect.center().y();
-
-                        // 检测水平对齐
-                        if (qAbs(x_distance) < 50) {
-                            isleft = true;  // 设置水平对齐标志
-                            alignedItem = item;
-                            // newPosition.setX(itemRect.left());  // 吸附到 x 轴
-                            suggestedPosition.setX(itemRect.left());  // 保存潜在的X坐标
-                            needAlignX = true;
-                        }
-
-                        // 检测垂直对齐
-                        if (qAbs(y_distance) < 50) {
-                            istop = true;   // 设置垂直对齐标志
-                            alignedItem = item;
-                            // newPosition.setY(itemRect.top());  // 吸附到 y 轴
-                            suggestedPosition.setY(itemRect.top());  // 保存潜在的Y坐标
-                            needAlignY = true;
-                        }
-
-                        // 检测右边界的水平对齐
-                        if (qAbs(right_distance) < 50) {
-                            isright = true;  // 新增：设置右边界对齐标志
-                            alignedItem = item;
-                            suggestedPosition.setX(itemRect.right() - movedRect.width());  // 吸附到右边界
-                            needAlignRight = true;
-                        }
-
-                        // 检测底边界的垂直对齐
-                        if (qAbs(bottom_distance) < 50) {
-                            isbottom = true;  // 新增：设置底边界对齐标志
-                            alignedItem = item;
-                            suggestedPosition.setY(itemRect.bottom() - movedRect.height());  // 吸附到底边界
-                            needAlignBottom = true;
-                        }
-
-                        // 检测中心对齐（X 方向）
-                        if (qAbs(center_x_distance) < 50) {
-                            iscenterX = true;  // 设置中心对齐标志
-                            alignedItem = item;
-                            // newPosition.setX(itemRect.center().x() - movedRect.width() / 2);  // 中心对齐吸附
-                            suggestedPosition.setX(itemRect.center().x() - movedRect.width() / 2 + 20);  // 保存潜在的中心对齐位置
-                            needAlignCenterX = true;
-                        }
-                        // 检测中心对齐（Y 方向）
-                        if (qAbs(center_y_distance) < 50) {
-                            iscenterY = true;  // 新增：设置中心对齐标志（Y 方向）
-                            alignedItem = item;
-                            suggestedPosition.setY(itemRect.center().y() - movedRect.height() / 2 + 20);  // 保存潜在的中心对齐位置（Y）
-                            needAlignCenterY = true;
-                        }
+                // 通过对齐索引查找每类边最近的候选图元，不再遍历场景中的所有图元
+                DiagramItem *diagramMovedItem = qgraphicsitem_cast<DiagramItem*>(movedItem);
+                if (diagramMovedItem != nullptr) {
+                    const QRectF movedRect = diagramMovedItem->sceneBoundingRect();
+                    const auto nearest = [&](AlignmentIndex::Edge edge) {
+                        return alignIndex.nearest(edge, AlignmentIndex::coordinate(movedRect, edge),
+                                                  alignThreshold, diagramMovedItem);
+                    };
+
+                    // 检测水平对齐（左边界）
+                    const AlignmentIndex::Candidate left = nearest(AlignmentIndex::Left);
+                    if (left.item) {
+                        isleft = true;  // 设置水平对齐标志
+                        alignedItem = left.item;
+                        suggestedPosition.setX(left.coordinate);  // 保存潜在的X坐标
+                        needAlignX = true;
+                    }
+
+                    // 检测垂直对齐（顶边界）
+                    const AlignmentIndex::Candidate top = nearest(AlignmentIndex::Top);
+                    if (top.item) {
+                        istop = true;   // 设置垂直对齐标志
+                        alignedItem = top.item;
+                        suggestedPosition.setY(top.coordinate);  // 保存潜在的Y坐标
+                        needAlignY = true;
+                    }
+
+                    // 检测右边界的水平对齐
+                    const AlignmentIndex::Candidate right = nearest(AlignmentIndex::Right);
+                    if (right.item) {
+                        isright = true;
+                        alignedItem = right.item;
+                        suggestedPosition.setX(right.coordinate - movedRect.width());  // 吸附到右边界
+                        needAlignRight = true;
+                    }
+
+                    // 检测底边界的垂直对齐
+                    const AlignmentIndex::Candidate bottom = nearest(AlignmentIndex::Bottom);
+                    if (bottom.item) {
+                        isbottom = true;
+                        alignedItem = bottom.item;
+                        suggestedPosition.setY(bottom.coordinate - movedRect.height());  // 吸附到底边界
+                        needAlignBottom = true;
+                    }
+
+                    // 检测中心对齐（X 方向）
+                    const AlignmentIndex::Candidate centerX = nearest(AlignmentIndex::CenterX);
+                    if (centerX.item) {
+                        iscenterX = true;
+                        alignedItem = centerX.item;
+                        suggestedPosition.setX(centerX.coordinate - movedRect.width() / 2 + 20);  // 保存潜在的中心对齐位置
+                        needAlignCenterX = true;
+                    }
+
+                    // 检测中心对齐（Y 方向）
+                    const AlignmentIndex::Candidate centerY = nearest(AlignmentIndex::CenterY);
+                    if (centerY.item) {
+                        iscenterY = true;
+                        alignedItem = centerY.item;
+                        suggestedPosition.setY(centerY.coordinate - movedRect.height() / 2 + 20);  // 保存潜在的中心对齐位置（Y）
+                        needAlignCenterY = true;
                     }
                 }
 
@@ -332,90 +355,128 @@ void DiagramScene::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
                 if (needAlignX || needAlignY || needAlignRight || needAlignBottom || needAlignCenterX || needAlignCenterY) {
                     // movedItem->setPos(newPosition);
                     alignPosition = suggestedPosition;  // 保存潜在的对齐位置，待 release 时处理
-                    update();  // 更新辅助线的绘制
                 }
             }
         }
         // 保留原有的鼠标移动事件逻辑
         QGraphicsScene::mouseMoveEvent(mouseEvent);
+        // 图元移动完成后再生成辅助线，覆盖层只重绘辅助线新旧位置
+        if (!ischeckingbox && movedItem && mouseEvent->buttons() & Qt::LeftButton)
+            updateAlignGuides();
     }else if(myMode == InsertPath && pathLine != nullptr){
         QLineF newLine(pathLine->line().p1(), mouseEvent->scenePos());
         pathLine->setLine(newLine);
+        // 实时高亮松开鼠标时会连接到的目标连接点
+        overlay.setHoverPort(pathStartPort.item ? ports.nearest(mouseEvent->scenePos(), portMagnet, pathStartPort.item)
+                                                : PortIndex::Port());
     }
 }
 //! [10]
-void DiagramScene::drawForeground(QPainter *painter, const QRectF &rect)
+void DiagramScene::drawBackground(QPainter *painter, const QRectF &rect)
 {
-    QPen pen;
-    pen.setStyle(Qt::DashLine);  // 使用虚线绘制辅助线
-    painter->setPen(pen);
+    QGraphicsScene::drawBackground(painter, rect);
+    // 连线在图元下层，批量绘制时画在背景之上、所有图元之前
+    if (batchConnectors) {
+        const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+        connectors.paint(painter, rect, lod);
+    }
+}
 
-    // 输出对齐辅助线的相关信息
-    if (movedItem != nullptr && alignedItem != nullptr) {
-        // 打印当前正在拖拽的图元的坐标
-        QRectF movedRect = movedItem->sceneBoundingRect();
-        // qDebug() << "正在拖拽的图元左边界: " << movedRect.left()
-        //          << ", 顶边: " << movedRect.top()
-        //          << ", 中心 X 坐标: " << movedRect.center().x()
-        //          << ", 宽度: " << movedRect.width()
-        //          << ", 高度: " << movedRect.height();
-
-        QRectF itemRect = alignedItem->sceneBoundingRect();  // 获取 alignedItem 的边界
-        // qDebug() << "对齐图元的左边界: " << itemRect.left()
-        //          << ", 顶边: " << itemRect.top()
-        //          << ", 中心 X 坐标: " << itemRect.center().x();
-
-        // qDebug() << "场景矩形的顶部: " << rect.top()
-        //          << ", 底部: " << rect.bottom()
-        //          << ", 左边: " << rect.left()
-        //          << ", 右边: " << rect.right();
-
-        // 如果需要绘制左边界垂直辅助线
-        if (isleft) {
-            // qDebug() << "正在绘制左边界垂直辅助线，x 位置: " << itemRect.left();
-            qreal topY = qMin(itemRect.top(), movedRect.top());  // 辅助线的顶部坐标
-            qreal bottomY = qMax(itemRect.bottom(), movedRect.bottom());  // 辅助线的底部坐标
-            painter->drawLine(itemRect.left()+6, topY - 20, itemRect.left()+6, bottomY + 20);
-        }
-        // 如果需要绘制右边界的垂直辅助线
-        if (isright) {
-            // qDebug() << "正在绘制右边界垂直辅助线，x 位置: " << itemRect.right();
-            // 辅助线长度为 alignedItem 和 movedItem 的 y 范围
-            qreal topY = qMin(itemRect.top(), movedRect.top());  // 辅助线的顶部坐标
-            qreal bottomY = qMax(itemRect.bottom(), movedRect.bottom());  // 辅助线的底部坐标
-            painter->drawLine(itemRect.right()-6, topY - 20, itemRect.right()-6, bottomY + 20);  // 绘制右边界辅助线
-        }
-        // 如果需要绘制顶边界的水平辅助线
-        if (istop) {
-            // qDebug() << "正在绘制顶边界垂直辅助线，y 位置: " << itemRect.top();
-            qreal leftX = qMin(itemRect.left(), movedRect.left());  // 辅助线的左侧坐标
-            qreal rightX = qMax(itemRect.right(), movedRect.right());  // 辅助线的右侧坐标
-            painter->drawLine(leftX - 20, itemRect.top()+6, rightX + 20, itemRect.top()+6);
-        }
-        // 如果需要绘制底边界的水平辅助线
-        if (isbottom) {
-            // qDebug() << "正在绘制底边界水平辅助线，y 位置: " << itemRect.bottom();
-            // 辅助线长度为 alignedItem 和 movedItem 的 x 范围
-            qreal leftX = qMin(itemRect.left(), movedRect.left());  // 辅助线的左侧坐标
-            qreal rightX = qMax(itemRect.right(), movedRect.right());  // 辅助线的右侧坐标
-            painter->drawLine(leftX- 20, itemRect.bottom()-6, rightX+ 20, itemRect.bottom()-6);  // 绘制底边界辅助线
-        }
-        // 如果需要绘制中心对齐的垂直辅助线（X 方向中心对齐）
-        if (iscenterX) {
-            // qDebug() << "正在绘制中心对齐的垂直辅助线，中心 X 坐标: " << itemRect.center().x();
-            qreal topY = qMin(itemRect.top(), movedRect.top());  // 辅助线的顶部坐标
-            qreal bottomY = qMax(itemRect.bottom(), movedRect.bottom());  // 辅助线的底部坐标
-            painter->drawLine(itemRect.center().x(), topY - 20, itemRect.center().x(), bottomY + 20);
+void DiagramScene::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    // 缓存模式下选中图元的控制点不进位图，在这里实时绘制
+    if (cacheRendering) {
+        const QList<QGraphicsItem *> selected = selectedItems();
+        for (QGraphicsItem *item : selected) {
+            DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item);
+            if (!diagramItem || !diagramItem->sceneBoundingRect().intersects(rect))
+                continue;
+            painter->save();
+            painter->setTransform(diagramItem->sceneTransform(), true);
+            const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+            if (!LevelOfDetail::hiddenDecorations(lod)) {
+                painter->setRenderHint(QPainter::Antialiasing);
+                diagramItem->paintHandles(painter);
+            }
+            painter->restore();
         }
+    }
+    overlay.paint(painter, rect, ports);
+}
 
-        // 如果需要绘制中心对齐的水平辅助线（Y 方向中心对齐）
-        if (iscenterY) {
-            // qDebug() << "正在绘制中心对齐的水平辅助线，中心 Y 坐标: " << itemRect.center().y();
-            qreal leftX = qMin(itemRect.left(), movedRect.left());  // 辅助线的左侧坐标
-            qreal rightX = qMax(itemRect.right(), movedRect.right());  // 辅助线的右侧坐标
-            painter->drawLine(leftX - 20, itemRect.center().y(), rightX + 20, itemRect.center().y());
-        }
+void DiagramScene::setCachedRendering(bool enabled)
+{
+    if (enabled == cacheRendering)
+        return;
+    cacheRendering = enabled;
+    if (!enabled)
+        itemCache.clear();
+    update();
+}
+
+void DiagramScene::setBatchedConnectors(bool enabled)
+{
+    if (enabled == batchConnectors)
+        return;
+    batchConnectors = enabled;
+    connectors.clear();
+    const QList<QGraphicsItem *> all = items();
+    for (QGraphicsItem *item : all) {
+        if (item->type() != DiagramPath::Type)
+            continue;
+        DiagramPath *path = static_cast<DiagramPath *>(item);
+        path->setBatched(enabled);
+        if (enabled)
+            connectors.update(path);
+    }
+    update();
+}
+
+void DiagramScene::updateConnector(DiagramPath *path)
+{
+    if (path->isBatched() != batchConnectors)
+        path->setBatched(batchConnectors);
+    if (!batchConnectors)
+        return;
+    if (bulkDepth > 0) {
+        // 路由完成后 applyGeometry 会再次调用，那时再放入连线层
+        dirtyPaths.insert(path);
+        return;
     }
+    const QRectF oldBounds = connectors.boundsOf(path);
+    connectors.update(path);
+    update(oldBounds.united(connectors.boundsOf(path)));
+}
+
+void DiagramScene::updateAlignGuides()
+{
+    QList<QLineF> guides;
+
+    if (movedItem != nullptr && alignedItem != nullptr) {
+        const QRectF movedRect = movedItem->sceneBoundingRect();
+        const QRectF itemRect = alignedItem->sceneBoundingRect();  // 获取 alignedItem 的边界
+
+        // 竖直辅助线的长度覆盖 alignedItem 和 movedItem 的 y 范围，水平辅助线覆盖 x 范围
+        const qreal topY = qMin(itemRect.top(), movedRect.top()) - 20;
+        const qreal bottomY = qMax(itemRect.bottom(), movedRect.bottom()) + 20;
+        const qreal leftX = qMin(itemRect.left(), movedRect.left()) - 20;
+        const qreal rightX = qMax(itemRect.right(), movedRect.right()) + 20;
+
+        if (isleft)     // 左边界垂直辅助线
+            guides.append(QLineF(itemRect.left()+6, topY, itemRect.left()+6, bottomY));
+        if (isright)    // 右边界垂直辅助线
+            guides.append(QLineF(itemRect.right()-6, topY, itemRect.right()-6, bottomY));
+        if (istop)      // 顶边界水平辅助线
+            guides.append(QLineF(leftX, itemRect.top()+6, rightX, itemRect.top()+6));
+        if (isbottom)   // 底边界水平辅助线
+            guides.append(QLineF(leftX, itemRect.bottom()-6, rightX, itemRect.bottom()-6));
+        if (iscenterX)  // X 方向中心对齐的垂直辅助线
+            guides.append(QLineF(itemRect.center().x(), topY, itemRect.center().x(), bottomY));
+        if (iscenterY)  // Y 方向中心对齐的水平辅助线
+            guides.append(QLineF(leftX, itemRect.center().y(), rightX, itemRect.center().y()));
+    }
+
+    overlay.setGuides(guides);
 }
 
 //! [11]
@@ -448,25 +509,7 @@ void DiagramScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
         }
     }
     else if (ischeckingbox) {
-        endpoint = mouseEvent->scenePos();
-        removeItem(rectItem);
-        rectItem = nullptr;
-
-        int x1 = beginpoint.rx() > endpoint.rx() ? endpoint.rx() : beginpoint.rx();
-        int x2 = beginpoint.rx() < endpoint.rx() ? endpoint.rx() : beginpoint.rx();
-        int y1 = beginpoint.ry() > endpoint.ry() ? endpoint.ry() : beginpoint.ry();
-        int y2 = beginpoint.ry() < endpoint.ry() ? endpoint.ry() : beginpoint.ry();
-
-        foreach (QGraphicsItem *item, this->items()) {
-            if (item->mapToScene(item->boundingRect().center()).rx() < x2 &&
-                item->mapToScene(item->boundingRect().center()).rx() > x1 &&
-                item->mapToScene(item->boundingRect().center()).ry() > y1 &&
-                item->mapToScene(item->boundingRect().center()).ry() < y2) {
-                item->setSelected(true);
-            }
-        }
-        ischeckingbox = false;
-        update();
+        finishMarquee(mouseEvent->scenePos());
     }
     else if (myMode == MoveItem) {
         // 拖拽结束后，进行吸附
@@ -481,7 +524,6 @@ void DiagramScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
             DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem*>(movedItem);
             if (diagramItem != nullptr) {
                 diagramItem->isMoving = false;  // 重置 isMoving 状态
-                diagramItem->updatePathes();
             }
 
             // 清除对齐状态
@@ -492,81 +534,35 @@ void DiagramScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
             iscenterX = false;  // 清除 X 方向中心对齐状态
             iscenterY = false;  // 清除 Y 方向中心对齐状态
             alignedItem = nullptr;
-
-
-            QTimer::singleShot(300, this, [this]() {
-                update();  // 清除辅助线（延迟0.3秒）
-            });
+            overlay.clearGuides();
 
             // 最后清除移动图元
             movedItem = nullptr;  // 清除移动图元
         }
 
-        update();  // 清除辅助线（延迟0.3秒）
-
     }else if(myMode == InsertPath){
-
-        QList<QGraphicsItem *> startItems = items(pathLine->line().p1());
-        if (startItems.count() && startItems.first() == pathLine)
-            startItems.removeFirst();
-        QList<QGraphicsItem *> endItems = items(pathLine->line().p2());
-        if (endItems.count() && endItems.first() == pathLine)
-            endItems.removeFirst();
-
-
-        if (startItems.count() > 0 && endItems.count() > 0 &&
-            startItems.first()->type() == DiagramItem::Type &&
-            endItems.first()->type() == DiagramItem::Type &&
-            startItems.first() != endItems.first()) {
-            DiagramItem *startItem = qgraphicsitem_cast<DiagramItem *>(startItems.first());
-            DiagramItem *endItem = qgraphicsitem_cast<DiagramItem *>(endItems.first());
-
-
-
-            DiagramItem::TransformState startState = DiagramItem::TF_Cen;
-            DiagramItem::TransformState endState = DiagramItem::TF_Cen;
-
-            QRectF tempRect;
-
-
-            for(DiagramItem::TransformState state : startItem->linkWhere().keys()){
-                tempRect = startItem->mapRectToScene(startItem->linkWhere()[state]);
-                QRectF *magnetRect = new QRectF(tempRect.topLeft()-QPointF(20,20),tempRect.size()+QSize(40,40));
-                if(  magnetRect->contains(pathLine->line().p1()) ) {
-
-                    startState = state;
-                    qDebug()<<startState;
-                    break;
-                }
-            }
-
-            for(DiagramItem::TransformState state : endItem->linkWhere().keys()){
-                tempRect = endItem->mapRectToScene(endItem->linkWhere()[state]);
-                QRectF *magnetRect = new QRectF(tempRect.topLeft()-QPointF(20,20),tempRect.size()+QSize(40,40));
-                if( magnetRect->contains(pathLine->line().p2()) ) {
-                    endState = state;
-                    qDebug()<<endState;
-                    break;
-                }
-            }
-
-            // qDebug()<<startState<<endState;
-            if(startState && endState){
-                DiagramPath *path = new DiagramPath(startItem,endItem,startState,endState);
-
-                startItem->addPathes(path);
-                startItem->marks[path] = "1" + QString::number(startState);
-                qDebug()<<startItem->marks;
-                endItem->addPathes(path);
-                endItem->marks[path] = "0" + QString::number(endState);
-                qDebug()<<endItem->marks;
-                qDebug()<<startState<<endState;
-                path->updatePath();
-                path->setZValue(-1000.0);
-                addItem(path);
-                emit pathInserted(path);
-            }
+        // 起点在按下鼠标时已经吸附，终点取松开位置附近最近的其他图元的连接点
+        const PortIndex::Port endPort = pathStartPort.item
+                ? ports.nearest(pathLine->line().p2(), portMagnet, pathStartPort.item)
+                : PortIndex::Port();
+
+        if (pathStartPort.item && endPort.item) {
+            DiagramItem *startItem = pathStartPort.item;
+            DiagramItem *endItem = endPort.item;
+            DiagramItem::TransformState startState = pathStartPort.state;
+            DiagramItem::TransformState endState = endPort.state;
+
+            DiagramPath *path = new DiagramPath(startItem,endItem,startState,endState);
+
+            startItem->addPathes(path);
+            endItem->addPathes(path);
+            path->updatePath();
+            path->setZValue(-1000.0);
+            addItem(path);
+            emit pathInserted(path);
         }
+        overlay.setHoverPort(PortIndex::Port());
+        pathStartPort = PortIndex::Port();
         removeItem(pathLine);
         delete pathLine;
         setMode(premode);
@@ -583,6 +579,63 @@ void DiagramScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
 //! [13]
 
 //! [14]
+void DiagramScene::updateMarquee(const QPointF &pos)
+{
+    endpoint = pos;
+    const QRectF marqueeRect = QRectF(beginpoint, endpoint).normalized();
+
+    // 区域查询只返回与框相交的图元，再按中心点是否在框内筛选
+    QSet<QGraphicsItem *> hits;
+    const QList<QGraphicsItem *> candidates = items(marqueeRect, Qt::IntersectsItemBoundingRect);
+    for (QGraphicsItem *item : candidates) {
+        if (!(item->flags() & QGraphicsItem::ItemIsSelectable))
+            continue;
+        if (batchConnectors && item->type() == DiagramPath::Type)
+            continue;
+        if (marqueeRect.contains(item->mapToScene(item->boundingRect().center())))
+            hits.insert(item);
+    }
+    // 批量绘制的连线外框为空，改从连线层的线段索引中查找
+    if (batchConnectors) {
+        const QList<DiagramPath *> paths = connectors.pathsIn(marqueeRect);
+        for (DiagramPath *path : paths) {
+            if (marqueeRect.contains(connectors.boundsOf(path).center()))
+                hits.insert(path);
+        }
+    }
+
+    // 只改动进出框的图元；预览期间屏蔽 selectionChanged，松开鼠标时统一发出一次
+    {
+        const QSignalBlocker blocker(this);
+        for (QGraphicsItem *item : std::as_const(marqueeHits)) {
+            if (!hits.contains(item) && !marqueeBase.contains(item))
+                item->setSelected(false);
+        }
+        for (QGraphicsItem *item : std::as_const(hits)) {
+            if (!marqueeHits.contains(item))
+                item->setSelected(true);
+        }
+    }
+    marqueeHits = hits;
+
+    // 覆盖层只刷新新旧矩形覆盖的区域
+    overlay.setMarquee(marqueeRect);
+}
+
+void DiagramScene::finishMarquee(const QPointF &pos)
+{
+    updateMarquee(pos);
+
+    const bool changed = !(marqueeHits - marqueeBase).isEmpty();
+    ischeckingbox = false;
+    marqueeHits.clear();
+    marqueeBase.clear();
+    overlay.setMarquee(QRectF());
+
+    if (changed)
+        emit selectionChanged();
+}
+
 bool DiagramScene::isItemChange(int type) const
 {
     const QList<QGraphicsItem *> items = selectedItems();
@@ -603,17 +656,673 @@ QGraphicsTextItem* DiagramScene::createTextItem() {
     addItem(newItem);
     return newItem;
 }
-void DiagramScene::setLinkVisible(bool b)   //设置全局所有DiagramItem显示连接点
+void DiagramScene::updateItemIndex(DiagramItem *item)
 {
-    DiagramItem *item;
-    QList<QGraphicsItem *> itemList = this->items();
-    for(auto *it : itemList){
-        if(it->type()== DiagramItem::Type){
-            item = qgraphicsitem_cast<DiagramItem *>(it);
-            item->showLink = b;
-            item->update();
+    markNodeChanged(item);
+    // 组合中的子图元随组移动时收不到自身的位置变化，只索引顶层图元
+    if (item->parentItem() != nullptr) {
+        removeItemIndex(item);
+        return;
+    }
+    if (bulkDepth > 0) {
+        // 批量构建期间只登记，endBulkBuild 时每个图元索引一次
+        bulkIndexed.insert(item);
+        return;
+    }
+    const QRectF rect = item->sceneBoundingRect();
+    if (routing == OrthogonalRouting) {
+        // 旧位置和新位置所在路由区域内的连线都可能需要改道
+        const QRectF oldRect = alignIndex.rectOf(item);
+        if (oldRect != rect) {
+            markCorridorsDirty(oldRect);
+            markCorridorsDirty(rect);
         }
     }
+    alignIndex.update(item, rect);
+    ports.update(item);
+}
+
+void DiagramScene::removeItemIndex(DiagramItem *item)
+{
+    bulkIndexed.remove(item);
+    if (routing == OrthogonalRouting)
+        markCorridorsDirty(alignIndex.rectOf(item));
+    alignIndex.remove(item);
+    ports.remove(item);
+    if (overlay.hoverPort().item == item)
+        overlay.setHoverPort(PortIndex::Port());
+    if (pathStartPort.item == item)
+        pathStartPort = PortIndex::Port();
+    if (alignedItem == item) {
+        alignedItem = nullptr;
+        overlay.clearGuides();
+    }
+}
+
+bool DiagramScene::event(QEvent *event)
+{
+    if (event->type() == pathFlushEventType()) {
+        flushDirtyPaths();
+        return true;
+    }
+    return QGraphicsScene::event(event);
 }
-//! [15]
 
+void DiagramScene::markPathDirty(DiagramPath *path)
+{
+    if (path->detached())
+        return;
+    ++pathStats.marked;
+    dirtyPaths.insert(path);
+    if (!pathFlushPending) {
+        pathFlushPending = true;
+        QCoreApplication::postEvent(this, new QEvent(pathFlushEventType()), Qt::HighEventPriority);
+    }
+}
+
+void DiagramScene::pathDetached(DiagramPath *path)
+{
+    dirtyPaths.remove(path);
+    corridors.remove(path);
+}
+
+void DiagramScene::removeDirtyPath(DiagramPath *path)
+{
+    dirtyPaths.remove(path);
+    corridors.remove(path);
+    removeGraphEdge(path);
+    if (virtualView)
+        virtualView->pathLeft(path);
+    if (connectors.contains(path)) {
+        update(connectors.boundsOf(path));
+        connectors.remove(path);
+    }
+}
+
+void DiagramScene::addGraphNode(DiagramItem *item)
+{
+    if (item->graphNode != DiagramGraph::InvalidId)
+        return;
+    item->graphNode = topology.addNode(item);
+    if (projectJournal) {
+        journalChanged.insert(item);
+        if (item->parentItem())
+            journalGrouped.insert(item);
+    }
+    // 图元离开后再加入（组合、撤销删除）时，补登仍留在场景中的连线
+    for (DiagramPath *path : std::as_const(item->pathes)) {
+        if (path->scene() == this)
+            addGraphEdge(path);
+    }
+    if (virtualView)
+        virtualView->itemEntered(item);
+}
+
+void DiagramScene::removeGraphNode(DiagramItem *item)
+{
+    if (item->graphNode == DiagramGraph::InvalidId)
+        return;
+    if (virtualView)
+        virtualView->itemLeft(item);
+    if (projectJournal) {
+        journalChanged.remove(item);
+        journalGrouped.remove(item);
+        if (item->journalKey >= 0)
+            journalRemovedNodes.append(item->journalKey);
+    }
+    // 相连的连线也明确记为删除，撤销重建接回图元的键时这些连线的键同样可以接回；
+    // 连线再加入时按新连线记录
+    item->journalKey = -1;
+    for (const DiagramGraph::EdgeList *edges : { &topology.outEdges(item->graphNode), &topology.inEdges(item->graphNode) }) {
+        for (DiagramGraph::EdgeId edge : *edges) {
+            if (DiagramPath *path = topology.edge(edge).path) {
+                path->graphEdge = DiagramGraph::InvalidId;
+                if (projectJournal && path->journalKey >= 0)
+                    journalRemovedPaths.append(path->journalKey);
+                path->journalKey = -1;
+            }
+        }
+    }
+    topology.removeNode(item->graphNode);
+    item->graphNode = DiagramGraph::InvalidId;
+}
+
+void DiagramScene::addGraphEdge(DiagramPath *path)
+{
+    if (path->graphEdge != DiagramGraph::InvalidId)
+        return;
+    DiagramItem *from = path->getStartItem();
+    DiagramItem *to = path->getEndItem();
+    if (!from || !to || from->scene() != this || to->scene() != this
+        || from->graphNode == DiagramGraph::InvalidId || to->graphNode == DiagramGraph::InvalidId)
+        return;
+    path->graphEdge = topology.addEdge(from->graphNode, to->graphNode,
+                                       path->getStartState(), path->getEndState(), path);
+    if (projectJournal)
+        journalAdded.insert(path);
+    if (virtualView)
+        virtualView->pathEntered(path);
+}
+
+void DiagramScene::removeGraphEdge(DiagramPath *path)
+{
+    if (projectJournal) {
+        journalAdded.remove(path);
+        if (path->journalKey >= 0)
+            journalRemovedPaths.append(path->journalKey);
+    }
+    path->journalKey = -1;
+    if (path->graphEdge == DiagramGraph::InvalidId)
+        return;
+    topology.removeEdge(path->graphEdge);
+    path->graphEdge = DiagramGraph::InvalidId;
+}
+
+DiagramModel DiagramScene::toModel() const
+{
+    if (virtualView)
+        return virtualView->snapshot();
+    return toModel(items());
+}
+
+DiagramModel DiagramScene::toModel(const QList<QGraphicsItem *> &source) const
+{
+    return toModel(source, nullptr, nullptr);
+}
+
+DiagramModel DiagramScene::toModel(const QList<QGraphicsItem *> &source, QList<DiagramItem *> *nodeItems,
+                                   QList<DiagramPath *> *connectorItems) const
+{
+    DiagramModel model;
+    QList<int> nodeIndex(topology.nodeCapacity(), -1);   // 拓扑图节点编号 -> 模型下标
+    QList<DiagramPath *> paths;
+    for (QGraphicsItem *item : source) {
+        if (item->type() == DiagramPath::Type) {
+            paths.append(static_cast<DiagramPath *>(item));
+            continue;
+        }
+        DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item);
+        if (!diagramItem)
+            continue;
+        const int index = model.addNode(modelNode(diagramItem));
+        if (diagramItem->graphNode != DiagramGraph::InvalidId)
+            nodeIndex[diagramItem->graphNode] = index;
+        if (nodeItems)
+            nodeItems->append(diagramItem);
+    }
+    for (DiagramPath *path : std::as_const(paths)) {
+        if (!topology.hasEdge(path->graphEdge))
+            continue;
+        const DiagramGraph::Edge &edge = topology.edge(path->graphEdge);
+        const int from = nodeIndex.at(edge.from);
+        const int to = nodeIndex.at(edge.to);
+        if (from < 0 || to < 0)
+            continue;
+        model.addConnector(DiagramModel::Connector{ from, to, edge.fromPort, edge.toPort });
+        if (connectorItems)
+            connectorItems->append(path);
+    }
+    return model;
+}
+
+DiagramModel DiagramScene::toModel(JournalKeys *keys) const
+{
+    if (virtualView || !projectJournal) {
+        *keys = JournalKeys();
+        return toModel();
+    }
+    QList<DiagramItem *> nodeItems;
+    QList<DiagramPath *> connectorItems;
+    const DiagramModel model = toModel(items(), &nodeItems, &connectorItems);
+    keys->generation = projectJournal->keyGeneration();
+    keys->nodes.clear();
+    keys->connectors.clear();
+    for (DiagramItem *item : std::as_const(nodeItems))
+        keys->nodes.append(item->journalKey);
+    for (DiagramPath *path : std::as_const(connectorItems))
+        keys->connectors.append(path->journalKey);
+    return model;
+}
+
+void DiagramScene::restoreModel(const DiagramModel &model, const JournalKeys &keys)
+{
+    BulkBuildGuard bulk(this);
+    if (!projectJournal || keys.generation != projectJournal->keyGeneration()) {
+        clearVirtualModel();
+        clear();
+        addModel(model);
+        if (projectJournal)
+            journalRebuilt = true;
+        return;
+    }
+
+    // 重建前日志中存活的键：场景中有键的图元、连线，以及删除了但还没写入的
+    QSet<int> liveNodes(journalRemovedNodes.cbegin(), journalRemovedNodes.cend());
+    QSet<int> livePaths(journalRemovedPaths.cbegin(), journalRemovedPaths.cend());
+    QHash<int, DiagramModel::Node> savedNodes;   // 没有未保存改动的图元，日志中的内容即当前内容
+    for (QGraphicsItem *item : items()) {
+        if (item->type() == DiagramPath::Type) {
+            const int key = static_cast<DiagramPath *>(item)->journalKey;
+            if (key >= 0)
+                livePaths.insert(key);
+            continue;
+        }
+        DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item);
+        if (!diagramItem || diagramItem->journalKey < 0)
+            continue;
+        liveNodes.insert(diagramItem->journalKey);
+        if (!journalChanged.contains(diagramItem) && !journalGrouped.contains(diagramItem))
+            savedNodes.insert(diagramItem->journalKey, modelNode(diagramItem));
+    }
+
+    clear();
+    QList<DiagramItem *> nodeItems;
+    QList<DiagramPath *> connectorItems;
+    addModel(model, QPointF(), &nodeItems, &connectorItems);
+
+    // 接回仍存活的键，内容与日志中相同的图元不再记录
+    QSet<int> restoredNodes;
+    for (int i = 0; i < nodeItems.size(); ++i) {
+        DiagramItem *item = nodeItems.at(i);
+        const int key = keys.nodes.value(i, -1);
+        if (!item || key < 0 || !liveNodes.contains(key) || restoredNodes.contains(key))
+            continue;
+        item->journalKey = key;
+        restoredNodes.insert(key);
+        const auto saved = savedNodes.constFind(key);
+        if (saved != savedNodes.cend() && *saved == modelNode(item))
+            journalChanged.remove(item);
+    }
+    // 连线两端都接回了快照时的键，才是日志中的那一条
+    QSet<int> restoredPaths;
+    for (int i = 0; i < connectorItems.size(); ++i) {
+        DiagramPath *path = connectorItems.at(i);
+        const int key = keys.connectors.value(i, -1);
+        if (!path || key < 0 || !livePaths.contains(key) || restoredPaths.contains(key))
+            continue;
+        const DiagramModel::Connector &c = model.connector(i);
+        if (nodeItems.at(c.from)->journalKey < 0 || nodeItems.at(c.to)->journalKey < 0)
+            continue;
+        path->journalKey = key;
+        journalAdded.remove(path);
+        restoredPaths.insert(key);
+    }
+
+    // 没有接回的键在日志中记为删除
+    journalRemovedNodes.clear();
+    journalRemovedPaths.clear();
+    for (int key : std::as_const(livePaths)) {
+        if (!restoredPaths.contains(key))
+            journalRemovedPaths.append(key);
+    }
+    for (int key : std::as_const(liveNodes)) {
+        if (!restoredNodes.contains(key))
+            journalRemovedNodes.append(key);
+    }
+}
+
+void DiagramScene::setJournal(ProjectJournal *journal)
+{
+    delete projectJournal;
+    projectJournal = journal;
+    journalRebuilt = false;
+    journalChanged.clear();
+    journalGrouped.clear();
+    journalAdded.clear();
+    journalRemovedNodes.clear();
+    journalRemovedPaths.clear();
+    if (!projectJournal)
+        return;
+    // 已在组合中的图元每次保存都重写
+    for (QGraphicsItem *item : items()) {
+        DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item);
+        if (diagramItem && diagramItem->parentItem())
+            journalGrouped.insert(diagramItem);
+    }
+}
+
+void DiagramScene::markNodeChanged(DiagramItem *item)
+{
+    if (projectJournal && item->graphNode != DiagramGraph::InvalidId)
+        journalChanged.insert(item);
+}
+
+QFuture<QString> DiagramScene::saveJournal(const QFuture<QString> &after)
+{
+    if (!projectJournal || virtualView)
+        return QFuture<QString>();
+    // 第一次保存、之前的写入失败或按失效的键重建过：整体写一次基准
+    if (!projectJournal->hasBase() || journalRebuilt)
+        return compactJournal(after);
+
+    // 先删后加：删除的键不再被引用，新连线两端的图元此时都已有键
+    for (int key : std::as_const(journalRemovedPaths))
+        projectJournal->removeConnector(key);
+    for (int key : std::as_const(journalRemovedNodes))
+        projectJournal->removeNode(key);
+    journalChanged.unite(journalGrouped);
+    for (DiagramItem *item : std::as_const(journalChanged)) {
+        const DiagramModel::Node node = modelNode(item);
+        if (item->journalKey < 0)
+            item->journalKey = projectJournal->addNode(node);
+        else
+            projectJournal->setNode(item->journalKey, node);
+    }
+    for (DiagramPath *path : std::as_const(journalAdded)) {
+        if (path->journalKey >= 0 || !topology.hasEdge(path->graphEdge))
+            continue;
+        const DiagramGraph::Edge &edge = topology.edge(path->graphEdge);
+        const int from = topology.item(edge.from)->journalKey;
+        const int to = topology.item(edge.to)->journalKey;
+        if (from >= 0 && to >= 0)
+            path->journalKey = projectJournal->addConnector(from, to, edge.fromPort, edge.toPort);
+    }
+    journalChanged.clear();
+    journalAdded.clear();
+    journalRemovedNodes.clear();
+    journalRemovedPaths.clear();
+
+    // 日志过长时直接写新的基准，快照已包含这些改动
+    if (projectJournal->needsCompaction())
+        return compactJournal(after);
+    return projectJournal->save(after);
+}
+
+QFuture<QString> DiagramScene::compactJournal(const QFuture<QString> &after)
+{
+    if (!projectJournal || virtualView)
+        return QFuture<QString>();
+    QList<DiagramItem *> nodeItems;
+    QList<DiagramPath *> connectorItems;
+    const DiagramModel model = toModel(items(), &nodeItems, &connectorItems);
+    // 快照之外的连线（端点不在场景中）没有键
+    for (QGraphicsItem *item : items()) {
+        if (item->type() == DiagramPath::Type)
+            static_cast<DiagramPath *>(item)->journalKey = -1;
+    }
+    for (int i = 0; i < nodeItems.size(); ++i)
+        nodeItems.at(i)->journalKey = i;
+    for (int i = 0; i < connectorItems.size(); ++i)
+        connectorItems.at(i)->journalKey = i;
+    journalChanged.clear();
+    journalAdded.clear();
+    journalRemovedNodes.clear();
+    journalRemovedPaths.clear();
+    journalRebuilt = false;
+    return projectJournal->compact(model, after);
+}
+
+DiagramModel::Node DiagramScene::modelNode(DiagramItem *item)
+{
+    DiagramModel::Node node;
+    node.type = item->myDiagramType;
+    node.pos = item->scenePos();
+    node.size = item->getSize();
+    node.fill = item->m_color.rgba();
+    node.text = item->labelText();
+    const QFont font = item->labelFont();
+    node.style.family = font.family();
+    node.style.pointSize = font.pointSize();
+    node.style.bold = font.bold();
+    node.style.italic = font.italic();
+    node.style.color = item->labelColor().rgba();
+    return node;
+}
+
+void DiagramScene::applyModelNode(DiagramItem *item, const DiagramModel::Node &node, const QPointF &offset)
+{
+    item->setPos(node.pos + offset);
+    item->setFixedSize(node.size);
+    item->m_color = QColor::fromRgba(node.fill);
+    item->setLabelText(node.text);
+    // 从默认字体开始，回收再用的图元不保留上一次的字体
+    QFont font;
+    if (!node.style.family.isEmpty())
+        font.setFamily(node.style.family);
+    if (node.style.pointSize > 0)
+        font.setPointSize(node.style.pointSize);
+    font.setBold(node.style.bold);
+    font.setItalic(node.style.italic);
+    item->setLabelFont(font);
+    item->setLabelColor(QColor::fromRgba(node.style.color));
+}
+
+DiagramItem *DiagramScene::addModelNode(const DiagramModel::Node &node, const QPointF &offset)
+{
+    if (node.type < DiagramItem::Step || node.type > DiagramItem::Hexagon)
+        return nullptr;
+    auto *item = new DiagramItem(DiagramItem::DiagramType(node.type), myItemMenu);
+    applyModelNode(item, node, offset);
+    addItem(item);
+    return item;
+}
+
+DiagramPath *DiagramScene::addConnector(DiagramItem *startItem, DiagramItem *endItem, int startPort, int endPort)
+{
+    auto *path = new DiagramPath(startItem, endItem, DiagramItem::TransformState(startPort),
+                                 DiagramItem::TransformState(endPort));
+    startItem->addPathes(path);
+    endItem->addPathes(path);
+    path->setZValue(-1000.0);
+    addItem(path);
+    return path;
+}
+
+void DiagramScene::beginBulkBuild()
+{
+    if (bulkDepth++ > 0)
+        return;
+    bulkIndexMethod = itemIndexMethod();
+    setItemIndexMethod(NoIndex);
+    for (QGraphicsView *view : views())
+        view->setUpdatesEnabled(false);
+}
+
+void DiagramScene::endBulkBuild()
+{
+    Q_ASSERT(bulkDepth > 0);
+    if (--bulkDepth > 0)
+        return;
+    // 恢复 BSP 索引，Qt 按全部图元一次重建
+    setItemIndexMethod(bulkIndexMethod);
+    applyBulkChanges();
+    update();
+}
+
+void DiagramScene::flushBulkBuild()
+{
+    if (bulkDepth == 0)
+        return;
+    // 暂时退出批量状态，索引和路由直接生效，不再登记回待定集合
+    const int depth = std::exchange(bulkDepth, 0);
+    applyBulkChanges();
+    bulkDepth = depth;
+}
+
+void DiagramScene::applyBulkChanges()
+{
+    const QSet<DiagramItem *> indexed = std::exchange(bulkIndexed, QSet<DiagramItem *>());
+    for (DiagramItem *item : indexed)
+        updateItemIndex(item);
+    // 几何已经确定，新连线和受影响的连线一次批量路由
+    const QSet<DiagramPath *> paths = std::exchange(dirtyPaths, QSet<DiagramPath *>());
+    routePaths(paths.values());
+    for (QGraphicsView *view : views())
+        view->setUpdatesEnabled(true);
+}
+
+QList<QGraphicsItem *> DiagramScene::addModel(const DiagramModel &model, const QPointF &offset)
+{
+    return addModel(model, offset, nullptr, nullptr);
+}
+
+QList<QGraphicsItem *> DiagramScene::addModel(const DiagramModel &model, const QPointF &offset,
+                                              QList<DiagramItem *> *nodeItems, QList<DiagramPath *> *connectorItems)
+{
+    BulkBuildGuard bulk(this);
+    QList<QGraphicsItem *> created;
+    QList<DiagramItem *> nodes(model.nodeCount(), nullptr);
+    for (int i = 0; i < model.nodeCount(); ++i) {
+        DiagramItem *item = addModelNode(model.node(i), offset);
+        if (!item)
+            continue;
+        nodes[i] = item;
+        created.append(item);
+    }
+    if (nodeItems)
+        *nodeItems = nodes;
+    if (connectorItems)
+        *connectorItems = QList<DiagramPath *>(model.connectorCount(), nullptr);
+
+    // 先建好所有连线，批量构建结束时一次性并行路由
+    for (int i = 0; i < model.connectorCount(); ++i) {
+        const DiagramModel::Connector &c = model.connector(i);
+        DiagramItem *startItem = nodes.value(c.from);
+        DiagramItem *endItem = nodes.value(c.to);
+        if (!startItem || !endItem)
+            continue;
+        DiagramPath *path = addConnector(startItem, endItem, c.fromPort, c.toPort);
+        dirtyPaths.insert(path);
+        created.append(path);
+        if (connectorItems)
+            (*connectorItems)[i] = path;
+    }
+    return created;
+}
+
+void DiagramScene::setVirtualModel(const DiagramModel &model)
+{
+    if (!virtualView)
+        virtualView = new VirtualDiagram(this, myItemMenu);
+    virtualView->setModel(model);
+    // 已在场景中的图元和连线一并纳入模型
+    const QList<QGraphicsItem *> existing = items();
+    for (QGraphicsItem *item : existing) {
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item))
+            virtualView->itemEntered(diagramItem);
+    }
+    for (QGraphicsItem *item : existing) {
+        if (DiagramPath *path = qgraphicsitem_cast<DiagramPath *>(item))
+            virtualView->pathEntered(path);
+    }
+    // 场景范围覆盖整张图，滚动条按完整模型计算
+    setSceneRect(sceneRect() | virtualView->bounds().adjusted(-200, -200, 200, 200));
+}
+
+void DiagramScene::clearVirtualModel()
+{
+    delete virtualView;
+    virtualView = nullptr;
+}
+
+void DiagramScene::setVisibleRect(const QRectF &rect)
+{
+    if (virtualView)
+        virtualView->setViewport(rect);
+}
+
+void DiagramScene::markCorridorsDirty(const QRectF &rect)
+{
+    const QList<DiagramPath *> paths = corridors.intersecting(rect);
+    for (DiagramPath *path : paths)
+        markPathDirty(path);
+}
+
+void DiagramScene::setPathRouting(PathRouting mode)
+{
+    if (routing == mode)
+        return;
+    routing = mode;
+    corridors.clear();
+    const QList<QGraphicsItem *> all = items();
+    for (QGraphicsItem *item : all) {
+        if (item->type() == DiagramPath::Type)
+            markPathDirty(static_cast<DiagramPath *>(item));
+    }
+}
+
+ObstacleSnapshot DiagramScene::obstacleSnapshot() const
+{
+    ObstacleSnapshot snapshot;
+    const QList<QGraphicsItem *> all = items();
+    for (QGraphicsItem *item : all) {
+        if (item->type() != DiagramItem::Type || item->parentItem() != nullptr)
+            continue;
+        const DiagramItem *diagramItem = static_cast<DiagramItem *>(item);
+        snapshot.add(diagramItem->mapRectToScene(diagramItem->frameRect()));
+    }
+    return snapshot;
+}
+
+void DiagramScene::routePaths(const QList<DiagramPath *> &requested)
+{
+    QList<DiagramPath *> paths;
+    for (DiagramPath *path : requested) {
+        if (path->detached())
+            dirtyPaths.remove(path);
+        else
+            paths.append(path);
+    }
+    if (paths.isEmpty())
+        return;
+    const bool orthogonal = routing == OrthogonalRouting;
+    const ObstacleSnapshot obstacles = orthogonal ? obstacleSnapshot() : ObstacleSnapshot();
+
+    QList<PathBatchRouter::Job> jobs;
+    jobs.reserve(paths.size());
+    for (DiagramPath *path : paths)
+        jobs.append(PathBatchRouter::Job{ path->endpoints(), orthogonal });
+
+    const QList<PathBatchRouter::Output> outputs = PathBatchRouter::run(jobs, obstacles, pathRouter);
+    for (qsizetype i = 0; i < paths.size(); ++i) {
+        DiagramPath *path = paths.at(i);
+        dirtyPaths.remove(path);
+        path->applyGeometry(outputs.at(i).geometry);
+        if (orthogonal)
+            corridors.update(path, outputs.at(i).corridor);
+    }
+}
+
+QList<QPointF> DiagramScene::routePath(DiagramPath *path, const OrthogonalRouter::Request &request)
+{
+    const OrthogonalRouter::Result result = pathRouter.route(request, [this](const QRectF &region) {
+        // 障碍物为区域内的顶层图元外框
+        QList<QRectF> obstacles;
+        const QList<QGraphicsItem *> nearby = items(region, Qt::IntersectsItemBoundingRect);
+        for (QGraphicsItem *item : nearby) {
+            if (item->type() != DiagramItem::Type || item->parentItem() != nullptr)
+                continue;
+            const DiagramItem *diagramItem = static_cast<DiagramItem *>(item);
+            obstacles.append(diagramItem->mapRectToScene(diagramItem->frameRect()));
+        }
+        return obstacles;
+    });
+    corridors.update(path, result.corridor);
+    return result.points;
+}
+
+void DiagramScene::flushDirtyPaths()
+{
+    pathFlushPending = false;
+    // 批量构建期间（如进度对话框处理事件时）不路由，留给 endBulkBuild
+    if (dirtyPaths.isEmpty() || bulkDepth > 0)
+        return;
+
+    const QSet<DiagramPath *> paths = std::exchange(dirtyPaths, QSet<DiagramPath *>());
+    ++pathStats.flushes;
+    pathStats.recomputed += paths.size();
+    // 大量连线同时变脏（整体拖动、切换路由方式）时并行重算
+    if (paths.size() >= 64) {
+        routePaths(paths.values());
+        return;
+    }
+    for (DiagramPath *path : paths)
+        path->updatePath();
+}
+
+void DiagramScene::setLinkVisible(bool b)   //设置全局所有DiagramItem显示连接点
+{
+    // 连接点由覆盖层按暴露区域绘制，不再逐个刷新图元
+    overlay.setPortsVisible(b);
+}
+//! [15]
@@ -6,9 +6,19 @@
 
 #include "diagramitem.h"
 #include "diagramtextitem.h"
+#include "alignmentindex.h"
+#include "portindex.h"
+#include "sceneoverlay.h"
+#include "itemrendercache.h"
+#include "orthogonalrouter.h"
+#include "connectorlayer.h"
+#include "diagramgraph.h"
+#include "diagrammodel.h"
 
+#include <QFuture>
 #include <QGraphicsScene>
 #include <QKeyEvent>
+#include <QSet>
 
 
 
@@ -24,6 +34,10 @@ QT_END_NAMESPACE
 
 extern bool isInsertPath;
 
+class ObstacleSnapshot;
+class ProjectJournal;
+class VirtualDiagram;
+
 //! [0]
 class DiagramScene : public QGraphicsScene
 {
@@ -31,8 +45,10 @@ class DiagramScene : public QGraphicsScene
 
 public:
     enum Mode { InsertItem, InsertLine, InsertText, MoveItem, InsertPath};
+    enum PathRouting { LegacyRouting, OrthogonalRouting };
 
     explicit DiagramScene(QMenu *itemMenu, QObject *parent = nullptr);
+    ~DiagramScene() override;
     QFont font() const { return myFont; }
     QColor textColor() const { return myTextColor; }
     QColor itemColor() const { return myItemColor; }
@@ -42,6 +58,121 @@ public:
     void setItemColor(const QColor &color);
     void setFont(const QFont &font);
     void setLinkVisible(bool b);
+    bool linkVisible() const { return overlay.portsVisible(); }
+
+    // 图元几何（位置/尺寸/旋转）变化时由 DiagramItem 调用，增量维护对齐索引
+    void updateItemIndex(DiagramItem *item);
+    void removeItemIndex(DiagramItem *item);
+    const AlignmentIndex &alignmentIndex() const { return alignIndex; }
+    const PortIndex &portIndex() const { return ports; }
+    const SceneOverlay &interactionOverlay() const { return overlay; }
+
+    // 连线重算合并：端点图元移动时只登记脏连线，下一次绘制前每条连线只重算一次
+    struct PathUpdateStats {
+        int marked = 0;       // markPathDirty 调用次数
+        int recomputed = 0;   // 实际执行 updatePath 的次数
+        int flushes = 0;      // 非空刷新的次数
+    };
+    void markPathDirty(DiagramPath *path);
+    void removeDirtyPath(DiagramPath *path);   // 连线离开场景或析构时调用，同时移出路由区域索引和拓扑图
+    void pathDetached(DiagramPath *path);      // 连线的端点图元析构时调用：不再重算，移出路由区域索引
+    void flushDirtyPaths();
+    bool hasDirtyPaths() const { return !dirtyPaths.isEmpty(); }
+    const PathUpdateStats &pathUpdateStats() const { return pathStats; }
+    void resetPathUpdateStats() { pathStats = PathUpdateStats(); }
+
+    // 连线路由：LegacyRouting 按起止方位套用固定折线；OrthogonalRouting 绕开附近图元，
+    // 图元进入或离开某条连线的路由区域时只重算这条连线
+    void setPathRouting(PathRouting routing);
+    PathRouting pathRouting() const { return routing; }
+    OrthogonalRouter &router() { return pathRouter; }
+    const RouteCorridorIndex<DiagramPath *> &corridorIndex() const { return corridors; }
+    // 由 DiagramPath::updatePath 调用，返回含两端连接点的正交折线，失败时为空
+    QList<QPointF> routePath(DiagramPath *path, const OrthogonalRouter::Request &request);
+    // 批量重算连线（加载、粘贴、大量连线同时变脏）：GUI 线程取端点和障碍物快照，
+    // 线程池并行路由，最后在 GUI 线程一次性应用
+    void routePaths(const QList<DiagramPath *> &paths);
+    ObstacleSnapshot obstacleSnapshot() const;   // 所有顶层图元外框
+
+    // 拓扑图：图元、连线进出场景时由 DiagramItem / DiagramPath 登记，保存、复制时按编号读取端点
+    const DiagramGraph &graph() const { return topology; }
+    void addGraphNode(DiagramItem *item);
+    void removeGraphNode(DiagramItem *item);   // 相连的边一并删除
+    void addGraphEdge(DiagramPath *path);      // 两端图元都已登记时才加入
+    void removeGraphEdge(DiagramPath *path);
+
+    // 文档模型：保存、撤销快照、复制时从场景取出，加载、粘贴时按模型创建图元和连线
+    DiagramModel toModel() const;
+    // 只取 source 中的图元，以及本身和两端图元都在 source 中的连线
+    DiagramModel toModel(const QList<QGraphicsItem *> &source) const;
+    // 按模型创建图元（整体平移 offset）和连线，连线一次批量路由；返回新建的图元和连线
+    QList<QGraphicsItem *> addModel(const DiagramModel &model, const QPointF &offset = QPointF());
+    static DiagramModel::Node modelNode(DiagramItem *item);   // 图元当前的位置、尺寸、文字和样式
+    static void applyModelNode(DiagramItem *item, const DiagramModel::Node &node, const QPointF &offset = QPointF());
+    // 按模型节点新建图元（整体平移 offset）并加入场景，类型无效时返回空
+    DiagramItem *addModelNode(const DiagramModel::Node &node, const QPointF &offset = QPointF());
+    // 新建连线并登记到两端图元，加入场景；路由由调用方统一进行
+    DiagramPath *addConnector(DiagramItem *startItem, DiagramItem *endItem, int startPort, int endPort);
+
+    // 批量构建：加载、撤销恢复、粘贴时一次插入大量图元和连线。期间暂停 BSP 索引、
+    // 对齐和连接点索引、连线层和视图刷新，连线只登记不路由；最外层 endBulkBuild
+    // 一次重建索引，再按最终几何批量路由所有待定连线。可以嵌套
+    void beginBulkBuild();
+    void endBulkBuild();
+    // 批量构建中途交付已加入的部分：登记的图元建对齐和连接点索引，待定连线路由，视图恢复刷新；
+    // BSP 索引保持关闭，到最外层 endBulkBuild 才重建一次。分片加载每片结束时调用，开销只与本片成正比
+    void flushBulkBuild();
+    bool bulkBuilding() const { return bulkDepth > 0; }
+    class BulkBuildGuard   // 作用域内处于批量构建
+    {
+    public:
+        explicit BulkBuildGuard(DiagramScene *scene) : scene(scene) { scene->beginBulkBuild(); }
+        ~BulkBuildGuard() { scene->endBulkBuild(); }
+    private:
+        Q_DISABLE_COPY(BulkBuildGuard)
+        DiagramScene *scene;
+    };
+
+    // 虚拟化：超大图只为视口附近的节点创建图元，移出视口的图元回收再用，
+    // 保存（toModel）、查找、选择都针对完整模型。视图滚动、缩放后调用 setVisibleRect
+    void setVirtualModel(const DiagramModel &model);
+    void clearVirtualModel();   // 删除虚拟模式下的所有图元并退出虚拟模式
+    VirtualDiagram *virtualDiagram() const { return virtualView; }
+    void setVisibleRect(const QRectF &rect);
+
+    // 缓存绘制：图元主体与文字按缩放档位缓存为位图，控制点改由前景覆盖层绘制
+    void setCachedRendering(bool enabled);
+    bool cachedRendering() const { return cacheRendering; }
+    ItemRenderCache &renderCache() { return itemCache; }
+    const ItemRenderCache &renderCache() const { return itemCache; }
+
+    // 连线批量绘制：所有连线由 ConnectorLayer 在背景层按画笔分组一次画出，
+    // 点选、框选也在连线层的线段索引中查找；关闭时每条连线仍是独立绘制的图元
+    void setBatchedConnectors(bool enabled);
+    bool batchedConnectors() const { return batchConnectors; }
+    const ConnectorLayer &connectorLayer() const { return connectors; }
+    void updateConnector(DiagramPath *path);   // 连线几何、选中状态变化或进入场景时由 DiagramPath 调用
+
+    // 增量保存：场景带有工程日志时，登记上次保存以来增删、移动、缩放、改样式的图元和增删的连线，
+    // saveJournal 只把这些改动交给日志追加，还没有基准、之前写入失败或日志过长时改为整体写基准。
+    // 写盘在线程池中进行，排在 after 之后（见 ProjectJournal::save），返回的结果为错误描述，成功时为空；
+    // 没有日志或处于虚拟模式时返回无效的 QFuture，应整体保存。场景拥有日志
+    void setJournal(ProjectJournal *journal);
+    ProjectJournal *journal() const { return projectJournal; }
+    QFuture<QString> saveJournal(const QFuture<QString> &after = QFuture<QString>());
+    // 以当前快照为新的基准，图元、连线按快照下标重新编号
+    QFuture<QString> compactJournal(const QFuture<QString> &after = QFuture<QString>());
+    void markNodeChanged(DiagramItem *item);     // 图元文字、颜色、字体变化时调用
+    // 撤销快照中图元、连线的日志键，下标与快照模型相同
+    struct JournalKeys {
+        quint64 generation = 0;   // 取快照时键的代号，与日志当前代号不同时键已失效
+        QList<int> nodes;
+        QList<int> connectors;
+    };
+    DiagramModel toModel(JournalKeys *keys) const;   // 同 toModel()，另外给出日志键
+    // 撤销、重做：清空场景后按快照重建。键仍有效时图元、连线接回原来的键，下一次保存只追加与重建前
+    // 不同的部分；键已失效（之后压缩过或换了日志）时下一次保存整体重写基准
+    void restoreModel(const DiagramModel &model, const JournalKeys &keys);
 
 public slots:
     void setMode(Mode mode);
@@ -56,15 +187,26 @@ signals:
     void pathInserted(DiagramPath *path);
 
 protected:
+    bool event(QEvent *event) override;
         // 重写键盘事件
     void keyPressEvent(QKeyEvent *event) override;
     void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
+    void drawBackground(QPainter *painter, const QRectF &rect) override;
     void drawForeground(QPainter *painter, const QRectF &rect) override;
 
 private:
     bool isItemChange(int type) const;
+    void updateMarquee(const QPointF &pos);   // 更新框选矩形并实时预览选择
+    void finishMarquee(const QPointF &pos);   // 结束框选，一次性提交选择
+    void updateAlignGuides();                 // 按当前对齐状态生成辅助线
+    void markCorridorsDirty(const QRectF &rect);  // 路由区域与 rect 相交的连线标记为待重算
+    DiagramModel toModel(const QList<QGraphicsItem *> &source, QList<DiagramItem *> *nodeItems,
+                         QList<DiagramPath *> *connectorItems) const;   // 同时给出模型下标对应的图元和连线
+    // 同时给出模型下标对应的新图元和连线，没有创建的为空
+    QList<QGraphicsItem *> addModel(const DiagramModel &model, const QPointF &offset,
+                                    QList<DiagramItem *> *nodeItems, QList<DiagramPath *> *connectorItems);
 
     DiagramItem::DiagramType myItemType;
     QMenu *myItemMenu;
@@ -81,7 +223,8 @@ private:
     QPointF beginpoint;//鼠标框选起始位置
     QPointF endpoint;//鼠标框选末位置
     bool ischeckingbox=false;//判断是否正在框选
-    QGraphicsRectItem *rectItem = nullptr;
+    QSet<QGraphicsItem *> marqueeBase;     // 开始框选时已选中的图元
+    QSet<QGraphicsItem *> marqueeHits;     // 中心落在框选矩形内的图元（实时预览）
 
     QPointF alignPosition;//对齐
     bool isleft = false;     // 标记是否进行水平对齐
@@ -92,8 +235,35 @@ private:
     bool iscenterY = false;   // 标记是否进行中心对齐
     QGraphicsItem *movedItem = nullptr;  // 当前正在拖动的图元
     QGraphicsItem *alignedItem = nullptr;  // 当前对齐的图元
-    Mode premode;
-    QGraphicsLineItem *pathLine;
+    AlignmentIndex alignIndex;             // 所有顶层 DiagramItem 的边坐标索引
+    PortIndex ports;                       // 所有顶层 DiagramItem 的连接点索引
+    PortIndex::Port pathStartPort;         // 连线起点吸附到的连接点
+    SceneOverlay overlay;                  // 辅助线、框选矩形、连接点的前景覆盖层
+    QSet<DiagramPath *> dirtyPaths;        // 等待重算的连线
+    bool pathFlushPending = false;         // 是否已投递刷新事件
+    PathUpdateStats pathStats;
+    PathRouting routing = LegacyRouting;
+    OrthogonalRouter pathRouter;
+    RouteCorridorIndex<DiagramPath *> corridors;   // 每条正交连线的路由区域
+    DiagramGraph topology;                 // 图元与连线的拓扑关系
+    ItemRenderCache itemCache;             // 图元位图缓存，容量有上限
+    bool cacheRendering = false;
+    ConnectorLayer connectors;             // 批量绘制模式下的全部连线
+    bool batchConnectors = false;
+    VirtualDiagram *virtualView = nullptr; // 虚拟模式下的模型与图元池，普通模式为空
+    int bulkDepth = 0;                     // beginBulkBuild 的嵌套层数
+    void applyBulkChanges();               // 索引登记的图元、路由待定连线，调用时 bulkDepth 须为 0
+    ItemIndexMethod bulkIndexMethod = BspTreeIndex;   // 批量构建前的索引方式
+    QSet<DiagramItem *> bulkIndexed;       // 批量构建期间几何变化、等待索引的图元
+    ProjectJournal *projectJournal = nullptr;   // 增量保存的工程日志，未启用为空
+    QSet<DiagramItem *> journalChanged;    // 上次保存以来新加或改动的图元
+    QSet<DiagramItem *> journalGrouped;    // 组合中的图元：随组移动时收不到位置变化，每次保存都重写
+    QSet<DiagramPath *> journalAdded;      // 上次保存以来新加的连线
+    QList<int> journalRemovedNodes;        // 上次保存以来删除的图元和连线的键
+    QList<int> journalRemovedPaths;
+    bool journalRebuilt = false;           // 场景按失效的键重建过，下一次保存整体重写基准
+    Mode premode = MoveItem;
+    QGraphicsLineItem *pathLine = nullptr;
 };
 //! [0]
 
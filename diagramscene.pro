@@ -1,5 +1,6 @@
 QT += widgets
 QT += svg
+QT += concurrent
 
 requires(qtConfig(fontcombobox))
 
@@ -11,7 +12,25 @@ HEADERS     =   mainwindow.h \
 	diagramscene.h \
 	arrow.h \
 	diagramtextitem.h \
-	findreplacedialog.h
+	findreplacedialog.h \
+	alignmentindex.h \
+	portindex.h \
+	sceneoverlay.h \
+	shapecache.h \
+	levelofdetail.h \
+	itemrendercache.h \
+	shapeiconatlas.h \
+	startuptrace.h \
+	orthogonalrouter.h \
+	pathbatchrouter.h \
+	connectorlayer.h \
+	diagramgraph.h \
+	diagrammodel.h \
+	virtualdiagram.h \
+	projectfile.h \
+	fcprojtextreader.h \
+	projectloader.h \
+	projectjournal.h
 
 SOURCES     =   mainwindow.cpp \
         deletecommand.cpp \
@@ -22,7 +41,25 @@ SOURCES     =   mainwindow.cpp \
 	main.cpp \
 	arrow.cpp \
 	diagramtextitem.cpp \
-	diagramscene.cpp
+	diagramscene.cpp \
+	alignmentindex.cpp \
+	portindex.cpp \
+	sceneoverlay.cpp \
+	shapecache.cpp \
+	levelofdetail.cpp \
+	itemrendercache.cpp \
+	shapeiconatlas.cpp \
+	startuptrace.cpp \
+	orthogonalrouter.cpp \
+	pathbatchrouter.cpp \
+	connectorlayer.cpp \
+	diagramgraph.cpp \
+	diagrammodel.cpp \
+	virtualdiagram.cpp \
+	projectfile.cpp \
+	fcprojtextreader.cpp \
+	projectloader.cpp \
+	projectjournal.cpp
 
 RESOURCES   =   diagramscene.qrc
 
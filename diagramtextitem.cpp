@@ -4,6 +4,11 @@
 #include "diagramtextitem.h"
 #include "diagramscene.h"
 #include "diagramitem.h"
+#include "levelofdetail.h"
+#include "itemrendercache.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 
 //! [0]
 DiagramTextItem::DiagramTextItem(QGraphicsItem *parent)
@@ -12,9 +17,49 @@ DiagramTextItem::DiagramTextItem(QGraphicsItem *parent)
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
     setTextInteractionFlags(Qt::TextEditorInteraction);
+    // setPlainText 会重置文档版本号，不能只靠 revision() 判断内容是否变化
+    connect(document(), &QTextDocument::contentsChanged, this, [this]() { m_renderGeneration = 0; });
 }
 //! [0]
 
+void DiagramTextItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                            QWidget *widget)
+{
+    // 正在编辑的文字始终完整绘制
+    const qreal lod = LevelOfDetail::of(option, painter);
+    if (hasFocus() || !LevelOfDetail::greekedLabel(lod)) {
+        // 缓存绘制模式下未选中的文字按缩放档位贴图，选中框和光标仍实时绘制
+        DiagramScene *diagramScene = qobject_cast<DiagramScene *>(scene());
+        if (!diagramScene || !diagramScene->cachedRendering() || hasFocus() || isSelected()) {
+            QGraphicsTextItem::paint(painter, option, widget);
+            return;
+        }
+        const QRectF rect = boundingRect();
+        const size_t signature = qHashMulti(0, font().key(), defaultTextColor().rgba(),
+                                            rect.width(), rect.height());
+        if (signature != m_renderSignature || m_renderGeneration == 0) {
+            m_renderSignature = signature;
+            m_renderGeneration = ItemRenderCache::nextGeneration();
+        }
+        QStyleOptionGraphicsItem textOption(*option);
+        textOption.exposedRect = rect;
+        diagramScene->renderCache().draw(painter, m_renderGeneration, lod, rect,
+                                         [this, &textOption, widget](QPainter *p) {
+                                             QGraphicsTextItem::paint(p, &textOption, widget);
+                                         });
+        return;
+    }
+    if (LevelOfDetail::hiddenLabel(lod) || document()->isEmpty())
+        return;
+
+    // 缩小后文字不可读，用与文字同色的半透明灰条代替文字排版
+    const QRectF rect = boundingRect();
+    const qreal margin = document()->documentMargin();
+    QColor color = defaultTextColor();
+    color.setAlpha(110);
+    painter->fillRect(QRectF(rect.left() + margin, rect.center().y() - rect.height() / 6,
+                             rect.width() - 2 * margin, rect.height() / 3), color);
+}
 
 //! [1]
 
@@ -23,7 +23,8 @@ public:
     DiagramTextItem(QGraphicsItem *parent = nullptr);
 
     int type() const override { return Type; }
-    QColor text_color;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget) override;
     // void contextMenuEvent(QGraphicsSceneContextMenuEvent *event);
 
 signals:
@@ -35,6 +36,10 @@ protected:
     void focusOutEvent(QFocusEvent *event) override;
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
+
+private:
+    size_t m_renderSignature = 0;     // 上次生成位图时的字体/颜色/尺寸摘要
+    quint64 m_renderGeneration = 0;   // 0 表示需要换新（文字内容变化时清零）
 };
 //! [0]
 
@@ -0,0 +1,210 @@
+#include "fcprojtextreader.h"
+#include "diagrammodel.h"
+
+#include <climits>
+#include <cstring>
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+// [begin, end) 是一个十进制整数（可带符号）时写入 value
+static bool parseInt(const char *begin, const char *end, int *value)
+{
+    bool negative = false;
+    if (begin != end && (*begin == '-' || *begin == '+')) {
+        negative = *begin == '-';
+        ++begin;
+    }
+    if (begin == end)
+        return false;
+    qint64 result = 0;
+    for (const char *p = begin; p != end; ++p) {
+        if (*p < '0' || *p > '9')
+            return false;
+        result = result * 10 + (*p - '0');
+        if (result > qint64(INT_MAX) + 1)
+            return false;
+    }
+    if (negative)
+        result = -result;
+    if (result > INT_MAX)
+        return false;
+    *value = int(result);
+    return true;
+}
+
+static QString token(const char *begin, const char *end)
+{
+    return QString::fromUtf8(begin, end - begin);
+}
+
+FcprojTextReader::FcprojTextReader(const char *data, qint64 size)
+    : begin(data), end(data + size), pos(data), lineStart(data)
+{
+}
+
+bool FcprojTextReader::read(DiagramModel *model)
+{
+    model->clear();
+    pos = lineStart = begin;
+    line = 1;
+    record = -1;
+    inConnectors = false;
+    errLine = errColumn = 0;
+    errMessage.clear();
+
+    auto failed = [model]() {
+        model->clear();
+        return false;
+    };
+
+    int nodeTotal = 0;
+    if (!nextSection("DT_Size_", &nodeTotal))
+        return failed();
+    // 个数来自文件，按剩余长度估计上限，避免为损坏的文件预留过多内存（每个图元至少 20 个词元）
+    model->reserve(int(qMin<qint64>(nodeTotal, (end - pos) / 40 + 1)), 0);
+    for (record = 0; record < nodeTotal; ++record) {
+        DiagramModel::Node node;
+        int x = 0, y = 0, width = 0, height = 0, reserved = 0;
+        if (!nextInt(&x, "横坐标") || !nextInt(&y, "纵坐标") || !nextInt(&width, "宽度")
+            || !nextInt(&height, "高度") || !nextInt(&reserved, "保留字段")
+            || !nextColor(&node.fill, "填充色")
+            || !nextText(&node.text, "文字")
+            || !nextInt(&node.type, "图形类型")
+            || !nextText(&node.style.family, "字体")
+            || !nextInt(&node.style.pointSize, "字号")
+            || !nextFlag(&node.style.bold, "粗体")
+            || !nextFlag(&node.style.italic, "斜体")
+            || !nextColor(&node.style.color, "文字颜色"))
+            return failed();
+        node.pos = QPointF(x, y);
+        node.size = QSizeF(width, height);
+        model->addNode(node);
+    }
+
+    // 没有连线的文件不带 LN 段
+    skipSpace();
+    if (pos == end)
+        return true;
+    record = -1;
+    inConnectors = true;
+    int connectorTotal = 0;
+    if (!nextSection("LN_Size_", &connectorTotal))
+        return failed();
+    model->reserve(nodeTotal, int(qMin<qint64>(connectorTotal, (end - pos) / 8 + 1)));
+    for (record = 0; record < connectorTotal; ++record) {
+        DiagramModel::Connector c;
+        if (!nextInt(&c.from, "起点编号") || !nextInt(&c.fromPort, "起点连接点")
+            || !nextInt(&c.to, "终点编号") || !nextInt(&c.toPort, "终点连接点"))
+            return failed();
+        // 文件中的图元编号从 1 开始
+        --c.from;
+        --c.to;
+        model->addConnector(c);
+    }
+    return true;
+}
+
+QString FcprojTextReader::errorString() const
+{
+    if (errLine == 0)
+        return QString();
+    return QStringLiteral("第 %1 行第 %2 列：%3").arg(errLine).arg(errColumn).arg(errMessage);
+}
+
+void FcprojTextReader::skipSpace()
+{
+    while (pos != end && isSpace(*pos)) {
+        if (*pos == '\n') {
+            ++line;
+            lineStart = pos + 1;
+        }
+        ++pos;
+    }
+}
+
+bool FcprojTextReader::nextToken(const char **tokenBegin, const char **tokenEnd, const char *field)
+{
+    skipSpace();
+    if (pos == end)
+        return fail(pos, QStringLiteral("%1缺少%2，文件提前结束").arg(recordName(), QString::fromUtf8(field)));
+    *tokenBegin = pos;
+    while (pos != end && !isSpace(*pos))
+        ++pos;
+    *tokenEnd = pos;
+    return true;
+}
+
+bool FcprojTextReader::nextInt(int *value, const char *field)
+{
+    const char *b = nullptr, *e = nullptr;
+    if (!nextToken(&b, &e, field))
+        return false;
+    if (!parseInt(b, e, value))
+        return fail(b, QStringLiteral("%1的%2应为整数，实际是“%3”").arg(recordName(), QString::fromUtf8(field), token(b, e)));
+    return true;
+}
+
+bool FcprojTextReader::nextColor(QRgb *rgb, const char *field)
+{
+    // 颜色按 r b g a 的顺序保存
+    int r = 0, b = 0, g = 0, a = 0;
+    if (!nextInt(&r, field) || !nextInt(&b, field) || !nextInt(&g, field) || !nextInt(&a, field))
+        return false;
+    *rgb = qRgba(r, g, b, a);
+    return true;
+}
+
+bool FcprojTextReader::nextFlag(bool *value, const char *field)
+{
+    const char *b = nullptr, *e = nullptr;
+    if (!nextToken(&b, &e, field))
+        return false;
+    // 与参照实现一致：1 和 true 为真，其他都为假
+    const qint64 length = e - b;
+    *value = (length == 1 && *b == '1') || (length == 4 && std::memcmp(b, "true", 4) == 0);
+    return true;
+}
+
+bool FcprojTextReader::nextText(QString *text, const char *field)
+{
+    const char *b = nullptr, *e = nullptr;
+    if (!nextToken(&b, &e, field))
+        return false;
+    *text = token(b, e);
+    text->replace(QLatin1Char('*'), QLatin1Char(' '));   // 原地替换，不再复制
+    return true;
+}
+
+bool FcprojTextReader::nextSection(const char *prefix, int *count)
+{
+    const char *b = nullptr, *e = nullptr;
+    const QString name = QString::fromLatin1(prefix);
+    if (!nextToken(&b, &e, prefix))
+        return false;
+    const qint64 prefixLength = qint64(std::strlen(prefix));
+    if (e - b < prefixLength || std::memcmp(b, prefix, size_t(prefixLength)) != 0)
+        return fail(b, QStringLiteral("应为 %1 段，实际是“%2”").arg(name, token(b, e)));
+    if (!parseInt(b + prefixLength, e, count) || *count < 0)
+        return fail(b, QStringLiteral("%1 段的个数无效").arg(name));
+    return true;
+}
+
+bool FcprojTextReader::fail(const char *at, const QString &message)
+{
+    errLine = line;
+    // 列号按字符计算，只在出错时把本行开头转换一次
+    errColumn = QString::fromUtf8(lineStart, at - lineStart).size() + 1;
+    errMessage = message;
+    return false;
+}
+
+QString FcprojTextReader::recordName() const
+{
+    if (record < 0)
+        return inConnectors ? QStringLiteral("LN 段") : QStringLiteral("DT 段");
+    return inConnectors ? QStringLiteral("第 %1 条连线").arg(record + 1)
+                        : QStringLiteral("第 %1 个图元").arg(record + 1);
+}
@@ -0,0 +1,48 @@
+#ifndef FCPROJTEXTREADER_H
+#define FCPROJTEXTREADER_H
+
+#include <QRgb>
+#include <QString>
+
+class DiagramModel;
+
+// .fcproj 第 1 版文本格式的读取器
+// 直接在缓冲区（通常是 QFile::map 映射的文件）上按空白切分词元，不复制；数字就地转换，
+// 不经过 QString；文字只在转成 QString 时复制一次，星号原地换回空格。
+// 整个文件只扫描一遍，格式错误时给出行号和列号。
+// DiagramModel::readText 是基于 QTextStream 的参照实现，两者读出的模型相同
+class FcprojTextReader
+{
+public:
+    FcprojTextReader(const char *data, qint64 size);   // data 在读取期间须保持有效
+
+    bool read(DiagramModel *model);   // 失败时清空 model
+    int errorLine() const { return errLine; }       // 从 1 开始，没有错误时为 0
+    int errorColumn() const { return errColumn; }   // 按字符计，从 1 开始
+    QString errorString() const;                    // 带行列号的错误描述
+
+private:
+    void skipSpace();
+    bool nextToken(const char **begin, const char **end, const char *field);   // 文件结束时报错
+    bool nextInt(int *value, const char *field);
+    bool nextColor(QRgb *rgb, const char *field);
+    bool nextFlag(bool *value, const char *field);
+    bool nextText(QString *text, const char *field);
+    bool nextSection(const char *prefix, int *count);
+    bool fail(const char *at, const QString &message);
+    QString recordName() const;
+
+    const char *begin;
+    const char *end;
+    const char *pos;
+    const char *lineStart;
+    int line = 1;
+    int record = -1;            // 正在读的图元或连线下标
+    bool inConnectors = false;  // 是否已进入 LN 段
+
+    int errLine = 0;
+    int errColumn = 0;
+    QString errMessage;
+};
+
+#endif // FCPROJTEXTREADER_H
@@ -0,0 +1,125 @@
+#include "itemrendercache.h"
+
+#include <QPaintDevice>
+#include <QPainter>
+
+#include <atomic>
+#include <cmath>
+
+namespace {
+const int maxPixmapSide = 2048;     // 超过该边长的位图不缓存，直接矢量绘制
+const int minBucket = -16;          // 1/16 缩放
+const int maxBucket = 12;           // 8 倍缩放
+
+int pixmapCostKB(const QPixmap &pixmap)
+{
+    const qint64 bytes = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    return qMax(1, int((bytes + 1023) / 1024));
+}
+}
+
+ItemRenderCache::ItemRenderCache(int capacityKB)
+{
+    cache.setMaxCost(capacityKB);
+}
+
+void ItemRenderCache::setCapacityKB(int capacityKB)
+{
+    cache.setMaxCost(capacityKB);
+}
+
+quint64 ItemRenderCache::nextGeneration()
+{
+    static std::atomic<quint64> counter{0};
+    return ++counter;
+}
+
+int ItemRenderCache::zoomBucket(qreal lod)
+{
+    if (lod <= 0)
+        return minBucket;
+    return qBound(minBucket, int(std::ceil(std::log2(lod) * 4 - 1e-6)), maxBucket);
+}
+
+qreal ItemRenderCache::bucketScale(int bucket)
+{
+    return std::pow(2.0, bucket / 4.0);
+}
+
+void ItemRenderCache::draw(QPainter *painter, quint64 generation, qreal lod, const QRectF &localRect,
+                           const std::function<void(QPainter *)> &render)
+{
+    if (localRect.isEmpty())
+        return;
+
+    const qreal dpr = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+    const int bucket = zoomBucket(lod);
+    const qreal scale = bucketScale(bucket);
+    const QSize pixelSize(int(std::ceil(localRect.width() * scale * dpr)),
+                          int(std::ceil(localRect.height() * scale * dpr)));
+
+    // 放得很大时位图既占内存又不比矢量绘制快
+    if (pixelSize.width() > maxPixmapSide || pixelSize.height() > maxPixmapSide
+        || qint64(pixelSize.width()) * pixelSize.height() * 4 / 1024 > cache.maxCost()) {
+        ++bypassCount;
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        render(painter);
+        painter->restore();
+        return;
+    }
+
+    const Key key{ generation, bucket, qRound(dpr * 100) };
+    QPixmap *pixmap = cache.object(key);
+    if (pixmap) {
+        ++hitCount;
+    } else {
+        ++missCount;
+        pixmap = new QPixmap(pixelSize);
+        pixmap->setDevicePixelRatio(dpr);
+        pixmap->fill(Qt::transparent);
+        {
+            QPainter p(pixmap);
+            p.setRenderHint(QPainter::Antialiasing);
+            p.setRenderHint(QPainter::TextAntialiasing);
+            p.scale(scale, scale);
+            p.translate(-localRect.topLeft());
+            render(&p);
+        }
+        const int cost = pixmapCostKB(*pixmap);
+        QPixmap copy = *pixmap;   // insert 失败时 pixmap 已被删除
+        if (!cache.insert(key, pixmap, cost)) {
+            painter->drawPixmap(localRect, copy, QRectF(copy.rect()));
+            return;
+        }
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawPixmap(localRect, *pixmap, QRectF(pixmap->rect()));
+    painter->restore();
+}
+
+ItemRenderCache::Stats ItemRenderCache::stats() const
+{
+    Stats s;
+    s.hits = hitCount;
+    s.misses = missCount;
+    s.bypassed = bypassCount;
+    s.entries = cache.count();
+    s.usedKB = cache.totalCost();
+    s.capacityKB = cache.maxCost();
+    return s;
+}
+
+void ItemRenderCache::resetStats()
+{
+    hitCount = 0;
+    missCount = 0;
+    bypassCount = 0;
+}
+
+void ItemRenderCache::clear()
+{
+    cache.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef ITEMRENDERCACHE_H
+#define ITEMRENDERCACHE_H
+
+#include <QCache>
+#include <QPixmap>
+#include <QRectF>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+QT_END_NAMESPACE
+
+// 图元位图缓存
+// 图元主体和文字按“渲染代号 + 缩放档位”缓存为位图，绘制时直接贴图。
+// 代号在图元外观（尺寸、类型、颜色、旋转、文字）改变时换新，旧位图不再命中，由 LRU 自然淘汰；
+// 选中边框、控制点不进缓存，由场景覆盖层每次实时绘制，因此选中/悬停不会使缓存失效。
+// 缓存总量以 KB 计，超过上限时淘汰最久未用的位图
+class ItemRenderCache
+{
+public:
+    struct Stats {
+        qint64 hits = 0;        // 直接贴图的次数
+        qint64 misses = 0;      // 需要重新生成位图的次数
+        qint64 bypassed = 0;    // 位图过大、直接矢量绘制的次数
+        int entries = 0;        // 当前缓存的位图数
+        int usedKB = 0;         // 当前占用
+        int capacityKB = 0;     // 上限
+    };
+
+    explicit ItemRenderCache(int capacityKB = 32 * 1024);
+
+    void setCapacityKB(int capacityKB);
+    int capacityKB() const { return cache.maxCost(); }
+
+    // 每次外观变化时取一个新代号，全局唯一，不会与已删除图元的旧位图冲突
+    static quint64 nextGeneration();
+    // 缩放档位：每 1/4 个倍频一档，向上取整，位图只会被缩小贴出
+    static int zoomBucket(qreal lod);
+    static qreal bucketScale(int bucket);
+
+    // 把 localRect（图元坐标）范围的内容贴到 painter 上；缓存没有时调用 render 生成
+    void draw(QPainter *painter, quint64 generation, qreal lod, const QRectF &localRect,
+              const std::function<void(QPainter *)> &render);
+
+    Stats stats() const;
+    void resetStats();
+    void clear();
+
+private:
+    struct Key {
+        quint64 generation;
+        int bucket;
+        int dpr;    // 设备像素比 x100
+        bool operator==(const Key &other) const
+        {
+            return generation == other.generation && bucket == other.bucket && dpr == other.dpr;
+        }
+        friend size_t qHash(const Key &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.generation, key.bucket, key.dpr);
+        }
+    };
+
+    QCache<Key, QPixmap> cache;
+    qint64 hitCount = 0;
+    qint64 missCount = 0;
+    qint64 bypassCount = 0;
+};
+
+#endif // ITEMRENDERCACHE_H
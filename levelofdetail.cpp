@@ -0,0 +1,26 @@
+#include "levelofdetail.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+// 默认阈值：40% 以下省略箭头和控制点，35% 以下文字画成灰条，
+// 25% 以下图形画成矩形，15% 以下不画文字
+qreal LevelOfDetail::shapeThreshold = 0.25;
+qreal LevelOfDetail::labelThreshold = 0.35;
+qreal LevelOfDetail::labelHideThreshold = 0.15;
+qreal LevelOfDetail::decorationThreshold = 0.4;
+
+qreal LevelOfDetail::of(const QStyleOptionGraphicsItem *option, const QPainter *painter)
+{
+    if (option == nullptr)
+        return 1.0;
+    return option->levelOfDetailFromTransform(painter->worldTransform());
+}
+
+void LevelOfDetail::resetThresholds()
+{
+    shapeThreshold = 0.25;
+    labelThreshold = 0.35;
+    labelHideThreshold = 0.15;
+    decorationThreshold = 0.4;
+}
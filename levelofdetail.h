@@ -0,0 +1,38 @@
+#ifndef LEVELOFDETAIL_H
+#define LEVELOFDETAIL_H
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QStyleOptionGraphicsItem;
+QT_END_NAMESPACE
+
+// 缩放相关的细节层次（LOD）
+// 细节值取自 QStyleOptionGraphicsItem::levelOfDetailFromTransform，1.0 表示 100% 缩放。
+// 低于各阈值时图元改用简化画法：图形画成纯色矩形，文字画成灰条或不画，连线不画箭头和控制点
+class LevelOfDetail
+{
+public:
+    static qreal of(const QStyleOptionGraphicsItem *option, const QPainter *painter);
+
+    static bool simplifiedShape(qreal lod) { return lod < shapeThreshold; }      // 图形画成矩形
+    static bool greekedLabel(qreal lod) { return lod < labelThreshold; }         // 文字画成灰条
+    static bool hiddenLabel(qreal lod) { return lod < labelHideThreshold; }      // 文字不画
+    static bool hiddenDecorations(qreal lod) { return lod < decorationThreshold; } // 箭头、控制点不画
+
+    // 阈值可在运行时调整（例如按机器性能配置）
+    static void setShapeThreshold(qreal value) { shapeThreshold = value; }
+    static void setLabelThreshold(qreal value) { labelThreshold = value; }
+    static void setLabelHideThreshold(qreal value) { labelHideThreshold = value; }
+    static void setDecorationThreshold(qreal value) { decorationThreshold = value; }
+    static void resetThresholds();
+
+private:
+    static qreal shapeThreshold;
+    static qreal labelThreshold;
+    static qreal labelHideThreshold;
+    static qreal decorationThreshold;
+};
+
+#endif // LEVELOFDETAIL_H
@@ -1,13 +1,26 @@
 //程序运行开始的地方 -- 运行mainwindow
 #include "mainwindow.h"
+#include "startuptrace.h"
 #include <QApplication>
 
 int main(int argv, char *args[])
 {
+    // --startup-trace：记录启动各阶段耗时，首帧后写入日志
+    bool trace = false;
+    for (int i = 1; i < argv; ++i) {
+        if (qstrcmp(args[i], "--startup-trace") == 0)
+            trace = true;
+    }
+    StartupTrace::start(trace);
+
     QApplication app(argv, args);
+    StartupTrace::mark("application");
     MainWindow mainWindow;
+    StartupTrace::mark("mainwindow");
     // mainWindow.setGeometry(0, 0, 1920,1080);
     // mainWindow.show();
     mainWindow.showMaximized();     //其实直接使用showMaximized()就会实现自动铺满
+    StartupTrace::mark("show");
+    // 首帧在主视图视口第一次绘制后记录（见 MainWindow 构造函数）
     return app.exec();
 }
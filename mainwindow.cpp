@@ -8,6 +8,13 @@
 #include "deletecommand.h"
 #include "diagramitemgroup.h"
 #include "diagrampath.h"
+#include "shapeiconatlas.h"
+#include "startuptrace.h"
+#include "diagrammodel.h"
+#include "virtualdiagram.h"
+#include "projectfile.h"
+#include "projectloader.h"
+#include "projectjournal.h"
 
 #include <QtWidgets>
 
@@ -24,6 +31,8 @@
 #include <QList>
 #include <QPlainTextEdit>
 #include <QTextStream>
+#include <QFutureWatcher>
+#include <algorithm>
 
 #include <QSvgGenerator>
 #include <QGraphicsScene>
@@ -64,16 +73,31 @@ QString MainWindow::loadSavePicPath() {
 //! [0]
 MainWindow::MainWindow()
 {
-    createActions();
-    createToolBox();    //左侧图形
-    createMenus();      //上方菜单
-    createToolbars();   //上方字体/颜色等
-
-    findReplaceDialog = new FindReplaceDialog(this);//文本查找
+    // 工具箱图标在后台线程解码，与窗口构建并行
+    ShapeIconAtlas::instance().preload();
+    {
+        StartupTrace::Scope trace("mainwindow.actions");
+        createActions();
+    }
+    {
+        StartupTrace::Scope trace("mainwindow.toolbox");
+        createToolBox();    //左侧图形
+    }
+    {
+        StartupTrace::Scope trace("mainwindow.menus");
+        createMenus();      //上方菜单
+    }
+    {
+        StartupTrace::Scope trace("mainwindow.toolbars");
+        createToolbars();   //上方字体/颜色等
+    }
+    // 查找对话框在第一次使用时创建，见 openFindReplaceDialog()
 
+    StartupTrace::mark("mainwindow.scene");
     scene = new DiagramScene(itemMenu, this);
     scene->setSceneRect(QRectF(0, 0, 1920, 1080)); // 设置新场景的矩形区域
     scene->setBackgroundBrush(QPixmap(":/images/background4.png")); //默认纯白 我选的灰白网格
+    scene->setPathRouting(DiagramScene::OrthogonalRouting);   // 连线绕开图元
 
 
     //信号和槽 主要是组件被选择后的信号
@@ -81,20 +105,20 @@ MainWindow::MainWindow()
     connect(scene, &DiagramScene::textInserted,this, &MainWindow::textInserted);
     connect(scene, &DiagramScene::itemSelected,this, &MainWindow::itemSelected);
 
-    connect(findReplaceDialog, &FindReplaceDialog::findText, this, &MainWindow::handleFindText);
-    connect(findReplaceDialog, &FindReplaceDialog::replaceText, this, &MainWindow::handleReplaceText);
-    connect(findReplaceDialog, &FindReplaceDialog::replaceAllText, this, &MainWindow::handleReplaceAllText);
     connect(scene, &DiagramScene::itemInserted,this, &MainWindow::savefilestack);
     connect(scene, &DiagramScene::textInserted,this, &MainWindow::savefilestack);
     connect(scene, &DiagramScene::pathInserted,this, &MainWindow::savefilestack);
 
 
+    StartupTrace::mark("mainwindow.view");
     ///////////////////////////////////
     //这一段不建议进行注释处理 不认可能会导致内存报错 整个程序不能再构建
     layout = new QHBoxLayout;
     layout->addWidget(toolBox);
     view = new QGraphicsView(scene);
     view->setContextMenuPolicy(Qt::CustomContextMenu);
+    watchViewport(view, scene);
+    StartupTrace::finishAfterFirstPaint(view->viewport());
     connect(view, &QGraphicsView::customContextMenuRequested, this, &MainWindow::showContextMenu);
     //这一段不建议进行注释处理 不认可能会导致内存报错 整个程序不能再构建
     ///////////////////////////////////
@@ -132,6 +156,9 @@ MainWindow::MainWindow()
     setWindowTitle(tr("流程图工程界面"));
     setUnifiedTitleAndToolBarOnMac(true);
 
+    // 非必需的资源推迟到事件循环开始（首帧）之后再加载
+    QTimer::singleShot(0, this, &MainWindow::loadBackgroundIcons);
+
 
 
     //////////////////////////////////////这一部分监听非常有必要 因为你不监听他检测不出来
@@ -161,62 +188,7 @@ MainWindow::MainWindow()
 
 QString saveFilePath;//全局变量 文件路径 用来实现文件便利读取
 QString key = "123";
-
-// DiagramItem 和 LineSegment 结构体的定义
-struct  WriteDiagramItem {
-    int x; // x坐标
-    int y; // y坐标
-    int width; // 宽度
-    int height; // 高度
-    int type; // 图形类型
-    int rbg[4]; // 图形颜色(rbg三原色+透明度)
-    QString internalText; // 图形内部Text的内容
-    int itemtype;// 图形的类型
-    QString texttype;// 图形内部文本的类型
-    int textsize;//文字字号
-    bool boldtype;//是否黑体
-    bool itlatic;//是否斜体
-    int textrbg[4];// 图形内部文字的color
-};
-
-struct ReadDiagramItem {
-    int x; // x坐标
-    int y; // y坐标
-    int width; // 宽度
-    int height; // 高度
-    int type; // 图形类型
-    int rbg[4]; // 图形颜色(rbg三原色+透明度)
-    QString internalText; // 图形内部Text的内容
-    int itemtype;// 图形的类型
-    QString texttype;// 图形内部文本的类型
-    int textsize;//文字字号
-    bool boldtype;//是否黑体
-    bool itlatic;//是否斜体
-    int textrbg[4];// 图形内部文字的color
-};
-
-struct WriteDiagramPath
-{
-    int start;//开始item编号
-    int startp;//开始item节点
-    int end;//结束item编号
-    int endp;//结束item节点
-};
-
-struct ReadDiagramPath
-{
-    int start;//开始item编号
-    int startp;//开始item节点
-    int end;//结束item编号
-    int endp;//结束item节点
-};
-
-
-
-
-
-
-
+const int virtualNodeThreshold = 5000;   // 超过这个图元数的工程按视口虚拟化显示
 
 // /////////////////////////////////以下函数实现存储路径保存功能 防止因程序关闭而导致存储记忆消失
 // 定义存储路径的文件名
@@ -242,6 +214,14 @@ QString MainWindow::loadSaveFilePath() {
     return QString(); // 如果文件不存在或读取失败，返回空字符串
 }
 
+// 已结束的后台保存的错误描述，成功时为空；取消或没有给出结果也算失败
+static QString saveError(const QFuture<QString> &future)
+{
+    if (future.isCanceled() || future.resultCount() == 0)
+        return QObject::tr("后台保存没有完成");
+    return future.result();
+}
+
 //保存文件
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
@@ -259,81 +239,54 @@ void MainWindow::savefile(){
     saveFilePath = textFile;
     // 保存 saveFilePath 到文件
     saveSaveFilePath(saveFilePath);
-    // 创建 QFile 对象
-    QFile file(textFile);
-    // 以只写模式打开文件
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::critical(this, tr("保存失败"), tr("无法打开或写入工程信息."));
-        saveFileSuccess = false;
-        return;
-    }
-    // 创建 QTextStream 对象，并指定编码为 UTF-8
-    QTextStream out(&file);
-    // 获取 DiagramItem 结构体指针列表
-    QList<WriteDiagramItem*> diagramItems = getStructList();  //这个是得到的图形的
-    // 写入 DiagramItem 结构体列表的大小
-    out << "DT_Size_" << diagramItems.size() << "\n";
-    // 遍历 DiagramItem 结构体指针列表
-    for (WriteDiagramItem* itemPtr : diagramItems) {
-        // 替换 internalText 和 texttype 中的空格为星号
-        QString modifiedInternalText = itemPtr->internalText.replace(" ", "*");
-        QString modifiedTextType = itemPtr->texttype.replace(" ", "*");
-
-        // 写入结构体成员
-        out << itemPtr->x << " "
-            << itemPtr->y << " "
-            << itemPtr->width << " "
-            << itemPtr->height << " "
-            << itemPtr->type << " ";
-        for (int i = 0; i < 4; ++i) {
-            out << itemPtr->rbg[i] << " ";
-        }
-        out << modifiedInternalText << " " // 使用替换后的 internalText
-            << itemPtr->itemtype << " "
-            << modifiedTextType << " " // 使用替换后的 texttype
-            << itemPtr->textsize << " "
-            << itemPtr->boldtype << " "
-            << itemPtr->itlatic << " ";
-        for (int i = 0; i < 4; ++i) {
-            out << itemPtr->textrbg[i] << " ";
-        }
-        out << "\n";
-    }
-    // 关闭文件
-    file.close();
-    // 获取 DiagramPath 结构体指针列表
-    // 获取 DiagramPath 结构体指针列表
-    QList<struct WriteDiagramPath *> diagramPathsPtrs = getStructList1();
-    // 如果用户取消了文件选择或列表为空，则不执行任何操作
-    if (textFile.isEmpty() || diagramPathsPtrs.isEmpty()) {
-        saveFileSuccess = false;
-        return;
-    }
-    // 以追加模式打开文件，以写入 DiagramPath 数据
-    if (!file.open(QIODevice::Append)) {
-        QMessageBox::critical(this, tr("保存失败"), tr("无法打开或写入工程信息."));
-        saveFileSuccess = false;
-        return;
-    }
-    // 写入 DiagramPath 结构体列表的大小
-    out << "LN_Size_" << diagramPathsPtrs.size() << "\n";
-
-    // 遍历 DiagramPath 结构体指针列表
-    for (struct WriteDiagramPath *pathPtr : diagramPathsPtrs) {
-        if (pathPtr) {
-            // 写入结构体成员
-            out << pathPtr->start << " "
-                << pathPtr->startp << " "
-                << pathPtr->end << " "
-                << pathPtr->endp << "\n";
-        }
+    const bool journaled = journalAction->isChecked() && !scene->virtualDiagram();
+    if (journaled) {
+        // 增量保存：同一工程只追加上次保存以来的改动；第一次保存或日志过长时写基准快照。
+        // 写盘在后台进行，排在之前的保存之后，结果同样由下面的监视报告
+        if (!scene->journal() || scene->journal()->filePath() != textFile)
+            scene->setJournal(new ProjectJournal(textFile));
+        const QFuture<QString> written = scene->saveJournal(pendingSave);
+        if (!written.isValid())
+            return;   // 刚打开的工程没有改动，也还没有写过
+        pendingSave = written;
+    } else {
+        // 整体保存后日志不再对应这个文件
+        if (scene->journal() && scene->journal()->filePath() == textFile)
+            scene->setJournal(nullptr);
+        // 界面线程只取模型快照，序列化和写盘在后台进行，排在上一次保存之后，保证按顺序落盘
+        pendingSave = ProjectFile::saveAsync(textFile, scene->toModel(), pendingSave);
     }
-    // 关闭文件
-    file.close();
+    pendingSavePath = textFile;
+    auto *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, journaled, textFile]() {
+        watcher->deleteLater();
+        const QString error = saveError(watcher->future());
+        if (!error.isEmpty())
+            QMessageBox::critical(this, tr("保存失败"), tr("写入工程文件失败：%1").arg(error));
+        else if (!journaled)
+            QFile::remove(ProjectJournal::journalPath(textFile));
+    });
+    watcher->setFuture(pendingSave);
+}
+
+// 等待后台保存结束，返回是否成功
+bool MainWindow::waitForSave(QFuture<QString> &future)
+{
+    if (!future.isValid())
+        return true;
+    future.waitForFinished();
+    return saveError(future).isEmpty();
 }
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
+// 虚拟化场景按视口创建图元：滚动、缩放（滚动条范围随之变化）后通知场景
+static void syncVisibleRect(QGraphicsView *view, DiagramScene *scene)
+{
+    if (scene->virtualDiagram())
+        scene->setVisibleRect(view->mapToScene(view->viewport()->rect()).boundingRect());
+}
+
 void MainWindow::loadfile() {
     // 从文件中读取 saveFilePath
     saveFilePath = loadSaveFilePath();
@@ -345,223 +298,81 @@ void MainWindow::loadfile() {
         return;
     }
 
-    // 创建 QFile 对象
-    QFile file(textFile);
-    // 以只读模式打开文件
-    if (file.open(QIODevice::ReadOnly)) {
-        // 创建 QTextStream 对象
-        QTextStream in(&file);
-
-        // 创建新的列表用于存放读取的数据
-        QList<ReadDiagramItem> readDiagramItems;
-
-        // 读取 DiagramItem 结构体列表的大小
-        QString sizeString;
-        in >> sizeString;
-        if (sizeString.startsWith("DT_Size_")) {
-            quint32 diagramItemCount = sizeString.mid(8).toUInt(); // 去掉前缀并转换为整数
-            for (quint32 i = 0; i < diagramItemCount; ++i) {
-                ReadDiagramItem item;
-                in >> item.x >> item.y >> item.width >> item.height >> item.type;
-                for (int j = 0; j < 4; ++j) {
-                    in >> item.rbg[j];
-                }
-                // 读取 internalText 并替换星号为空格
-                QString internalText;
-                in >> internalText;
-                item.internalText = internalText.replace("*", " ");
-                in >> item.itemtype;
-                // 读取 texttype 并替换星号为空格
-                QString textType;
-                in >> textType;
-                item.texttype = textType.replace("*", " ");
-                in >> item.textsize;
-                // 读取布尔值需要特殊处理
-                QString boldTypeStr;
-                in >> boldTypeStr;
-                item.boldtype = (boldTypeStr == "true");
-
-                QString itlaticStr;
-                in >> itlaticStr;
-                item.itlatic = (itlaticStr == "true");
-
-                for (int j = 0; j < 4; ++j) {
-                    in >> item.textrbg[j];
-                }
-                // 调试输出每个读取到的 DiagramItem
-                qDebug() << "Read DiagramItem:";
-                qDebug() << "x: " << item.x;
-                qDebug() << "y: " << item.y;
-                qDebug() << "width: " << item.width;
-                qDebug() << "height: " << item.height;
-                qDebug() << "type: " << item.type;
-                qDebug() << "rbg: ";
-                for (int i = 0; i < 4; ++i) {
-                    qDebug() << item.rbg[i];
-                }
-                qDebug() << "internalText: " << item.internalText;
-                qDebug() << "itemtype: " << item.itemtype;
-                qDebug() << "texttype: " << item.texttype;
-                qDebug() << "textsize: " << item.textsize;
-                qDebug() << "boldtype: " << item.boldtype;
-                qDebug() << "itlatic: " << item.itlatic;
-                qDebug() << "textrbg: ";
-                for (int i = 0; i < 4; ++i) {
-                    qDebug() << item.textrbg[i];
-                }
-                readDiagramItems.append(item);
-            }
-        }
-
-        // 创建新的列表用于存放读取的 DiagramPath 数据
-        QList<ReadDiagramPath> readDiagramPaths;
-        in >> sizeString;
-        if (sizeString.startsWith("LN_Size_")) {
-            quint32 diagramPathCount = sizeString.mid(8).toUInt(); // 去掉前缀并转换为整数
-            for (quint32 i = 0; i < diagramPathCount; ++i) {
-                ReadDiagramPath path;
-                in >> path.start >> path.startp >> path.end >> path.endp;
-                // 调试输出每个读取到的 DiagramPath
-                qDebug() << "Read DiagramPath:";
-                qDebug() << "start: " << path.start;
-                qDebug() << "startp: " << path.startp;
-                qDebug() << "end: " << path.end;
-                qDebug() << "endp: " << path.endp;
-                readDiagramPaths.append(path);
-            }
+    // 在新标签页中异步加载：工作线程解析文件，界面线程分片创建图元，可随时取消
+    newScene();
+    DiagramScene *target = scene;
+    auto *loader = new ProjectLoader(target);
+    loader->setVirtualThreshold(virtualNodeThreshold);
+
+    auto *progress = new QProgressDialog(tr("正在加载 %1").arg(QFileInfo(textFile).fileName()), tr("取消"), 0, 0, this);
+    progress->setWindowTitle(tr("打开工程"));
+    progress->setWindowModality(Qt::NonModal);
+    progress->setMinimumDuration(300);
+    progress->setAutoReset(false);
+    connect(progress, &QProgressDialog::canceled, loader, &ProjectLoader::cancel);
+    connect(loader, &ProjectLoader::progress, progress, [progress](int done, int total) {
+        progress->setMaximum(total);
+        progress->setValue(done);
+    });
+    // 标签页关闭时加载器随场景析构，进度框一起关闭
+    connect(loader, &QObject::destroyed, progress, &QObject::deleteLater);
+
+    connect(loader, &ProjectLoader::finished, this,
+            [this, loader, target](ProjectLoader::Status status, const QString &error) {
+        loader->deleteLater();
+        if (status == ProjectLoader::Loaded) {
+            if (!target->views().isEmpty())
+                syncVisibleRect(target->views().constFirst(), target);
+            // 带日志的工程继续按增量保存
+            if (target->journal())
+                journalAction->setChecked(true);
+            // 提示用户读取成功
+            QMessageBox::information(this, tr("加载完成"), tr("成功加载工程."));
+            return;
         }
-        newScene();
-        QList<DiagramItem*> DiagramItemList;
-        foreach (ReadDiagramItem item,readDiagramItems) {
-            qDebug()<<"画";
-            DiagramItem *item1=new DiagramItem(static_cast<DiagramItem::DiagramType>(item.itemtype),itemMenu);
-            item1->setPos(QPoint(item.x,item.y));
-            item1->setFixedSize(QSize(item.width,item.height));
-            QColor itemcolor(item.rbg[0],item.rbg[2],item.rbg[1],item.rbg[3]);
-            QColor textcolor(item.textrbg[0],item.textrbg[2],item.textrbg[1],item.textrbg[3]);
-            item1->m_color=itemcolor;
-            item1->textItem->setPlainText(item.internalText);
-            item1->textItem->font().setPointSize(item.textsize);
-            item1->textItem->font().setFamily(item.texttype);
-            item1->textItem->font().setBold(item.boldtype);
-            item1->textItem->font().setItalic(item.itlatic);
-            item1->textItem->setDefaultTextColor(textcolor);
-            scene->addItem(item1);
-            DiagramItemList.append(item1);
+        // 失败或取消：关闭只有部分内容的新标签页；它已是最后一个标签页时不能关闭，清空其中的部分内容
+        const int index = sceneVector.indexOf(target);
+        if (index >= 0 && tabwidget->count() > 1) {
+            closeScene(index);
+        } else if (index >= 0) {
+            DiagramScene::BulkBuildGuard bulk(target);
+            target->clearVirtualModel();
+            target->clear();
         }
-
-        int size = DiagramItemList.size();
-        qDebug()<<"size: "<< size;
-        foreach (ReadDiagramPath item,readDiagramPaths) {
-            DiagramItem *startItem = DiagramItemList.at(item.start-1 );
-            DiagramItem *endItem = DiagramItemList.at(item.end-1 );
-            qDebug()<<scene->items();
-            DiagramItem::TransformState startState = static_cast<DiagramItem::TransformState>(item.startp);
-            DiagramItem::TransformState endState = static_cast<DiagramItem::TransformState>(item.endp);
-
-            DiagramPath *item1=new DiagramPath(startItem,endItem,startState,endState);
-
-            startItem->addPathes(item1);
-            startItem->marks[item1] = "1" + QString::number(startState);
-            qDebug()<<startItem->marks;
-            endItem->addPathes(item1);
-            endItem->marks[item1] = "0" + QString::number(endState);
-            qDebug()<<endItem->marks;
-            qDebug()<<startState<<endState;
-            item1->updatePath();
-            item1->setZValue(-1000.0);
-
-            scene->addItem(item1);
-
-        }
-        // 提示用户读取成功
-        QMessageBox::information(this, tr("加载完成"), tr("成功加载工程."));
+        if (status == ProjectLoader::Failed)
+            QMessageBox::critical(this, tr("加载失败"), error);
+    });
+    // 刚保存的同一个文件可能还在后台写：写完后再开始读，界面不等待。
+    // 用监视器而不是 then()：保存链上的 continuation 留给之后的保存接续
+    if (pendingSavePath == textFile && pendingSave.isValid() && !pendingSave.isFinished()) {
+        auto *saved = new QFutureWatcher<QString>(loader);
+        connect(saved, &QFutureWatcher<QString>::finished, loader, [loader, textFile]() { loader->start(textFile); });
+        saved->setFuture(pendingSave);
     } else {
-        // 文件打开失败，提示用户错误信息
-        QMessageBox::critical(this, tr("加载失败"), tr("无法打开或读取文件信息."));
+        loader->start(textFile);
     }
 }
 
-///////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////
-QList<struct WriteDiagramItem *> MainWindow::getStructList() {
-    QList<struct WriteDiagramItem *> DiagramItemList;
-    int p=0;
-    foreach(QGraphicsItem *item, scene->items()) {
-        DiagramItem *item1 = qgraphicsitem_cast<DiagramItem *>(item);
-        if (!item1) {
-            // 如果没有成功转换，可能是类型不匹配，可以在这里添加一个警告
-            qWarning() << "Failed to cast item to DiagramItem";
-            continue;
-        }
-        struct WriteDiagramItem *item0 = new WriteDiagramItem();
-        p++;
-        item0->x = item1->pos().x();
-        item0->y = item1->pos().y();
-        item0->width = item1->boundingRect().width()*0.8;
-        item0->height = item1->boundingRect().height()*0.72;
-        item0->rbg[0] = item1->m_color.red();
-        item0->rbg[1] = item1->m_color.blue();
-        item0->rbg[2] = item1->m_color.green();
-        item0->rbg[3] = item1->m_color.alpha();
-        item0->internalText = item1->textItem->toPlainText();
-        item0->itemtype = item1->myDiagramType;
-        item0->texttype = item1->textItem->font().family();
-        item0->textsize = item1->textItem->font().pointSize();
-        item0->boldtype = item1->textItem->font().bold();
-        item0->itlatic = item1->textItem->font().italic();
-        item0->textrbg[0] = item1->textItem->defaultTextColor().red();
-        item0->textrbg[1] = item1->textItem->defaultTextColor().blue();
-        item0->textrbg[2] = item1->textItem->defaultTextColor().green();
-        item0->textrbg[3] = item1->textItem->defaultTextColor().alpha();
-        qDebug()<<"type:"<<item1->myDiagramType;
-        qDebug()<<"item_marks: "<<item1->marks;
-
-        foreach (DiagramPath* line, item1->pathes) {
-            if(item1->marks[line][0] == '1' ){
-                line->start = p;
-                line->startp = item1->marks[line][1].digitValue();
-                qDebug()<<line;
-                qDebug()<<"start:"<<line->start;
-                qDebug()<<"startp"<<line->startp;
-            }
-            else if(item1->marks[line][0] == '0'){
-                line->end = p;
-                line->endp = item1->marks[line][1].digitValue();
-                qDebug()<<line;
-                qDebug()<<"end:"<<line->end;
-                qDebug()<<"endp"<<line->endp;
-            }
-        }
+void MainWindow::watchViewport(QGraphicsView *view, DiagramScene *scene)
+{
+    auto sync = [view, scene]() { syncVisibleRect(view, scene); };
+    connect(view->horizontalScrollBar(), &QScrollBar::valueChanged, scene, sync);
+    connect(view->verticalScrollBar(), &QScrollBar::valueChanged, scene, sync);
+    connect(view->horizontalScrollBar(), &QScrollBar::rangeChanged, scene, sync);
+    connect(view->verticalScrollBar(), &QScrollBar::rangeChanged, scene, sync);
+}
 
-        DiagramItemList.append(item0);
-    }
-    return DiagramItemList;
-}
-/////////////////////////////////////
-QList<struct WriteDiagramPath *> MainWindow::getStructList1() {
-    QList<struct WriteDiagramPath *> DiagramItemList;
-    foreach(QGraphicsItem *item, scene->items()) {
-        DiagramPath *item1 = qgraphicsitem_cast<DiagramPath *>(item);
-        if (!item1) {
-            // 如果没有成功转换，可能是类型不匹配，可以在这里添加一个警告
-            continue;
-        }
-        struct WriteDiagramPath *item0 = new WriteDiagramPath();
-        item0->start=item1->start;
-        item0->startp=item1->startp;
-        item0->end=item1->end;
-        item0->endp=item1->endp;
-        qDebug()<<"load path: ";
-        qDebug()<<"start: "<<item0->start;
-        qDebug()<<"startp:"<<item0->startp;
-        qDebug()<<"end: "<<item0->end;
-        qDebug()<<"endp: "<<item0->endp;
-        DiagramItemList.append(item0);
+void MainWindow::showModel(const DiagramModel &model)
+{
+    if (model.nodeCount() < virtualNodeThreshold) {
+        scene->addModel(model);
+        return;
     }
-    return DiagramItemList;
+    // 超大图只创建视口附近的图元
+    scene->setVirtualModel(model);
+    syncVisibleRect(view, scene);
 }
+
 //组合
 void MainWindow::combination(){
     DiagramItemGroup *group = new DiagramItemGroup();
@@ -597,70 +408,140 @@ void MainWindow::cancelCombination(){
 //查找文件
 void MainWindow::openFindReplaceDialog()
 {
-    if (findReplaceDialog) {
-        findReplaceDialog->show();  // 显示查找和替换对话框
+    if (!findReplaceDialog) {
+        // 启动时不创建，第一次打开时才构建
+        findReplaceDialog = new FindReplaceDialog(this);//文本查找
+        connect(findReplaceDialog, &FindReplaceDialog::findText, this, &MainWindow::handleFindText);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceText, this, &MainWindow::handleReplaceText);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceAllText, this, &MainWindow::handleReplaceAllText);
     }
+    findReplaceDialog->show();  // 显示查找和替换对话框
 }
 void MainWindow::handleFindText(const QString &text)
 {
-    bool found = false;  // 用于指示是否找到文本
-    QList<QGraphicsItem *> items = scene->items();  // 获取场景中的所有文本项
-    int startIndex = 0;  // 从哪个文本项开始查找
+    if (VirtualDiagram *virtualDiagram = scene->virtualDiagram()) {
+        if (!findInVirtualScene(virtualDiagram, text)) {
+            currentFoundItem = nullptr;
+            lastSearchPosition = -1;
+            lastFoundNode = -1;
+            QMessageBox::information(this, tr("查找结束"), tr("未找到更多的匹配项。"));
+        }
+        return;
+    }
 
-    // 如果上次已经查找到某个文本框了，继续从该文本框及其后面的文本框开始查找
-    if (currentTextItem) {
-        // 取消当前高亮
-        QTextCursor cursor = currentTextItem->textCursor();
+    bool found = false;  // 用于指示是否找到文本
+    QList<QGraphicsItem *> items = scene->items();  // 获取场景中的所有文本项和图元
+    // 如果上次已经查找到某个文本框或图元了，继续从它及其后面的项开始查找；它已被删除时从头开始
+    const int lastIndex = items.indexOf(currentFoundItem);
+    int startIndex = qMax(0, lastIndex);
+
+    // 取消当前高亮（图元的文本框在失去焦点时已经销毁）
+    if (DiagramTextItem *textItem = lastIndex >= 0 ? qgraphicsitem_cast<DiagramTextItem *>(items[lastIndex]) : nullptr) {
+        QTextCursor cursor = textItem->textCursor();
         cursor.clearSelection();  // 取消当前选中的文本
-        currentTextItem->setTextCursor(cursor);  // 应用更新后的光标
-
-        startIndex = items.indexOf(currentTextItem);  // 从上次查找到的文本框继续
+        textItem->setTextCursor(cursor);  // 应用更新后的光标
     }
 
     // 从当前文本框的下一个字符开始继续查找
     for (int i = startIndex; i < items.size(); ++i) {
-        if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(items[i])) {
-            QString content = textItem->toPlainText();  // 获取文本内容
-
-            // 如果是从当前文本项继续查找，使用 lastSearchPosition 来避免从头查找
-            int searchStartPosition = (textItem == currentTextItem) ? lastSearchPosition + 1 : 0;
-            int index = content.indexOf(text, searchStartPosition);
-
-            if (index != -1) {  // 找到匹配的文本
-                // 使用 QTextCursor 选中文本
-                QTextCursor cursor = textItem->textCursor();
-                cursor.setPosition(index);              // 设置光标位置到找到的文本开始处
-                cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, text.length());  // 选中查找到的文本
-                textItem->setTextCursor(cursor);        // 应用新的文本光标
-
-                textItem->setSelected(true);            // 选中整个文本框（可选）
-                view->ensureVisible(textItem);          // 将查找到的文本项滚动到视图中可见的位置
+        QString content;  // 获取文本内容
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(items[i])) {
+            content = diagramItem->labelText();
+        } else if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(items[i])) {
+            if (qgraphicsitem_cast<DiagramItem *>(textItem->parentItem()))
+                continue;  // 正在编辑的图元文字，按所属图元查找
+            content = textItem->toPlainText();
+        } else {
+            continue;
+        }
 
-                // 保存当前查找到的文本框和位置
-                currentTextItem = textItem;
-                lastSearchPosition = index + text.length();  // 更新上次查找结束的位置
+        // 如果是从当前项继续查找，使用 lastSearchPosition 来避免从头查找
+        int searchStartPosition = (items[i] == currentFoundItem) ? lastSearchPosition + 1 : 0;
+        int index = content.indexOf(text, searchStartPosition);
 
-                found = true;
-                break;  // 找到后退出
-            }
+        if (index != -1) {  // 找到匹配的文本
+            highlightFoundText(items[i], index, text.length());
+            found = true;
+            break;  // 找到后退出
         }
     }
 
     // 如果没有找到任何匹配项，重置查找状态，并提示用户
     if (!found) {
-        currentTextItem = nullptr;
+        currentFoundItem = nullptr;
         lastSearchPosition = -1;
         QMessageBox::information(this, tr("查找结束"), tr("未找到更多的匹配项。"));
     }
 }
 
+void MainWindow::highlightFoundText(QGraphicsItem *item, int index, int length)
+{
+    // 图元文字平时没有文本框，先进入编辑状态
+    DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(item);
+    if (DiagramItem *owner = qgraphicsitem_cast<DiagramItem *>(item)) {
+        owner->beginLabelEdit();
+        textItem = owner->labelEditor();
+    }
+    if (!textItem)
+        return;
+
+    // 使用 QTextCursor 选中文本
+    QTextCursor cursor = textItem->textCursor();
+    cursor.setPosition(index);              // 设置光标位置到找到的文本开始处
+    cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, length);  // 选中查找到的文本
+    textItem->setTextCursor(cursor);        // 应用新的文本光标
+
+    textItem->setSelected(true);            // 选中整个文本框（可选）
+    view->ensureVisible(textItem);          // 将查找到的文本项滚动到视图中可见的位置
+
+    // 保存当前查找到的文本框（或图元）和位置
+    currentFoundItem = item;
+    lastSearchPosition = index + length;  // 更新上次查找结束的位置
+}
+
+bool MainWindow::findInVirtualScene(VirtualDiagram *virtualDiagram, const QString &text)
+{
+    // 大部分节点没有图元，在模型中按节点顺序查找，命中后再创建图元并定位。
+    // 上次命中的图元可能已被回收给别的节点，按节点编号确认后才继续在它的文字里找
+    DiagramItem *current = virtualDiagram->itemOf(lastFoundNode);
+    if (current && current == currentFoundItem) {
+        const int index = current->labelText().indexOf(text, lastSearchPosition + 1);
+        if (index != -1) {
+            highlightFoundText(current, index, text.length());
+            return true;
+        }
+        if (DiagramTextItem *editor = current->labelEditor()) {
+            QTextCursor cursor = editor->textCursor();
+            cursor.clearSelection();
+            editor->setTextCursor(cursor);
+        }
+    }
+
+    const QList<int> hits = virtualDiagram->find(text);
+    const auto next = std::upper_bound(hits.cbegin(), hits.cend(), lastFoundNode);
+    if (next == hits.cend())
+        return false;
+    DiagramItem *owner = virtualDiagram->reveal(*next);
+    if (!owner)
+        return false;
+    lastFoundNode = *next;
+    highlightFoundText(owner, owner->labelText().indexOf(text), text.length());
+    return true;
+}
+
 void MainWindow::handleReplaceText(const QString &findText, const QString &replaceText)
 {
-    // 遍历场景中的所有文本项，替换指定文本
+    // 遍历场景中的所有文本项和图元文字，替换指定文本
     foreach (QGraphicsItem *item, scene->items()) {
-        if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(item)) {
-            QString currentText = textItem->toPlainText();
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item)) {
+            QString currentText = diagramItem->labelText();
             if (currentText.contains(findText)) {
+                diagramItem->setLabelText(currentText.replace(findText, replaceText));  // 替换找到的文本
+                break;  // 替换第一个匹配项后退出循环
+            }
+        } else if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(item)) {
+            QString currentText = textItem->toPlainText();
+            if (!qgraphicsitem_cast<DiagramItem *>(textItem->parentItem()) && currentText.contains(findText)) {
                 textItem->setPlainText(currentText.replace(findText, replaceText));  // 替换找到的文本
                 break;  // 替换第一个匹配项后退出循环
             }
@@ -670,11 +551,15 @@ void MainWindow::handleReplaceText(const QString &findText, const QString &repla
 
 void MainWindow::handleReplaceAllText(const QString &findText, const QString &replaceText)
 {
-    // 遍历场景中的所有文本项，替换所有匹配的文本
+    // 遍历场景中的所有文本项和图元文字，替换所有匹配的文本
     foreach (QGraphicsItem *item, scene->items()) {
-        if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(item)) {
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item)) {
+            QString currentText = diagramItem->labelText();
+            if (currentText.contains(findText))
+                diagramItem->setLabelText(currentText.replace(findText, replaceText));  // 替换所有匹配项
+        } else if (DiagramTextItem *textItem = qgraphicsitem_cast<DiagramTextItem *>(item)) {
             QString currentText = textItem->toPlainText();
-            if (currentText.contains(findText)) {
+            if (!qgraphicsitem_cast<DiagramItem *>(textItem->parentItem()) && currentText.contains(findText)) {
                 textItem->setPlainText(currentText.replace(findText, replaceText));  // 替换所有匹配项
             }
         }
@@ -729,88 +614,48 @@ void MainWindow::showContextMenu(const QPoint &pos) {
 }
 //复制
 void MainWindow::copyItems() {
+    // 选中的图元，以及两端都被选中的连线
     QByteArray itemData;
     QDataStream dataStream(&itemData, QIODevice::WriteOnly);
-    QMap<DiagramItem*,int> idmap;
-    int p = 0;
-    foreach (QGraphicsItem *item, scene->selectedItems()) {
-        if (DiagramItem *diagramItem = dynamic_cast<DiagramItem*>(item)) {
-            QPointF itemPos = diagramItem->pos(); // 获取图形项的位置
-            QColor itemColor = diagramItem->m_color; // 获取图形项的颜色
-            QSizeF itemSize = diagramItem->boundingRect().size(); // 获取图形项的大小
-            QString content =  diagramItem->textItem->toPlainText();
-            QColor textColor = diagramItem->textItem->defaultTextColor();
-            QFont font =diagramItem->textItem->font();
-            idmap[diagramItem] = p; //item的编号
-            dataStream << static_cast<int>(diagramItem->myDiagramType)
-                       << itemPos.x() << itemPos.y()
-                       << itemColor.rgba() // 颜色以RGBA形式存储
-                       << itemSize.width() << itemSize.height() << content <<textColor
-                       <<font<<p++; // 存储大小
-            // QMimeData *mimeData = new QMimeData();
-            // mimeData->setData("application/x-diagramscene-item-type", itemData);
-            // QApplication::clipboard()->setMimeData(mimeData, QClipboard::Clipboard);
-            qDebug() << "复制成功";
-        }
-    }
-
-    QByteArray pathData;
-    QDataStream pathStream(&pathData,QIODevice::WriteOnly);
-
-    foreach (QGraphicsItem *item, scene->selectedItems()) {
-        if(DiagramPath *path = dynamic_cast<DiagramPath*>(item)){
-            if(scene->selectedItems().contains(path->getStartItem()) &&
-                scene->selectedItems().contains(path->getEndItem())){
-                int start = idmap[path->getStartItem()];
-                int end = idmap[path->getEndItem()];
-                QChar startc = path->getStartItem()->marks[path][1];
-                QChar endc = path->getEndItem()->marks[path][1];
-                int startp = startc.digitValue();
-                int endp = endc.digitValue();
-                pathStream<<start<<end<<startp<<endp;
-                // QMimeData *mimeData = new QMimeData();
-                // mimeData->setData("application/x-digramscene-path-type",itemData);
-                // QApplication::clipboard()->setMimeData(mimeData,QClipboard::Clipboard);
-                qDebug()<<"线复制成功";
-            }
-        }
-    }
+    dataStream << scene->toModel(scene->selectedItems());
 
     QMimeData *mimeData = new QMimeData();
     mimeData->setData("application/x-diagramscene-item-type",itemData);
-    mimeData->setData("application/x-digramscene-path-type",pathData);
     QApplication::clipboard()->setMimeData(mimeData,QClipboard::Clipboard);
-
 }
 
 void MainWindow::cutItems() {
-    QByteArray itemData;
-    QDataStream dataStream(&itemData, QIODevice::WriteOnly);
-
-    QList<QGraphicsItem*> itemsToCut; // 用于存储要剪切的图形项
-
+    QList<DiagramItem*> itemsToCut; // 用于存储要剪切的图形项
     foreach (QGraphicsItem *item, scene->selectedItems()) {
-        if (DiagramItem *diagramItem = dynamic_cast<DiagramItem*>(item)) {
-            QPointF itemPos = diagramItem->pos(); // 获取图形项的位置
-            QColor itemColor = diagramItem->m_color; // 获取图形项的颜色
-            QSizeF itemSize = diagramItem->boundingRect().size(); // 获取图形项的大小
-            QString content =  diagramItem->textItem->toPlainText();
-            QColor textColor = diagramItem->textItem->defaultTextColor();
-            QFont font =diagramItem->textItem->font();
-
-            dataStream << static_cast<int>(diagramItem->myDiagramType)
-                       << itemPos.x() << itemPos.y()
-                       << itemColor.rgba() // 颜色以RGBA形式存储
-                       << itemSize.width() << itemSize.height() << content <<textColor<<font; // 存储大小
-
-            itemsToCut.append(item); // 将图形项添加到剪切列表
-            QMimeData *mimeData = new QMimeData();
-            mimeData->setData("application/x-diagramscene-item-type", itemData);
-            QApplication::clipboard()->setMimeData(mimeData, QClipboard::Clipboard);
-            qDebug() << "剪切成功";
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item))
+            itemsToCut.append(diagramItem); // 将图形项添加到剪切列表
+    }
+
+    // 与复制相同：两端都在剪切范围内的连线一起放入剪贴板（不要求连线本身被选中）
+    const QSet<DiagramItem *> cutSet(itemsToCut.cbegin(), itemsToCut.cend());
+    QList<QGraphicsItem *> source(itemsToCut.cbegin(), itemsToCut.cend());
+    QSet<DiagramPath *> innerPaths;
+    for (DiagramItem *item : std::as_const(itemsToCut)) {
+        for (DiagramPath *path : std::as_const(item->pathes)) {
+            if (cutSet.contains(path->getStartItem()) && cutSet.contains(path->getEndItem())
+                && !innerPaths.contains(path)) {
+                innerPaths.insert(path);
+                source.append(path);
+            }
         }
     }
-    foreach (QGraphicsItem *item, itemsToCut) {
+
+    QByteArray itemData;
+    QDataStream dataStream(&itemData, QIODevice::WriteOnly);
+    dataStream << scene->toModel(source);
+    QMimeData *mimeData = new QMimeData();
+    mimeData->setData("application/x-diagramscene-item-type", itemData);
+    QApplication::clipboard()->setMimeData(mimeData, QClipboard::Clipboard);
+
+    // 与删除相同，连在被剪切图元上的箭头和连线一并删除
+    for (DiagramItem *item : std::as_const(itemsToCut)) {
+        item->removeArrows();
+        item->removePathes();
         scene->removeItem(item);
         delete item;
     }
@@ -818,84 +663,20 @@ void MainWindow::cutItems() {
 }
 
 void MainWindow::pasteItems(const QPointF &scenePos) {
-    QMap<int,DiagramItem*> idmap;
     const QMimeData *mimeData = QApplication::clipboard()->mimeData();
-    if (mimeData && mimeData->hasFormat("application/x-diagramscene-item-type")) {
-        qDebug()<<"enter item paste";
-        QByteArray itemData = mimeData->data("application/x-diagramscene-item-type");
-        QDataStream dataStream(&itemData, QIODevice::ReadOnly);
-        QPointF firstItemOffset;
-        bool isFirstItem = true;
-        while (!dataStream.atEnd()) {
-            int typeInt;
-            qreal x, y;
-            quint32 color;
-            qreal width, height;
-            QString str;
-            QColor textcolor;
-            QFont font;
-            int id;
-            dataStream >> typeInt >> x >> y >> color >> width >> height>>str>>textcolor>>font>>id;
-
-            QGraphicsItem *newItem = scene->createItem(typeInt); // 直接使用读取的位置
-
-            if (DiagramItem *newDiagramItem = dynamic_cast<DiagramItem*>(newItem)) {
-                QColor itemColor = QColor(color); // 从RGBA值创建QColor对象
-                QSizeF itemSize(width*0.8, height*0.72); // 创建大小
-
-                newDiagramItem->setBrush(itemColor); // 设置颜色
-                newDiagramItem->setFixedSize(itemSize); // 设置固定大小
-                newDiagramItem->textItem->setPlainText(str);//设置文字
-                newDiagramItem->textItem->setDefaultTextColor(textcolor);
-                newDiagramItem->textItem->setFont(font);
-
-                idmap[id] = newDiagramItem;
-
-                if (isFirstItem) {
-                    firstItemOffset = QPointF(x, y);
-                    newDiagramItem->setPos(scenePos);
-                    isFirstItem = false;
-                } else {
-                    QPointF offset = QPointF(x, y) - firstItemOffset;
-                    newDiagramItem->setPos(scenePos + offset);
-                }
-
-                scene->addItem(newItem);
-            }
-        }
-        qDebug()<<"add item finished";
-    }
-
-    if(mimeData->hasFormat("application/x-digramscene-path-type")){
-        qDebug()<<"enter path paste";
-        QByteArray pathData = mimeData->data("application/x-digramscene-path-type");
-        QDataStream dataStream(&pathData,QIODevice::ReadOnly);
-        while(!dataStream.atEnd()){
-            int start;
-            int end;
-            int startp;
-            int endp;
-            dataStream>>start>>end>>startp>>endp;
-            DiagramItem *startItem = idmap[start];
-            DiagramItem *endItem = idmap[end];
-            DiagramItem::TransformState startState = static_cast<DiagramItem::TransformState>(startp);
-            DiagramItem::TransformState endState = static_cast<DiagramItem::TransformState>(endp);
-
-            DiagramPath *path = new DiagramPath(startItem,endItem,startState,endState);
-            startItem->addPathes(path);
-            startItem->marks[path] = "1" + QString::number(startp);
-            endItem->addPathes(path);
-            endItem->marks[path] = "0" + QString::number(endp);
-            path->updatePath();
-            path->setZValue(-1000.0);
-            scene->addItem(path);
-        }
-    }else{
-        qDebug()<<"have no path-type";
-    }
+    if (!mimeData || !mimeData->hasFormat("application/x-diagramscene-item-type"))
+        return;
+    QByteArray itemData = mimeData->data("application/x-diagramscene-item-type");
+    QDataStream dataStream(&itemData, QIODevice::ReadOnly);
+    DiagramModel model;
+    dataStream >> model;
+    if (model.nodeCount() == 0)
+        return;
+    // 第一个图元放到鼠标位置，其余图元保持相对位置；addModel 内部按批量构建插入
+    DiagramScene::BulkBuildGuard bulk(scene);
+    scene->addModel(model, scenePos - model.nodePos(0));
 }
 
-
 void MainWindow::pasteItemsFromMenu() {
     // QPointF scenePos = view->mapToScene(QCursor::pos() - view->pos()); // 获取鼠标当前位置的场景坐标
     QPoint globalMousePos = QCursor::pos();
@@ -938,12 +719,17 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 
     if (messageBox.clickedButton() == saveButton) {
         savefile(); // 调用 savefile() 函数，它将改变 saveFileSuccess 的值
+        // 退出前等后台保存写完：窗口即将关闭，这里仍阻塞界面线程
+        if (saveFileSuccess)
+            saveFileSuccess = waitForSave(pendingSave);
         if (saveFileSuccess) { // 检查 saveFileSuccess 的值
             event->accept();
         } else {
             event->ignore();
         }
     } else if (messageBox.clickedButton() == discardButton) {
+        // 之前发起的保存仍要写完
+        waitForSave(pendingSave);
         event->accept();
     } else if (messageBox.clickedButton() == cancelButton){
         event->ignore();
@@ -1000,10 +786,8 @@ void MainWindow::deleteItem()
     QList<QGraphicsItem *> selectedItems = scene->selectedItems();
     for (QGraphicsItem *item : std::as_const(selectedItems)) {
         if (item->type() == Arrow::Type) {
+            // 端点可能已被 detachItem 置空，由 ~Arrow 从仍存在的端点注销
             scene->removeItem(item);
-            Arrow *arrow = qgraphicsitem_cast<Arrow *>(item);
-            arrow->startItem()->removeArrow(arrow);
-            arrow->endItem()->removeArrow(arrow);
             delete item;
         }
     }
@@ -1026,10 +810,7 @@ void MainWindow::deleteItem()
             savefilestack();
             scene->removeItem(item);
             savefilestack();
-            DiagramPath *path = qgraphicsitem_cast<DiagramPath *>(item);
-            path->getStartItem()->removePath(path);
-            path->getEndItem()->removePath(path);
-            delete item;
+            delete item;   // ~DiagramPath 从两端图元注销
         }
     }
 }
@@ -1190,10 +971,12 @@ void MainWindow::newScene() // 新加
     DiagramScene *newScene = new DiagramScene(itemMenu, this);
     newScene->setSceneRect(QRectF(0, 0, 1920, 1080)); // 设置新场景的矩形区域
     newScene->setBackgroundBrush(QPixmap(":/images/background4.png")); // 设置背景
+    newScene->setPathRouting(DiagramScene::OrthogonalRouting);
 
     // 创建新的视图并关联到新场景
     QGraphicsView *newView = new QGraphicsView(newScene);
     newView->setRenderHint(QPainter::Antialiasing); // 设置抗锯齿，提高渲染质量
+    watchViewport(newView, newScene);
 
     // 设置视图中心，使其与场景的左上角对齐
     newView->centerOn(0, 0);
@@ -1239,6 +1022,7 @@ void MainWindow::closeScene(int index)  // 新加
     disconnect(sceneToRemove, &DiagramScene::itemInserted, this, &MainWindow::itemInserted);
     disconnect(sceneToRemove, &DiagramScene::textInserted, this, &MainWindow::textInserted);
     disconnect(sceneToRemove, &DiagramScene::itemSelected, this, &MainWindow::itemSelected);
+    QGraphicsView *viewToRemove = viewVector.at(index);
     // 从向量中移除场景和视图
     sceneVector.removeAt(index);
     viewVector.removeAt(index);
@@ -1246,6 +1030,9 @@ void MainWindow::closeScene(int index)  // 新加
     tabwidget->removeTab(index);
     // 更新当前场景和视图
     sceneChanged();
+    // 释放场景和视图；场景中正在进行的加载随之停止
+    viewToRemove->deleteLater();
+    sceneToRemove->deleteLater();
 }
 
 //! [20]
@@ -1411,6 +1198,10 @@ void MainWindow::createActions()
     loadFileAction->setStatusTip(tr("读取工程文件"));
     connect(loadFileAction, &QAction::triggered, this, &MainWindow::loadfile);
 
+    journalAction = new QAction(tr("增量保存"), this);
+    journalAction->setCheckable(true);
+    journalAction->setStatusTip(tr("保存时只追加改动，日志过长时在后台合并进工程文件"));
+
     boldAction = new QAction(tr("字体加粗"), this);
     boldAction->setCheckable(true);
     QPixmap pixmap(":/images/bold.png");
@@ -1513,6 +1304,7 @@ void MainWindow::createMenus()
     fileMenu->addAction(newSceneAction);
     fileMenu->addAction(saveFileAction);
     fileMenu->addAction(loadFileAction);
+    fileMenu->addAction(journalAction);
     fileMenu->addAction(saveSceneAction);
 
 
@@ -1538,6 +1330,15 @@ void MainWindow::createMenus()
 //! [24]
 
 //! [34]
+void MainWindow::loadBackgroundIcons()
+{
+    if (backgroundIconsLoaded)
+        return;
+    backgroundIconsLoaded = true;
+    for (int i = 0; i < backgroundComboBox->count(); ++i)
+        backgroundComboBox->setItemIcon(i, QIcon(backgroundComboBox->itemData(i).toString()));
+}
+
 void MainWindow::backgroundChanged(int index)
 {
     QString imagePath = backgroundComboBox->itemData(index).toString();
@@ -1583,10 +1384,11 @@ void MainWindow::createToolbars()
     // 创建背景样式下拉框
     backgroundComboBox = new QComboBox;
     backgroundComboBox->setToolTip(tr("更改画布样式")); // 设置鼠标悬停提示
-    backgroundComboBox->addItem(QIcon(":/images/background1.png"),tr("蓝白网格"), QVariant(":/images/background1.png"));
-    backgroundComboBox->addItem(QIcon(":/images/background2.png"),tr("白色网格"), QVariant(":/images/background2.png"));
-    backgroundComboBox->addItem(QIcon(":/images/background3.png"),tr("灰白网格"), QVariant(":/images/background3.png"));
-    backgroundComboBox->addItem(QIcon(":/images/background4.png"),tr("无网格线"), QVariant(":/images/background4.png"));
+    // 预览图标在首帧之后由 loadBackgroundIcons() 补上，启动时不解码
+    backgroundComboBox->addItem(tr("蓝白网格"), QVariant(":/images/background1.png"));
+    backgroundComboBox->addItem(tr("白色网格"), QVariant(":/images/background2.png"));
+    backgroundComboBox->addItem(tr("灰白网格"), QVariant(":/images/background3.png"));
+    backgroundComboBox->addItem(tr("无网格线"), QVariant(":/images/background4.png"));
     backgroundComboBox->setCurrentIndex(2); // 默认选中 "No Grid"
     backgroundComboBox->setCurrentText("无网格线");
     connect(backgroundComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),this, &MainWindow::backgroundChanged);
@@ -1668,8 +1470,8 @@ QWidget *MainWindow::createBackgroundCellWidget(const QString &text, const QStri
 QWidget *MainWindow::createCellWidget(const QString &text, DiagramItem::DiagramType type)
 {
 
-    DiagramItem item(type, itemMenu);
-    QIcon icon(item.image());
+    // 图标绘制时才从共享图标集取位图，不再为每个按钮构造一个 DiagramItem
+    QIcon icon = ShapeIconAtlas::instance().icon(type);
 
     QToolButton *button = new QToolButton;
     button->setIcon(icon);
@@ -1732,6 +1534,7 @@ void MainWindow::autoCleanStack() {
         while (files.size() > maxFiles-2) {  // 保留一定数量的文件
             QString filePath = dir.filePath(files.first());
             QFile::remove(filePath);
+            stackKeys.remove(files.first());
             files.removeFirst();
             fileCount--;  // 更新文件计数
         }
@@ -1764,81 +1567,13 @@ QString MainWindow::savefilestack(){
     // 保存 saveFilePath 到文件
     // saveSaveFilePath(textFile);
 
-    // 执行保存操作
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::critical(this, tr("保存失败"), tr("无法打开或写入工程信息."));
-        return "default";
-    }
+    // 执行保存操作：取快照后在后台写盘，排在上一个快照文件之后；快照只供撤销，不必同步到磁盘
     fileCount++;  // 增加文件计数
     autoCleanStack();  // 调用清理函数
-    // 创建 QTextStream 对象，并指定编码为 UTF-8
-    QTextStream out(&file);
-    // 获取 DiagramItem 结构体指针列表
-    QList<WriteDiagramItem*> diagramItems = getStructList();
-    // 写入 DiagramItem 结构体列表的大小
-    out << "DT_Size_" << diagramItems.size() << "\n";
-    // 遍历 DiagramItem 结构体指针列表
-    for (WriteDiagramItem* itemPtr : diagramItems) {
-        // 替换 internalText 和 texttype 中的空格为星号
-        QString modifiedInternalText = itemPtr->internalText.replace(" ", "*");
-        QString modifiedTextType = itemPtr->texttype.replace(" ", "*");
-
-        // 写入结构体成员
-        out << itemPtr->x << " "
-            << itemPtr->y << " "
-            << itemPtr->width << " "
-            << itemPtr->height << " "
-            << itemPtr->type << " ";
-        for (int i = 0; i < 4; ++i) {
-            out << itemPtr->rbg[i] << " ";
-        }
-        out << modifiedInternalText << " " // 使用替换后的 internalText
-            << itemPtr->itemtype << " "
-            << modifiedTextType << " " // 使用替换后的 texttype
-            << itemPtr->textsize << " "
-            << itemPtr->boldtype << " "
-            << itemPtr->itlatic << " ";
-        for (int i = 0; i < 4; ++i) {
-            out << itemPtr->textrbg[i] << " ";
-        }
-        out << "\n";
-    }
-    // 关闭文件
-    file.close();
-
-    // 获取 DiagramPath 结构体指针列表
-    // 获取 DiagramPath 结构体指针列表
-    QList<struct WriteDiagramPath *> diagramPathsPtrs = getStructList1();
-    // 如果用户取消了文件选择或列表为空，则不执行任何操作
-    if(!diagramPathsPtrs.isEmpty()){
-        if (textFile.isEmpty() || diagramPathsPtrs.isEmpty()) {
-            qDebug()<<"empty";
-            saveFileSuccess = false;
-            return "default";
-        }
-        // 以追加模式打开文件，以写入 DiagramPath 数据
-        if (!file.open(QIODevice::Append)) {
-            QMessageBox::critical(this, tr("保存失败"), tr("无法打开或写入工程信息."));
-            saveFileSuccess = false;
-            return "default";
-        }
-        // 写入 DiagramPath 结构体列表的大小
-        out << "LN_Size_" << diagramPathsPtrs.size() << "\n";
-
-        // 遍历 DiagramPath 结构体指针列表
-        for (struct WriteDiagramPath *pathPtr : diagramPathsPtrs) {
-            if (pathPtr) {
-                // 写入结构体成员
-                out << pathPtr->start << " "
-                    << pathPtr->startp << " "
-                    << pathPtr->end << " "
-                    << pathPtr->endp << "\n";
-            }
-        }
-    }
-    // 关闭文件
-    file.close();
+    DiagramScene::JournalKeys keys;
+    const DiagramModel model = scene->toModel(&keys);
+    stackKeys.insert(textFile, keys);
+    pendingStackSave = ProjectFile::saveAsync(filePath, model, pendingStackSave, ProjectFile::Scratch);
     undoStack.push(textFile);
     path++;
     return textFile;
@@ -1847,120 +1582,45 @@ QString MainWindow::savefilestack(){
 void MainWindow::loadfilestack(QString str) {
     // QString currentDir = QDir::currentPath();
     qDebug()<<"执行loadfilesstack";
-    QDir dir("stacks");
+    // 快照文件可能还在后台写：写完后再读，界面不等待；期间切换了标签页则不再重建
+    if (pendingStackSave.isValid() && !pendingStackSave.isFinished()) {
+        DiagramScene *target = scene;
+        auto *written = new QFutureWatcher<QString>(target);
+        connect(written, &QFutureWatcher<QString>::finished, this, [this, written, target, str]() {
+            written->deleteLater();
+            if (target == scene)
+                readfilestack(str);
+        });
+        written->setFuture(pendingStackSave);
+        return;
+    }
+    readfilestack(str);
+}
 
+void MainWindow::readfilestack(const QString &str) {
+    QDir dir("stacks");
     QString filePath = dir.filePath(str);
-
-    // 执行保存操作
     QFile file(filePath);
 
     // 以只读模式打开文件
     if (file.open(QIODevice::ReadOnly)) {
-        // 创建 QTextStream 对象
-        QTextStream in(&file);
-
-        // 创建新的列表用于存放读取的数据
-        QList<ReadDiagramItem> readDiagramItems;
-
-        // 读取 DiagramItem 结构体列表的大小
-        QString sizeString;
-        in >> sizeString;
-        if (sizeString.startsWith("DT_Size_")) {
-            quint32 diagramItemCount = sizeString.mid(8).toUInt(); // 去掉前缀并转换为整数
-            for (quint32 i = 0; i < diagramItemCount; ++i) {
-                ReadDiagramItem item;
-                in >> item.x >> item.y >> item.width >> item.height >> item.type;
-                for (int j = 0; j < 4; ++j) {
-                    in >> item.rbg[j];
-                }
-                // 读取 internalText 并替换星号为空格
-                QString internalText;
-                in >> internalText;
-                item.internalText = internalText.replace("*", " ");
-                in >> item.itemtype;
-                // 读取 texttype 并替换星号为空格
-                QString textType;
-                in >> textType;
-                item.texttype = textType.replace("*", " ");
-                in >> item.textsize;
-                // 读取布尔值需要特殊处理
-                QString boldTypeStr;
-                in >> boldTypeStr;
-                item.boldtype = (boldTypeStr == "true");
-
-                QString itlaticStr;
-                in >> itlaticStr;
-                item.itlatic = (itlaticStr == "true");
-
-                for (int j = 0; j < 4; ++j) {
-                    in >> item.textrbg[j];
-                }
-
-                readDiagramItems.append(item);
-            }
-
+        DiagramModel model;
+        QString error;
+        if (!ProjectFile::read(file, &model, &error)) {
+            qWarning() << "undo stack file" << filePath << error;
+            return;
         }
-
-        QList<ReadDiagramPath> readDiagramPaths;
-        in >> sizeString;
-        if (sizeString.startsWith("LN_Size_")) {
-            quint32 diagramPathCount = sizeString.mid(8).toUInt(); // 去掉前缀并转换为整数
-            for (quint32 i = 0; i < diagramPathCount; ++i) {
-                ReadDiagramPath path;
-                in >> path.start >> path.startp >> path.end >> path.endp;
-                // 调试输出每个读取到的 DiagramPath
-                qDebug() << "Read DiagramPath:";
-                qDebug() << "start: " << path.start;
-                qDebug() << "startp: " << path.startp;
-                qDebug() << "end: " << path.end;
-                qDebug() << "endp: " << path.endp;
-                readDiagramPaths.append(path);
-            }
+        if (scene->journal()) {
+            // 接回取快照时的日志键，下一次保存只追加与撤销前不同的部分
+            scene->restoreModel(model, stackKeys.value(str));
+            return;
         }
+        // 清空和重建都在批量构建中进行，索引和连线路由只在最后做一次
+        DiagramScene::BulkBuildGuard bulk(scene);
+        scene->clearVirtualModel();
         scene->clear();
-
-        QList<DiagramItem *> DiagramItemList;
-
-        foreach (ReadDiagramItem item,readDiagramItems) {
-            DiagramItem *item1=new DiagramItem(static_cast<DiagramItem::DiagramType>(item.itemtype),itemMenu);
-            item1->setPos(QPoint(item.x,item.y));
-            item1->setFixedSize(QSize(item.width,item.height));
-            QColor itemcolor(item.rbg[0],item.rbg[2],item.rbg[1],item.rbg[3]);
-            QColor textcolor(item.textrbg[0],item.textrbg[2],item.textrbg[1],item.textrbg[3]);
-            item1->m_color=itemcolor;
-            item1->textItem->setPlainText(item.internalText);
-            item1->textItem->font().setPointSize(item.textsize);
-            item1->textItem->font().setFamily(item.texttype);
-            item1->textItem->font().setBold(item.boldtype);
-            item1->textItem->font().setItalic(item.itlatic);
-            item1->textItem->setDefaultTextColor(textcolor);
-            scene->addItem(item1);
-            DiagramItemList.append(item1);
-        }
-        int size = DiagramItemList.size();
-        qDebug()<<"size: "<< size;
-        foreach (ReadDiagramPath item,readDiagramPaths) {
-            DiagramItem *startItem = DiagramItemList.at(item.start-1 );
-            DiagramItem *endItem = DiagramItemList.at(item.end-1 );
-            qDebug()<<scene->items();
-            DiagramItem::TransformState startState = static_cast<DiagramItem::TransformState>(item.startp);
-            DiagramItem::TransformState endState = static_cast<DiagramItem::TransformState>(item.endp);
-
-            DiagramPath *item1=new DiagramPath(startItem,endItem,startState,endState);
-
-            startItem->addPathes(item1);
-            startItem->marks[item1] = "1" + QString::number(startState);
-            qDebug()<<startItem->marks;
-            endItem->addPathes(item1);
-            endItem->marks[item1] = "0" + QString::number(endState);
-            qDebug()<<endItem->marks;
-            qDebug()<<startState<<endState;
-            item1->updatePath();
-            item1->setZValue(-1000.0);
-
-            scene->addItem(item1);
-
-        }        // 提示用户读取成功
+        showModel(model);
+        // 提示用户读取成功
         // QMessageBox::information(this, tr("加载完成"), tr("成功加载工程."));
     } else {
         // 文件打开失败，提示用户错误信息
@@ -10,10 +10,14 @@
 #include <QPixmap>
 #include "diagramitem.h"
 #include<QStack>
+#include <QFuture>
 #include "findreplacedialog.h"  // 包含新添加的查找和替换对话框
 #include "diagramtextitem.h"// 确保包含了 DiagramTextItem 的头文件
+#include "diagramscene.h"
+#include <QHash>
 
-class DiagramScene;
+class DiagramModel;
+class VirtualDiagram;
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -65,6 +69,7 @@ private slots:
     bool saveSceneAsImage();
     void closeEvent(QCloseEvent *event);
     void backgroundChanged(int index);
+    void loadBackgroundIcons();     // 背景下拉框的预览图标，首帧后加载
     void newScene();    //新加
     void sceneymChanged();//新加
     void closeScene(int index); //新加
@@ -83,10 +88,9 @@ private slots:
     bool saveSceneAsImageOrSvg();
     QString loadSaveFilePath();
     void loadfile();
-    QList<struct WriteDiagramItem *> getStructList();
-    QList<struct WriteDiagramPath *> getStructList1();
     QString savefilestack();
     void loadfilestack(QString str);
+    void readfilestack(const QString &str);   // 读快照文件并重建当前场景，文件须已写完
     void autoCleanStack();
     void undo();
     void redo();
@@ -111,6 +115,12 @@ private:
     QWidget *createCellWidget(const QString &text,
                               DiagramItem::DiagramType type);
 
+    void watchViewport(QGraphicsView *view, DiagramScene *scene);
+    void showModel(const DiagramModel &model);   // 在当前场景中显示模型，超大图使用虚拟化场景
+    bool findInVirtualScene(VirtualDiagram *virtualDiagram, const QString &text);
+    void highlightFoundText(QGraphicsItem *item, int index, int length);
+    bool waitForSave(QFuture<QString> &future);   // 阻塞界面线程，只用于退出前
+
     template<typename PointerToMemberFunction>
     QIcon createColorIcon(QColor color);
 
@@ -128,6 +138,7 @@ private:
     QAction *cutAction;
     QAction *saveFileAction;
     QAction *loadFileAction;
+    QAction *journalAction;
 
     QAction *findAction;
     QAction *combineAction;
@@ -179,9 +190,15 @@ private:
     QStack<QString> undoStack;
     QStack<QString> redoStack;
 
-    FindReplaceDialog *findReplaceDialog;  // 查找和替换对话框指针
-    DiagramTextItem *currentTextItem = nullptr;  // 当前查找的文本项
+    FindReplaceDialog *findReplaceDialog = nullptr;  // 查找和替换对话框指针，第一次使用时创建
+    bool backgroundIconsLoaded = false;
+    QGraphicsItem *currentFoundItem = nullptr;   // 当前查找到的文本项或图元，只用于比较，不解引用
     int lastSearchPosition = -1;
+    int lastFoundNode = -1;   // 虚拟化场景中上次查找到的节点
+    QFuture<QString> pendingSave;        // 后台进行中的工程保存，多次保存依次接续
+    QString pendingSavePath;
+    QFuture<QString> pendingStackSave;   // 后台进行中的撤销快照保存
+    QHash<QString, DiagramScene::JournalKeys> stackKeys;   // 撤销快照文件 -> 取快照时的日志键
     int path=0;
     int fileCount=0;
 };
@@ -0,0 +1,285 @@
+#include "orthogonalrouter.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace {
+const qreal infinity = std::numeric_limits<qreal>::infinity();
+
+OrthogonalRouter::Direction opposite(OrthogonalRouter::Direction dir)
+{
+    return dir == OrthogonalRouter::NoDirection ? dir : OrthogonalRouter::Direction((dir + 2) % 4);
+}
+
+void sortUnique(std::vector<qreal> &values)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+int indexOf(const std::vector<qreal> &values, qreal value)
+{
+    return int(std::lower_bound(values.begin(), values.end(), value) - values.begin());
+}
+
+// 稀疏正交可见图：网格线为障碍物边和起终点坐标，记录哪些节点、边落在障碍物内部
+struct VisibilityGrid
+{
+    std::vector<qreal> xs;
+    std::vector<qreal> ys;
+    int nx = 0;
+    int ny = 0;
+    std::vector<char> nodeBlocked;   // ny * nx
+    std::vector<char> hBlocked;      // ny * (nx - 1)，(xi, yi) -> (xi + 1, yi)
+    std::vector<char> vBlocked;      // (ny - 1) * nx，(xi, yi) -> (xi, yi + 1)
+
+    void build(const QList<QRectF> &obstacles, const QRectF &region,
+               const QPointF &start, const QPointF &end)
+    {
+        // 中线让起终点之间可以走 Z 形，不必贴着图元拐弯
+        xs = { region.left(), region.right(), start.x(), end.x(), (start.x() + end.x()) / 2 };
+        ys = { region.top(), region.bottom(), start.y(), end.y(), (start.y() + end.y()) / 2 };
+        for (const QRectF &r : obstacles) {
+            if (r.left() > region.left() && r.left() < region.right())
+                xs.push_back(r.left());
+            if (r.right() > region.left() && r.right() < region.right())
+                xs.push_back(r.right());
+            if (r.top() > region.top() && r.top() < region.bottom())
+                ys.push_back(r.top());
+            if (r.bottom() > region.top() && r.bottom() < region.bottom())
+                ys.push_back(r.bottom());
+        }
+        sortUnique(xs);
+        sortUnique(ys);
+        nx = int(xs.size());
+        ny = int(ys.size());
+        nodeBlocked.assign(size_t(nx) * ny, 0);
+        hBlocked.assign(size_t(nx - 1) * ny, 0);
+        vBlocked.assign(size_t(nx) * (ny - 1), 0);
+
+        // 网格线包含了所有障碍物的边，相邻两条网格线之间的线段要么整段在障碍物内部，要么整段在外
+        for (const QRectF &r : obstacles) {
+            // 严格落在障碍物内部的网格线范围
+            const int xIn0 = int(std::upper_bound(xs.begin(), xs.end(), r.left()) - xs.begin());
+            const int xIn1 = indexOf(xs, r.right()) - 1;
+            const int yIn0 = int(std::upper_bound(ys.begin(), ys.end(), r.top()) - ys.begin());
+            const int yIn1 = indexOf(ys, r.bottom()) - 1;
+            // 含边界的网格线范围
+            const int xOn0 = indexOf(xs, r.left());
+            const int xOn1 = int(std::upper_bound(xs.begin(), xs.end(), r.right()) - xs.begin()) - 1;
+            const int yOn0 = indexOf(ys, r.top());
+            const int yOn1 = int(std::upper_bound(ys.begin(), ys.end(), r.bottom()) - ys.begin()) - 1;
+
+            for (int yi = yIn0; yi <= yIn1; ++yi) {
+                for (int xi = xIn0; xi <= xIn1; ++xi)
+                    nodeBlocked[size_t(yi) * nx + xi] = 1;
+                for (int xi = xOn0; xi < xOn1; ++xi)
+                    hBlocked[size_t(yi) * (nx - 1) + xi] = 1;
+            }
+            for (int yi = yOn0; yi < yOn1; ++yi) {
+                for (int xi = xIn0; xi <= xIn1; ++xi)
+                    vBlocked[size_t(yi) * nx + xi] = 1;
+            }
+        }
+    }
+
+    // 从 node 沿 dir 走到相邻节点，不可走时返回 -1
+    int neighbor(int node, OrthogonalRouter::Direction dir) const
+    {
+        const int xi = node % nx;
+        const int yi = node / nx;
+        int next = -1;
+        switch (dir) {
+        case OrthogonalRouter::East:
+            if (xi + 1 < nx && !hBlocked[size_t(yi) * (nx - 1) + xi])
+                next = node + 1;
+            break;
+        case OrthogonalRouter::West:
+            if (xi > 0 && !hBlocked[size_t(yi) * (nx - 1) + xi - 1])
+                next = node - 1;
+            break;
+        case OrthogonalRouter::South:
+            if (yi + 1 < ny && !vBlocked[size_t(yi) * nx + xi])
+                next = node + nx;
+            break;
+        case OrthogonalRouter::North:
+            if (yi > 0 && !vBlocked[size_t(yi - 1) * nx + xi])
+                next = node - nx;
+            break;
+        default:
+            break;
+        }
+        return next >= 0 && !nodeBlocked[size_t(next)] ? next : -1;
+    }
+
+    QPointF point(int node) const { return QPointF(xs[size_t(node % nx)], ys[size_t(node / nx)]); }
+};
+}
+
+OrthogonalRouter::OrthogonalRouter(const Options &options)
+    : opts(options)
+{
+}
+
+QPointF OrthogonalRouter::step(Direction dir)
+{
+    switch (dir) {
+    case East: return QPointF(1, 0);
+    case South: return QPointF(0, 1);
+    case West: return QPointF(-1, 0);
+    case North: return QPointF(0, -1);
+    default: return QPointF();
+    }
+}
+
+QRectF OrthogonalRouter::searchRegion(const Request &request, int expansion) const
+{
+    const qreal padding = opts.searchPadding * (1 + 3 * expansion);
+    return QRectF(request.start, request.end).normalized()
+        .adjusted(-padding, -padding, padding, padding);
+}
+
+OrthogonalRouter::Result OrthogonalRouter::route(const Request &request, const ObstacleQuery &query) const
+{
+    Result result;
+    for (int expansion = 0; expansion <= opts.maxExpansions; ++expansion) {
+        const QRectF region = searchRegion(request, expansion);
+        const int expanded = result.expanded;
+        // 外扩后会伸进区域的障碍物也要取到
+        const qreal m = opts.margin;
+        result = routeIn(request, query(region.adjusted(-m, -m, m, m)), region);
+        result.expanded += expanded;
+        if (!result.points.isEmpty())
+            break;
+    }
+    return result;
+}
+
+OrthogonalRouter::Result OrthogonalRouter::route(const Request &request, const QList<QRectF> &obstacles) const
+{
+    return route(request, [&obstacles](const QRectF &region) {
+        QList<QRectF> nearby;
+        for (const QRectF &r : obstacles) {
+            if (r.intersects(region))
+                nearby.append(r);
+        }
+        return nearby;
+    });
+}
+
+OrthogonalRouter::Result OrthogonalRouter::routeIn(const Request &request, const QList<QRectF> &obstacles,
+                                                   const QRectF &region) const
+{
+    Result result;
+    result.corridor = region;
+
+    // 障碍物外扩；包含起点或终点的障碍物不参与（连接点落在别的图元上时仍能连出）
+    QList<QRectF> inflated;
+    inflated.reserve(obstacles.size());
+    for (const QRectF &r : obstacles) {
+        const QRectF grown = r.adjusted(-opts.margin, -opts.margin, opts.margin, opts.margin);
+        auto strictlyContains = [&grown](const QPointF &p) {
+            return p.x() > grown.left() && p.x() < grown.right()
+                   && p.y() > grown.top() && p.y() < grown.bottom();
+        };
+        if (!grown.intersects(region) || strictlyContains(request.start) || strictlyContains(request.end))
+            continue;
+        inflated.append(grown);
+    }
+
+    VisibilityGrid grid;
+    grid.build(inflated, region, request.start, request.end);
+    const int startNode = indexOf(grid.ys, request.start.y()) * grid.nx + indexOf(grid.xs, request.start.x());
+    const int endNode = indexOf(grid.ys, request.end.y()) * grid.nx + indexOf(grid.xs, request.end.x());
+
+    // 状态 = 节点 * 4 + 到达方向；转 180 度不允许，转 90 度加拐弯代价
+    const size_t stateCount = size_t(grid.nx) * grid.ny * 4;
+    std::vector<qreal> cost(stateCount, infinity);
+    std::vector<int> parent(stateCount, -1);
+    using Entry = std::pair<qreal, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    auto heuristic = [&](int node) {
+        const QPointF p = grid.point(node);
+        return std::abs(p.x() - request.end.x()) + std::abs(p.y() - request.end.y());
+    };
+    // 起点按四个方向入队：沿连接点方向离开没有额外代价，侧向离开加 portPenalty，不能反向穿回图元
+    for (int d = 0; d < 4; ++d) {
+        const Direction dir = Direction(d);
+        if (request.startDir != NoDirection && dir == opposite(request.startDir))
+            continue;
+        const qreal initial = request.startDir == NoDirection || dir == request.startDir ? 0 : opts.portPenalty;
+        const int state = startNode * 4 + d;
+        cost[size_t(state)] = initial;
+        open.push({ initial + heuristic(startNode), state });
+    }
+    const Direction entryDir = opposite(request.endDir);
+
+    qreal best = infinity;
+    int bestState = -1;
+    while (!open.empty()) {
+        const auto [f, state] = open.top();
+        open.pop();
+        if (f >= best)
+            break;
+        const qreal g = cost[size_t(state)];
+        if (f > g + heuristic(state / 4) + 1e-9)
+            continue;   // 过期的队列项
+        ++result.expanded;
+
+        const int node = state / 4;
+        const Direction dir = Direction(state % 4);
+        if (node == endNode) {
+            const qreal total = g + (entryDir != NoDirection && dir != entryDir ? opts.portPenalty : 0);
+            if (total < best) {
+                best = total;
+                bestState = state;
+            }
+            continue;
+        }
+
+        for (int d = 0; d < 4; ++d) {
+            const Direction nextDir = Direction(d);
+            if (nextDir == opposite(dir))
+                continue;
+            const int next = grid.neighbor(node, nextDir);
+            if (next < 0)
+                continue;
+            const QPointF a = grid.point(node);
+            const QPointF b = grid.point(next);
+            const qreal nextCost = g + std::abs(b.x() - a.x()) + std::abs(b.y() - a.y())
+                                   + (nextDir != dir ? opts.bendPenalty : 0);
+            const int nextState = next * 4 + d;
+            if (nextCost < cost[size_t(nextState)]) {
+                cost[size_t(nextState)] = nextCost;
+                parent[size_t(nextState)] = state;
+                open.push({ nextCost + heuristic(next), nextState });
+            }
+        }
+    }
+
+    if (bestState < 0)
+        return result;
+
+    // 回溯并合并共线的点，只保留拐点
+    QList<QPointF> nodes;
+    for (int state = bestState; state >= 0; state = parent[size_t(state)])
+        nodes.prepend(grid.point(state / 4));
+    for (const QPointF &p : std::as_const(nodes)) {
+        if (result.points.size() >= 2) {
+            const QPointF &a = result.points.at(result.points.size() - 2);
+            const QPointF &b = result.points.last();
+            if ((a.x() == b.x() && b.x() == p.x()) || (a.y() == b.y() && b.y() == p.y())) {
+                result.points.last() = p;
+                continue;
+            }
+        }
+        if (result.points.isEmpty() || result.points.last() != p)
+            result.points.append(p);
+    }
+    if (result.points.size() == 1)
+        result.points.append(request.end);
+    return result;
+}
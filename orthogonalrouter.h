@@ -0,0 +1,146 @@
+#ifndef ORTHOGONALROUTER_H
+#define ORTHOGONALROUTER_H
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+
+#include <cmath>
+#include <functional>
+
+// 正交连线路由
+// 在起点、终点附近的障碍物（图元外框）上建立稀疏正交可见图：
+// 只取障碍物外扩后的边、起终点及其中线所在的横纵坐标作为网格线，网格交点为节点，
+// 再用 A*（曼哈顿距离 + 拐弯代价）找拐弯少、长度短且不穿过障碍物的折线。
+// 纯几何计算，不依赖场景，可在任意线程调用
+class OrthogonalRouter
+{
+public:
+    enum Direction { East, South, West, North, NoDirection };
+
+    struct Request {
+        QPointF start;                      // 起点（起点图元连接点）
+        Direction startDir = NoDirection;   // 离开起点图元的方向
+        QPointF end;                        // 终点（终点图元连接点）
+        Direction endDir = NoDirection;     // 终点图元连接点朝外的方向，连线从反方向进入
+    };
+
+    struct Result {
+        QList<QPointF> points;   // 折线拐点，含起点和终点；路由失败时为空
+        QRectF corridor;         // 参与路由的区域，区域内障碍物变化时需要重算
+        int expanded = 0;        // A* 展开的节点数
+    };
+
+    struct Options {
+        qreal margin = 5;          // 连线与障碍物保持的距离
+        qreal searchPadding = 120; // 起终点外接矩形向外扩展的搜索范围
+        qreal bendPenalty = 40;    // 每个拐弯折合的长度
+        qreal portPenalty = 80;    // 不沿连接点方向离开或进入图元的额外代价
+        int maxExpansions = 1;     // 搜索失败时搜索范围扩大的次数
+    };
+
+    // 返回与 region 相交的障碍物（场景坐标下的图元外框），结果与顺序无关
+    using ObstacleQuery = std::function<QList<QRectF>(const QRectF &region)>;
+
+    explicit OrthogonalRouter(const Options &options = Options());
+
+    const Options &options() const { return opts; }
+
+    // 本次请求需要的障碍物查询范围（调用方据此收集障碍物）
+    QRectF searchRegion(const Request &request, int expansion = 0) const;
+
+    // 障碍物在内部按 margin 外扩；搜索失败时扩大范围重新查询障碍物
+    Result route(const Request &request, const ObstacleQuery &query) const;
+    Result route(const Request &request, const QList<QRectF> &obstacles) const;
+
+    static QPointF step(Direction dir);
+
+private:
+    Result routeIn(const Request &request, const QList<QRectF> &obstacles, const QRectF &region) const;
+
+    Options opts;
+};
+
+// 连线路由区域索引
+// 按均匀网格登记每条连线的路由区域，图元进入或离开某个区域时只重算对应的连线
+template <typename Key>
+class RouteCorridorIndex
+{
+public:
+    explicit RouteCorridorIndex(qreal cellSize = 200) : cell(cellSize) {}
+
+    void update(Key key, const QRectF &corridor)
+    {
+        remove(key);
+        if (corridor.isEmpty())
+            return;
+        corridors.insert(key, corridor);
+        forEachCell(corridor, [&](const QPoint &c) { grid[c].append(key); });
+    }
+
+    void remove(Key key)
+    {
+        auto it = corridors.find(key);
+        if (it == corridors.end())
+            return;
+        forEachCell(it.value(), [&](const QPoint &c) {
+            auto cellIt = grid.find(c);
+            if (cellIt == grid.end())
+                return;
+            cellIt.value().removeAll(key);
+            if (cellIt.value().isEmpty())
+                grid.erase(cellIt);
+        });
+        corridors.erase(it);
+    }
+
+    void clear()
+    {
+        grid.clear();
+        corridors.clear();
+    }
+
+    bool contains(Key key) const { return corridors.contains(key); }
+    QRectF corridorOf(Key key) const { return corridors.value(key); }
+    int size() const { return corridors.size(); }
+
+    // 路由区域与 rect 相交的所有连线（不重复）
+    QList<Key> intersecting(const QRectF &rect) const
+    {
+        QList<Key> result;
+        if (rect.isEmpty())
+            return result;
+        forEachCell(rect, [&](const QPoint &c) {
+            const auto cellIt = grid.constFind(c);
+            if (cellIt == grid.cend())
+                return;
+            for (Key key : cellIt.value()) {
+                if (!result.contains(key) && corridors.value(key).intersects(rect))
+                    result.append(key);
+            }
+        });
+        return result;
+    }
+
+private:
+    template <typename Fn>
+    void forEachCell(const QRectF &rect, Fn fn) const
+    {
+        const int x0 = int(std::floor(rect.left() / cell));
+        const int x1 = int(std::floor(rect.right() / cell));
+        const int y0 = int(std::floor(rect.top() / cell));
+        const int y1 = int(std::floor(rect.bottom() / cell));
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx)
+                fn(QPoint(cx, cy));
+        }
+    }
+
+    qreal cell;
+    QHash<QPoint, QList<Key>> grid;   // 网格 -> 路由区域覆盖该格的连线
+    QHash<Key, QRectF> corridors;     // 连线 -> 当前登记的路由区域，用于增量删除
+};
+
+#endif // ORTHOGONALROUTER_H
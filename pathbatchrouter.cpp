@@ -0,0 +1,83 @@
+#include "pathbatchrouter.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+ObstacleSnapshot::ObstacleSnapshot(qreal cellSize)
+    : cell(cellSize)
+{
+}
+
+QPoint ObstacleSnapshot::cellOf(const QPointF &pos) const
+{
+    return QPoint(int(std::floor(pos.x() / cell)), int(std::floor(pos.y() / cell)));
+}
+
+void ObstacleSnapshot::add(const QRectF &rect)
+{
+    const int index = rects.size();
+    rects.append(rect);
+    const QPoint from = cellOf(rect.topLeft());
+    const QPoint to = cellOf(rect.bottomRight());
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx)
+            grid[QPoint(cx, cy)].append(index);
+    }
+}
+
+QList<QRectF> ObstacleSnapshot::query(const QRectF &region) const
+{
+    std::vector<int> hits;
+    const QPoint from = cellOf(region.topLeft());
+    const QPoint to = cellOf(region.bottomRight());
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx) {
+            const auto cellIt = grid.constFind(QPoint(cx, cy));
+            if (cellIt == grid.cend())
+                continue;
+            for (int index : cellIt.value()) {
+                if (rects.at(index).intersects(region))
+                    hits.push_back(index);
+            }
+        }
+    }
+    // 跨多个格子的障碍物只返回一次
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+    QList<QRectF> result;
+    result.reserve(qsizetype(hits.size()));
+    for (int index : hits)
+        result.append(rects.at(index));
+    return result;
+}
+
+QList<PathBatchRouter::Output> PathBatchRouter::run(const QList<Job> &jobs, const ObstacleSnapshot &obstacles,
+                                                    const OrthogonalRouter &router, int parallelThreshold)
+{
+    auto routeOne = [&obstacles, &router](const Job &job) {
+        Output output;
+        QList<QPointF> route;
+        if (job.orthogonal) {
+            const OrthogonalRouter::Result result = router.route(
+                DiagramPath::routeRequest(job.ends),
+                [&obstacles](const QRectF &region) { return obstacles.query(region); });
+            route = result.points;
+            output.corridor = result.corridor;
+        }
+        output.geometry = DiagramPath::buildGeometry(job.ends, route);
+        return output;
+    };
+
+    if (jobs.size() < parallelThreshold) {
+        QList<Output> outputs;
+        outputs.reserve(jobs.size());
+        for (const Job &job : jobs)
+            outputs.append(routeOne(job));
+        return outputs;
+    }
+    return QtConcurrent::blockingMapped<QList<Output>>(jobs, routeOne);
+}
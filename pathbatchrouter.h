@@ -0,0 +1,51 @@
+#ifndef PATHBATCHROUTER_H
+#define PATHBATCHROUTER_H
+
+#include "diagrampath.h"
+#include "orthogonalrouter.h"
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QRectF>
+
+// 障碍物快照
+// 在 GUI 线程一次性取出所有顶层图元的外框放进均匀网格，之后只读，多个工作线程可同时查询
+class ObstacleSnapshot
+{
+public:
+    explicit ObstacleSnapshot(qreal cellSize = 200);
+
+    void add(const QRectF &rect);
+    int size() const { return rects.size(); }
+    QList<QRectF> query(const QRectF &region) const;   // 与 region 相交的障碍物，不重复
+
+private:
+    QPoint cellOf(const QPointF &pos) const;
+
+    qreal cell;
+    QList<QRectF> rects;
+    QHash<QPoint, QList<int>> grid;   // 网格 -> 覆盖该格的障碍物下标
+};
+
+// 连线批量路由
+// 加载、粘贴等一次生成大量连线时使用：端点和障碍物都来自快照，
+// 线程池中只做纯几何计算（路由 + 生成 QPainterPath），结果按输入顺序返回，由调用方在 GUI 线程一次应用
+class PathBatchRouter
+{
+public:
+    struct Job {
+        DiagramPath::Endpoints ends;
+        bool orthogonal = false;   // false 时套用固定折线
+    };
+    struct Output {
+        DiagramPath::Geometry geometry;
+        QRectF corridor;           // 正交路由的路由区域
+    };
+
+    // 少于 parallelThreshold 条时直接在当前线程计算，省去线程调度
+    static QList<Output> run(const QList<Job> &jobs, const ObstacleSnapshot &obstacles,
+                             const OrthogonalRouter &router, int parallelThreshold = 64);
+};
+
+#endif // PATHBATCHROUTER_H
@@ -0,0 +1,130 @@
+#include "portindex.h"
+
+#include <cmath>
+
+PortIndex::PortIndex(qreal cellSize)
+    : cell(cellSize)
+{
+}
+
+QPoint PortIndex::cellOf(const QPointF &pos) const
+{
+    return QPoint(int(std::floor(pos.x() / cell)), int(std::floor(pos.y() / cell)));
+}
+
+void PortIndex::update(DiagramItem *item)
+{
+    QList<Port> itemPorts;
+    static const DiagramItem::TransformState sides[] = {
+        DiagramItem::TF_Right, DiagramItem::TF_Left, DiagramItem::TF_Bottom, DiagramItem::TF_Top
+    };
+    itemPorts.reserve(4);
+    for (DiagramItem::TransformState side : sides) {
+        Port port;
+        port.item = item;
+        port.state = side;
+        port.pos = item->mapToScene(item->portRect(side).center());
+        itemPorts.append(port);
+    }
+
+    auto old = ports.find(item);
+    if (old != ports.end()) {
+        removeFromGrid(item, old.value());
+        old.value() = itemPorts;
+    } else {
+        ports.insert(item, itemPorts);
+    }
+
+    for (const Port &port : std::as_const(itemPorts))
+        grid[cellOf(port.pos)].append(port);
+}
+
+void PortIndex::remove(DiagramItem *item)
+{
+    auto it = ports.find(item);
+    if (it == ports.end())
+        return;
+    removeFromGrid(item, it.value());
+    ports.erase(it);
+}
+
+void PortIndex::clear()
+{
+    grid.clear();
+    ports.clear();
+}
+
+void PortIndex::removeFromGrid(DiagramItem *item, const QList<Port> &itemPorts)
+{
+    for (const Port &port : itemPorts) {
+        auto cellIt = grid.find(cellOf(port.pos));
+        if (cellIt == grid.end())
+            continue;
+        cellIt.value().removeIf([item](const Port &p) { return p.item == item; });
+        if (cellIt.value().isEmpty())
+            grid.erase(cellIt);
+    }
+}
+
+PortIndex::Port PortIndex::nearest(const QPointF &pos, qreal radius, const DiagramItem *exclude) const
+{
+    Port best;
+    qreal bestDistance = 0;
+
+    const QPoint from = cellOf(pos - QPointF(radius, radius));
+    const QPoint to = cellOf(pos + QPointF(radius, radius));
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx) {
+            const auto cellIt = grid.constFind(QPoint(cx, cy));
+            if (cellIt == grid.cend())
+                continue;
+            for (const Port &port : cellIt.value()) {
+                if (port.item == exclude)
+                    continue;
+                const QPointF d = port.pos - pos;
+                if (qAbs(d.x()) > radius || qAbs(d.y()) > radius)
+                    continue;
+                const qreal distance = QPointF::dotProduct(d, d);
+                if (!best.item || distance < bestDistance) {
+                    best = port;
+                    bestDistance = distance;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+QList<PortIndex::Port> PortIndex::portsIn(const QRectF &rect) const
+{
+    QList<Port> result;
+    if (rect.isEmpty() || grid.isEmpty())
+        return result;
+
+    const QPoint from = cellOf(rect.topLeft());
+    const QPoint to = cellOf(rect.bottomRight());
+    const qreal cellCount = (qreal(to.x()) - from.x() + 1) * (qreal(to.y()) - from.y() + 1);
+
+    const auto collect = [&](const QList<Port> &cellPorts) {
+        for (const Port &port : cellPorts) {
+            if (rect.contains(port.pos))
+                result.append(port);
+        }
+    };
+
+    // 区域覆盖的格子比已占用的格子还多时（例如缩小查看整张图），直接遍历已占用的格子
+    if (cellCount > grid.size()) {
+        for (auto it = grid.cbegin(); it != grid.cend(); ++it)
+            collect(it.value());
+        return result;
+    }
+
+    for (int cy = from.y(); cy <= to.y(); ++cy) {
+        for (int cx = from.x(); cx <= to.x(); ++cx) {
+            const auto cellIt = grid.constFind(QPoint(cx, cy));
+            if (cellIt != grid.cend())
+                collect(cellIt.value());
+        }
+    }
+    return result;
+}
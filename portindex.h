@@ -0,0 +1,48 @@
+#ifndef PORTINDEX_H
+#define PORTINDEX_H
+
+#include "diagramitem.h"
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+
+// 连接点索引
+// 按场景坐标把每个 DiagramItem 的四个连接点放进均匀网格，
+// 查找鼠标附近的连接点时只检查周围几个格子，不再逐个图元遍历 linkWhere()
+class PortIndex
+{
+public:
+    struct Port {
+        DiagramItem *item = nullptr;                              // 所属图元，没有命中时为 nullptr
+        DiagramItem::TransformState state = DiagramItem::TF_Cen;  // 连接点方位
+        QPointF pos;                                              // 连接点中心（场景坐标）
+    };
+
+    explicit PortIndex(qreal cellSize = 50);
+
+    void update(DiagramItem *item);   // 按图元当前几何重新登记连接点
+    void remove(DiagramItem *item);
+    void clear();
+
+    bool contains(DiagramItem *item) const { return ports.contains(item); }
+    int size() const { return ports.size(); }
+    QList<Port> portsOf(DiagramItem *item) const { return ports.value(item); }
+
+    // 查找以 pos 为中心、边长 2*radius 的方形磁吸区内最近的连接点，exclude 的连接点不参与
+    Port nearest(const QPointF &pos, qreal radius, const DiagramItem *exclude = nullptr) const;
+    // 返回落在 rect 内的所有连接点
+    QList<Port> portsIn(const QRectF &rect) const;
+
+private:
+    QPoint cellOf(const QPointF &pos) const;
+    void removeFromGrid(DiagramItem *item, const QList<Port> &itemPorts);
+
+    qreal cell;
+    QHash<QPoint, QList<Port>> grid;           // 网格 -> 落在其中的连接点
+    QHash<DiagramItem *, QList<Port>> ports;   // 图元 -> 当前登记的连接点，用于增量删除
+};
+
+#endif // PORTINDEX_H
@@ -0,0 +1,374 @@
+#include "projectfile.h"
+#include "diagrammodel.h"
+#include "fcprojtextreader.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <cstring>
+
+static const char fileMagic[4] = { 'F', 'C', 'P', 'J' };
+static const int headerSize = 16;
+static const int chunkHeaderSize = 8;
+static const int styleRecordSize = 16;
+static const int nodeRecordSize = 48;
+static const int edgeRecordSize = 12;
+
+static qint64 padded(qint64 size)
+{
+    return (size + 3) & ~qint64(3);
+}
+
+// 写入预先按总长分配好的缓冲区，p 随写入前移
+template <typename T>
+static void put(char *&p, T value)
+{
+    qToLittleEndian(value, p);
+    p += sizeof(T);
+}
+
+static void putByte(char *&p, quint8 value)
+{
+    *p++ = char(value);
+}
+
+static void putDouble(char *&p, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(p, bits);
+}
+
+static void putBytes(char *&p, const char *data, qint64 size)
+{
+    std::memcpy(p, data, size_t(size));
+    p += size;
+}
+
+static void putChunk(char *&p, const char *tag, qint64 size)
+{
+    putBytes(p, tag, 4);
+    put(p, quint32(size));
+}
+
+static void putPadding(char *&p, qint64 size)
+{
+    const qint64 n = padded(size) - size;
+    std::memset(p, 0, size_t(n));
+    p += n;
+}
+
+template <typename T>
+static T get(const char *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+static double getDouble(const char *p)
+{
+    const quint64 bits = get<quint64>(p);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool ProjectFile::isBinary(const char *data, qint64 size)
+{
+    return size >= 4 && std::memcmp(data, fileMagic, 4) == 0;
+}
+
+QByteArray ProjectFile::encode(const DiagramModel &model)
+{
+    const int nodeTotal = model.types.size();
+    const int styleTotal = model.styles.size();
+    const int edgeTotal = model.connectors.size();
+
+    // 字符串表：先是各图元的文字（下标与图元相同），再是各样式的字体名
+    QByteArray blob;
+    QList<quint32> offsets;
+    offsets.reserve(nodeTotal + styleTotal + 1);
+    for (const QString &text : model.texts) {
+        offsets.append(quint32(blob.size()));
+        blob += text.toUtf8();
+    }
+    for (const DiagramModel::TextStyle &style : model.styles) {
+        offsets.append(quint32(blob.size()));
+        blob += style.family.toUtf8();
+    }
+    offsets.append(quint32(blob.size()));
+
+    const qint64 strsSize = 4 + 4 * qint64(offsets.size()) + blob.size();
+    const qint64 stylSize = 4 + qint64(styleRecordSize) * styleTotal;
+    const qint64 nodeSize = 4 + qint64(nodeRecordSize) * nodeTotal;
+    const qint64 edgeSize = 4 + qint64(edgeRecordSize) * edgeTotal;
+    const qint64 total = headerSize + 4 * chunkHeaderSize
+                         + padded(strsSize) + padded(stylSize) + padded(nodeSize) + padded(edgeSize);
+
+    QByteArray out(total, Qt::Uninitialized);
+    char *p = out.data();
+    putBytes(p, fileMagic, 4);
+    put(p, Version);
+    put(p, quint16(headerSize));
+    put(p, quint32(4));   // 块数
+    put(p, quint32(0));
+
+    putChunk(p, "STRS", strsSize);
+    put(p, quint32(nodeTotal + styleTotal));
+    for (quint32 offset : std::as_const(offsets))
+        put(p, offset);
+    putBytes(p, blob.constData(), blob.size());
+    putPadding(p, strsSize);
+
+    putChunk(p, "STYL", stylSize);
+    put(p, quint32(styleTotal));
+    for (int i = 0; i < styleTotal; ++i) {
+        const DiagramModel::TextStyle &style = model.styles.at(i);
+        put(p, quint32(nodeTotal + i));   // 字体名在字符串表中的下标
+        put(p, qint32(style.pointSize));
+        put(p, quint32(style.color));
+        putByte(p, style.bold);
+        putByte(p, style.italic);
+        put(p, quint16(0));
+    }
+    putPadding(p, stylSize);
+
+    putChunk(p, "NODE", nodeSize);
+    put(p, quint32(nodeTotal));
+    for (int i = 0; i < nodeTotal; ++i) {
+        putDouble(p, model.positions.at(i).x());
+        putDouble(p, model.positions.at(i).y());
+        putDouble(p, model.sizes.at(i).width());
+        putDouble(p, model.sizes.at(i).height());
+        put(p, quint32(model.fills.at(i)));
+        put(p, quint32(i));   // 文字在字符串表中的下标
+        put(p, quint32(model.textStyles.at(i)));
+        put(p, quint16(model.types.at(i)));
+        put(p, quint16(0));
+    }
+    putPadding(p, nodeSize);
+
+    putChunk(p, "EDGE", edgeSize);
+    put(p, quint32(edgeTotal));
+    for (const DiagramModel::Connector &c : model.connectors) {
+        put(p, quint32(c.from));
+        put(p, quint32(c.to));
+        putByte(p, quint8(c.fromPort));
+        putByte(p, quint8(c.toPort));
+        put(p, quint16(0));
+    }
+    putPadding(p, edgeSize);
+
+    Q_ASSERT(p == out.constData() + total);
+    return out;
+}
+
+bool ProjectFile::decode(const char *data, qint64 size, DiagramModel *model, QString *error)
+{
+    model->clear();
+    auto fail = [model, error](const QString &message) {
+        model->clear();
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    if (size < headerSize || !isBinary(data, size))
+        return fail(QStringLiteral("不是第 2 版工程文件"));
+    const quint16 version = get<quint16>(data + 4);
+    const quint16 headerLength = get<quint16>(data + 6);
+    const quint32 chunkTotal = get<quint32>(data + 8);
+    if (version > Version)
+        return fail(QStringLiteral("工程文件版本 %1 高于支持的版本 %2").arg(version).arg(Version));
+    if (headerLength < headerSize || headerLength > size)
+        return fail(QStringLiteral("文件头长度无效"));
+
+    struct Chunk {
+        const char *data = nullptr;
+        qint64 size = 0;
+    };
+    Chunk strs, styl, node, edge;
+    qint64 pos = headerLength;
+    for (quint32 i = 0; i < chunkTotal; ++i) {
+        if (size - pos < chunkHeaderSize)
+            return fail(QStringLiteral("第 %1 个块的块头超出文件末尾").arg(i + 1));
+        const char *tag = data + pos;
+        const qint64 length = get<quint32>(data + pos + 4);
+        pos += chunkHeaderSize;
+        if (length > size - pos)
+            return fail(QStringLiteral("块 %1 超出文件末尾").arg(QString::fromLatin1(tag, 4)));
+        const Chunk chunk{ data + pos, length };
+        if (std::memcmp(tag, "STRS", 4) == 0)
+            strs = chunk;
+        else if (std::memcmp(tag, "STYL", 4) == 0)
+            styl = chunk;
+        else if (std::memcmp(tag, "NODE", 4) == 0)
+            node = chunk;
+        else if (std::memcmp(tag, "EDGE", 4) == 0)
+            edge = chunk;
+        // 其他块是更新版本加入的，跳过
+        pos += padded(length);
+    }
+    if (!node.data)
+        return fail(QStringLiteral("缺少 NODE 块"));
+
+    // 记录个数，块长度不够时返回 -1；块不存在时为 0
+    auto recordCount = [](const Chunk &chunk, int recordSize) -> qint64 {
+        if (!chunk.data)
+            return 0;
+        if (chunk.size < 4)
+            return -1;
+        const qint64 count = get<quint32>(chunk.data);
+        return 4 + count * recordSize <= chunk.size ? count : -1;
+    };
+    const qint64 styleTotal = recordCount(styl, styleRecordSize);
+    const qint64 nodeTotal = recordCount(node, nodeRecordSize);
+    const qint64 edgeTotal = recordCount(edge, edgeRecordSize);
+    if (styleTotal < 0 || nodeTotal < 0 || edgeTotal < 0)
+        return fail(QStringLiteral("记录个数与块长度不符"));
+
+    qint64 stringTotal = 0;
+    const char *offsets = nullptr;
+    const char *blob = nullptr;
+    qint64 blobSize = 0;
+    if (strs.data) {
+        if (strs.size < 4)
+            return fail(QStringLiteral("字符串表长度无效"));
+        stringTotal = get<quint32>(strs.data);
+        const qint64 tableSize = 4 + 4 * (stringTotal + 1);
+        if (tableSize > strs.size)
+            return fail(QStringLiteral("字符串表长度无效"));
+        offsets = strs.data + 4;
+        blob = strs.data + tableSize;
+        blobSize = strs.size - tableSize;
+    }
+    auto stringAt = [&](quint32 index, QString *out) {
+        if (index >= stringTotal)
+            return false;
+        const quint32 begin = get<quint32>(offsets + 4 * qint64(index));
+        const quint32 end = get<quint32>(offsets + 4 * qint64(index) + 4);
+        if (begin > end || end > blobSize)
+            return false;
+        *out = QString::fromUtf8(blob + begin, end - begin);
+        return true;
+    };
+
+    model->styles.reserve(styleTotal);
+    for (qint64 i = 0; i < styleTotal; ++i) {
+        const char *r = styl.data + 4 + i * styleRecordSize;
+        DiagramModel::TextStyle style;
+        if (!stringAt(get<quint32>(r), &style.family))
+            return fail(QStringLiteral("第 %1 个样式的字体名无效").arg(i + 1));
+        style.pointSize = get<qint32>(r + 4);
+        style.color = get<quint32>(r + 8);
+        style.bold = r[12] != 0;
+        style.italic = r[13] != 0;
+        model->styles.append(style);
+    }
+
+    model->reserve(int(nodeTotal), int(edgeTotal));
+    for (qint64 i = 0; i < nodeTotal; ++i) {
+        const char *r = node.data + 4 + i * nodeRecordSize;
+        QString text;
+        if (!stringAt(get<quint32>(r + 36), &text))
+            return fail(QStringLiteral("第 %1 个图元的文字无效").arg(i + 1));
+        const quint32 style = get<quint32>(r + 40);
+        if (style >= styleTotal)
+            return fail(QStringLiteral("第 %1 个图元的样式无效").arg(i + 1));
+        model->types.append(qint8(get<quint16>(r + 44)));
+        model->positions.append(QPointF(getDouble(r), getDouble(r + 8)));
+        model->sizes.append(QSizeF(getDouble(r + 16), getDouble(r + 24)));
+        model->fills.append(get<quint32>(r + 32));
+        model->texts.append(text);
+        model->textStyles.append(int(style));
+    }
+
+    for (qint64 i = 0; i < edgeTotal; ++i) {
+        const char *r = edge.data + 4 + i * edgeRecordSize;
+        // 端点下标的合法性由 DiagramModel::validate 检查
+        model->connectors.append(DiagramModel::Connector{ int(get<quint32>(r)), int(get<quint32>(r + 4)),
+                                                          quint8(r[8]), quint8(r[9]) });
+    }
+    return true;
+}
+
+bool ProjectFile::read(QFile &file, DiagramModel *model, QString *error)
+{
+    const qint64 size = file.size();
+    uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    QByteArray bytes;
+    if (!mapped)
+        bytes = file.readAll();   // 不能映射时（如部分网络文件系统）整读
+    const char *data = mapped ? reinterpret_cast<const char *>(mapped) : bytes.constData();
+    const qint64 length = mapped ? size : bytes.size();
+
+    bool ok = false;
+    if (isBinary(data, length)) {
+        ok = decode(data, length, model, error);
+    } else {
+        // 第 1 版文本格式，按导入读取
+        FcprojTextReader reader(data, length);
+        ok = reader.read(model);
+        if (!ok && error)
+            *error = reader.errorString();
+    }
+    if (mapped)
+        file.unmap(mapped);
+    return ok;
+}
+
+bool ProjectFile::write(QIODevice *device, const DiagramModel &model, QString *error)
+{
+    const QByteArray bytes = encode(model);
+    if (device->write(bytes) != bytes.size()) {
+        if (error)
+            *error = device->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ProjectFile::save(const QString &filePath, const DiagramModel &model, QString *error, Durability durability)
+{
+    if (durability == Scratch) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            if (error)
+                *error = file.errorString();
+            return false;
+        }
+        return write(&file, model, error);
+    }
+    // QSaveFile 写临时文件，commit 时先同步到磁盘再改名替换目标文件
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    if (!write(&file, model, error)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QFuture<QString> ProjectFile::saveAsync(const QString &filePath, const DiagramModel &model,
+                                        const QFuture<QString> &after, Durability durability)
+{
+    // 快照按值捕获：各列隐式共享，不复制数据，界面线程之后的修改也不会影响它
+    auto task = [filePath, model, durability]() {
+        QString error;
+        return save(filePath, model, &error, durability) ? QString() : error;
+    };
+    if (!after.isValid())
+        return QtConcurrent::run(task);
+    // 接在上一次保存之后，由线程池在它结束时启动；上一次失败不影响本次
+    return QFuture<QString>(after).then(QtFuture::Launch::Async, [task](const QString &) { return task(); });
+}
@@ -0,0 +1,54 @@
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+class QIODevice;
+QT_END_NAMESPACE
+
+class DiagramModel;
+
+// .fcproj 第 2 版：分块、带版本号的小端二进制格式
+//
+//   文件头 16 字节  "FCPJ" | quint16 版本 | quint16 文件头长度 | quint32 块数 | quint32 保留
+//   块            4 字节标识 | quint32 内容长度 | 内容（补齐到 4 字节）
+//     STRS  字符串表：quint32 个数，个数+1 个 quint32 偏移（最后一个是总长），UTF-8 字节
+//     STYL  文字样式：quint32 个数，每条 16 字节
+//     NODE  图元：    quint32 个数，每条 48 字节，文字和样式用下标引用
+//     EDGE  连线：    quint32 个数，每条 12 字节
+//
+// 记录长度固定，读取时把整个文件映射进内存，按偏移直接取值，不再逐词解析；
+// 文字不做转义，星号、空格、换行都原样保存。不认识的块跳过，旧版本读得了新增的块。
+// 读取时按文件头识别格式，第 1 版的文本格式仍可导入；保存总是写第 2 版
+class ProjectFile
+{
+public:
+    static constexpr quint16 Version = 2;
+
+    static bool isBinary(const char *data, qint64 size);   // 以 "FCPJ" 开头
+    static QByteArray encode(const DiagramModel &model);
+    static bool decode(const char *data, qint64 size, DiagramModel *model, QString *error = nullptr);
+
+    // file 须已按只读打开；二进制文件通过 QFile::map 读取，映射失败时整读
+    static bool read(QFile &file, DiagramModel *model, QString *error = nullptr);
+    static bool write(QIODevice *device, const DiagramModel &model, QString *error = nullptr);
+
+    enum Durability {
+        Durable,   // 原子保存：先写同目录下的临时文件，同步到磁盘后改名替换，中途出错或崩溃时原文件不变
+        Scratch    // 直接覆盖写、不同步到磁盘，用于撤销快照这类崩溃后不需要保留的文件
+    };
+
+    static bool save(const QString &filePath, const DiagramModel &model, QString *error = nullptr,
+                     Durability durability = Durable);
+    // 在线程池中 save，结果为错误描述，成功时为空；model 应是界面线程取下的快照。
+    // after 是之前的一次保存，本次排在它写完之后开始，按顺序落盘而不阻塞调用线程
+    static QFuture<QString> saveAsync(const QString &filePath, const DiagramModel &model,
+                                      const QFuture<QString> &after = QFuture<QString>(),
+                                      Durability durability = Durable);
+};
+
+#endif // PROJECTFILE_H
@@ -0,0 +1,390 @@
+#include "projectjournal.h"
+#include "projectfile.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QAtomicInteger>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <functional>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char journalMagic[4] = { 'F', 'C', 'J', 'L' };
+static const int stampSize = 16;
+static const int journalHeaderSize = 8 + stampSize;
+static const int frameHeaderSize = 6;   // quint32 长度 + quint16 校验
+static const QDataStream::Version streamVersion = QDataStream::Qt_6_0;
+
+static QByteArray journalHeader(const QByteArray &stamp)
+{
+    QByteArray header(journalMagic, 4);
+    header.resize(8);
+    qToBigEndian(ProjectJournal::Version, header.data() + 4);
+    qToBigEndian(quint16(0), header.data() + 6);
+    return header + stamp;
+}
+
+static QByteArray stampOf(QByteArrayView bytes)
+{
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Md5);
+}
+
+// 追加写入后确保落盘，QFile::flush 只交给操作系统
+static bool syncToDisk(QFile &file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+static bool writeAtomically(const QString &filePath, const QByteArray &bytes, QString *error)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// 与剪贴板格式（DiagramModel 的 QDataStream 运算符）相同的字段顺序
+static void writeNode(QDataStream &out, const DiagramModel::Node &node)
+{
+    out << qint32(node.type) << node.pos << node.size << quint32(node.fill) << node.text
+        << node.style.family << qint32(node.style.pointSize) << node.style.bold << node.style.italic
+        << quint32(node.style.color);
+}
+
+static DiagramModel::Node readNode(QDataStream &in)
+{
+    DiagramModel::Node node;
+    qint32 type = 0, pointSize = 0;
+    quint32 fill = 0, color = 0;
+    in >> type >> node.pos >> node.size >> fill >> node.text
+       >> node.style.family >> pointSize >> node.style.bold >> node.style.italic >> color;
+    node.type = type;
+    node.fill = fill;
+    node.style.pointSize = pointSize;
+    node.style.color = color;
+    return node;
+}
+
+// 写入任务依次执行，摘要只在任务中读写；失败标记界面线程也要读
+struct ProjectJournal::WriteState
+{
+    QByteArray baseStamp;            // 当前基准文件的摘要，写入日志文件头
+    QAtomicInteger<bool> failed;     // 有写入失败：之后的追加不再进行，直到压缩重写
+};
+
+// 排在 after 之后在线程池中执行，after 无效时直接提交
+static QFuture<QString> runAfter(const QFuture<QString> &after, const std::function<QString()> &task)
+{
+    if (!after.isValid())
+        return QtConcurrent::run(task);
+    return QFuture<QString>(after).then(QtFuture::Launch::Async, [task](const QString &) { return task(); });
+}
+
+static quint64 nextKeyGeneration()
+{
+    // 日志可能在加载线程中创建
+    static QAtomicInteger<quint64> last;
+    return last.fetchAndAddRelaxed(1) + 1;
+}
+
+ProjectJournal::ProjectJournal(const QString &filePath)
+    : baseFile(filePath), state(QSharedPointer<WriteState>::create()), generation(nextKeyGeneration())
+{
+}
+
+QString ProjectJournal::journalPath(const QString &filePath)
+{
+    return filePath + QStringLiteral(".journal");
+}
+
+bool ProjectJournal::exists(const QString &filePath)
+{
+    return QFile::exists(journalPath(filePath));
+}
+
+bool ProjectJournal::open(DiagramModel *model, QString *error)
+{
+    QFile file(baseFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    // 摘要按基准文件的原始字节计算
+    const qint64 size = file.size();
+    if (uchar *mapped = size > 0 ? file.map(0, size) : nullptr) {
+        state->baseStamp = stampOf(QByteArrayView(mapped, size));
+        file.unmap(mapped);
+    } else {
+        state->baseStamp = stampOf(file.readAll());
+        file.seek(0);
+    }
+    if (!ProjectFile::read(file, model, error))
+        return false;
+    baseReady = true;
+    pending.clear();
+    journalLength = 0;
+
+    QFile journal(journalPath(baseFile));
+    const QByteArray log = journal.open(QIODevice::ReadOnly) ? journal.readAll() : QByteArray();
+    return replay(log, model, error);
+}
+
+bool ProjectJournal::replay(const QByteArray &log, DiagramModel *model, QString *error)
+{
+    // 回放在逐键的状态上进行，最后按键的顺序排成模型
+    QList<DiagramModel::Node> nodes;
+    QList<DiagramModel::Connector> connectors;   // 端点是图元的键
+    nodes.reserve(model->nodeCount());
+    for (int i = 0; i < model->nodeCount(); ++i)
+        nodes.append(model->node(i));
+    connectors.reserve(model->connectorCount());
+    for (int i = 0; i < model->connectorCount(); ++i)
+        connectors.append(model->connector(i));
+    QList<bool> nodeAlive(nodes.size(), true);
+    QList<bool> connectorAlive(connectors.size(), true);
+
+    // 没有日志，或日志属于被整体重写之前的基准：从基准开始，下次保存时重写日志
+    const bool current = log.size() >= journalHeaderSize && log.startsWith(QByteArrayView(journalMagic, 4))
+                         && qFromBigEndian<quint16>(log.constData() + 4) <= Version
+                         && log.mid(8, stampSize) == state->baseStamp;
+    qint64 pos = current ? journalHeaderSize : 0;
+    int record = 0;
+    while (current && log.size() - pos >= frameHeaderSize) {
+        const qint64 length = qFromBigEndian<quint32>(log.constData() + pos);
+        const quint16 checksum = qFromBigEndian<quint16>(log.constData() + pos + 4);
+        if (length > log.size() - pos - frameHeaderSize)
+            break;   // 最后一条没写完
+        const QByteArray payload = log.mid(pos + frameHeaderSize, length);
+        if (qChecksum(payload) != checksum)
+            break;
+        ++record;
+
+        QDataStream in(payload);
+        in.setVersion(streamVersion);
+        quint8 op = 0;
+        qint32 key = -1;
+        in >> op >> key;
+        bool valid = true;
+        switch (op) {
+        case AddNode:
+            valid = key == nodes.size();
+            nodes.append(readNode(in));
+            nodeAlive.append(true);
+            break;
+        case SetNode:
+            valid = key >= 0 && key < nodes.size();
+            if (valid)
+                nodes[key] = readNode(in);
+            break;
+        case RemoveNode:
+            // 相连的连线在最后按端点是否存活统一去掉
+            valid = key >= 0 && key < nodes.size();
+            if (valid)
+                nodeAlive[key] = false;
+            break;
+        case AddConnector: {
+            qint32 from = -1, to = -1, fromPort = 0, toPort = 0;
+            in >> from >> to >> fromPort >> toPort;
+            valid = key == connectors.size() && from >= 0 && from < nodes.size() && to >= 0 && to < nodes.size();
+            connectors.append(DiagramModel::Connector{ from, to, fromPort, toPort });
+            connectorAlive.append(true);
+            break;
+        }
+        case RemoveConnector:
+            valid = key >= 0 && key < connectors.size();
+            if (valid)
+                connectorAlive[key] = false;
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid || in.status() != QDataStream::Ok) {
+            model->clear();
+            if (error)
+                *error = QStringLiteral("日志第 %1 条记录无效").arg(record);
+            return false;
+        }
+        pos += frameHeaderSize + length;
+    }
+    // 之后的残缺部分在下次保存时截掉
+    journalLength = current ? pos : 0;
+
+    model->clear();
+    model->reserve(nodes.size(), connectors.size());
+    modelNodeKeys.clear();
+    modelConnectorKeys.clear();
+    QList<int> indexOfKey(nodes.size(), -1);
+    for (int key = 0; key < nodes.size(); ++key) {
+        if (!nodeAlive.at(key))
+            continue;
+        indexOfKey[key] = model->addNode(nodes.at(key));
+        modelNodeKeys.append(key);
+    }
+    for (int key = 0; key < connectors.size(); ++key) {
+        const DiagramModel::Connector &c = connectors.at(key);
+        if (!connectorAlive.at(key) || indexOfKey.at(c.from) < 0 || indexOfKey.at(c.to) < 0)
+            continue;
+        model->addConnector(DiagramModel::Connector{ indexOfKey.at(c.from), indexOfKey.at(c.to), c.fromPort, c.toPort });
+        modelConnectorKeys.append(key);
+    }
+    nextNodeKey = nodes.size();
+    nextConnectorKey = connectors.size();
+    return true;
+}
+
+void ProjectJournal::append(const QByteArray &payload)
+{
+    char header[frameHeaderSize];
+    qToBigEndian(quint32(payload.size()), header);
+    qToBigEndian(qChecksum(payload), header + 4);
+    pending.append(header, frameHeaderSize);
+    pending += payload;
+}
+
+int ProjectJournal::addNode(const DiagramModel::Node &node)
+{
+    const int key = nextNodeKey++;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(AddNode) << qint32(key);
+    writeNode(out, node);
+    append(payload);
+    return key;
+}
+
+void ProjectJournal::setNode(int key, const DiagramModel::Node &node)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(SetNode) << qint32(key);
+    writeNode(out, node);
+    append(payload);
+}
+
+void ProjectJournal::removeNode(int key)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(RemoveNode) << qint32(key);
+    append(payload);
+}
+
+int ProjectJournal::addConnector(int fromKey, int toKey, int fromPort, int toPort)
+{
+    const int key = nextConnectorKey++;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(AddConnector) << qint32(key) << qint32(fromKey) << qint32(toKey) << qint32(fromPort) << qint32(toPort);
+    append(payload);
+    return key;
+}
+
+void ProjectJournal::removeConnector(int key)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(streamVersion);
+    out << quint8(RemoveConnector) << qint32(key);
+    append(payload);
+}
+
+bool ProjectJournal::hasBase() const
+{
+    return baseReady && !state->failed.loadAcquire();
+}
+
+QFuture<QString> ProjectJournal::save(const QFuture<QString> &after)
+{
+    if (pending.isEmpty() && journalLength > 0)
+        return lastWrite;
+
+    // 先截掉上次没写完的记录（或不属于当前基准的旧日志），再从有效部分之后追加
+    const QString filePath = journalPath(baseFile);
+    const qint64 offset = journalLength;
+    const QByteArray records = pending;
+    const QSharedPointer<WriteState> shared = state;
+    lastWrite = runAfter(after.isValid() ? after : lastWrite, [filePath, offset, records, shared]() {
+        if (shared->failed.loadAcquire())
+            return QStringLiteral("之前的日志写入失败，需要重写基准");
+        if (offset == 0 && shared->baseStamp.isEmpty())
+            return QStringLiteral("还没有基准快照");
+        const QByteArray bytes = offset == 0 ? journalHeader(shared->baseStamp) + records : records;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadWrite) || (file.size() != offset && !file.resize(offset))
+            || !file.seek(offset) || file.write(bytes) != bytes.size() || !syncToDisk(file)) {
+            shared->failed.storeRelease(true);
+            return file.errorString();
+        }
+        return QString();
+    });
+    journalLength += offset == 0 ? journalHeaderSize + records.size() : records.size();
+    pending.clear();
+    return lastWrite;
+}
+
+QFuture<QString> ProjectJournal::compact(const DiagramModel &model, const QFuture<QString> &after)
+{
+    pending.clear();
+    nextNodeKey = model.nodeCount();
+    nextConnectorKey = model.connectorCount();
+    generation = nextKeyGeneration();
+    baseReady = true;
+    journalLength = journalHeaderSize;
+    const QString filePath = baseFile;
+    const QSharedPointer<WriteState> shared = state;
+    compactionFuture = runAfter(after.isValid() ? after : lastWrite, [filePath, model, shared]() {
+        const QByteArray bytes = ProjectFile::encode(model);
+        const QByteArray stamp = stampOf(bytes);
+        // 先换基准再清空日志：两步之间崩溃时，旧日志的摘要与新基准对不上，打开时被忽略
+        QString error;
+        if (!writeAtomically(filePath, bytes, &error)) {
+            shared->failed.storeRelease(true);
+            return error;
+        }
+        shared->baseStamp = stamp;
+        if (!writeAtomically(journalPath(filePath), journalHeader(stamp), &error)) {
+            shared->failed.storeRelease(true);
+            return error;
+        }
+        shared->failed.storeRelease(false);
+        return QString();
+    });
+    lastWrite = compactionFuture;
+    return compactionFuture;
+}
+
+bool ProjectJournal::waitForWrites(QString *error)
+{
+    compactionFuture = QFuture<QString>();
+    if (!lastWrite.isValid())
+        return true;
+    lastWrite.waitForFinished();
+    const QString result = lastWrite.resultCount() > 0 ? lastWrite.result() : QStringLiteral("日志写入被取消");
+    if (!result.isEmpty()) {
+        if (error)
+            *error = result;
+        return false;
+    }
+    return true;
+}
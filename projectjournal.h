@@ -0,0 +1,89 @@
+#ifndef PROJECTJOURNAL_H
+#define PROJECTJOURNAL_H
+
+#include "diagrammodel.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+// 增量保存的工程：基准快照加只追加的操作日志
+//
+//   <工程>.fcproj          基准快照，即普通的第 2 版工程文件，不认识日志的程序也能打开
+//   <工程>.fcproj.journal  文件头 "FCJL" | quint16 版本 | quint16 保留 | 16 字节基准摘要（MD5）
+//                          之后逐条追加：quint32 内容长度 | quint16 校验 | 内容（QDataStream）
+//
+// 图元、连线用键标识：基准中的下标就是键，新加的依次往后编号，删除后不重用，压缩时重排。
+// 保存只追加上次保存以来的记录，耗时与改动量成正比；日志超过阈值时把当前快照写成新的基准
+// 并清空日志。写盘都在线程池中按提交顺序依次进行，界面线程不等待。基准和日志各自原子替换，
+// 基准换新以后旧日志的摘要对不上，打开时忽略，不会重复回放；日志末尾没写完的记录（写入时崩溃）
+// 在打开时丢弃
+class ProjectJournal
+{
+public:
+    enum Op : quint8 { AddNode = 1, SetNode, RemoveNode, AddConnector, RemoveConnector };
+    static constexpr quint16 Version = 1;
+
+    // 删除时不等待进行中的写入：写入任务只持有文件名和数据，由调用方持有 pendingWrites() 等它结束
+    explicit ProjectJournal(const QString &filePath = QString());
+
+    static QString journalPath(const QString &filePath);
+    static bool exists(const QString &filePath);   // 工程旁有日志文件
+
+    // 读取基准并回放日志，model 中图元、连线按键的顺序排列；不依赖界面，可在工作线程调用
+    bool open(DiagramModel *model, QString *error = nullptr);
+    const QList<int> &nodeKeys() const { return modelNodeKeys; }             // 模型下标 -> 键
+    const QList<int> &connectorKeys() const { return modelConnectorKeys; }
+    QString filePath() const { return baseFile; }
+    // 键的代号：压缩重新编号后换新，不同日志对象之间也不相同。按代号判断之前记下的键是否仍可用
+    quint64 keyGeneration() const { return generation; }
+
+    // 记录改动，save 时一次追加到日志
+    int addNode(const DiagramModel::Node &node);   // 返回新图元的键
+    void setNode(int key, const DiagramModel::Node &node);
+    void removeNode(int key);                      // 相连的连线一并删除
+    int addConnector(int fromKey, int toKey, int fromPort, int toPort);
+    void removeConnector(int key);
+    bool hasPendingRecords() const { return !pending.isEmpty(); }
+
+    // 在线程池中追加并同步到磁盘，排在 after 之后；after 为空时排在本日志上一次写入之后，
+    // 不为空时应已排在它之后。结果为错误描述，成功时为空。
+    // hasBase 为 false（还没有基准，或之前的写入失败）时应先 compact
+    QFuture<QString> save(const QFuture<QString> &after = QFuture<QString>());
+    bool hasBase() const;
+    qint64 journalSize() const { return journalLength; }
+    void setCompactionThreshold(qint64 bytes) { compactionThreshold = bytes; }   // 默认 1 MB
+    bool needsCompaction() const { return journalLength + pending.size() > compactionThreshold; }
+
+    // 压缩：在线程池中把 model 写成新的基准并清空日志，排队方式同 save。model 是当前完整快照，
+    // 它的下标成为新的键（调用方同时给图元重新编号），未保存的记录已包含在快照中，一并丢弃。
+    // 结果为错误描述，成功时为空；失败后 hasBase 为 false，需要再次压缩
+    QFuture<QString> compact(const DiagramModel &model, const QFuture<QString> &after = QFuture<QString>());
+    QFuture<QString> compaction() const { return compactionFuture; }   // 最近一次压缩，waitForWrites 后清空
+    QFuture<QString> pendingWrites() const { return lastWrite; }       // 最后交出的写入
+    bool waitForWrites(QString *error = nullptr);   // 等交出的写入全部结束，最后一次失败时返回 false
+
+private:
+    struct WriteState;
+
+    void append(const QByteArray &payload);
+    bool replay(const QByteArray &log, DiagramModel *model, QString *error);
+
+    QString baseFile;
+    QSharedPointer<WriteState> state;   // 与写入任务共享
+    QByteArray pending;            // 已编码、尚未写入的记录
+    qint64 journalLength = 0;      // 交出的写入都完成后日志文件有效部分的长度，为 0 时要先写文件头
+    qint64 compactionThreshold = 1024 * 1024;
+    int nextNodeKey = 0;
+    int nextConnectorKey = 0;
+    bool baseReady = false;
+    quint64 generation;
+    QList<int> modelNodeKeys;
+    QList<int> modelConnectorKeys;
+    QFuture<QString> compactionFuture;
+    QFuture<QString> lastWrite;
+};
+
+#endif // PROJECTJOURNAL_H
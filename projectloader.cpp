@@ -0,0 +1,173 @@
+#include "projectloader.h"
+#include "projectfile.h"
+#include "diagramscene.h"
+#include "diagramgraph.h"
+#include "diagrampath.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsView>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+ProjectLoader::ProjectLoader(DiagramScene *scene)
+    : QObject(scene), scene(scene)
+{
+    connect(&watcher, &QFutureWatcher<Parsed>::finished, this, &ProjectLoader::parsed);
+}
+
+ProjectLoader::~ProjectLoader()
+{
+    // 随场景析构时场景已不可用，不再访问；解析线程只使用自己的副本，结束后自行释放
+    watcher.disconnect(this);
+    delete journal;
+}
+
+void ProjectLoader::start(const QString &filePath)
+{
+    running = true;
+    nextNode = nextConnector = 0;
+    emit progress(0, 0);
+    watcher.setFuture(QtConcurrent::run([filePath]() {
+        Parsed result;
+        QString error;
+        if (ProjectJournal::exists(filePath)) {
+            result.journaled = true;
+            result.journal = ProjectJournal(filePath);
+            result.ok = result.journal.open(&result.model, &error);
+            if (!result.ok)
+                result.error = tr("工程文件格式错误：%1").arg(error);
+            return result;
+        }
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            result.error = tr("无法打开或读取文件信息.");
+            return result;
+        }
+        result.ok = ProjectFile::read(file, &result.model, &error);
+        if (!result.ok)
+            result.error = tr("工程文件格式错误：%1").arg(error);
+        return result;
+    }));
+}
+
+void ProjectLoader::cancel()
+{
+    if (running)
+        finish(Canceled);
+}
+
+void ProjectLoader::parsed()
+{
+    if (!running)
+        return;   // 解析期间已取消
+    Parsed result = watcher.result();
+    if (!result.ok) {
+        finish(Failed, result.error);
+        return;
+    }
+    model = std::move(result.model);
+    if (virtualThreshold >= 0 && model.nodeCount() >= virtualThreshold) {
+        // 超大图只创建视口附近的图元，不需要分片；虚拟模式不支持增量保存，日志不交给场景
+        scene->setVirtualModel(model);
+        finish(Loaded);
+        return;
+    }
+    if (result.journaled)
+        journal = new ProjectJournal(std::move(result.journal));
+    nodes = QList<DiagramItem *>(model.nodeCount(), nullptr);
+    nodeIds = QList<int>(model.nodeCount(), DiagramGraph::InvalidId);
+    // 构建期间视图只能浏览，不能编辑，避免用户删掉还要连线的图元
+    building = true;
+    deliverMsecs = 0;
+    setViewsInteractive(false);
+    scene->beginBulkBuild();
+    buildSlice();
+}
+
+void ProjectLoader::buildSlice()
+{
+    if (!running)
+        return;
+    const int nodeTotal = model.nodeCount();
+    const int connectorTotal = model.connectorCount();
+    // 一片的耗时包括结束时的交付，按上一片的交付时间预留，至少建一个
+    const qint64 budget = qMax<qint64>(1, sliceMsecs - deliverMsecs);
+    QElapsedTimer timer;
+    timer.start();
+    while (nextNode < nodeTotal && timer.elapsed() < budget) {
+        if (DiagramItem *item = scene->addModelNode(model.node(nextNode))) {
+            nodes[nextNode] = item;
+            nodeIds[nextNode] = item->graphNode;
+            if (journal)
+                item->journalKey = journal->nodeKeys().at(nextNode);
+        }
+        ++nextNode;
+    }
+    // 图元全部加入后再建连线，两端都已存在
+    while (nextNode == nodeTotal && nextConnector < connectorTotal && timer.elapsed() < budget) {
+        const int index = nextConnector++;
+        const DiagramModel::Connector &c = model.connector(index);
+        DiagramItem *startItem = builtNode(c.from);
+        DiagramItem *endItem = builtNode(c.to);
+        if (startItem && endItem) {
+            DiagramPath *path = scene->addConnector(startItem, endItem, c.fromPort, c.toPort);
+            if (journal)
+                path->journalKey = journal->connectorKeys().at(index);
+            scene->markPathDirty(path);
+        }
+    }
+    // 本片的图元建索引，连线按最终几何路由，之后就能看到
+    const qint64 built = timer.elapsed();
+    scene->flushBulkBuild();
+    deliverMsecs = timer.elapsed() - built;
+    emit progress(nextNode + nextConnector, nodeTotal + connectorTotal);
+    if (!running)
+        return;   // 收到进度时取消了
+    if (nextNode == nodeTotal && nextConnector == connectorTotal) {
+        finish(Loaded);
+        return;
+    }
+    QTimer::singleShot(0, this, &ProjectLoader::buildSlice);
+}
+
+DiagramItem *ProjectLoader::builtNode(int index) const
+{
+    if (index < 0 || index >= nodes.size() || !nodes.at(index))
+        return nullptr;
+    // 按拓扑图确认图元仍在场景中
+    const DiagramGraph &graph = scene->graph();
+    const int id = nodeIds.at(index);
+    if (!graph.hasNode(id) || graph.item(id) != nodes.at(index))
+        return nullptr;
+    return nodes.at(index);
+}
+
+void ProjectLoader::setViewsInteractive(bool interactive)
+{
+    for (QGraphicsView *view : scene->views())
+        view->setInteractive(interactive);
+}
+
+void ProjectLoader::finish(Status status, const QString &error)
+{
+    running = false;
+    if (building) {
+        // 取消时已加入的部分同样在这里建好索引
+        building = false;
+        scene->endBulkBuild();
+        setViewsInteractive(true);
+    }
+    if (journal) {
+        // 完整加载后图元与日志一一对应，之后的保存只追加改动；取消时部分内容不能接着记日志
+        if (status == Loaded)
+            scene->setJournal(journal);
+        else
+            delete journal;
+        journal = nullptr;
+    }
+    model.clear();
+    nodes.clear();
+    nodeIds.clear();
+    emit finished(status, error);
+}
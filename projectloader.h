@@ -0,0 +1,72 @@
+#ifndef PROJECTLOADER_H
+#define PROJECTLOADER_H
+
+#include "diagrammodel.h"
+#include "projectjournal.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+
+class DiagramItem;
+class DiagramScene;
+
+// 异步打开工程
+// 工作线程读取并解析文件，GUI 线程再按时间片把图元、连线加入场景：每片只占几毫秒，
+// 片与片之间回到事件循环，界面保持响应，已加入的部分立即可见。
+// 整个构建处于一次批量构建中，BSP 索引在结束时只重建一次；每片只索引、路由本片的内容。
+// 加载器是场景的子对象，关闭标签页（删除场景）时随之析构，后台解析的结果直接丢弃。
+// 工程旁有日志时按增量保存的工程打开：回放日志，图元带上日志中的键，加载完成后把日志交给场景
+class ProjectLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status { Loaded, Failed, Canceled };
+    Q_ENUM(Status)
+
+    explicit ProjectLoader(DiagramScene *scene);
+    ~ProjectLoader() override;
+
+    void setSliceDuration(int msecs) { sliceMsecs = msecs; }           // 默认 8 毫秒
+    void setVirtualThreshold(int nodes) { virtualThreshold = nodes; }   // 达到该节点数时整体交给虚拟化场景，-1 表示不使用
+    void start(const QString &filePath);
+    bool isRunning() const { return running; }
+
+public slots:
+    void cancel();   // 已加入场景的部分保留，由调用方决定去留
+
+signals:
+    void progress(int done, int total);   // 解析阶段 total 为 0
+    void finished(ProjectLoader::Status status, const QString &error);
+
+private:
+    struct Parsed {
+        bool ok = false;
+        DiagramModel model;
+        QString error;
+        bool journaled = false;
+        ProjectJournal journal;
+    };
+
+    void parsed();
+    void buildSlice();
+    DiagramItem *builtNode(int index) const;   // 已建且仍在场景中的图元
+    void setViewsInteractive(bool interactive);
+    void finish(Status status, const QString &error = QString());
+
+    DiagramScene *scene;
+    QFutureWatcher<Parsed> watcher;
+    DiagramModel model;
+    ProjectJournal *journal = nullptr;   // 增量保存的工程，加载完成后交给场景
+    QList<DiagramItem *> nodes;   // 模型下标 -> 新建的图元
+    QList<int> nodeIds;           // 模型下标 -> 图元在拓扑图中的编号
+    int nextNode = 0;
+    int nextConnector = 0;
+    int sliceMsecs = 8;
+    qint64 deliverMsecs = 0;   // 上一片交付（索引、路由）所用时间，从下一片的预算中扣除
+    int virtualThreshold = -1;
+    bool running = false;
+    bool building = false;
+};
+
+#endif // PROJECTLOADER_H
@@ -0,0 +1,117 @@
+#include "sceneoverlay.h"
+
+#include <QGraphicsScene>
+#include <QPainter>
+
+namespace {
+const qreal overlayMargin = 3;     // 线宽/抗锯齿留出的余量
+const qreal hoverRadius = 7;       // 目标连接点高亮圆半径
+const qreal portHalfSize = 5;      // 连接点标记半边长
+
+QRectF hoverRect(const PortIndex::Port &port)
+{
+    if (!port.item)
+        return QRectF();
+    return QRectF(port.pos - QPointF(hoverRadius, hoverRadius), QSizeF(hoverRadius * 2, hoverRadius * 2));
+}
+}
+
+SceneOverlay::SceneOverlay(QGraphicsScene *scene)
+    : scene(scene)
+{
+}
+
+void SceneOverlay::invalidate(const QRectF &oldRect, const QRectF &newRect)
+{
+    const QRectF dirty = oldRect.united(newRect);
+    if (dirty.isNull())
+        return;
+    scene->update(dirty.adjusted(-overlayMargin, -overlayMargin, overlayMargin, overlayMargin));
+}
+
+void SceneOverlay::setGuides(const QList<QLineF> &lines)
+{
+    if (lines == guideLines)
+        return;
+
+    QRectF bounds;
+    for (const QLineF &line : lines)
+        bounds = bounds.united(QRectF(line.p1(), line.p2()).normalized().adjusted(-1, -1, 1, 1));
+
+    invalidate(guidesRect, bounds);
+    guideLines = lines;
+    guidesRect = bounds;
+}
+
+void SceneOverlay::setMarquee(const QRectF &rect)
+{
+    if (rect == marqueeRect)
+        return;
+    invalidate(marqueeRect, rect);
+    marqueeRect = rect;
+}
+
+void SceneOverlay::setHoverPort(const PortIndex::Port &port)
+{
+    if (port.item == hoverTarget.item && port.state == hoverTarget.state && port.pos == hoverTarget.pos)
+        return;
+    invalidate(hoverRect(hoverTarget), hoverRect(port));
+    hoverTarget = port;
+}
+
+void SceneOverlay::setPortsVisible(bool visible)
+{
+    if (visible == showPorts)
+        return;
+    showPorts = visible;
+    // 连接点分布在整个场景，一次整体失效，由视图只重绘一次
+    scene->update();
+}
+
+void SceneOverlay::paint(QPainter *painter, const QRectF &exposed, const PortIndex &ports) const
+{
+    // 连接点
+    if (showPorts) {
+        const QRectF portArea = exposed.adjusted(-portHalfSize, -portHalfSize, portHalfSize, portHalfSize);
+        const QList<PortIndex::Port> visiblePorts = ports.portsIn(portArea);
+        if (!visiblePorts.isEmpty()) {
+            painter->save();
+            painter->setPen(Qt::black);
+            painter->setBrush(QBrush(Qt::blue));
+            for (const PortIndex::Port &port : visiblePorts)
+                painter->drawRect(QRectF(port.pos - QPointF(portHalfSize, portHalfSize),
+                                         QSizeF(portHalfSize * 2, portHalfSize * 2)));
+            painter->restore();
+        }
+    }
+
+    // 框选矩形
+    if (!marqueeRect.isEmpty() && marqueeRect.intersects(exposed)) {
+        QColor semiTransparentBlue(Qt::blue);
+        semiTransparentBlue.setAlpha(50);
+        painter->save();
+        painter->setPen(QPen(Qt::black, 1, Qt::DashLine));
+        painter->setBrush(semiTransparentBlue);
+        painter->drawRect(marqueeRect);
+        painter->restore();
+    }
+
+    // 对齐辅助线
+    if (!guideLines.isEmpty() && guidesRect.intersects(exposed)) {
+        QPen pen;
+        pen.setStyle(Qt::DashLine);  // 使用虚线绘制辅助线
+        painter->save();
+        painter->setPen(pen);
+        painter->drawLines(guideLines);
+        painter->restore();
+    }
+
+    // 连线时的目标连接点
+    if (hoverTarget.item != nullptr) {
+        painter->save();
+        painter->setPen(QPen(QColor(0, 160, 80), 2));
+        painter->setBrush(QColor(0, 200, 100, 120));
+        painter->drawEllipse(hoverTarget.pos, hoverRadius, hoverRadius);
+        painter->restore();
+    }
+}
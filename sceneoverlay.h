@@ -0,0 +1,50 @@
+#ifndef SCENEOVERLAY_H
+#define SCENEOVERLAY_H
+
+#include "portindex.h"
+
+#include <QLineF>
+#include <QList>
+#include <QRectF>
+
+QT_BEGIN_NAMESPACE
+class QGraphicsScene;
+class QPainter;
+QT_END_NAMESPACE
+
+// 交互覆盖层
+// 对齐辅助线、框选矩形、连接点标记统一在场景前景层绘制，不作为图元加入场景。
+// 每次状态变化只让新旧覆盖区域的并集失效，不再整场景 update()
+class SceneOverlay
+{
+public:
+    explicit SceneOverlay(QGraphicsScene *scene);
+
+    void setGuides(const QList<QLineF> &lines);   // 对齐辅助线（场景坐标）
+    void clearGuides() { setGuides(QList<QLineF>()); }
+    const QList<QLineF> &guides() const { return guideLines; }
+
+    void setMarquee(const QRectF &rect);           // 框选矩形，空矩形表示隐藏
+    QRectF marquee() const { return marqueeRect; }
+
+    void setHoverPort(const PortIndex::Port &port); // 连线时高亮的目标连接点
+    const PortIndex::Port &hoverPort() const { return hoverTarget; }
+
+    void setPortsVisible(bool visible);            // 显示所有图元的连接点
+    bool portsVisible() const { return showPorts; }
+
+    // 只绘制与 exposed 相交的部分；连接点通过 ports 按区域查询
+    void paint(QPainter *painter, const QRectF &exposed, const PortIndex &ports) const;
+
+private:
+    void invalidate(const QRectF &oldRect, const QRectF &newRect);
+
+    QGraphicsScene *scene;
+    QList<QLineF> guideLines;
+    QRectF guidesRect;            // 所有辅助线的外接矩形
+    QRectF marqueeRect;
+    PortIndex::Port hoverTarget;
+    bool showPorts = false;
+};
+
+#endif // SCENEOVERLAY_H
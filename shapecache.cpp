@@ -0,0 +1,317 @@
+#include "shapecache.h"
+#include "diagramitem.h"
+
+#include <QMutexLocker>
+
+QMutex ShapeCache::mutex;
+QHash<ShapeCache::Key, QWeakPointer<const ShapeGeometry>> ShapeCache::table;
+int ShapeCache::builds = 0;
+
+QSizeF ShapeCache::normalizedSize(int type, const QSizeF &size)
+{
+    QSizeF result = size;
+    switch (type) {
+    case DiagramItem::PredefinedProcess:
+    case DiagramItem::Memory:
+    case DiagramItem::DirectAccessStorage:
+    case DiagramItem::Card:
+    case DiagramItem::ManualInput:
+    case DiagramItem::PerforatedTape:
+    case DiagramItem::Display:
+    case DiagramItem::Preparation:
+    case DiagramItem::ManualOperation:
+        result.setWidth(size.height() * 1.5);
+        break;
+    case DiagramItem::SequentialAccessStorage:
+    case DiagramItem::Disk:
+        result.setWidth(size.height());
+        break;
+    case DiagramItem::Hexagon:
+        result.setWidth(size.height() * 1.2); // 宽度稍微大于高度
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+QSharedPointer<const ShapeGeometry> ShapeCache::geometry(int type, const QSizeF &size, qreal border)
+{
+    const Key key{type, size.width(), size.height(), border};
+
+    QMutexLocker locker(&mutex);
+    const auto it = table.constFind(key);
+    if (it != table.cend()) {
+        if (QSharedPointer<const ShapeGeometry> shared = it.value().toStrongRef())
+            return shared;
+    }
+
+    QSharedPointer<const ShapeGeometry> shared = build(type, size, border);
+    ++builds;
+    if (table.size() > 256 && table.size() % 256 == 0)
+        purgeExpired();
+    table.insert(key, shared);
+    return shared;
+}
+
+void ShapeCache::purgeExpired()
+{
+    for (auto it = table.begin(); it != table.end();) {
+        if (it.value().isNull())
+            it = table.erase(it);
+        else
+            ++it;
+    }
+}
+
+int ShapeCache::liveCount()
+{
+    QMutexLocker locker(&mutex);
+    int count = 0;
+    for (auto it = table.cbegin(); it != table.cend(); ++it) {
+        if (!it.value().isNull())
+            ++count;
+    }
+    return count;
+}
+
+int ShapeCache::buildCount()
+{
+    QMutexLocker locker(&mutex);
+    return builds;
+}
+
+// 各图形的轮廓与原 DiagramItem::paint() 中的绘制代码一一对应，size 已经过 normalizedSize 换算
+QSharedPointer<ShapeGeometry> ShapeCache::build(int type, const QSizeF &size, qreal border)
+{
+    QSharedPointer<ShapeGeometry> geometry(new ShapeGeometry);
+    QPainterPath &path = geometry->outline;
+    QPolygonF &polygon = geometry->fillPolygon;
+
+    const qreal w = size.width();
+    const qreal h = size.height();
+    const qreal b = border;
+
+    switch (type) {
+    case DiagramItem::StartEnd:
+        path.moveTo(b+(w-2*b)*0.15, b);
+        path.arcTo(QRectF(b,b,(w-2*b)*0.3,h-2*b),90,180);
+        path.lineTo(w-b-(w-2*b)*0.15,h-b);
+        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),270,180);
+        path.closeSubpath();
+        break;
+
+    case DiagramItem::Conditional:
+        polygon << QPointF(w/2, b) << QPointF(b,h/2)
+                << QPointF(w/2, h-b) << QPointF(w-b, h/2)
+                << QPointF(w/2, b);
+        path.addPolygon(polygon);
+        geometry->drawAsPolygon = true;
+        break;
+
+    case DiagramItem::Step:
+        path.addRect(QRectF(QPointF(b,b),size-QSizeF(10,10)));
+        polygon = path.toFillPolygon();
+        geometry->drawAsPolygon = true;
+        break;
+
+    case DiagramItem::circular:
+        path.addEllipse(b,b,w-2*b,h-2*b);
+        polygon = path.toFillPolygon();
+        geometry->drawAsPolygon = true;
+        break;
+
+    case DiagramItem::Document: {
+        // 矩形的左、右和上边
+        path.moveTo(QPointF(b, h - b-15));  // 左下角
+        path.lineTo(QPointF(b, b));  // 左上角
+        path.lineTo(QPointF(w - b, b));  // 右上角
+        path.lineTo(QPointF(w - b, h - b-15));  // 右下角
+
+        // 底边的波浪线，从左下角到右下角
+        QPointF bottomRight = QPointF(w - b, h - b -15);
+        QPointF bottomLeft = QPointF(b, h - b -15);
+        qreal waveHeight = 10;
+        qreal waveLength = (bottomRight.x() - bottomLeft.x()) / 3;
+        path.moveTo(bottomLeft);
+        path.cubicTo(bottomLeft.x() + waveLength  , bottomLeft.y() + waveHeight + waveHeight/2,
+                     bottomLeft.x() + waveLength + waveLength/2, bottomLeft.y() ,
+                     bottomRight.x(), bottomRight.y());
+        break;
+    }
+
+    case DiagramItem::PredefinedProcess: {
+        // 矩形轮廓加内侧两条竖线
+        path.addRect(b, b, w - 2 * b, h - 2 * b);
+        qreal innerLineOffset = w / 8;
+        path.moveTo(QPointF(b + innerLineOffset, b));
+        path.lineTo(QPointF(b + innerLineOffset, h - b));
+        path.moveTo(QPointF(w - b - innerLineOffset, b));
+        path.lineTo(QPointF(w - b - innerLineOffset, h - b));
+        break;
+    }
+
+    case DiagramItem::StoredData:
+        path.moveTo(b+(w-2*b)*0.15, b);
+        path.arcTo(QRectF(b,b,(w-2*b)*0.3,h-2*b),90,180);
+        path.lineTo(w-b-(w-2*b)*0.15,h-b);
+        path.moveTo(b+(w-2*b)*0.15, b);
+        path.lineTo(w-b-(w-2*b)*0.15,b);
+        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),90,180);
+        break;
+
+    case DiagramItem::Memory: {
+        // 外部矩形加顶部、左侧两条线
+        path.addRect(b, b, w - 2 * b, h - 2 * b);
+        qreal lineWidth = (h - 2 * b) * 0.1;  // 线条位置为高度的10%
+        qreal lineHeight = (w - 2 * b) * 0.1; // 线条位置为宽度的10%
+        path.moveTo(QPointF(b, b + lineWidth));
+        path.lineTo(QPointF(w - b, b + lineWidth));
+        path.moveTo(QPointF(b + lineHeight, b));
+        path.lineTo(QPointF(b + lineHeight, h - b));
+        break;
+    }
+
+    case DiagramItem::SequentialAccessStorage: {
+        // 大圆加底部水平线
+        qreal diameter = h - 2 * b;
+        QPointF center(b + diameter / 2, h / 2);
+        path.addEllipse(QRectF(center.x() - diameter / 2, center.y() - diameter / 2, diameter, diameter));
+        path.moveTo(QPointF(center.x() , h - b));
+        path.lineTo(QPointF(w - b, h - b));
+        break;
+    }
+
+    case DiagramItem::Io:
+        polygon << QPointF(b+(w-2*b)*0.2, b) << QPointF(w-b,b)
+                << QPointF(w-b-(w-2*b)*0.2, h-b) << QPointF(b, h-b)
+                << QPointF(b+(w-2*b)*0.2,b);
+        path.addPolygon(polygon);
+        geometry->drawAsPolygon = true;
+        break;
+
+    case DiagramItem::DirectAccessStorage: {   //多一条竖线
+        qreal diameter = h - 2 * b;
+        path.moveTo(b+diameter / 2, b);
+        path.arcTo(QRectF(b, b, diameter, diameter), 90, 180);  // 左侧半圆
+        path.lineTo(w - diameter / 2, h - b);                    // 下边直线
+        path.arcTo(QRectF(w - diameter, b, diameter, diameter), 270, 360);  // 右侧整圆
+        path.arcTo(QRectF(w - diameter, b, diameter, diameter), 270, 180);
+        path.closeSubpath();
+        break;
+    }
+
+    case DiagramItem::Disk: {
+        // 椭圆的高为宽的一半
+        qreal ellipseWidth = w - 2 * b;
+        qreal ellipseHeight = ellipseWidth / 2;
+        path.moveTo(b, b + ellipseHeight / 2);
+        path.arcTo(QRectF(b, b, ellipseWidth, ellipseHeight), 180, 360);   // 顶部椭圆
+        path.lineTo(b, h - b - ellipseHeight/2);                            // 左侧垂直线
+        path.arcTo(QRectF(b, h - b - ellipseHeight, ellipseWidth, ellipseHeight), 180, 180);  // 底部椭圆
+        path.lineTo(b + ellipseWidth, b + ellipseHeight / 2);               // 右侧垂直线
+        path.arcTo(QRectF(b, b, ellipseWidth, ellipseHeight), 0, -180);     // 顶部椭圆的下半部分
+        break;
+    }
+
+    case DiagramItem::Card:
+        path.moveTo(b, h - b);          // 左下角
+        path.lineTo(b, b + w * 0.15);   // 左边缘
+        path.lineTo(b + w * 0.15, b );  // 顶部斜边
+        path.lineTo(w - b, b);          // 顶部直边
+        path.lineTo(w - b, h - b);      // 右边缘
+        path.lineTo(b, h - b);          // 底部边缘
+        break;
+
+    case DiagramItem::ManualInput:
+        path.moveTo(b, h - b);          // 左下角
+        path.lineTo(b, b + w * 0.15);   // 左边缘
+        path.lineTo(w - b, b );         // 顶部斜边
+        path.lineTo(w - b, h - b);      // 右边缘
+        path.lineTo(b, h - b);          // 底部边缘
+        break;
+
+    case DiagramItem::PerforatedTape: {    //填充有问题
+        QPointF topLeft = QPointF(b, b+10);
+        QPointF bottomLeft = QPointF(b, h - b-10);
+        QPointF topRight = QPointF(w - b, b+10);
+        QPointF bottomRight = QPointF(w - b, h - b-10);
+
+        qreal waveHeight = 10;
+        qreal waveLength = (bottomRight.x() - bottomLeft.x()) / 3;
+
+        // 左边竖线，底部向右的波浪线，右边竖线，顶部向左的波浪线
+        path.moveTo(topLeft);
+        path.lineTo(bottomLeft);
+        path.moveTo(bottomLeft);
+        path.cubicTo(bottomLeft.x() + waveLength / 2, bottomLeft.y() + 1.5 * waveHeight,
+                     bottomLeft.x() + waveLength + waveLength / 2, bottomLeft.y() - 1.5 * waveHeight,
+                     bottomRight.x(), bottomRight.y());
+        path.lineTo(topRight);
+        path.moveTo(topRight);
+        path.cubicTo(topRight.x() - waveLength / 2, topRight.y() - 1.5 * waveHeight,
+                     topRight.x() - waveLength - waveLength / 2, topRight.y() + 1.5 * waveHeight,
+                     topLeft.x(), topLeft.y());
+        break;
+    }
+
+    case DiagramItem::Display:
+        path.moveTo(b + w * 0.15, b);
+        path.lineTo(b, h / 2);                              // 第一条斜线
+        path.lineTo(b + w * 0.15, h - b);                   // 第二条斜线
+        path.lineTo(w - b - (w - 2 * b) * 0.15, h - b);     // 底部水平线
+        path.arcTo(QRectF(w-b-(w-2*b)*0.3,b,(w-2*b)*0.3,h-2*b),270,180);  // 右侧半圆
+        path.lineTo(b + w * 0.15, b);                       // 顶部水平线回到起点
+        path.closeSubpath();
+        break;
+
+    case DiagramItem::Preparation:
+        path.moveTo(b + w * 0.15, b);           // 左上角的起点
+        path.lineTo(b, h / 2);                  // 左侧斜边
+        path.lineTo(b + w * 0.15, h - b);       // 左侧的第二条斜边
+        path.lineTo(w - b - w * 0.15, h - b);   // 底部水平直线
+        path.lineTo(w - b, h / 2);              // 右侧的第二条斜线
+        path.lineTo(w - b - w * 0.15, b);       // 顶部水平直线
+        path.closeSubpath();
+        break;
+
+    case DiagramItem::ManualOperation:
+        path.moveTo(b + w * 0.15, h - b);       // 左下角
+        path.lineTo(b , b);                     // 左上角
+        path.lineTo(w - b , b);                 // 右上角
+        path.lineTo(w - b - w * 0.15, h - b);   // 右下角
+        path.lineTo(b + w * 0.15, h - b);       // 回到左下角
+        path.closeSubpath();
+        break;
+
+    case DiagramItem::ParallelMode:
+        // 上下两条直线
+        path.moveTo(b, h / 3);
+        path.lineTo(w - b, h / 3);
+        path.moveTo(b, 2 * h / 3);
+        path.lineTo(w - b, 2 * h / 3);
+        break;
+
+    case DiagramItem::Hexagon:
+        path.moveTo(b, h - b);                  // 左下角
+        path.lineTo(b, b + h * 0.15);           // 左上斜边的底部
+        path.lineTo(b + w * 0.15, b);           // 左上角的顶点
+        path.lineTo(w - b - w * 0.15, b);       // 右上角的顶点
+        path.lineTo(w - b, b + h * 0.15);       // 右上斜边的底部
+        path.lineTo(w - b, h - b);              // 右下角
+        path.lineTo(b, h - b);                  // 回到左下角
+        path.closeSubpath();
+        break;
+
+    default:
+        break;
+    }
+
+    // 没有显式多边形的图形用轮廓的填充多边形，保证 polygon() 对所有类型都可用
+    if (polygon.isEmpty())
+        polygon = path.toFillPolygon();
+
+    geometry->hitShape.addPolygon(polygon);
+    geometry->hitShape.closeSubpath();
+    return geometry;
+}
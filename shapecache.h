@@ -0,0 +1,60 @@
+#ifndef SHAPECACHE_H
+#define SHAPECACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QSharedPointer>
+#include <QSizeF>
+#include <QWeakPointer>
+
+// 一种图形在某个尺寸下的几何数据，构建后只读，由同类型同尺寸的图元共享
+struct ShapeGeometry
+{
+    QPainterPath outline;       // 绘制用轮廓
+    QPolygonF fillPolygon;      // 填充多边形（箭头求交等也使用它）
+    QPainterPath hitShape;      // 命中测试用的闭合区域
+    bool drawAsPolygon = false; // 原实现中用 drawPolygon 绘制的类型
+};
+
+// 图形几何缓存（享元表）
+// 以 (图形类型, 尺寸, 边距) 为键，尺寸不变时 paint() 只读取缓存，不再每次重建 QPainterPath。
+// 表中只保存弱引用，最后一个使用该几何的图元改变尺寸或析构后数据随之释放
+class ShapeCache
+{
+public:
+    static QSharedPointer<const ShapeGeometry> geometry(int type, const QSizeF &size, qreal border);
+
+    // 部分图形的宽度由高度决定（原先在 paint() 中修改 m_grapSize），这里统一换算
+    static QSizeF normalizedSize(int type, const QSizeF &size);
+
+    static int liveCount();   // 仍被图元引用的几何条目数
+    static int buildCount();  // 累计构建次数，用于验证复用
+
+private:
+    struct Key {
+        int type;
+        qreal width;
+        qreal height;
+        qreal border;
+        bool operator==(const Key &other) const
+        {
+            return type == other.type && width == other.width
+                   && height == other.height && border == other.border;
+        }
+    };
+    friend size_t qHash(const Key &key, size_t seed) noexcept
+    {
+        return qHashMulti(seed, key.type, key.width, key.height, key.border);
+    }
+
+    static QSharedPointer<ShapeGeometry> build(int type, const QSizeF &size, qreal border);
+    static void purgeExpired();
+
+    static QMutex mutex;
+    static QHash<Key, QWeakPointer<const ShapeGeometry>> table;
+    static int builds;
+};
+
+#endif // SHAPECACHE_H
@@ -0,0 +1,180 @@
+#include "shapeiconatlas.h"
+
+#include <QCoreApplication>
+#include <QIconEngine>
+#include <QMutexLocker>
+#include <QPaintDevice>
+#include <QPainter>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+const int shapeTypeCount = DiagramItem::Hexagon + 1;
+
+// 绘制时才向图标集要对应尺寸和像素比的位图，创建工具箱按钮时不解码
+class ShapeIconEngine : public QIconEngine
+{
+public:
+    explicit ShapeIconEngine(DiagramItem::DiagramType type) : type(type) {}
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode, QIcon::State) override
+    {
+        const qreal dpr = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+        const QPixmap pm = ShapeIconAtlas::instance().pixmap(type, rect.size(), dpr);
+        const QSizeF logical = pm.deviceIndependentSize();
+        painter->drawPixmap(QRectF(rect.x() + (rect.width() - logical.width()) / 2,
+                                   rect.y() + (rect.height() - logical.height()) / 2,
+                                   logical.width(), logical.height()), pm, QRectF(pm.rect()));
+    }
+
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        return scaledPixmap(size, mode, state, 1.0);
+    }
+
+    QPixmap scaledPixmap(const QSize &size, QIcon::Mode, QIcon::State, qreal scale) override
+    {
+        return ShapeIconAtlas::instance().pixmap(type, size, scale);
+    }
+
+    QSize actualSize(const QSize &size, QIcon::Mode, QIcon::State) override
+    {
+        return size;
+    }
+
+    bool isNull() override { return false; }
+    QIconEngine *clone() const override { return new ShapeIconEngine(type); }
+
+private:
+    DiagramItem::DiagramType type;
+};
+}
+
+ShapeIconAtlas &ShapeIconAtlas::instance()
+{
+    static ShapeIconAtlas atlas;
+    // QPixmap 必须在 QGuiApplication 析构前释放，不能留到静态对象析构
+    static const bool cleanupRegistered = []() {
+        qAddPostRoutine([]() { ShapeIconAtlas::instance().clear(); });
+        return true;
+    }();
+    Q_UNUSED(cleanupRegistered);
+    return atlas;
+}
+
+ShapeIconAtlas::~ShapeIconAtlas()
+{
+    preloading.waitForFinished();
+}
+
+QString ShapeIconAtlas::resourcePath(DiagramItem::DiagramType type)
+{
+    switch (type) {
+    case DiagramItem::Step: return QStringLiteral(":/images/NodesIcon/Step.png");
+    case DiagramItem::Conditional: return QStringLiteral(":/images/NodesIcon/Conditional.png");
+    case DiagramItem::StartEnd: return QStringLiteral(":/images/NodesIcon/StartEnd.png");
+    case DiagramItem::Io: return QStringLiteral(":/images/NodesIcon/Io.png");
+    case DiagramItem::circular: return QStringLiteral(":/images/NodesIcon/Circular.png");
+    case DiagramItem::StoredData: return QStringLiteral(":/images/NodesIcon/StoredData.png");
+    case DiagramItem::Document: return QStringLiteral(":/images/NodesIcon/Document.png");
+    case DiagramItem::PredefinedProcess: return QStringLiteral(":/images/NodesIcon/PredefinedProcess.png");
+    case DiagramItem::Memory: return QStringLiteral(":/images/NodesIcon/Memory.png");
+    case DiagramItem::SequentialAccessStorage: return QStringLiteral(":/images/NodesIcon/SequentialAccessStorage.png");
+    case DiagramItem::DirectAccessStorage: return QStringLiteral(":/images/NodesIcon/DirectAccessStorage.png");
+    case DiagramItem::Disk: return QStringLiteral(":/images/NodesIcon/Disk.png");
+    case DiagramItem::Card: return QStringLiteral(":/images/NodesIcon/Card.png");
+    case DiagramItem::ManualInput: return QStringLiteral(":/images/NodesIcon/ManualInput.png");
+    case DiagramItem::PerforatedTape: return QStringLiteral(":/images/NodesIcon/PerforatedTape.png");
+    case DiagramItem::Display: return QStringLiteral(":/images/NodesIcon/Display.png");
+    case DiagramItem::Preparation: return QStringLiteral(":/images/NodesIcon/Preparation.png");
+    case DiagramItem::ManualOperation: return QStringLiteral(":/images/NodesIcon/ManualOperation.png");
+    case DiagramItem::ParallelMode: return QStringLiteral(":/images/NodesIcon/ParallelMode.png");
+    case DiagramItem::Hexagon: return QStringLiteral(":/images/NodesIcon/Hexgon.png");
+    }
+    return QString();
+}
+
+QImage ShapeIconAtlas::decode(DiagramItem::DiagramType type)
+{
+    // 解码在锁外进行，两个线程同时解码同一图标时只保留先完成的那份
+    {
+        QMutexLocker locker(&mutex);
+        auto it = images.constFind(type);
+        if (it != images.constEnd())
+            return it.value();
+    }
+    QImage decoded(resourcePath(type));
+    if (!decoded.isNull())
+        decoded = decoded.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QMutexLocker locker(&mutex);
+    auto it = images.constFind(type);
+    if (it != images.constEnd())
+        return it.value();
+    ++decodes;
+    images.insert(type, decoded);
+    return decoded;
+}
+
+void ShapeIconAtlas::preload()
+{
+    QMutexLocker locker(&mutex);
+    if (preloading.isRunning() || images.size() == shapeTypeCount)
+        return;
+    preloading = QtConcurrent::run([this]() {
+        for (int t = 0; t < shapeTypeCount; ++t)
+            decode(DiagramItem::DiagramType(t));
+    });
+}
+
+void ShapeIconAtlas::waitForPreload()
+{
+    QFuture<void> future;
+    {
+        QMutexLocker locker(&mutex);
+        future = preloading;
+    }
+    future.waitForFinished();
+}
+
+QImage ShapeIconAtlas::image(DiagramItem::DiagramType type)
+{
+    return decode(type);
+}
+
+QPixmap ShapeIconAtlas::pixmap(DiagramItem::DiagramType type, const QSize &size, qreal devicePixelRatio)
+{
+    const PixmapKey key{ int(type), size.width(), size.height(), qRound(devicePixelRatio * 100) };
+    auto it = pixmaps.constFind(key);
+    if (it != pixmaps.constEnd())
+        return it.value();
+
+    const QImage source = image(type);
+    QPixmap result;
+    if (!source.isNull() && !size.isEmpty()) {
+        const QImage scaled = source.scaled(size * devicePixelRatio, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        result = QPixmap::fromImage(scaled);
+        result.setDevicePixelRatio(devicePixelRatio);
+    }
+    pixmaps.insert(key, result);
+    return result;
+}
+
+QIcon ShapeIconAtlas::icon(DiagramItem::DiagramType type)
+{
+    return QIcon(new ShapeIconEngine(type));
+}
+
+int ShapeIconAtlas::decodeCount() const
+{
+    QMutexLocker locker(&mutex);
+    return decodes;
+}
+
+void ShapeIconAtlas::clear()
+{
+    waitForPreload();
+    QMutexLocker locker(&mutex);
+    images.clear();
+    pixmaps.clear();
+    decodes = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SHAPEICONATLAS_H
+#define SHAPEICONATLAS_H
+
+#include "diagramitem.h"
+
+#include <QFuture>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QMutex>
+#include <QPixmap>
+
+// 图元图标集
+// 每种图形的图标只从资源解码一次，全进程共享（工具箱、拖拽预览、调色板等）。
+// preload() 在后台线程解码全部图标；未预加载时首次取用才解码。
+// 按逻辑尺寸和设备像素比缩放后的位图在 GUI 线程缓存
+class ShapeIconAtlas
+{
+public:
+    static ShapeIconAtlas &instance();
+    ~ShapeIconAtlas();
+
+    static QString resourcePath(DiagramItem::DiagramType type);
+
+    void preload();                                       // 后台解码全部图标，可重复调用
+    void waitForPreload();
+    QImage image(DiagramItem::DiagramType type);           // 原始尺寸，线程安全
+    QPixmap pixmap(DiagramItem::DiagramType type, const QSize &size, qreal devicePixelRatio); // 仅 GUI 线程
+    QIcon icon(DiagramItem::DiagramType type);             // 绘制时才取位图的图标
+
+    int decodeCount() const;                               // 实际解码次数（每种最多一次）
+    void clear();                                          // 丢弃全部解码结果和位图
+
+private:
+    ShapeIconAtlas() = default;
+    QImage decode(DiagramItem::DiagramType type);
+
+    mutable QMutex mutex;
+    QHash<int, QImage> images;
+    QFuture<void> preloading;
+    int decodes = 0;
+
+    struct PixmapKey {
+        int type;
+        int width;
+        int height;
+        int dpr;    // x100
+        bool operator==(const PixmapKey &other) const
+        {
+            return type == other.type && width == other.width && height == other.height && dpr == other.dpr;
+        }
+        friend size_t qHash(const PixmapKey &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.type, key.width, key.height, key.dpr);
+        }
+    };
+    QHash<PixmapKey, QPixmap> pixmaps;
+};
+
+#endif // SHAPEICONATLAS_H
@@ -0,0 +1,140 @@
+#include "startuptrace.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QEvent>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QWidget>
+
+namespace {
+// 一次性的事件过滤器：收到第一个绘制事件后卸下自己，等这次绘制处理完再记录首帧
+class FirstPaintFilter : public QObject
+{
+public:
+    using QObject::QObject;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint) {
+            watched->removeEventFilter(this);
+            QMetaObject::invokeMethod(this, [this]() {
+                StartupTrace::mark("first-frame");
+                StartupTrace::finish();
+                deleteLater();
+            }, Qt::QueuedConnection);
+        }
+        return false;
+    }
+};
+}
+
+bool StartupTrace::enabled = false;
+QElapsedTimer StartupTrace::clock;
+QList<StartupTrace::Phase> StartupTrace::recorded;
+QString StartupTrace::customLogPath;
+
+StartupTrace::Scope::Scope(const char *name)
+    : phaseName(name), begin(StartupTrace::enabled ? StartupTrace::now() : 0)
+{
+}
+
+StartupTrace::Scope::~Scope()
+{
+    if (StartupTrace::enabled)
+        StartupTrace::record(phaseName, begin, StartupTrace::now() - begin);
+}
+
+void StartupTrace::start(bool on)
+{
+    enabled = on;
+    recorded.clear();
+    if (enabled)
+        clock.start();
+}
+
+qint64 StartupTrace::now()
+{
+    return clock.isValid() ? clock.nsecsElapsed() : 0;
+}
+
+void StartupTrace::record(const char *name, qint64 startNs, qint64 elapsedNs)
+{
+    recorded.append(Phase{ QString::fromUtf8(name), startNs, elapsedNs });
+}
+
+void StartupTrace::mark(const char *name)
+{
+    if (!enabled)
+        return;
+    record(name, now(), 0);
+}
+
+QList<StartupTrace::Phase> StartupTrace::phases()
+{
+    return recorded;
+}
+
+QString StartupTrace::report()
+{
+    QString text;
+    QTextStream out(&text);
+    out << "startup trace " << QDateTime::currentDateTime().toString(Qt::ISODate) << '\n';
+    for (const Phase &phase : std::as_const(recorded)) {
+        out << QString::number(phase.startNs / 1e6, 'f', 2).rightJustified(10) << " ms  ";
+        if (phase.elapsedNs > 0)
+            out << QString::number(phase.elapsedNs / 1e6, 'f', 2).rightJustified(8) << " ms  ";
+        else
+            out << QString(12, QLatin1Char(' '));
+        out << phase.name << '\n';
+    }
+    return text;
+}
+
+QString StartupTrace::logPath()
+{
+    if (!customLogPath.isEmpty())
+        return customLogPath;
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    if (dir.isEmpty())
+        dir = QDir::tempPath();
+    return QDir(dir).filePath(QStringLiteral("startup-trace.log"));
+}
+
+void StartupTrace::setLogPath(const QString &path)
+{
+    customLogPath = path;
+}
+
+bool StartupTrace::finish()
+{
+    if (!enabled)
+        return false;
+
+    const QString text = report();
+    qInfo().noquote() << text;
+
+    const QString path = logPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    // 追加写入，便于对比多次启动
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "无法写入启动日志" << path;
+        return false;
+    }
+    file.write(text.toUtf8());
+    file.write("\n");
+    return true;
+}
+
+void StartupTrace::finishAfterFirstPaint(QWidget *widget)
+{
+    if (!enabled)
+        return;
+    // 过滤器是 widget 的子对象，窗口没显示就关闭时随之释放
+    widget->installEventFilter(new FirstPaintFilter(widget));
+}
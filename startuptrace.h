@@ -0,0 +1,56 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
+// 启动过程计时
+// 用 --startup-trace 启动时记录各阶段耗时（相对进程启动计时起点的毫秒数），
+// 首帧显示后写入日志文件并输出到调试信息。未启用时 mark() 只做一次布尔判断
+class StartupTrace
+{
+public:
+    struct Phase {
+        QString name;
+        qint64 startNs;     // 相对起点
+        qint64 elapsedNs;   // 本阶段耗时；单点标记为 0
+    };
+
+    // 计时范围：构造时开始、析构时记录一个阶段
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name);
+        ~Scope();
+    private:
+        const char *phaseName;
+        qint64 begin;
+    };
+
+    static void start(bool enabled);           // main() 最早调用，启用并开始计时
+    static bool isEnabled() { return enabled; }
+    static void mark(const char *name);         // 记录一个时间点
+    static QList<Phase> phases();
+    static QString report();                    // 可读的分阶段报告
+    static QString logPath();
+    static void setLogPath(const QString &path);
+    static bool finish();                       // 写入日志；返回是否写入成功
+    // widget（主视图的视口）第一次绘制完成后记录 "first-frame" 并 finish；未启用时什么也不做
+    static void finishAfterFirstPaint(QWidget *widget);
+
+private:
+    static qint64 now();
+    static void record(const char *name, qint64 startNs, qint64 elapsedNs);
+
+    static bool enabled;
+    static QElapsedTimer clock;
+    static QList<Phase> recorded;
+    static QString customLogPath;
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,153 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+#include <QGraphicsRectItem>
+#include <QRandomGenerator>
+
+#include "../alignmentindex.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+
+class TestAlignmentIndex : public QObject
+{
+    Q_OBJECT
+private slots:
+    void nearest_picks_closest_edge();
+    void nearest_respects_tolerance_and_exclude();
+    void update_and_remove_are_incremental();
+    void scene_keeps_index_in_sync();
+    void drag_query_latency_data();
+    void drag_query_latency();
+};
+
+void TestAlignmentIndex::nearest_picks_closest_edge()
+{
+    QGraphicsRectItem a, b, c;
+    AlignmentIndex index;
+    index.update(&a, QRectF(0, 0, 100, 50));
+    index.update(&b, QRectF(130, 200, 100, 50));
+    index.update(&c, QRectF(300, 400, 60, 60));
+
+    // 左边界 128 离 b(130) 最近
+    const AlignmentIndex::Candidate left = index.nearest(AlignmentIndex::Left, 128, 50);
+    QCOMPARE(left.item, &b);
+    QCOMPARE(left.coordinate, 130.0);
+    QCOMPARE(left.distance, 2.0);
+
+    // 垂直中心 27 离 a(25) 最近
+    const AlignmentIndex::Candidate centerY = index.nearest(AlignmentIndex::CenterY, 27, 50);
+    QCOMPARE(centerY.item, &a);
+    QCOMPARE(centerY.coordinate, 25.0);
+
+    // 底边界 458 离 c(460) 最近
+    const AlignmentIndex::Candidate bottom = index.nearest(AlignmentIndex::Bottom, 458, 50);
+    QCOMPARE(bottom.item, &c);
+}
+
+void TestAlignmentIndex::nearest_respects_tolerance_and_exclude()
+{
+    QGraphicsRectItem a, b;
+    AlignmentIndex index;
+    index.update(&a, QRectF(0, 0, 100, 50));
+    index.update(&b, QRectF(20, 0, 100, 50));
+
+    // 超出阈值不命中（与原实现一致，距离必须严格小于阈值）
+    QVERIFY(index.nearest(AlignmentIndex::Left, 70, 50).item == nullptr);
+    QVERIFY(index.nearest(AlignmentIndex::Left, 70, 50.5).item == &b);
+
+    // 正在拖动的图元自身被排除，退而求其次
+    const AlignmentIndex::Candidate c = index.nearest(AlignmentIndex::Left, 20, 50, &b);
+    QCOMPARE(c.item, &a);
+    QCOMPARE(c.distance, 20.0);
+}
+
+void TestAlignmentIndex::update_and_remove_are_incremental()
+{
+    QGraphicsRectItem a;
+    AlignmentIndex index;
+    index.update(&a, QRectF(0, 0, 100, 50));
+    index.update(&a, QRectF(500, 500, 100, 50));
+    QCOMPARE(index.size(), 1);
+
+    // 旧位置的边已经被移除
+    QVERIFY(index.nearest(AlignmentIndex::Left, 0, 10).item == nullptr);
+    QCOMPARE(index.nearest(AlignmentIndex::Left, 505, 10).item, &a);
+
+    index.remove(&a);
+    QCOMPARE(index.size(), 0);
+    QVERIFY(index.nearest(AlignmentIndex::Left, 500, 10).item == nullptr);
+}
+
+void TestAlignmentIndex::scene_keeps_index_in_sync()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(400, 300);
+
+    const AlignmentIndex &index = scene.alignmentIndex();
+    QCOMPARE(index.size(), 2);
+    QCOMPARE(index.rectOf(a), a->sceneBoundingRect());
+    QCOMPARE(index.rectOf(b), b->sceneBoundingRect());
+
+    // 尺寸变化也会刷新索引
+    b->setFixedSize(QSizeF(220, 130));
+    QCOMPARE(index.rectOf(b), b->sceneBoundingRect());
+
+    // 移出场景 / 删除后不再保留
+    scene.removeItem(a);
+    QCOMPARE(index.size(), 1);
+    delete a;
+    delete b;
+    QCOMPARE(index.size(), 0);
+}
+
+void TestAlignmentIndex::drag_query_latency_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("10000") << 10000;
+    QTest::newRow("50000") << 50000;
+}
+
+// 模拟一次拖动事件：更新被拖动图元的索引并做六次最近边查询，耗时应与图元数量基本无关
+void TestAlignmentIndex::drag_query_latency()
+{
+    QFETCH(int, count);
+
+    QList<QGraphicsRectItem *> items;
+    AlignmentIndex index;
+    QRandomGenerator rng(42);
+    for (int i = 0; i < count; ++i) {
+        auto *item = new QGraphicsRectItem;
+        items.append(item);
+        index.update(item, QRectF(rng.bounded(20000), rng.bounded(20000), 190, 140));
+    }
+
+    QGraphicsRectItem *moved = items.first();
+    qreal x = 0;
+    QBENCHMARK {
+        x += 7;
+        const QRectF rect(qreal(int(x) % 20000), 5000, 190, 140);
+        index.update(moved, rect);
+        for (int e = 0; e < AlignmentIndex::EdgeCount; ++e) {
+            const AlignmentIndex::Edge edge = AlignmentIndex::Edge(e);
+            index.nearest(edge, AlignmentIndex::coordinate(rect, edge), 50, moved);
+        }
+    }
+
+    qDeleteAll(items);
+}
+
+int runAlignmentIndexTests(int argc, char** argv)
+{
+    TestAlignmentIndex tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_alignment_index.moc"
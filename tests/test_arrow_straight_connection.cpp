@@ -135,6 +135,9 @@ class TestArrowStraightConnection : public QObject
 private slots:
     void straightConnection_basic_and_stable();
     void straightConnection_afterMove();
+    void straightConnection_curvedAndRotated();
+    void paint_does_not_change_geometry();
+    void endpoint_deleted_before_arrow();
 };
 
 void TestArrowStraightConnection::straightConnection_basic_and_stable()
@@ -234,6 +237,104 @@ void TestArrowStraightConnection::straightConnection_afterMove()
     delete end;
 }
 
+void TestArrowStraightConnection::straightConnection_curvedAndRotated()
+{
+    QGraphicsScene scene;
+    QMenu menu;
+
+    auto *start = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    auto *end   = new DiagramItem(DiagramItem::circular, &menu, nullptr);
+
+    start->setFixedSize(QSizeF(200, 100));
+    end->setFixedSize(QSizeF(160, 160));
+    start->setPos(100, 100);
+    end->setPos(500, 300);
+
+    scene.addItem(start);
+    scene.addItem(end);
+
+    auto *arrow = new Arrow(start, end);
+    scene.addItem(arrow);
+
+    // 不经过 render，几何在构造和端点变化时就已算好
+    QPointF head, tail;
+    getArrowHeadTailScene(arrow, head, tail);
+    assertHeadNearEndBoundaryOrInside(end, head, 6.0, 8.0);
+    assertTailAtStartCenter(start, tail, 1e-6);
+
+    end->setRotation(30);
+    getArrowHeadTailScene(arrow, head, tail);
+    assertHeadNearEndBoundaryOrInside(end, head, 6.0, 8.0);
+    QCOMPARE(arrow->arrowHeadPolygon().first(), arrow->line().p1());
+
+    delete arrow;
+    delete start;
+    delete end;
+}
+
+void TestArrowStraightConnection::paint_does_not_change_geometry()
+{
+    QGraphicsScene scene;
+    QMenu menu;
+
+    auto *start = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    auto *end   = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    start->setPos(100, 100);
+    end->setPos(450, 120);
+    scene.addItem(start);
+    scene.addItem(end);
+
+    auto *arrow = new Arrow(start, end);
+    scene.addItem(arrow);
+
+    const QLineF before = arrow->line();
+    const QRectF boundsBefore = arrow->boundingRect();
+    forceOneRender(scene);
+    forceOneRender(scene);
+    QCOMPARE(arrow->line(), before);
+    QCOMPARE(arrow->boundingRect(), boundsBefore);
+
+    // 端点图元先析构时箭头不再引用它
+    delete end;
+    QVERIFY(arrow->endItem() == nullptr);
+    forceOneRender(scene);
+
+    delete arrow;
+    delete start;
+}
+
+void TestArrowStraightConnection::endpoint_deleted_before_arrow()
+{
+    QGraphicsScene scene;
+    QMenu menu;
+
+    auto *start = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    auto *end   = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    start->setPos(100, 100);
+    end->setPos(450, 120);
+    scene.addItem(start);
+    scene.addItem(end);
+    auto *arrow = new Arrow(start, end);
+    scene.addItem(arrow);
+    QVERIFY(!arrow->line().isNull());
+
+    // 终点图元先析构：箭头不再有几何，剩下的端点移动、旋转时也不重算
+    delete end;
+    QVERIFY(arrow->endItem() == nullptr);
+    QVERIFY(arrow->line().isNull());
+    QVERIFY(arrow->arrowHeadPolygon().isEmpty());
+    start->setPos(300, 300);
+    start->setRotationAngle(45);
+    forceOneRender(scene);
+    QVERIFY(arrow->line().isNull());
+    QVERIFY(arrow->arrowHeadPolygon().isEmpty());
+
+    // 箭头析构时只从仍存在的端点注销
+    delete arrow;
+    start->setPos(100, 100);
+    delete start;
+}
+
 int runArrowStraightConnectionTests(int argc, char** argv)
 {
     TestArrowStraightConnection tc;
@@ -0,0 +1,138 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+#include <QRandomGenerator>
+
+#include "../pathbatchrouter.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+
+class TestBatchRouting : public QObject
+{
+    Q_OBJECT
+private slots:
+    void snapshot_query_returns_each_obstacle_once();
+    void batch_matches_serial_data();
+    void batch_matches_serial();
+    void large_flush_uses_batch();
+    void route_connectors_serial();
+    void route_connectors_batch();
+};
+
+// 网格排布的图元和随机连接相邻图元的连线（未计算几何）
+static QList<DiagramPath *> buildChart(DiagramScene &scene, QMenu *menu, int columns, int rows, int pathCount)
+{
+    QList<DiagramItem *> nodes;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            auto *item = new DiagramItem(DiagramItem::Step, menu);
+            scene.addItem(item);
+            item->setPos(c * 250, r * 200);
+            nodes.append(item);
+        }
+    }
+    QRandomGenerator rng(7);
+    QList<DiagramPath *> paths;
+    for (int i = 0; i < pathCount; ++i) {
+        const int c = rng.bounded(columns - 2);
+        const int r = rng.bounded(rows - 1);
+        DiagramItem *from = nodes.at(r * columns + c);
+        DiagramItem *to = nodes.at((r + rng.bounded(2)) * columns + c + 1 + rng.bounded(2));
+        auto *path = new DiagramPath(from, to, DiagramItem::TF_Right, DiagramItem::TF_Left);
+        from->addPathes(path);
+        to->addPathes(path);
+        scene.addItem(path);
+        paths.append(path);
+    }
+    return paths;
+}
+
+void TestBatchRouting::snapshot_query_returns_each_obstacle_once()
+{
+    ObstacleSnapshot snapshot(100);
+    snapshot.add(QRectF(0, 0, 450, 450));     // 跨 25 个格子
+    snapshot.add(QRectF(1000, 1000, 10, 10));
+
+    QCOMPARE(snapshot.query(QRectF(-50, -50, 600, 600)).size(), 1);
+    QCOMPARE(snapshot.query(QRectF(-50, -50, 2000, 2000)).size(), 2);
+    QVERIFY(snapshot.query(QRectF(600, 600, 100, 100)).isEmpty());
+}
+
+void TestBatchRouting::batch_matches_serial_data()
+{
+    QTest::addColumn<int>("routing");
+    QTest::newRow("legacy") << int(DiagramScene::LegacyRouting);
+    QTest::newRow("orthogonal") << int(DiagramScene::OrthogonalRouting);
+}
+
+void TestBatchRouting::batch_matches_serial()
+{
+    QFETCH(int, routing);
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::PathRouting(routing));
+    const QList<DiagramPath *> paths = buildChart(scene, &menu, 12, 8, 300);
+
+    scene.routePaths(paths);
+    QList<QPainterPath> batched;
+    for (DiagramPath *path : paths)
+        batched.append(path->path());
+
+    for (int i = 0; i < paths.size(); ++i) {
+        QVERIFY(!batched.at(i).isEmpty());
+        paths.at(i)->updatePath();
+        QCOMPARE(paths.at(i)->path(), batched.at(i));
+    }
+    if (routing == DiagramScene::OrthogonalRouting)
+        QCOMPARE(scene.corridorIndex().size(), paths.size());
+}
+
+void TestBatchRouting::large_flush_uses_batch()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+    const QList<DiagramPath *> paths = buildChart(scene, &menu, 10, 6, 200);
+    QCoreApplication::processEvents();
+    scene.resetPathUpdateStats();
+
+    for (DiagramPath *path : paths)
+        scene.markPathDirty(path);
+    scene.flushDirtyPaths();
+    QCOMPARE(scene.pathUpdateStats().recomputed, paths.size());
+    QVERIFY(!scene.hasDirtyPaths());
+    for (DiagramPath *path : paths)
+        QVERIFY(scene.corridorIndex().contains(path));
+}
+
+// 加载大图时的连线计算：逐条 updatePath 与批量并行路由对比
+void TestBatchRouting::route_connectors_serial()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+    const QList<DiagramPath *> paths = buildChart(scene, &menu, 60, 40, 5000);
+    QBENCHMARK {
+        for (DiagramPath *path : paths)
+            path->updatePath();
+    }
+}
+
+void TestBatchRouting::route_connectors_batch()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+    const QList<DiagramPath *> paths = buildChart(scene, &menu, 60, 40, 5000);
+    QBENCHMARK {
+        scene.routePaths(paths);
+    }
+}
+
+int runBatchRoutingTests(int argc, char** argv)
+{
+    TestBatchRouting tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_batch_routing.moc"
@@ -0,0 +1,167 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../diagramscene.h"
+#include "../diagrammodel.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "test_fixtures.h"
+
+class TestBulkBuild : public QObject
+{
+    Q_OBJECT
+private slots:
+    void indexes_suspended_while_building();
+    void connectors_routed_once_geometry_is_final();
+    void nested_builds_finish_at_outermost();
+    void deleted_items_leave_no_trace();
+    void batched_connectors_reach_layer();
+    void add_model_10000_nodes();
+    void add_model_10000_nodes_incremental();
+};
+
+static QList<DiagramPath *> pathsOf(const QList<QGraphicsItem *> &items)
+{
+    QList<DiagramPath *> paths;
+    for (QGraphicsItem *item : items) {
+        if (DiagramPath *path = qgraphicsitem_cast<DiagramPath *>(item))
+            paths.append(path);
+    }
+    return paths;
+}
+
+void TestBulkBuild::indexes_suspended_while_building()
+{
+    DiagramScene scene(nullptr);
+    QCOMPARE(scene.itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+
+    scene.beginBulkBuild();
+    QVERIFY(scene.bulkBuilding());
+    QCOMPARE(scene.itemIndexMethod(), QGraphicsScene::NoIndex);
+    auto *item = new DiagramItem(DiagramItem::Step);
+    scene.addItem(item);
+    item->setPos(300, 200);
+    QVERIFY(!scene.alignmentIndex().contains(item));
+    QVERIFY(!scene.portIndex().contains(item));
+    scene.endBulkBuild();
+
+    QVERIFY(!scene.bulkBuilding());
+    QCOMPARE(scene.itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+    QCOMPARE(scene.alignmentIndex().rectOf(item), item->sceneBoundingRect());
+    QVERIFY(scene.portIndex().contains(item));
+    QCOMPARE(scene.items(item->sceneBoundingRect().center()).contains(item), true);
+}
+
+void TestBulkBuild::connectors_routed_once_geometry_is_final()
+{
+    DiagramScene scene(nullptr);
+    const QList<QGraphicsItem *> created = scene.addModel(chainModel(3));
+    const QList<DiagramPath *> paths = pathsOf(created);
+    QCOMPARE(paths.size(), 2);
+    QVERIFY(!scene.hasDirtyPaths());
+    for (DiagramPath *path : paths) {
+        QVERIFY(!path->path().isEmpty());
+        // 路径从起点图元的连接点出发，说明路由时图元已在最终位置
+        QVERIFY(path->path().boundingRect().intersects(path->getStartItem()->sceneBoundingRect()));
+        QVERIFY(path->path().boundingRect().intersects(path->getEndItem()->sceneBoundingRect()));
+    }
+}
+
+void TestBulkBuild::nested_builds_finish_at_outermost()
+{
+    DiagramScene scene(nullptr);
+    scene.beginBulkBuild();
+    const QList<DiagramPath *> paths = pathsOf(scene.addModel(chainModel(4)));
+    // addModel 自己的批量构建结束时仍在外层之内，连线还没有路由
+    QVERIFY(scene.bulkBuilding());
+    QVERIFY(scene.hasDirtyPaths());
+    QVERIFY(paths.first()->path().isEmpty());
+
+    // 外层里继续移动图元，连线按移动后的位置路由
+    DiagramItem *first = paths.first()->getStartItem();
+    first->setPos(first->pos() + QPointF(0, 500));
+    QCoreApplication::processEvents();   // 期间的刷新事件不路由
+    QVERIFY(paths.first()->path().isEmpty());
+    scene.endBulkBuild();
+
+    QVERIFY(!scene.hasDirtyPaths());
+    for (DiagramPath *path : paths)
+        QVERIFY(!path->path().isEmpty());
+    QVERIFY(paths.first()->path().boundingRect().intersects(first->sceneBoundingRect()));
+    QCOMPARE(scene.alignmentIndex().rectOf(first), first->sceneBoundingRect());
+}
+
+void TestBulkBuild::deleted_items_leave_no_trace()
+{
+    DiagramScene scene(nullptr);
+    scene.beginBulkBuild();
+    const QList<QGraphicsItem *> created = scene.addModel(chainModel(3));
+    QList<DiagramItem *> items;
+    for (QGraphicsItem *item : created) {
+        if (DiagramItem *diagramItem = qgraphicsitem_cast<DiagramItem *>(item))
+            items.append(diagramItem);
+    }
+    // 删除中间的图元和它的两条连线
+    items.at(1)->removePathes();
+    scene.removeItem(items.at(1));
+    delete items.at(1);
+    scene.endBulkBuild();
+
+    QCOMPARE(scene.graph().nodeCount(), 2);
+    QCOMPARE(scene.graph().edgeCount(), 0);
+    QVERIFY(scene.alignmentIndex().contains(items.at(0)));
+    QVERIFY(scene.alignmentIndex().contains(items.at(2)));
+}
+
+void TestBulkBuild::batched_connectors_reach_layer()
+{
+    DiagramScene scene(nullptr);
+    scene.setBatchedConnectors(true);
+    const QList<DiagramPath *> paths = pathsOf(scene.addModel(chainModel(5)));
+    QCOMPARE(paths.size(), 4);
+    for (DiagramPath *path : paths) {
+        QVERIFY(path->isBatched());
+        QVERIFY(scene.connectorLayer().contains(path));
+        QVERIFY(!scene.connectorLayer().boundsOf(path).isEmpty());
+    }
+}
+
+void TestBulkBuild::add_model_10000_nodes()
+{
+    const DiagramModel model = chainModel(10000);
+    QBENCHMARK {
+        DiagramScene scene(nullptr);
+        scene.addModel(model);
+        QCOMPARE(scene.graph().nodeCount(), 10000);
+    }
+}
+
+void TestBulkBuild::add_model_10000_nodes_incremental()
+{
+    // 对照：逐个插入并立即路由
+    const DiagramModel model = chainModel(10000);
+    QBENCHMARK {
+        DiagramScene scene(nullptr);
+        QList<DiagramItem *> nodes;
+        nodes.reserve(model.nodeCount());
+        for (int i = 0; i < model.nodeCount(); ++i) {
+            auto *item = new DiagramItem(DiagramItem::Step);
+            DiagramScene::applyModelNode(item, model.node(i));
+            scene.addItem(item);
+            nodes.append(item);
+        }
+        for (int i = 0; i < model.connectorCount(); ++i) {
+            const DiagramModel::Connector &c = model.connector(i);
+            scene.addConnector(nodes.at(c.from), nodes.at(c.to), c.fromPort, c.toPort)->updatePath();
+        }
+        QCOMPARE(scene.graph().nodeCount(), 10000);
+    }
+}
+
+int runBulkBuildTests(int argc, char** argv)
+{
+    TestBulkBuild tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_bulk_build.moc"
@@ -0,0 +1,265 @@
+#include <QtTest/QtTest>
+#include <QGraphicsSceneMouseEvent>
+#include <QImage>
+#include <QMenu>
+#include <QPainter>
+
+#include "../connectorlayer.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "test_fixtures.h"
+
+class TestConnectorLayer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void indexes_segments();
+    void toggling_moves_paths_into_layer();
+    void batched_render_matches_items();
+    void click_selects_batched_path();
+    void marquee_selects_batched_path();
+    void render_connectors_items();
+    void render_connectors_batched();
+};
+
+static QImage renderScene(QGraphicsScene &scene, const QRectF &source)
+{
+    QImage image(source.size().toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+    return image;
+}
+
+// 两个图元和从左边图元右侧连到右边图元左侧的连线
+static DiagramPath *buildPair(DiagramScene &scene, QMenu *menu, QPointF from, QPointF to)
+{
+    auto *a = new DiagramItem(DiagramItem::Step, menu);
+    auto *b = new DiagramItem(DiagramItem::Step, menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(from);
+    b->setPos(to);
+    return connectItems(scene, a, b);
+}
+
+static QPointF midpointOf(const QPainterPath &body)
+{
+    // 取主干中间一段的中点，避开两端的图元
+    const int i = body.elementCount() / 2;
+    return (QPointF(body.elementAt(i - 1)) + QPointF(body.elementAt(i))) / 2;
+}
+
+void TestConnectorLayer::indexes_segments()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    DiagramPath *path = buildPair(scene, &menu, QPointF(0, 0), QPointF(600, 300));
+
+    ConnectorLayer layer(100);
+    layer.update(path);
+    QVERIFY(layer.contains(path));
+    QVERIFY(layer.boundsOf(path).contains(path->path().boundingRect()));
+
+    const QPointF mid = midpointOf(path->bodyPath());
+    QCOMPARE(layer.pathAt(mid, 2), path);
+    QCOMPARE(layer.pathAt(mid + QPointF(1.5, 1.5), 4), path);
+    QCOMPARE(layer.pathAt(QPointF(5000, 5000), 4), nullptr);
+    QCOMPARE(layer.pathsIn(QRectF(mid - QPointF(3, 3), QSizeF(6, 6))), QList<DiagramPath *>{ path });
+    QVERIFY(layer.pathsIn(QRectF(5000, 5000, 10, 10)).isEmpty());
+
+    layer.remove(path);
+    QCOMPARE(layer.size(), 0);
+    QCOMPARE(layer.pathAt(mid, 2), nullptr);
+}
+
+void TestConnectorLayer::toggling_moves_paths_into_layer()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    DiagramPath *first = buildPair(scene, &menu, QPointF(0, 0), QPointF(500, 0));
+
+    scene.setBatchedConnectors(true);
+    QVERIFY(first->isBatched());
+    QVERIFY(first->boundingRect().isEmpty());
+    QCOMPARE(scene.connectorLayer().size(), 1);
+
+    // 开启后新加入的连线同样进入连线层，几何变化后索引随之更新
+    DiagramPath *second = buildPair(scene, &menu, QPointF(0, 600), QPointF(500, 900));
+    QVERIFY(second->isBatched());
+    QCOMPARE(scene.connectorLayer().size(), 2);
+    second->getEndItem()->setPos(800, 900);
+    second->updatePath();
+    QCOMPARE(scene.connectorLayer().boundsOf(second).right(), second->path().boundingRect().right() + 0.5);
+
+    scene.removeItem(second);
+    QCOMPARE(scene.connectorLayer().size(), 1);
+    second->getStartItem()->removePath(second);
+    second->getEndItem()->removePath(second);
+    delete second;
+
+    scene.setBatchedConnectors(false);
+    QVERIFY(!first->isBatched());
+    QVERIFY(!first->boundingRect().isEmpty());
+    QCOMPARE(scene.connectorLayer().size(), 0);
+}
+
+void TestConnectorLayer::batched_render_matches_items()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    QList<DiagramPath *> paths;
+    for (int i = 0; i < 4; ++i)
+        paths.append(buildPair(scene, &menu, QPointF(0, i * 250), QPointF(500, i * 250 + 100)));
+    // 只比较连线：图元隐藏
+    for (QGraphicsItem *item : scene.items()) {
+        if (item->type() == DiagramItem::Type)
+            item->setVisible(false);
+    }
+    const QRectF source = scene.itemsBoundingRect().adjusted(-20, -20, 20, 20);
+    const QImage itemImage = renderScene(scene, source);
+
+    scene.setBatchedConnectors(true);
+    const QImage batchedImage = renderScene(scene, source);
+    QCOMPARE(scene.connectorLayer().lastPaintStats().paths, paths.size());
+    QCOMPARE(scene.connectorLayer().lastPaintStats().batches, 1);
+
+    // 折线连接处的像素可能略有差别，要求逐条绘制的像素绝大部分在批量绘制中同样画出
+    int drawn = 0;
+    int matched = 0;
+    for (int y = 0; y < itemImage.height(); ++y) {
+        for (int x = 0; x < itemImage.width(); ++x) {
+            if (qGray(itemImage.pixel(x, y)) > 128)
+                continue;
+            ++drawn;
+            if (qGray(batchedImage.pixel(x, y)) <= 128)
+                ++matched;
+        }
+    }
+    QVERIFY(drawn > 0);
+    QVERIFY2(matched >= drawn * 95 / 100, qPrintable(QStringLiteral("%1 / %2").arg(matched).arg(drawn)));
+}
+
+static void pressAt(DiagramScene &scene, const QPointF &pos, Qt::KeyboardModifiers modifiers = Qt::NoModifier)
+{
+    QGraphicsSceneMouseEvent press(QEvent::GraphicsSceneMousePress);
+    press.setScenePos(pos);
+    press.setButton(Qt::LeftButton);
+    press.setButtons(Qt::LeftButton);
+    press.setModifiers(modifiers);
+    QCoreApplication::sendEvent(&scene, &press);
+
+    QGraphicsSceneMouseEvent release(QEvent::GraphicsSceneMouseRelease);
+    release.setScenePos(pos);
+    release.setButton(Qt::LeftButton);
+    release.setModifiers(modifiers);
+    QCoreApplication::sendEvent(&scene, &release);
+}
+
+void TestConnectorLayer::click_selects_batched_path()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    DiagramPath *path = buildPair(scene, &menu, QPointF(0, 0), QPointF(600, 300));
+    scene.setBatchedConnectors(true);
+
+    const QPointF mid = midpointOf(path->bodyPath());
+    pressAt(scene, mid + QPointF(1, 1));
+    QVERIFY(path->isSelected());
+    QCOMPARE(scene.selectedItems(), QList<QGraphicsItem *>{ path });
+
+    // 点在空白处清空选择
+    pressAt(scene, QPointF(3000, 3000));
+    QVERIFY(!path->isSelected());
+}
+
+void TestConnectorLayer::marquee_selects_batched_path()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    DiagramPath *path = buildPair(scene, &menu, QPointF(0, 0), QPointF(600, 300));
+    scene.setBatchedConnectors(true);
+
+    const QRectF bounds = scene.connectorLayer().boundsOf(path).adjusted(-5, -5, 5, 5);
+    QGraphicsSceneMouseEvent press(QEvent::GraphicsSceneMousePress);
+    press.setScenePos(bounds.topLeft());
+    press.setButton(Qt::LeftButton);
+    press.setButtons(Qt::LeftButton);
+    press.setModifiers(Qt::ShiftModifier);
+    QCoreApplication::sendEvent(&scene, &press);
+
+    QGraphicsSceneMouseEvent move(QEvent::GraphicsSceneMouseMove);
+    move.setScenePos(bounds.bottomRight());
+    move.setButtons(Qt::LeftButton);
+    move.setModifiers(Qt::ShiftModifier);
+    QCoreApplication::sendEvent(&scene, &move);
+
+    QVERIFY(path->isSelected());
+
+    QGraphicsSceneMouseEvent release(QEvent::GraphicsSceneMouseRelease);
+    release.setScenePos(bounds.bottomRight());
+    release.setButton(Qt::LeftButton);
+    release.setModifiers(Qt::ShiftModifier);
+    QCoreApplication::sendEvent(&scene, &release);
+    QVERIFY(path->isSelected());
+}
+
+// 5000 条连线整体渲染：逐条图元与批量绘制对比
+static void buildConnectorChart(DiagramScene &scene, QMenu *menu)
+{
+    const int columns = 50;
+    const int rows = 50;
+    QList<DiagramItem *> nodes;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            auto *item = new DiagramItem(DiagramItem::Step, menu);
+            scene.addItem(item);
+            item->setPos(c * 250, r * 200);
+            nodes.append(item);
+        }
+    }
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c + 1 < columns; ++c) {
+            connectItems(scene, nodes.at(r * columns + c), nodes.at(r * columns + c + 1));
+            if (r + 1 < rows && c % 2 == 0)
+                connectItems(scene, nodes.at(r * columns + c), nodes.at((r + 1) * columns + c + 1));
+        }
+    }
+}
+
+void TestConnectorLayer::render_connectors_items()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    buildConnectorChart(scene, &menu);
+    const QRectF source = scene.itemsBoundingRect();
+    QImage image(QSize(1600, 1200), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        QPainter painter(&image);
+        scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+    }
+}
+
+void TestConnectorLayer::render_connectors_batched()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    buildConnectorChart(scene, &menu);
+    scene.setBatchedConnectors(true);
+    const QRectF source = scene.itemsBoundingRect();
+    QImage image(QSize(1600, 1200), QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        QPainter painter(&image);
+        scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+    }
+    QVERIFY(scene.connectorLayer().lastPaintStats().paths > 0);
+}
+
+int runConnectorLayerTests(int argc, char** argv)
+{
+    TestConnectorLayer tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_connector_layer.moc"
@@ -0,0 +1,169 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../diagramgraph.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "test_fixtures.h"
+
+class TestDiagramGraph : public QObject
+{
+    Q_OBJECT
+private slots:
+    void tracks_in_and_out_edges();
+    void removing_node_removes_edges();
+    void ids_are_stable();
+    void edge_is_compact();
+    void scene_registers_items_and_paths();
+    void regrouped_item_keeps_its_paths();
+    void build_10000_edges();
+};
+
+void TestDiagramGraph::tracks_in_and_out_edges()
+{
+    DiagramGraph graph;
+    const DiagramGraph::NodeId a = graph.addNode(nullptr);
+    const DiagramGraph::NodeId b = graph.addNode(nullptr);
+    const DiagramGraph::NodeId c = graph.addNode(nullptr);
+    const DiagramGraph::EdgeId ab = graph.addEdge(a, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    const DiagramGraph::EdgeId ac = graph.addEdge(a, c, DiagramItem::TF_Bottom, DiagramItem::TF_Top);
+
+    QCOMPARE(graph.nodeCount(), 3);
+    QCOMPARE(graph.edgeCount(), 2);
+    QCOMPARE(graph.outEdges(a).size(), 2);
+    QCOMPARE(graph.inEdges(a).size(), 0);
+    QCOMPARE(graph.inEdges(b).size(), 1);
+    QCOMPARE(graph.inEdges(b).at(0), ab);
+    QCOMPARE(graph.edge(ac).to, c);
+    QCOMPARE(int(graph.edge(ac).fromPort), int(DiagramItem::TF_Bottom));
+    QCOMPARE(int(graph.edge(ac).toPort), int(DiagramItem::TF_Top));
+
+    graph.removeEdge(ab);
+    QVERIFY(!graph.hasEdge(ab));
+    QCOMPARE(graph.outEdges(a).size(), 1);
+    QVERIFY(graph.inEdges(b).isEmpty());
+}
+
+void TestDiagramGraph::removing_node_removes_edges()
+{
+    DiagramGraph graph;
+    const DiagramGraph::NodeId a = graph.addNode(nullptr);
+    const DiagramGraph::NodeId b = graph.addNode(nullptr);
+    const DiagramGraph::NodeId c = graph.addNode(nullptr);
+    graph.addEdge(a, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    graph.addEdge(c, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    const DiagramGraph::EdgeId ac = graph.addEdge(a, c, DiagramItem::TF_Right, DiagramItem::TF_Left);
+
+    graph.removeNode(b);
+    QVERIFY(!graph.hasNode(b));
+    QCOMPARE(graph.edgeCount(), 1);
+    QVERIFY(graph.hasEdge(ac));
+    QCOMPARE(graph.outEdges(c).size(), 0);
+    QCOMPARE(graph.outEdges(a).size(), 1);
+}
+
+void TestDiagramGraph::ids_are_stable()
+{
+    DiagramGraph graph;
+    const DiagramGraph::NodeId a = graph.addNode(nullptr);
+    const DiagramGraph::NodeId b = graph.addNode(nullptr);
+    const DiagramGraph::NodeId c = graph.addNode(nullptr);
+    const DiagramGraph::EdgeId bc = graph.addEdge(b, c, DiagramItem::TF_Right, DiagramItem::TF_Left);
+
+    // 删除其他节点不影响已有编号，空出的槽位被重用
+    graph.removeNode(a);
+    QVERIFY(graph.hasNode(b));
+    QCOMPARE(graph.edge(bc).from, b);
+    QCOMPARE(graph.edge(bc).to, c);
+    QCOMPARE(graph.addNode(nullptr), a);
+    QCOMPARE(graph.nodeCapacity(), 3);
+}
+
+void TestDiagramGraph::edge_is_compact()
+{
+    // 原来每条连线要在两端图元各存一个 QMap 节点和一个 QString（"1"+方位），
+    // 现在只是边表中的一项加上两端邻接数组里的两个整数
+    QVERIFY(sizeof(DiagramGraph::Edge) <= 24);
+}
+
+void TestDiagramGraph::scene_registers_items_and_paths()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    QCOMPARE(scene.graph().nodeCount(), 2);
+    QCOMPARE(scene.graph().item(a->graphNode), a);
+
+    DiagramPath *path = connectItems(scene, a, b);
+    const DiagramGraph &graph = scene.graph();
+    QVERIFY(graph.hasEdge(path->graphEdge));
+    const DiagramGraph::Edge &edge = graph.edge(path->graphEdge);
+    QCOMPARE(edge.from, a->graphNode);
+    QCOMPARE(edge.to, b->graphNode);
+    QCOMPARE(int(edge.fromPort), int(DiagramItem::TF_Right));
+    QCOMPARE(int(edge.toPort), int(DiagramItem::TF_Left));
+    QCOMPARE(edge.path, path);
+    QCOMPARE(graph.outEdges(a->graphNode).size(), 1);
+    QCOMPARE(graph.inEdges(b->graphNode).size(), 1);
+
+    scene.removeItem(path);
+    QCOMPARE(path->graphEdge, -1);
+    QCOMPARE(scene.graph().edgeCount(), 0);
+    scene.addItem(path);
+    QCOMPARE(scene.graph().edgeCount(), 1);
+
+    // 删除端点图元后边随之删除
+    a->removePath(path);
+    b->removePath(path);
+    delete b;
+    QCOMPARE(scene.graph().nodeCount(), 1);
+    QCOMPARE(scene.graph().edgeCount(), 0);
+    QCOMPARE(path->graphEdge, -1);
+    scene.removeItem(path);
+    delete path;
+}
+
+void TestDiagramGraph::regrouped_item_keeps_its_paths()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    DiagramPath *path = connectItems(scene, a, b);
+
+    // 图元暂时离开场景（组合、撤销删除）再加入，连线仍然在场景中时要重新登记
+    scene.removeItem(a);
+    QCOMPARE(scene.graph().edgeCount(), 0);
+    scene.addItem(a);
+    QVERIFY(scene.graph().hasEdge(path->graphEdge));
+    QCOMPARE(scene.graph().edge(path->graphEdge).from, a->graphNode);
+}
+
+void TestDiagramGraph::build_10000_edges()
+{
+    QBENCHMARK {
+        DiagramGraph graph;
+        for (int i = 0; i < 5000; ++i)
+            graph.addNode(nullptr);
+        for (int i = 0; i < 10000; ++i)
+            graph.addEdge(i % 5000, (i * 7 + 1) % 5000, DiagramItem::TF_Right, DiagramItem::TF_Left);
+        int degree = 0;
+        for (int n = 0; n < 5000; ++n)
+            degree += graph.outEdges(n).size() + graph.inEdges(n).size();
+        QCOMPARE(degree, 20000);
+    }
+}
+
+int runDiagramGraphTests(int argc, char** argv)
+{
+    TestDiagramGraph tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_diagram_graph.moc"
@@ -0,0 +1,244 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../diagrammodel.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+
+class TestDiagramModel : public QObject
+{
+    Q_OBJECT
+private slots:
+    void text_roundtrip();
+    void reads_legacy_file();
+    void styles_are_shared();
+    void validate_reports_broken_connectors();
+    void find_text();
+    void datastream_roundtrip();
+    void scene_roundtrip();
+    void item_without_menu();
+    void serialize_20000_nodes();
+};
+
+static DiagramModel::Node makeNode(int type, qreal x, qreal y, const QString &text)
+{
+    DiagramModel::Node node;
+    node.type = type;
+    node.pos = QPointF(x, y);
+    node.size = QSizeF(100, 60);
+    node.fill = qRgba(10, 20, 30, 255);
+    node.text = text;
+    node.style.family = QStringLiteral("Microsoft YaHei");
+    node.style.pointSize = 12;
+    node.style.color = qRgba(200, 100, 50, 255);
+    return node;
+}
+
+void TestDiagramModel::text_roundtrip()
+{
+    DiagramModel model;
+    model.addNode(makeNode(DiagramItem::Step, 10, 20, QStringLiteral("开始 节点")));
+    DiagramModel::Node second = makeNode(DiagramItem::Conditional, -40, 300, QStringLiteral("判断"));
+    second.style.bold = true;
+    model.addNode(second);
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+
+    QString buffer;
+    QTextStream out(&buffer);
+    model.writeText(out);
+    out.flush();
+
+    DiagramModel loaded;
+    QTextStream in(&buffer);
+    QString error;
+    QVERIFY2(loaded.readText(in, &error), qPrintable(error));
+    QCOMPARE(loaded.nodeCount(), 2);
+    QCOMPARE(loaded.connectorCount(), 1);
+    const DiagramModel::Node a = loaded.node(0);
+    QCOMPARE(a.text, QStringLiteral("开始 节点"));
+    QCOMPARE(a.style.family, QStringLiteral("Microsoft YaHei"));
+    QCOMPARE(a.fill, qRgba(10, 20, 30, 255));
+    QCOMPARE(a.style.color, qRgba(200, 100, 50, 255));
+    QCOMPARE(loaded.nodePos(1), QPointF(-40, 300));
+    QVERIFY(loaded.node(1).style.bold);
+    QCOMPARE(loaded.connector(0).from, 0);
+    QCOMPARE(loaded.connector(0).to, 1);
+    QCOMPARE(loaded.connector(0).fromPort, int(DiagramItem::TF_Bottom));
+}
+
+void TestDiagramModel::reads_legacy_file()
+{
+    // 旧版本保存的文件：颜色按 r b g a，布尔写成 1/0，连线编号从 1 开始
+    QString legacy = QStringLiteral(
+        "DT_Size_2\n"
+        "0 0 120 80 0 255 0 0 255 开始 0 SimSun 9 1 0 0 0 0 255 \n"
+        "0 200 120 80 0 0 255 0 255 结束 2 SimSun 9 0 1 0 0 0 255 \n"
+        "LN_Size_1\n"
+        "1 4 2 8\n");
+    QTextStream in(&legacy);
+    DiagramModel model;
+    QVERIFY(model.readText(in));
+    QCOMPARE(model.nodeCount(), 2);
+    QCOMPARE(model.nodeType(1), int(DiagramItem::StartEnd));
+    QCOMPARE(model.node(0).fill, qRgba(255, 0, 0, 255));
+    QCOMPARE(model.node(1).fill, qRgba(0, 0, 255, 255));
+    QVERIFY(model.node(0).style.bold);
+    QVERIFY(model.node(1).style.italic);
+    QCOMPARE(model.connector(0).from, 0);
+    QCOMPARE(model.connector(0).to, 1);
+    QVERIFY(model.validate().isEmpty());
+
+    // 没有连线的文件不带 LN 段
+    QString itemsOnly = QStringLiteral("DT_Size_1\n0 0 120 80 0 255 0 0 255 a 0 SimSun 9 0 0 0 0 0 255 \n");
+    QTextStream in2(&itemsOnly);
+    QVERIFY(model.readText(in2));
+    QCOMPARE(model.nodeCount(), 1);
+    QCOMPARE(model.connectorCount(), 0);
+
+    QString broken = QStringLiteral("LN_Size_1\n");
+    QTextStream in3(&broken);
+    QString error;
+    QVERIFY(!model.readText(in3, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestDiagramModel::styles_are_shared()
+{
+    DiagramModel model;
+    for (int i = 0; i < 100; ++i)
+        model.addNode(makeNode(DiagramItem::Step, i * 10, 0, QString::number(i)));
+    DiagramModel::Node other = makeNode(DiagramItem::Step, 0, 0, QStringLiteral("x"));
+    other.style.italic = true;
+    model.addNode(other);
+    QCOMPARE(model.nodeCount(), 101);
+    QCOMPARE(model.styleCount(), 2);
+    QVERIFY(model.node(100).style.italic);
+    QVERIFY(!model.node(99).style.italic);
+}
+
+void TestDiagramModel::validate_reports_broken_connectors()
+{
+    DiagramModel model;
+    model.addNode(makeNode(DiagramItem::Step, 0, 0, QStringLiteral("a")));
+    model.addNode(makeNode(DiagramItem::Step, 0, 100, QStringLiteral("b")));
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+    QVERIFY(model.validate().isEmpty());
+
+    model.addConnector(DiagramModel::Connector{ 0, 5, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Cen, DiagramItem::TF_Top });
+    QCOMPARE(model.validate().size(), 2);
+}
+
+void TestDiagramModel::find_text()
+{
+    DiagramModel model;
+    model.addNode(makeNode(DiagramItem::Step, 0, 0, QStringLiteral("读取 Input")));
+    model.addNode(makeNode(DiagramItem::Step, 0, 100, QStringLiteral("处理")));
+    model.addNode(makeNode(DiagramItem::Step, 0, 200, QStringLiteral("input 校验")));
+    QCOMPARE(model.find(QStringLiteral("input")), QList<int>({ 2 }));
+    QCOMPARE(model.find(QStringLiteral("input"), Qt::CaseInsensitive), QList<int>({ 0, 2 }));
+}
+
+void TestDiagramModel::datastream_roundtrip()
+{
+    DiagramModel model;
+    model.addNode(makeNode(DiagramItem::Io, 1.5, 2.5, QStringLiteral("输入")));
+    model.addNode(makeNode(DiagramItem::Step, 0, 120, QStringLiteral("处理")));
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << model;
+    }
+    DiagramModel copy;
+    QDataStream in(&data, QIODevice::ReadOnly);
+    in >> copy;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QCOMPARE(copy.nodeCount(), 2);
+    QCOMPARE(copy.connectorCount(), 1);
+    // 二进制格式保留小数坐标
+    QCOMPARE(copy.nodePos(0), QPointF(1.5, 2.5));
+    QCOMPARE(copy.nodeText(0), QStringLiteral("输入"));
+    QVERIFY(copy.node(1).style == model.node(1).style);
+}
+
+void TestDiagramModel::scene_roundtrip()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Conditional, &menu);
+    a->setPos(0, 0);
+    b->setPos(0, 300);
+    a->setLabelText(QStringLiteral("开始"));
+    QFont font = a->labelFont();
+    font.setBold(true);
+    a->setLabelFont(font);
+    scene.addItem(a);
+    scene.addItem(b);
+    auto *path = new DiagramPath(a, b, DiagramItem::TF_Bottom, DiagramItem::TF_Top);
+    a->addPathes(path);
+    b->addPathes(path);
+    scene.addItem(path);
+
+    const DiagramModel model = scene.toModel();
+    QCOMPARE(model.nodeCount(), 2);
+    QCOMPARE(model.connectorCount(), 1);
+
+    DiagramScene other(&menu);
+    const QList<QGraphicsItem *> created = other.addModel(model, QPointF(50, 0));
+    QCOMPARE(created.size(), 3);
+    QCOMPARE(other.graph().nodeCount(), 2);
+    QCOMPARE(other.graph().edgeCount(), 1);
+
+    const DiagramModel again = other.toModel();
+    QCOMPARE(again.nodeCount(), 2);
+    QCOMPARE(again.connectorCount(), 1);
+    const int first = again.find(QStringLiteral("开始")).value(0, -1);
+    QVERIFY(first >= 0);
+    QVERIFY(again.node(first).style.bold);
+    QCOMPARE(again.nodePos(first), QPointF(50, 0));
+    QCOMPARE(again.nodeSize(first), model.nodeSize(model.find(QStringLiteral("开始")).value(0)));
+}
+
+void TestDiagramModel::item_without_menu()
+{
+    // 批量生成图元时不必提供右键菜单
+    DiagramScene scene(nullptr);
+    auto *item = new DiagramItem(DiagramItem::Step);
+    scene.addItem(item);
+    QCOMPARE(scene.graph().nodeCount(), 1);
+}
+
+void TestDiagramModel::serialize_20000_nodes()
+{
+    // 不创建任何图元，纯模型的保存与读取
+    DiagramModel model;
+    model.reserve(20000, 19999);
+    for (int i = 0; i < 20000; ++i)
+        model.addNode(makeNode(i % 4, (i % 100) * 150, (i / 100) * 120, QStringLiteral("节点%1").arg(i)));
+    for (int i = 0; i + 1 < 20000; ++i)
+        model.addConnector(DiagramModel::Connector{ i, i + 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+
+    QBENCHMARK {
+        QString buffer;
+        QTextStream out(&buffer);
+        model.writeText(out);
+        out.flush();
+        DiagramModel loaded;
+        QTextStream in(&buffer);
+        QVERIFY(loaded.readText(in));
+        QCOMPARE(loaded.nodeCount(), 20000);
+        QCOMPARE(loaded.connectorCount(), 19999);
+    }
+}
+
+int runDiagramModelTests(int argc, char** argv)
+{
+    TestDiagramModel tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_diagram_model.moc"
@@ -205,15 +205,17 @@ void TestDiagramItemProperties::text_property_chain()
     QMenu menu;
     DiagramItem *item = new DiagramItem(DiagramItem::Step, &menu, nullptr);
 
-    QVERIFY(item->textItem != nullptr);
+    // 文本框只在编辑时存在
+    QVERIFY(item->labelEditor() == nullptr);
+    QCOMPARE(item->labelText(), QStringLiteral("请输入"));
 
     const QString text = QStringLiteral("单元测试");
-    item->textItem->setPlainText(text);
-    QCOMPARE(item->textItem->toPlainText(), text);
+    item->setLabelText(text);
+    QCOMPARE(item->labelText(), text);
 
     const QColor tcolor = Qt::blue;
-    item->textItem->setDefaultTextColor(tcolor);
-    QCOMPARE(item->textItem->defaultTextColor(), tcolor);
+    item->setLabelColor(tcolor);
+    QCOMPARE(item->labelColor(), tcolor);
 
     delete item;
 }
@@ -73,6 +73,8 @@ class TestDiagramPathConnection : public QObject
 private slots:
     void path4combo_data();
     void path4combo();
+    void deleting_path_unregisters_endpoints();
+    void deleting_endpoint_detaches_path();
 };
 
 void TestDiagramPathConnection::path4combo_data()
@@ -195,6 +197,36 @@ void TestDiagramPathConnection::path4combo()
     delete endItem;
 }
 
+void TestDiagramPathConnection::deleting_path_unregisters_endpoints()
+{
+    QMenu menu;
+    DiagramItem startItem(DiagramItem::Step, &menu, nullptr);
+    DiagramItem endItem(DiagramItem::Step, &menu, nullptr);
+    auto *path = new DiagramPath(&startItem, &endItem, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    startItem.addPathes(path);
+    endItem.addPathes(path);
+
+    delete path;
+    QVERIFY(startItem.pathes.isEmpty());
+    QVERIFY(endItem.pathes.isEmpty());
+}
+
+void TestDiagramPathConnection::deleting_endpoint_detaches_path()
+{
+    QMenu menu;
+    auto *startItem = new DiagramItem(DiagramItem::Step, &menu, nullptr);
+    DiagramItem endItem(DiagramItem::Step, &menu, nullptr);
+    auto *path = new DiagramPath(startItem, &endItem, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    startItem->addPathes(path);
+    endItem.addPathes(path);
+
+    // 端点先析构（如 scene->clear() 的顺序），之后删除连线不访问已释放的图元
+    delete startItem;
+    QCOMPARE(path->getStartItem(), nullptr);
+    delete path;
+    QVERIFY(endItem.pathes.isEmpty());
+}
+
 int runDiagramPathConnectionTests(int argc, char** argv)
 {
     TestDiagramPathConnection tc;
@@ -0,0 +1,209 @@
+#include <QtTest/QtTest>
+
+#include "../fcprojtextreader.h"
+#include "../diagrammodel.h"
+#include "../diagramitem.h"
+
+class TestFcprojTextReader : public QObject
+{
+    Q_OBJECT
+private slots:
+    void matches_reference_reader();
+    void reads_legacy_file();
+    void reports_line_and_column();
+    void reports_truncated_file();
+    void rejects_bad_section();
+    void reference_reader_100000_nodes();
+    void streaming_reader_100000_nodes();
+};
+
+static DiagramModel chainModel(int count)
+{
+    DiagramModel model;
+    model.reserve(count, count - 1);
+    for (int i = 0; i < count; ++i) {
+        DiagramModel::Node node;
+        node.type = i % 4;
+        node.pos = QPointF((i % 100) * 150, -(i / 100) * 120);
+        node.size = QSizeF(120, 80);
+        node.fill = qRgba(10, 20, 30, 255);
+        node.text = QStringLiteral("节点 %1").arg(i);
+        node.style.family = QStringLiteral("Microsoft YaHei");
+        node.style.pointSize = 12;
+        node.style.bold = i % 2;
+        node.style.color = qRgba(200, 100, 50, 255);
+        model.addNode(node);
+    }
+    for (int i = 0; i + 1 < count; ++i)
+        model.addConnector(DiagramModel::Connector{ i, i + 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+    return model;
+}
+
+static QByteArray toText(const DiagramModel &model)
+{
+    QString buffer;
+    QTextStream out(&buffer);
+    model.writeText(out);
+    out.flush();
+    return buffer.toUtf8();
+}
+
+// 读取 bytes，失败时返回带行列号的错误
+static bool readBuffer(const QByteArray &bytes, DiagramModel *model, int *line = nullptr, int *column = nullptr,
+                       QString *error = nullptr)
+{
+    FcprojTextReader reader(bytes.constData(), bytes.size());
+    const bool ok = reader.read(model);
+    if (line)
+        *line = reader.errorLine();
+    if (column)
+        *column = reader.errorColumn();
+    if (error)
+        *error = reader.errorString();
+    return ok;
+}
+
+void TestFcprojTextReader::matches_reference_reader()
+{
+    const QByteArray bytes = toText(chainModel(50));
+
+    DiagramModel reference;
+    QTextStream in(bytes);
+    QVERIFY(reference.readText(in));
+
+    DiagramModel model;
+    QVERIFY(readBuffer(bytes, &model));
+    QCOMPARE(model.nodeCount(), reference.nodeCount());
+    QCOMPARE(model.connectorCount(), reference.connectorCount());
+    QCOMPARE(model.styleCount(), reference.styleCount());
+    for (int i = 0; i < model.nodeCount(); ++i) {
+        const DiagramModel::Node a = model.node(i);
+        const DiagramModel::Node b = reference.node(i);
+        QCOMPARE(a.type, b.type);
+        QCOMPARE(a.pos, b.pos);
+        QCOMPARE(a.size, b.size);
+        QCOMPARE(a.fill, b.fill);
+        QCOMPARE(a.text, b.text);
+        QVERIFY(a.style == b.style);
+    }
+    for (int i = 0; i < model.connectorCount(); ++i) {
+        QCOMPARE(model.connector(i).from, reference.connector(i).from);
+        QCOMPARE(model.connector(i).to, reference.connector(i).to);
+        QCOMPARE(model.connector(i).fromPort, reference.connector(i).fromPort);
+        QCOMPARE(model.connector(i).toPort, reference.connector(i).toPort);
+    }
+    QCOMPARE(model.nodeText(7), QStringLiteral("节点 7"));
+}
+
+void TestFcprojTextReader::reads_legacy_file()
+{
+    // 旧版本保存的文件：颜色按 r b g a，布尔写成 1/0，连线编号从 1 开始，行尾带空格和 \r
+    const QByteArray legacy =
+        "DT_Size_2\r\n"
+        "0 0 120 80 0 255 0 0 255 开始 0 SimSun 9 1 0 0 0 0 255 \r\n"
+        "0 200 120 80 0 0 255 0 255 结束 2 SimSun 9 0 true 0 0 0 255 \r\n"
+        "LN_Size_1\r\n"
+        "1 4 2 8\r\n";
+    DiagramModel model;
+    QVERIFY(readBuffer(legacy, &model));
+    QCOMPARE(model.nodeCount(), 2);
+    QCOMPARE(model.nodeType(1), int(DiagramItem::StartEnd));
+    QCOMPARE(model.node(0).fill, qRgba(255, 0, 0, 255));
+    QCOMPARE(model.node(1).fill, qRgba(0, 0, 255, 255));
+    QVERIFY(model.node(0).style.bold);
+    QVERIFY(model.node(1).style.italic);
+    QCOMPARE(model.connector(0).from, 0);
+    QCOMPARE(model.connector(0).to, 1);
+    QVERIFY(model.validate().isEmpty());
+
+    // 没有连线的文件不带 LN 段
+    QVERIFY(readBuffer("DT_Size_1\n0 0 120 80 0 255 0 0 255 a 0 SimSun 9 0 0 0 0 0 255\n", &model));
+    QCOMPARE(model.nodeCount(), 1);
+    QCOMPARE(model.connectorCount(), 0);
+}
+
+void TestFcprojTextReader::reports_line_and_column()
+{
+    // 第 3 行的宽度写错；列号按字符计，不按字节
+    const QByteArray bytes =
+        "DT_Size_2\n"
+        "0 0 120 80 0 255 0 0 255 开始 0 SimSun 9 1 0 0 0 0 255\n"
+        "0 200 12x 80 0 0 255 0 255 结束 2 SimSun 9 0 1 0 0 0 255\n";
+    DiagramModel model;
+    int line = 0, column = 0;
+    QString error;
+    QVERIFY(!readBuffer(bytes, &model, &line, &column, &error));
+    QCOMPARE(line, 3);
+    QCOMPARE(column, 7);
+    QVERIFY(error.contains(QStringLiteral("第 2 个图元")));
+    QVERIFY(error.contains(QStringLiteral("12x")));
+    QCOMPARE(model.nodeCount(), 0);
+
+    const QByteArray afterLabel =
+        "DT_Size_1\n"
+        "0 0 120 80 0 255 0 0 255 开始 x SimSun 9 1 0 0 0 0 255\n";
+    QVERIFY(!readBuffer(afterLabel, &model, &line, &column));
+    QCOMPARE(line, 2);
+    QCOMPARE(column, 29);
+}
+
+void TestFcprojTextReader::reports_truncated_file()
+{
+    const QByteArray bytes = "DT_Size_1\n0 0 120 80 0 255 0 0 255 开始 0 SimSun\n";
+    DiagramModel model;
+    int line = 0, column = 0;
+    QString error;
+    QVERIFY(!readBuffer(bytes, &model, &line, &column, &error));
+    QCOMPARE(line, 3);
+    QCOMPARE(column, 1);
+    QVERIFY(error.contains(QStringLiteral("字号")));
+
+    const QByteArray connectors = toText(chainModel(3)).chopped(4);   // 最后一条连线缺少终点
+    QVERIFY(!readBuffer(connectors, &model, nullptr, nullptr, &error));
+    QVERIFY(error.contains(QStringLiteral("第 2 条连线")));
+}
+
+void TestFcprojTextReader::rejects_bad_section()
+{
+    DiagramModel model;
+    int line = 0, column = 0;
+    QString error;
+    QVERIFY(!readBuffer("LN_Size_1\n", &model, &line, &column, &error));
+    QCOMPARE(line, 1);
+    QCOMPARE(column, 1);
+    QVERIFY(error.contains(QStringLiteral("DT_Size_")));
+
+    QVERIFY(!readBuffer("DT_Size_-3\n", &model));
+    QVERIFY(!readBuffer(QByteArray(), &model, nullptr, nullptr, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestFcprojTextReader::reference_reader_100000_nodes()
+{
+    const QByteArray bytes = toText(chainModel(100000));
+    QBENCHMARK {
+        DiagramModel model;
+        QTextStream in(bytes);
+        QVERIFY(model.readText(in));
+        QCOMPARE(model.nodeCount(), 100000);
+    }
+}
+
+void TestFcprojTextReader::streaming_reader_100000_nodes()
+{
+    const QByteArray bytes = toText(chainModel(100000));
+    QBENCHMARK {
+        DiagramModel model;
+        FcprojTextReader reader(bytes.constData(), bytes.size());
+        QVERIFY(reader.read(&model));
+        QCOMPARE(model.nodeCount(), 100000);
+    }
+}
+
+int runFcprojTextReaderTests(int argc, char** argv)
+{
+    TestFcprojTextReader tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_fcproj_text_reader.moc"
@@ -43,8 +43,7 @@ static void addNDiagramItems(QGraphicsScene* scene, int n)
         auto* item = new DiagramItem(DiagramItem::Step, &dummyMenu);
         item->setPos(50 + (i % 20) * 80, 50 + (i / 20) * 60);
         item->setFixedSize(QSizeF(150, 100));
-        if (item->textItem)
-            item->textItem->setPlainText(QString("node-%1").arg(i));
+        item->setLabelText(QString("node-%1").arg(i));
         scene->addItem(item);
     }
 }
@@ -122,8 +121,8 @@ void TestFileIo::fcproj_save_load_roundtrip_via_dialog()
     closeMessageBoxesAsync();
     autoAcceptFileDialogAsync(fcprojPath, QFileDialog::AcceptSave);
     QVERIFY2(invokeSlot(&w, "savefile"), "invoke savefile failed.");
-    QCoreApplication::processEvents();
-    QVERIFY(QFile::exists(fcprojPath));
+    // 保存在后台写盘，等文件出现；之后的 loadfile 会等同一文件的保存写完
+    QTRY_VERIFY(QFile::exists(fcprojPath));
 
     // 清空后加载（loadfile 会 newScene，current tab 会变）
     scene->clear();
@@ -132,7 +131,6 @@ void TestFileIo::fcproj_save_load_roundtrip_via_dialog()
     closeMessageBoxesAsync();
     autoAcceptFileDialogAsync(fcprojPath, QFileDialog::AcceptOpen);
     QVERIFY2(invokeSlot(&w, "loadfile"), "invoke loadfile failed.");
-    QCoreApplication::processEvents();
 
     // 重新取 current tab（因为 newScene 切走了）
     view = currentTabView(w);
@@ -140,7 +138,8 @@ void TestFileIo::fcproj_save_load_roundtrip_via_dialog()
     scene = view->scene();
     QVERIFY(scene != nullptr);
 
-    QCOMPARE(countDiagramItems(scene), 10);
+    // 加载是异步的：后台解析，界面线程分片创建图元
+    QTRY_COMPARE(countDiagramItems(scene), 10);
 }
 
 void TestFileIo::fcproj_io_performance()
@@ -174,22 +173,23 @@ void TestFileIo::fcproj_io_performance()
     autoAcceptFileDialogAsync(fcprojPath, QFileDialog::AcceptSave);
     timer.start();
     QVERIFY(invokeSlot(&w, "savefile"));
+    QTRY_VERIFY(QFile::exists(fcprojPath));
     const qint64 saveMs = timer.elapsed();
-    QVERIFY(QFile::exists(fcprojPath));
 
     // 加载计时（会 newScene）
     closeMessageBoxesAsync();
     autoAcceptFileDialogAsync(fcprojPath, QFileDialog::AcceptOpen);
     timer.restart();
     QVERIFY(invokeSlot(&w, "loadfile"));
-    const qint64 loadMs = timer.elapsed();
 
     view = currentTabView(w);
     QVERIFY(view != nullptr);
     scene = view->scene();
     QVERIFY(scene != nullptr);
 
-    QCOMPARE(countDiagramItems(scene), N);
+    // 加载是异步的，计时到图元全部出现为止
+    QTRY_COMPARE(countDiagramItems(scene), N);
+    const qint64 loadMs = timer.elapsed();
 
     // 放宽阈值（你 loadfile/savefile 有大量 qDebug）
     QVERIFY2(saveMs < 15000, qPrintable(QString("fcproj save too slow: %1ms").arg(saveMs)));
@@ -0,0 +1,44 @@
+#ifndef TEST_FIXTURES_H
+#define TEST_FIXTURES_H
+
+// 多个测试共用的场景、模型构造
+
+#include "../diagrammodel.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "../diagramscene.h"
+
+#include <QPointF>
+#include <QSizeF>
+#include <QString>
+
+// count 个步骤图元从左到右依次相连，每行 columns 个
+inline DiagramModel chainModel(int count, int columns = 100)
+{
+    DiagramModel model;
+    model.reserve(count, count - 1);
+    for (int i = 0; i < count; ++i) {
+        DiagramModel::Node node;
+        node.type = DiagramItem::Step;
+        node.pos = QPointF((i % columns) * 200, (i / columns) * 150);
+        node.size = QSizeF(100, 60);
+        node.text = QStringLiteral("节点%1").arg(i);
+        model.addNode(node);
+    }
+    for (int i = 0; i + 1 < count; ++i)
+        model.addConnector(DiagramModel::Connector{ i, i + 1, DiagramItem::TF_Right, DiagramItem::TF_Left });
+    return model;
+}
+
+// 从 a 的右侧连到 b 的左侧，加入场景并算好路径
+inline DiagramPath *connectItems(DiagramScene &scene, DiagramItem *a, DiagramItem *b)
+{
+    auto *path = new DiagramPath(a, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    a->addPathes(path);
+    b->addPathes(path);
+    scene.addItem(path);
+    path->updatePath();
+    return path;
+}
+
+#endif // TEST_FIXTURES_H
@@ -0,0 +1,104 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../diagramitem.h"
+
+class TestHandleGeometry : public QObject
+{
+    Q_OBJECT
+private slots:
+    void handles_keep_legacy_layout();
+    void geometry_follows_resize_and_transform();
+    void hit_testing_finds_each_handle();
+    void hover_hit_test_benchmark();
+};
+
+static const DiagramItem::TransformState allHandles[] = {
+    DiagramItem::TF_TopL, DiagramItem::TF_Top, DiagramItem::TF_TopR, DiagramItem::TF_Right,
+    DiagramItem::TF_BottomR, DiagramItem::TF_Bottom, DiagramItem::TF_BottomL, DiagramItem::TF_Left
+};
+static const DiagramItem::TransformState allPorts[] = {
+    DiagramItem::TF_Top, DiagramItem::TF_Right, DiagramItem::TF_Bottom, DiagramItem::TF_Left
+};
+
+void TestHandleGeometry::handles_keep_legacy_layout()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);   // 默认 150x100，边框 5
+
+    QCOMPARE(item.handleRect(DiagramItem::TF_TopL), QRectF(0, 0, 10, 10));
+    QCOMPARE(item.handleRect(DiagramItem::TF_Top), QRectF(70, 0, 10, 10));
+    QCOMPARE(item.handleRect(DiagramItem::TF_BottomR), QRectF(140, 90, 10, 10));
+    QCOMPARE(item.portRect(DiagramItem::TF_Left), QRectF(-15, 45, 10, 10));
+    QCOMPARE(item.portRect(DiagramItem::TF_Bottom), QRectF(70, 105, 10, 10));
+
+    // QMap 形式的旧接口与数组一致
+    const QMap<DiagramItem::TransformState, QRectF> rectMap = item.rectWhere();
+    QCOMPARE(rectMap.size(), 8);
+    for (DiagramItem::TransformState state : allHandles)
+        QCOMPARE(rectMap.value(state), item.handleRect(state));
+    const QMap<DiagramItem::TransformState, QRectF> linkMap = item.linkWhere();
+    QCOMPARE(linkMap.size(), 4);
+    for (DiagramItem::TransformState state : allPorts)
+        QCOMPARE(linkMap.value(state), item.portRect(state));
+
+    // 角上没有连接点
+    QVERIFY(item.portRect(DiagramItem::TF_TopL).isNull());
+    QVERIFY(item.handleRect(DiagramItem::TF_Cen).isNull());
+}
+
+void TestHandleGeometry::geometry_follows_resize_and_transform()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);
+
+    item.setFixedSize(QSizeF(300, 200));
+    QCOMPARE(item.handleRect(DiagramItem::TF_BottomR), QRectF(290, 190, 10, 10));
+    QCOMPARE(item.portRect(DiagramItem::TF_Right), QRectF(305, 95, 10, 10));
+
+    // 控制点边长随变换缩放，保持屏幕上大小不变
+    item.setTransform(QTransform::fromScale(2, 2));
+    QCOMPARE(item.handleRect(DiagramItem::TF_TopL).size(), QSizeF(5, 5));
+    QCOMPARE(item.portRect(DiagramItem::TF_Top).size(), QSizeF(5, 5));
+}
+
+void TestHandleGeometry::hit_testing_finds_each_handle()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);
+
+    for (DiagramItem::TransformState state : allHandles)
+        QCOMPARE(item.handleAt(item.handleRect(state).center()), state);
+    for (DiagramItem::TransformState state : allPorts)
+        QCOMPARE(item.portAt(item.portRect(state).center()), state);
+
+    QCOMPARE(item.handleAt(QPointF(40, 40)), DiagramItem::TF_Cen);
+    QCOMPARE(item.portAt(QPointF(-100, -100)), DiagramItem::TF_Cen);
+}
+
+// 一次悬停的命中测试：8 个控制点 + 4 个连接点
+void TestHandleGeometry::hover_hit_test_benchmark()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);
+    const QPointF probes[] = { QPointF(75, 50), QPointF(145, 95), QPointF(-10, 50), QPointF(200, 200) };
+
+    int hits = 0;
+    QBENCHMARK {
+        for (const QPointF &probe : probes) {
+            if (item.handleAt(probe) != DiagramItem::TF_Cen)
+                ++hits;
+            if (item.portAt(probe) != DiagramItem::TF_Cen)
+                ++hits;
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
+int runHandleGeometryTests(int argc, char** argv)
+{
+    TestHandleGeometry tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_handle_geometry.moc"
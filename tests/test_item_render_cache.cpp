@@ -0,0 +1,195 @@
+#include <QtTest/QtTest>
+#include <QImage>
+#include <QMenu>
+#include <QPainter>
+
+#include "../itemrendercache.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+
+class TestItemRenderCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void repaint_hits_cache();
+    void selection_does_not_invalidate_cache();
+    void resize_and_recolor_invalidate_cache();
+    void label_is_cached_and_invalidated();
+    void zoom_buckets_are_separate();
+    void memory_is_bounded();
+    void cached_repaint_benchmark();
+};
+
+static QImage renderScene(QGraphicsScene &scene, const QRectF &source, qreal scale)
+{
+    QImage image((source.size() * scale).toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+    return image;
+}
+
+static DiagramItem *addItem(DiagramScene &scene, QMenu *menu, const QPointF &pos)
+{
+    auto *item = new DiagramItem(DiagramItem::Conditional, menu);
+    scene.addItem(item);
+    item->setPos(pos);
+    return item;
+}
+
+void TestItemRenderCache::repaint_hits_cache()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    addItem(scene, &menu, QPointF(0, 0));
+    const QRectF source(-50, -50, 300, 250);
+
+    const QImage first = renderScene(scene, source, 1.0);
+    const ItemRenderCache::Stats afterFirst = scene.renderCache().stats();
+    QVERIFY(afterFirst.misses > 0);
+    QCOMPARE(afterFirst.hits, qint64(0));
+
+    const QImage second = renderScene(scene, source, 1.0);
+    const ItemRenderCache::Stats afterSecond = scene.renderCache().stats();
+    QCOMPARE(afterSecond.misses, afterFirst.misses);
+    QCOMPARE(afterSecond.hits, afterFirst.misses);
+    QCOMPARE(first, second);
+}
+
+void TestItemRenderCache::selection_does_not_invalidate_cache()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    DiagramItem *item = addItem(scene, &menu, QPointF(0, 0));
+    const QRectF source(-50, -50, 300, 250);
+
+    const QImage unselected = renderScene(scene, source, 1.0);
+    const qint64 misses = scene.renderCache().stats().misses;
+
+    // 控制点由覆盖层绘制：画面变化，但不需要重新生成位图
+    item->setSelected(true);
+    const QImage selected = renderScene(scene, source, 1.0);
+    QCOMPARE(scene.renderCache().stats().misses, misses);
+    QVERIFY(selected != unselected);
+
+    item->setSelected(false);
+    QCOMPARE(renderScene(scene, source, 1.0), unselected);
+    QCOMPARE(scene.renderCache().stats().misses, misses);
+}
+
+void TestItemRenderCache::resize_and_recolor_invalidate_cache()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    DiagramItem *item = addItem(scene, &menu, QPointF(0, 0));
+    const QRectF source(-50, -50, 400, 300);
+
+    renderScene(scene, source, 1.0);
+    qint64 misses = scene.renderCache().stats().misses;
+
+    item->setFixedSize(QSizeF(220, 140));
+    renderScene(scene, source, 1.0);
+    QVERIFY(scene.renderCache().stats().misses > misses);
+    misses = scene.renderCache().stats().misses;
+
+    // m_color 会被外部直接赋值，绘制时也要能发现
+    item->m_color = Qt::yellow;
+    const QImage image = renderScene(scene, source, 1.0);
+    QVERIFY(scene.renderCache().stats().misses > misses);
+    // 取中心偏下的位置，避开居中的文字
+    const QRectF body = item->polygon().boundingRect();
+    const QPointF probe = item->mapToScene(body.center() + QPointF(0, body.height() / 4)) - source.topLeft();
+    const QColor color(image.pixel(probe.toPoint()));
+    QVERIFY(color.red() > 245 && color.green() > 245 && color.blue() < 10);
+}
+
+void TestItemRenderCache::label_is_cached_and_invalidated()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    DiagramItem *item = addItem(scene, &menu, QPointF(0, 0));
+    const QRectF source(-50, -50, 300, 250);
+
+    const QImage first = renderScene(scene, source, 1.0);
+    qint64 misses = scene.renderCache().stats().misses;
+    // 文字在位图里：命中缓存时画面不变
+    QCOMPARE(renderScene(scene, source, 1.0), first);
+    QCOMPARE(scene.renderCache().stats().misses, misses);
+
+    item->setLabelText(QStringLiteral("改过的文字"));
+    const QImage renamed = renderScene(scene, source, 1.0);
+    QVERIFY(scene.renderCache().stats().misses > misses);
+    QVERIFY(renamed != first);
+    misses = scene.renderCache().stats().misses;
+
+    item->setLabelColor(Qt::red);
+    QVERIFY(renderScene(scene, source, 1.0) != renamed);
+    QVERIFY(scene.renderCache().stats().misses > misses);
+}
+
+void TestItemRenderCache::zoom_buckets_are_separate()
+{
+    QCOMPARE(ItemRenderCache::zoomBucket(1.0), 0);
+    QCOMPARE(ItemRenderCache::zoomBucket(2.0), 4);
+    QCOMPARE(ItemRenderCache::zoomBucket(0.5), -4);
+    // 档位向上取整，位图分辨率不低于实际缩放
+    QVERIFY(ItemRenderCache::bucketScale(ItemRenderCache::zoomBucket(0.7)) >= 0.7);
+    QVERIFY(ItemRenderCache::bucketScale(ItemRenderCache::zoomBucket(1.3)) >= 1.3);
+
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    addItem(scene, &menu, QPointF(0, 0));
+    const QRectF source(-50, -50, 300, 250);
+
+    renderScene(scene, source, 1.0);
+    const qint64 misses = scene.renderCache().stats().misses;
+    renderScene(scene, source, 0.5);
+    QVERIFY(scene.renderCache().stats().misses > misses);
+}
+
+void TestItemRenderCache::memory_is_bounded()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    scene.renderCache().setCapacityKB(512);
+    for (int i = 0; i < 100; ++i)
+        addItem(scene, &menu, QPointF((i % 10) * 220, (i / 10) * 160));
+
+    renderScene(scene, scene.itemsBoundingRect(), 1.0);
+    const ItemRenderCache::Stats stats = scene.renderCache().stats();
+    QCOMPARE(stats.capacityKB, 512);
+    QVERIFY(stats.usedKB <= stats.capacityKB);
+    QVERIFY(stats.entries > 0);
+    QVERIFY(stats.entries < 200);
+}
+
+// 2000 个图元在 100% 缩放下反复整图重绘（命中缓存）
+void TestItemRenderCache::cached_repaint_benchmark()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setCachedRendering(true);
+    scene.renderCache().setCapacityKB(256 * 1024);
+    for (int i = 0; i < 2000; ++i)
+        addItem(scene, &menu, QPointF((i % 50) * 220, (i / 50) * 160));
+    const QRectF source = scene.itemsBoundingRect();
+    renderScene(scene, source, 1.0);
+
+    QBENCHMARK {
+        renderScene(scene, source, 1.0);
+    }
+}
+
+int runItemRenderCacheTests(int argc, char** argv)
+{
+    TestItemRenderCache tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_item_render_cache.moc"
@@ -0,0 +1,173 @@
+#include <QtTest/QtTest>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QMenu>
+#include <QPainter>
+#include <QPointer>
+
+#include "../diagramitem.h"
+#include "../diagramtextitem.h"
+
+class TestLabelLayout : public QObject
+{
+    Q_OBJECT
+private slots:
+    void editor_created_only_while_editing();
+    void editing_writes_back_label();
+    void paint_does_not_move_editor();
+    void label_recentred_on_text_and_size_change();
+    void static_label_is_drawn();
+    void overflowing_label_extends_bounds();
+    void label_repaint_benchmark();
+};
+
+static QImage renderScene(QGraphicsScene &scene, const QRectF &source)
+{
+    QImage image(source.size().toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+    return image;
+}
+
+void TestLabelLayout::editor_created_only_while_editing()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *item = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(item);
+
+    // 平时不创建文本框，也没有子图元
+    QVERIFY(!item->labelEditor());
+    QVERIFY(!item->isEditingLabel());
+    QVERIFY(item->childItems().isEmpty());
+
+    item->beginLabelEdit();
+    QVERIFY(item->isEditingLabel());
+    QPointer<DiagramTextItem> editor = item->labelEditor();
+    QVERIFY(editor);
+    QCOMPARE(editor->toPlainText(), item->labelText());
+    QCOMPARE(editor->textInteractionFlags(), Qt::TextEditorInteraction);
+
+    item->endLabelEdit();
+    QVERIFY(!item->isEditingLabel());
+    QVERIFY(!item->labelEditor());
+    QTRY_VERIFY(editor.isNull());
+}
+
+void TestLabelLayout::editing_writes_back_label()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *item = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(item);
+    item->setLabelColor(Qt::darkGreen);
+
+    item->beginLabelEdit();
+    QCOMPARE(item->labelEditor()->defaultTextColor(), QColor(Qt::darkGreen));
+    item->labelEditor()->setPlainText("编辑后");
+    QCOMPARE(item->labelText(), QString("编辑后"));
+
+    // 编辑期间从外部修改（如替换）也同步到文本框
+    item->setLabelText("替换后");
+    QCOMPARE(item->labelEditor()->toPlainText(), QString("替换后"));
+    item->endLabelEdit();
+    QCOMPARE(item->labelText(), QString("替换后"));
+}
+
+void TestLabelLayout::paint_does_not_move_editor()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *item = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(item);
+    item->beginLabelEdit();
+    DiagramTextItem *editor = item->labelEditor();
+    const QPointF labelPos = editor->pos();
+
+    QSignalSpy spy(editor, &QGraphicsObject::xChanged);
+    renderScene(scene, QRectF(-50, -50, 300, 250));
+    renderScene(scene, QRectF(-50, -50, 300, 250));
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(editor->pos(), labelPos);
+}
+
+void TestLabelLayout::label_recentred_on_text_and_size_change()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);
+    item.beginLabelEdit();
+    DiagramTextItem *editor = item.labelEditor();
+    const QPointF shortPos = editor->pos();
+
+    item.setLabelText("较长的一段文字");
+    QVERIFY(editor->pos().x() < shortPos.x());
+    const QRectF bounds = item.boundingRect();
+    const QRectF label = editor->mapRectToParent(editor->boundingRect());
+    QVERIFY(qAbs(label.center().x() - bounds.center().x()) < 1);
+
+    item.setFixedSize(QSizeF(300, 200));
+    const QRectF resized = editor->mapRectToParent(editor->boundingRect());
+    QVERIFY(qAbs(resized.center().y() - item.boundingRect().center().y()) < 1);
+}
+
+void TestLabelLayout::static_label_is_drawn()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *item = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(item);
+    const QRectF source(-50, -50, 300, 250);
+
+    item->setLabelText(QString());
+    const QImage empty = renderScene(scene, source);
+    item->setLabelText("流程");
+    const QImage labelled = renderScene(scene, source);
+    QVERIFY(labelled != empty);
+
+    // 修改颜色后静态文本随之重建
+    item->setLabelColor(Qt::red);
+    QVERIFY(renderScene(scene, source) != labelled);
+}
+
+void TestLabelLayout::overflowing_label_extends_bounds()
+{
+    QMenu menu;
+    DiagramItem item(DiagramItem::Step, &menu);
+    item.setLabelText("短");
+    const QRectF frame = item.boundingRect();
+
+    // 超出图形的文字由图元绘制，boundingRect 把它包括进来
+    item.setLabelText(QString(80, QLatin1Char('W')));
+    QVERIFY(item.boundingRect().width() > frame.width());
+    QVERIFY(!item.labelEditor());
+
+    item.setLabelText("短");
+    QCOMPARE(item.boundingRect(), frame);
+}
+
+// 500 个带文字的图元整图重绘
+void TestLabelLayout::label_repaint_benchmark()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    for (int i = 0; i < 500; ++i) {
+        auto *item = new DiagramItem(DiagramItem::Step, &menu);
+        item->setLabelText(QString("步骤 %1").arg(i));
+        item->setPos((i % 25) * 220, (i / 25) * 160);
+        scene.addItem(item);
+    }
+    const QRectF source = scene.itemsBoundingRect();
+
+    QBENCHMARK {
+        renderScene(scene, source);
+    }
+}
+
+int runLabelLayoutTests(int argc, char** argv)
+{
+    TestLabelLayout tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_label_layout.moc"
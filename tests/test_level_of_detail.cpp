@@ -0,0 +1,136 @@
+#include <QtTest/QtTest>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QMenu>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "../levelofdetail.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+
+class TestLevelOfDetail : public QObject
+{
+    Q_OBJECT
+private slots:
+    void cleanup();
+    void lod_follows_painter_scale();
+    void thresholds_are_configurable();
+    void path_body_excludes_arrow_head();
+    void full_scene_repaint_data();
+    void full_scene_repaint();
+};
+
+static QGraphicsScene *buildChart(QMenu *menu, int columns, int rows)
+{
+    auto *scene = new QGraphicsScene;
+    DiagramItem *previous = nullptr;
+    for (int i = 0; i < columns * rows; ++i) {
+        auto *item = new DiagramItem(DiagramItem::DiagramType(i % (DiagramItem::Hexagon + 1)), menu);
+        item->setPos((i % columns) * 240, (i / columns) * 180);
+        scene->addItem(item);
+        if (previous && i % columns != 0) {
+            auto *path = new DiagramPath(previous, item, DiagramItem::TF_Right, DiagramItem::TF_Left);
+            previous->addPathes(path);
+            item->addPathes(path);
+            path->updatePath();
+            scene->addItem(path);
+        }
+        previous = item;
+    }
+    return scene;
+}
+
+static void renderScene(QGraphicsScene *scene, qreal scale)
+{
+    const QRectF source = scene->itemsBoundingRect();
+    QImage image((source.size() * scale).toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    scene->render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+}
+
+void TestLevelOfDetail::cleanup()
+{
+    LevelOfDetail::resetThresholds();
+}
+
+void TestLevelOfDetail::lod_follows_painter_scale()
+{
+    QImage image(10, 10, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    QStyleOptionGraphicsItem option;
+
+    painter.setWorldTransform(QTransform::fromScale(0.1, 0.1));
+    QVERIFY(qAbs(LevelOfDetail::of(&option, &painter) - 0.1) < 1e-6);
+    QVERIFY(LevelOfDetail::simplifiedShape(0.1));
+    QVERIFY(LevelOfDetail::hiddenLabel(0.1));
+
+    painter.setWorldTransform(QTransform());
+    QCOMPARE(LevelOfDetail::of(&option, &painter), 1.0);
+    QVERIFY(!LevelOfDetail::simplifiedShape(1.0));
+    QVERIFY(!LevelOfDetail::greekedLabel(1.0));
+    QVERIFY(!LevelOfDetail::hiddenDecorations(1.0));
+
+    QCOMPARE(LevelOfDetail::of(nullptr, &painter), 1.0);
+}
+
+void TestLevelOfDetail::thresholds_are_configurable()
+{
+    QVERIFY(LevelOfDetail::hiddenDecorations(0.3));
+    LevelOfDetail::setDecorationThreshold(0.2);
+    QVERIFY(!LevelOfDetail::hiddenDecorations(0.3));
+
+    QVERIFY(!LevelOfDetail::simplifiedShape(0.5));
+    LevelOfDetail::setShapeThreshold(0.6);
+    QVERIFY(LevelOfDetail::simplifiedShape(0.5));
+}
+
+void TestLevelOfDetail::path_body_excludes_arrow_head()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    a->setPos(0, 0);
+    b->setPos(300, 0);
+    scene.addItem(a);
+    scene.addItem(b);
+    auto *path = new DiagramPath(a, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    path->updatePath();
+    scene.addItem(path);
+
+    // 完整路径（含箭头）仍用于命中测试，主干只少了箭头两笔
+    QVERIFY(!path->bodyPath().isEmpty());
+    QCOMPARE(path->path().elementCount(), path->bodyPath().elementCount() + 3);
+    const QPointF endLink = b->mapToScene(b->linkWhere()[DiagramItem::TF_Left].center());
+    QVERIFY(path->bodyPath().boundingRect().adjusted(-1, -1, 1, 1).contains(endLink));
+}
+
+void TestLevelOfDetail::full_scene_repaint_data()
+{
+    QTest::addColumn<qreal>("zoom");
+    QTest::newRow("10%") << 0.10;
+    QTest::newRow("25%") << 0.25;
+    QTest::newRow("100%") << 1.00;
+}
+
+// 2000 个图元、约 1950 条连线的整图重绘耗时
+void TestLevelOfDetail::full_scene_repaint()
+{
+    QFETCH(qreal, zoom);
+    QMenu menu;
+    QScopedPointer<QGraphicsScene> scene(buildChart(&menu, 50, 40));
+
+    QBENCHMARK {
+        renderScene(scene.data(), zoom);
+    }
+}
+
+int runLevelOfDetailTests(int argc, char** argv)
+{
+    TestLevelOfDetail tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_level_of_detail.moc"
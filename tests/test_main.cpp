@@ -78,6 +78,29 @@ int main(int argc, char** argv)
     extern int runDiagramItemPropertiesTests(int argc, char** argv);
     extern int runConnectionLineStyleTests(int argc, char** argv);
     extern int runArrowStraightConnectionTests(int argc, char** argv);
+    extern int runAlignmentIndexTests(int argc, char** argv);
+    extern int runPortIndexTests(int argc, char** argv);
+    extern int runSceneOverlayTests(int argc, char** argv);
+    extern int runPathCoalescingTests(int argc, char** argv);
+    extern int runShapeCacheTests(int argc, char** argv);
+    extern int runLevelOfDetailTests(int argc, char** argv);
+    extern int runItemRenderCacheTests(int argc, char** argv);
+    extern int runHandleGeometryTests(int argc, char** argv);
+    extern int runLabelLayoutTests(int argc, char** argv);
+    extern int runShapeIconAtlasTests(int argc, char** argv);
+    extern int runStartupTraceTests(int argc, char** argv);
+    extern int runOrthogonalRouterTests(int argc, char** argv);
+    extern int runBatchRoutingTests(int argc, char** argv);
+    extern int runConnectorLayerTests(int argc, char** argv);
+    extern int runDiagramGraphTests(int argc, char** argv);
+    extern int runDiagramModelTests(int argc, char** argv);
+    extern int runVirtualDiagramTests(int argc, char** argv);
+    extern int runProjectFileTests(int argc, char** argv);
+    extern int runFcprojTextReaderTests(int argc, char** argv);
+    extern int runBulkBuildTests(int argc, char** argv);
+    extern int runProjectLoaderTests(int argc, char** argv);
+    extern int runProjectSaveTests(int argc, char** argv);
+    extern int runProjectJournalTests(int argc, char** argv);
 
     // 由于你现在的 runXXXTests 里是 QTest::qExec(&tc, argc, argv)
     // 为了统一静默，我们不再调用 runXXXTests，而是直接 qExecSilent(&tc,...)
@@ -134,5 +157,28 @@ int main(int argc, char** argv)
     status |= runConnectionLineStyleTests(injectedArgc, injectedArgv);
     status |= runArrowStraightConnectionTests(injectedArgc, injectedArgv);
     status |= runShortcutTests(injectedArgc, injectedArgv);
+    status |= runAlignmentIndexTests(injectedArgc, injectedArgv);
+    status |= runPortIndexTests(injectedArgc, injectedArgv);
+    status |= runSceneOverlayTests(injectedArgc, injectedArgv);
+    status |= runPathCoalescingTests(injectedArgc, injectedArgv);
+    status |= runShapeCacheTests(injectedArgc, injectedArgv);
+    status |= runLevelOfDetailTests(injectedArgc, injectedArgv);
+    status |= runItemRenderCacheTests(injectedArgc, injectedArgv);
+    status |= runHandleGeometryTests(injectedArgc, injectedArgv);
+    status |= runLabelLayoutTests(injectedArgc, injectedArgv);
+    status |= runShapeIconAtlasTests(injectedArgc, injectedArgv);
+    status |= runStartupTraceTests(injectedArgc, injectedArgv);
+    status |= runOrthogonalRouterTests(injectedArgc, injectedArgv);
+    status |= runBatchRoutingTests(injectedArgc, injectedArgv);
+    status |= runConnectorLayerTests(injectedArgc, injectedArgv);
+    status |= runDiagramGraphTests(injectedArgc, injectedArgv);
+    status |= runDiagramModelTests(injectedArgc, injectedArgv);
+    status |= runVirtualDiagramTests(injectedArgc, injectedArgv);
+    status |= runProjectFileTests(injectedArgc, injectedArgv);
+    status |= runFcprojTextReaderTests(injectedArgc, injectedArgv);
+    status |= runBulkBuildTests(injectedArgc, injectedArgv);
+    status |= runProjectLoaderTests(injectedArgc, injectedArgv);
+    status |= runProjectSaveTests(injectedArgc, injectedArgv);
+    status |= runProjectJournalTests(injectedArgc, injectedArgv);
     return status;
 }
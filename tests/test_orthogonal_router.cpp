@@ -0,0 +1,253 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+#include <QRandomGenerator>
+
+#include "../orthogonalrouter.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "test_fixtures.h"
+
+class TestOrthogonalRouter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void straight_when_clear();
+    void avoids_obstacles();
+    void leaves_and_enters_along_ports();
+    void enclosed_target_fails();
+    void corridor_index_tracks_paths();
+    void scene_reroutes_only_affected_paths();
+    void deleted_endpoint_drops_path();
+    void route_1000_paths_among_5000_nodes();
+};
+
+static bool crossesInterior(const QPointF &a, const QPointF &b, const QRectF &r)
+{
+    // 正交线段与矩形内部（不含边界）是否相交
+    const QRectF seg = QRectF(a, b).normalized();
+    return seg.right() > r.left() && seg.left() < r.right()
+           && seg.bottom() > r.top() && seg.top() < r.bottom();
+}
+
+static void verifyRoute(const QList<QPointF> &points, const QList<QRectF> &obstacles)
+{
+    QVERIFY(points.size() >= 2);
+    for (int i = 1; i < points.size(); ++i) {
+        const QPointF a = points.at(i - 1);
+        const QPointF b = points.at(i);
+        QVERIFY2(a.x() == b.x() || a.y() == b.y(), "线段不是水平或竖直的");
+        for (const QRectF &r : obstacles)
+            QVERIFY2(!crossesInterior(a, b, r), "线段穿过障碍物");
+    }
+}
+
+void TestOrthogonalRouter::straight_when_clear()
+{
+    OrthogonalRouter router;
+    OrthogonalRouter::Request request;
+    request.start = QPointF(0, 0);
+    request.startDir = OrthogonalRouter::East;
+    request.end = QPointF(300, 0);
+    request.endDir = OrthogonalRouter::West;
+
+    const OrthogonalRouter::Result result = router.route(request, QList<QRectF>());
+    QCOMPARE(result.points, (QList<QPointF>{ QPointF(0, 0), QPointF(300, 0) }));
+    QVERIFY(result.corridor.contains(QRectF(0, 0, 300, 1)));
+}
+
+void TestOrthogonalRouter::avoids_obstacles()
+{
+    OrthogonalRouter router;
+    OrthogonalRouter::Request request;
+    request.start = QPointF(0, 0);
+    request.startDir = OrthogonalRouter::East;
+    request.end = QPointF(400, 0);
+    request.endDir = OrthogonalRouter::West;
+
+    const QList<QRectF> obstacles{ QRectF(150, -60, 100, 120), QRectF(280, 40, 60, 200) };
+    const OrthogonalRouter::Result result = router.route(request, obstacles);
+    verifyRoute(result.points, obstacles);
+    QCOMPARE(result.points.first(), request.start);
+    QCOMPARE(result.points.last(), request.end);
+    // 绕开中间的图元至少要拐两次
+    QVERIFY(result.points.size() >= 4);
+}
+
+void TestOrthogonalRouter::leaves_and_enters_along_ports()
+{
+    OrthogonalRouter router;
+    OrthogonalRouter::Request request;
+    request.start = QPointF(0, 0);
+    request.startDir = OrthogonalRouter::South;
+    request.end = QPointF(300, 200);
+    request.endDir = OrthogonalRouter::North;
+
+    const OrthogonalRouter::Result result = router.route(request, QList<QRectF>());
+    const QList<QPointF> &p = result.points;
+    QVERIFY(p.size() >= 3);
+    // 第一段向下离开起点，最后一段从上方向下进入终点
+    QCOMPARE(p.at(1).x(), p.at(0).x());
+    QVERIFY(p.at(1).y() > p.at(0).y());
+    QCOMPARE(p.at(p.size() - 2).x(), p.last().x());
+    QVERIFY(p.at(p.size() - 2).y() < p.last().y());
+}
+
+void TestOrthogonalRouter::enclosed_target_fails()
+{
+    OrthogonalRouter router;
+    OrthogonalRouter::Request request;
+    request.start = QPointF(0, 0);
+    request.end = QPointF(300, 0);
+
+    // 终点四周被墙围住
+    const QList<QRectF> walls{
+        QRectF(250, -60, 100, 20), QRectF(250, 40, 100, 20),
+        QRectF(250, -60, 20, 120), QRectF(330, -60, 20, 120)
+    };
+    const OrthogonalRouter::Result result = router.route(request, walls);
+    QVERIFY(result.points.isEmpty());
+    QVERIFY(!result.corridor.isEmpty());
+}
+
+void TestOrthogonalRouter::corridor_index_tracks_paths()
+{
+    RouteCorridorIndex<int> index(100);
+    index.update(1, QRectF(0, 0, 300, 100));
+    index.update(2, QRectF(1000, 1000, 50, 50));
+
+    QCOMPARE(index.intersecting(QRectF(250, 50, 10, 10)), QList<int>{ 1 });
+    QVERIFY(index.intersecting(QRectF(500, 500, 10, 10)).isEmpty());
+
+    index.update(1, QRectF(900, 900, 200, 200));
+    QVERIFY(index.intersecting(QRectF(250, 50, 10, 10)).isEmpty());
+    QCOMPARE(index.intersecting(QRectF(1010, 1010, 5, 5)).size(), 2);
+
+    index.remove(2);
+    QCOMPARE(index.size(), 1);
+}
+
+void TestOrthogonalRouter::scene_reroutes_only_affected_paths()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    auto *c = new DiagramItem(DiagramItem::Step, &menu);
+    auto *d = new DiagramItem(DiagramItem::Step, &menu);
+    auto *blocker = new DiagramItem(DiagramItem::Step, &menu);
+    for (DiagramItem *item : { a, b, c, d, blocker })
+        scene.addItem(item);
+    a->setPos(100, 100);
+    b->setPos(700, 100);
+    c->setPos(100, 2000);
+    d->setPos(700, 2000);
+    blocker->setPos(400, 1200);
+
+    DiagramPath *near = connectItems(scene, a, b);
+    DiagramPath *far = connectItems(scene, c, d);
+    QCoreApplication::processEvents();
+    QVERIFY(scene.corridorIndex().contains(near));
+    QVERIFY(scene.corridorIndex().contains(far));
+    scene.resetPathUpdateStats();
+
+    // 把图元拖到上方连线中间：只有这一条连线重算并绕开它
+    blocker->setPos(380, 60);
+    QCoreApplication::processEvents();
+    QCOMPARE(scene.pathUpdateStats().recomputed, 1);
+
+    const QRectF obstacle = blocker->mapRectToScene(blocker->frameRect());
+    const QPainterPath body = near->bodyPath();
+    QList<QPointF> points;
+    for (int i = 0; i < body.elementCount(); ++i)
+        points.append(body.elementAt(i));
+    // 首尾两段是图元内部的控制点到连接点，不参与检查
+    verifyRoute(points.mid(1, points.size() - 2), { obstacle });
+
+    // 拖走后再次只重算这一条
+    scene.resetPathUpdateStats();
+    blocker->setPos(400, 1200);
+    QCoreApplication::processEvents();
+    QCOMPARE(scene.pathUpdateStats().recomputed, 1);
+}
+
+void TestOrthogonalRouter::deleted_endpoint_drops_path()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(700, 100);
+    DiagramPath *path = connectItems(scene, a, b);
+    QCoreApplication::processEvents();
+    QVERIFY(scene.corridorIndex().contains(path));
+
+    // 直接析构端点图元，连线留在场景中：不再重算，也不再占用路由区域
+    scene.resetPathUpdateStats();
+    delete b;
+    QVERIFY(path->detached());
+    QVERIFY(!scene.corridorIndex().contains(path));
+    QCoreApplication::processEvents();
+    QCOMPARE(scene.pathUpdateStats().recomputed, 0);
+    a->setPos(100, 300);
+    QCoreApplication::processEvents();
+    QCOMPARE(scene.pathUpdateStats().recomputed, 0);
+}
+
+// 5000 个图元、1000 条连线全部重算一次的耗时
+void TestOrthogonalRouter::route_1000_paths_among_5000_nodes()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setSceneRect(QRectF(0, 0, 100 * 250, 50 * 200));
+
+    const int columns = 100;
+    const int rows = 50;
+    QList<DiagramItem *> nodes;
+    nodes.reserve(columns * rows);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            auto *item = new DiagramItem(DiagramItem::Step, &menu);
+            scene.addItem(item);
+            item->setPos(c * 250, r * 200);
+            nodes.append(item);
+        }
+    }
+
+    // 每条连线跨过 1~3 列、0~2 行，中间必然隔着别的图元
+    QRandomGenerator rng(20240101);
+    QList<DiagramPath *> paths;
+    for (int i = 0; i < 1000; ++i) {
+        const int c = rng.bounded(columns - 3);
+        const int r = rng.bounded(rows - 2);
+        DiagramItem *from = nodes.at(r * columns + c);
+        DiagramItem *to = nodes.at((r + rng.bounded(3)) * columns + c + 1 + rng.bounded(3));
+        auto *path = new DiagramPath(from, to, DiagramItem::TF_Right, DiagramItem::TF_Left);
+        from->addPathes(path);
+        to->addPathes(path);
+        scene.addItem(path);
+        paths.append(path);
+    }
+
+    scene.setPathRouting(DiagramScene::OrthogonalRouting);
+    QBENCHMARK {
+        for (DiagramPath *path : std::as_const(paths))
+            scene.markPathDirty(path);
+        scene.flushDirtyPaths();
+    }
+    QCOMPARE(scene.corridorIndex().size(), paths.size());
+}
+
+int runOrthogonalRouterTests(int argc, char** argv)
+{
+    TestOrthogonalRouter tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_orthogonal_router.moc"
@@ -0,0 +1,133 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+
+class TestPathCoalescing : public QObject
+{
+    Q_OBJECT
+private slots:
+    void shared_path_recomputed_once_per_flush();
+    void flushed_path_matches_current_geometry();
+    void deleted_dirty_path_is_dropped();
+    void plain_scene_updates_synchronously();
+};
+
+static DiagramPath *connectItems(QGraphicsScene &scene, DiagramItem *a, DiagramItem *b)
+{
+    auto *path = new DiagramPath(a, b, DiagramItem::TF_Right, DiagramItem::TF_Left);
+    a->addPathes(path);
+    b->addPathes(path);
+    path->updatePath();
+    scene.addItem(path);
+    return path;
+}
+
+static bool pathPasses(const QPainterPath &path, const QPointF &p)
+{
+    for (int i = 0; i < path.elementCount(); ++i) {
+        const QPointF e = path.elementAt(i);
+        if (QLineF(e, p).length() < 1.5)
+            return true;
+    }
+    return false;
+}
+
+void TestPathCoalescing::shared_path_recomputed_once_per_flush()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(500, 300);
+    connectItems(scene, a, b);
+    QCoreApplication::processEvents();
+    scene.resetPathUpdateStats();
+
+    // 模拟同一帧内多选拖动：两个端点各移动多次
+    for (int i = 1; i <= 10; ++i) {
+        a->setPos(100 + i, 100 + i);
+        b->setPos(500 + i, 300 + i);
+    }
+    QCOMPARE(scene.pathUpdateStats().marked, 20);
+    QCOMPARE(scene.pathUpdateStats().recomputed, 0);
+    QVERIFY(scene.hasDirtyPaths());
+
+    QCoreApplication::processEvents();
+    QCOMPARE(scene.pathUpdateStats().recomputed, 1);
+    QCOMPARE(scene.pathUpdateStats().flushes, 1);
+    QVERIFY(!scene.hasDirtyPaths());
+}
+
+void TestPathCoalescing::flushed_path_matches_current_geometry()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(500, 300);
+    DiagramPath *path = connectItems(scene, a, b);
+
+    b->setPos(650, 420);
+    b->setFixedSize(QSizeF(200, 120));
+    scene.flushDirtyPaths();
+
+    const QPointF endLink = b->mapToScene(b->linkWhere()[DiagramItem::TF_Left].center());
+    const QPointF startLink = a->mapToScene(a->linkWhere()[DiagramItem::TF_Right].center());
+    QVERIFY(pathPasses(path->path(), startLink));
+    QVERIFY(pathPasses(path->path(), endLink));
+}
+
+void TestPathCoalescing::deleted_dirty_path_is_dropped()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    DiagramPath *path = connectItems(scene, a, b);
+    QCoreApplication::processEvents();
+
+    a->setPos(50, 50);
+    QVERIFY(scene.hasDirtyPaths());
+    a->removePath(path);
+    b->removePath(path);
+    delete path;
+    QVERIFY(!scene.hasDirtyPaths());
+    QCoreApplication::processEvents();
+}
+
+void TestPathCoalescing::plain_scene_updates_synchronously()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(500, 300);
+    DiagramPath *path = connectItems(scene, a, b);
+
+    // 不在 DiagramScene 中时没有刷新时机，移动后立即重算
+    b->setPos(600, 400);
+    const QPointF endLink = b->mapToScene(b->linkWhere()[DiagramItem::TF_Left].center());
+    QVERIFY(pathPasses(path->path(), endLink));
+}
+
+int runPathCoalescingTests(int argc, char** argv)
+{
+    TestPathCoalescing tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_path_coalescing.moc"
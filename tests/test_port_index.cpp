@@ -0,0 +1,113 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../portindex.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+
+class TestPortIndex : public QObject
+{
+    Q_OBJECT
+private slots:
+    void nearest_finds_port_inside_magnet();
+    void nearest_skips_excluded_item();
+    void index_follows_move_and_resize();
+    void removed_items_leave_index();
+};
+
+static QPointF portPos(DiagramItem *item, DiagramItem::TransformState state)
+{
+    return item->mapToScene(item->linkWhere()[state].center());
+}
+
+void TestPortIndex::nearest_finds_port_inside_magnet()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    a->setPos(100, 100);
+
+    const PortIndex &index = scene.portIndex();
+    QCOMPARE(index.portsOf(a).size(), 4);
+
+    // 磁吸区内命中最近的连接点
+    const QPointF right = portPos(a, DiagramItem::TF_Right);
+    const PortIndex::Port hit = index.nearest(right + QPointF(12, -8), 25);
+    QCOMPARE(hit.item, a);
+    QCOMPARE(hit.state, DiagramItem::TF_Right);
+    QCOMPARE(hit.pos, right);
+
+    // 超出磁吸区不命中
+    QVERIFY(index.nearest(right + QPointF(30, 0), 25).item == nullptr);
+}
+
+void TestPortIndex::nearest_skips_excluded_item()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(100, 100);
+    b->setPos(300, 100);
+
+    // a 的右连接点和 b 的左连接点相距较近，排除 a 后应得到 b
+    const QPointF aRight = portPos(a, DiagramItem::TF_Right);
+    const QPointF bLeft = portPos(b, DiagramItem::TF_Left);
+    const QPointF probe = aRight + (bLeft - aRight) * 0.3;
+    QVERIFY(qAbs(bLeft.x() - probe.x()) < 25);
+
+    QCOMPARE(scene.portIndex().nearest(probe, 25).item, a);
+    QCOMPARE(scene.portIndex().nearest(probe, 25, a).item, b);
+}
+
+void TestPortIndex::index_follows_move_and_resize()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    a->setPos(100, 100);
+
+    const PortIndex &index = scene.portIndex();
+    const QPointF oldBottom = portPos(a, DiagramItem::TF_Bottom);
+
+    a->setPos(400, 250);
+    QVERIFY(index.nearest(oldBottom, 5).item == nullptr);
+    QCOMPARE(index.nearest(portPos(a, DiagramItem::TF_Bottom), 5).state, DiagramItem::TF_Bottom);
+
+    a->setFixedSize(QSizeF(260, 180));
+    QCOMPARE(index.nearest(portPos(a, DiagramItem::TF_Right), 5).state, DiagramItem::TF_Right);
+
+    a->setScale(2.0);
+    QCOMPARE(index.nearest(portPos(a, DiagramItem::TF_Bottom), 5).state, DiagramItem::TF_Bottom);
+}
+
+void TestPortIndex::removed_items_leave_index()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    a->setPos(100, 100);
+    const QPointF top = portPos(a, DiagramItem::TF_Top);
+
+    scene.removeItem(a);
+    QCOMPARE(scene.portIndex().size(), 0);
+    QVERIFY(scene.portIndex().nearest(top, 25).item == nullptr);
+
+    scene.addItem(a);
+    QCOMPARE(scene.portIndex().size(), 1);
+    delete a;
+    QCOMPARE(scene.portIndex().size(), 0);
+}
+
+int runPortIndexTests(int argc, char** argv)
+{
+    TestPortIndex tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_port_index.moc"
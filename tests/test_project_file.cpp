@@ -0,0 +1,206 @@
+#include <QtTest/QtTest>
+#include <QtEndian>
+
+#include "../projectfile.h"
+#include "../diagrammodel.h"
+#include "../diagramitem.h"
+
+class TestProjectFile : public QObject
+{
+    Q_OBJECT
+private slots:
+    void binary_roundtrip();
+    void labels_are_not_escaped();
+    void imports_text_file();
+    void rejects_newer_version();
+    void rejects_truncated_file();
+    void skips_unknown_chunks();
+    void save_100000_nodes();
+    void load_100000_nodes();
+};
+
+static DiagramModel::Node makeNode(int type, qreal x, qreal y, const QString &text)
+{
+    DiagramModel::Node node;
+    node.type = type;
+    node.pos = QPointF(x, y);
+    node.size = QSizeF(120, 80);
+    node.fill = qRgba(10, 20, 30, 255);
+    node.text = text;
+    node.style.family = QStringLiteral("Microsoft YaHei");
+    node.style.pointSize = 12;
+    node.style.color = qRgba(200, 100, 50, 255);
+    return node;
+}
+
+static DiagramModel chainModel(int count)
+{
+    DiagramModel model;
+    model.reserve(count, count - 1);
+    for (int i = 0; i < count; ++i)
+        model.addNode(makeNode(i % 4, (i % 100) * 150, (i / 100) * 120, QStringLiteral("节点%1").arg(i)));
+    for (int i = 0; i + 1 < count; ++i)
+        model.addConnector(DiagramModel::Connector{ i, i + 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+    return model;
+}
+
+// 写入临时文件后再按打开工程的方式读回
+static bool saveAndLoad(const DiagramModel &model, DiagramModel *loaded, QString *error)
+{
+    QTemporaryFile file;
+    if (!file.open() || !ProjectFile::write(&file, model, error))
+        return false;
+    file.close();
+    if (!file.open())
+        return false;
+    return ProjectFile::read(file, loaded, error);
+}
+
+void TestProjectFile::binary_roundtrip()
+{
+    DiagramModel model;
+    model.addNode(makeNode(DiagramItem::Step, 10.5, -20.25, QStringLiteral("开始")));
+    DiagramModel::Node second = makeNode(DiagramItem::Conditional, -40, 300, QStringLiteral("判断"));
+    second.style.bold = true;
+    second.style.italic = true;
+    second.size = QSizeF(33.3, 44.4);
+    model.addNode(second);
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Bottom, DiagramItem::TF_Top });
+
+    DiagramModel loaded;
+    QString error;
+    QVERIFY2(saveAndLoad(model, &loaded, &error), qPrintable(error));
+    QCOMPARE(loaded.nodeCount(), 2);
+    QCOMPARE(loaded.connectorCount(), 1);
+    QCOMPARE(loaded.nodeType(1), int(DiagramItem::Conditional));
+    QCOMPARE(loaded.nodePos(0), QPointF(10.5, -20.25));
+    QCOMPARE(loaded.node(1).size, QSizeF(33.3, 44.4));
+    QCOMPARE(loaded.node(0).fill, qRgba(10, 20, 30, 255));
+    QCOMPARE(loaded.node(0).style.family, QStringLiteral("Microsoft YaHei"));
+    QCOMPARE(loaded.node(0).style.color, qRgba(200, 100, 50, 255));
+    QVERIFY(!loaded.node(0).style.bold);
+    QVERIFY(loaded.node(1).style.bold);
+    QVERIFY(loaded.node(1).style.italic);
+    QCOMPARE(loaded.connector(0).from, 0);
+    QCOMPARE(loaded.connector(0).to, 1);
+    QCOMPARE(loaded.connector(0).fromPort, int(DiagramItem::TF_Bottom));
+    QCOMPARE(loaded.connector(0).toPort, int(DiagramItem::TF_Top));
+    QVERIFY(loaded.validate().isEmpty());
+}
+
+void TestProjectFile::labels_are_not_escaped()
+{
+    // 文本格式用 * 代替空格，带星号的文字读回会被改掉
+    const QStringList labels = { QStringLiteral("a*b"), QStringLiteral("两个 空格  "),
+                                 QStringLiteral("第一行\n第二行"), QString(), QStringLiteral("*") };
+    DiagramModel model;
+    for (const QString &label : labels)
+        model.addNode(makeNode(DiagramItem::Step, 0, 0, label));
+
+    const QByteArray bytes = ProjectFile::encode(model);
+    DiagramModel loaded;
+    QString error;
+    QVERIFY2(ProjectFile::decode(bytes.constData(), bytes.size(), &loaded, &error), qPrintable(error));
+    QCOMPARE(loaded.nodeCount(), labels.size());
+    for (int i = 0; i < labels.size(); ++i)
+        QCOMPARE(loaded.nodeText(i), labels.at(i));
+}
+
+void TestProjectFile::imports_text_file()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write("DT_Size_2\n"
+               "0 0 120 80 0 255 0 0 255 开始 0 SimSun 9 1 0 0 0 0 255 \n"
+               "0 200 120 80 0 0 255 0 255 结束 2 SimSun 9 0 1 0 0 0 255 \n"
+               "LN_Size_1\n"
+               "1 4 2 8\n");
+    file.close();
+    QVERIFY(file.open());
+
+    DiagramModel model;
+    QString error;
+    QVERIFY2(ProjectFile::read(file, &model, &error), qPrintable(error));
+    QCOMPARE(model.nodeCount(), 2);
+    QCOMPARE(model.nodeText(0), QStringLiteral("开始"));
+    QCOMPARE(model.nodeType(1), int(DiagramItem::StartEnd));
+    QCOMPARE(model.connectorCount(), 1);
+}
+
+void TestProjectFile::rejects_newer_version()
+{
+    QByteArray bytes = ProjectFile::encode(chainModel(3));
+    qToLittleEndian(quint16(ProjectFile::Version + 1), bytes.data() + 4);
+
+    DiagramModel model;
+    QString error;
+    QVERIFY(!ProjectFile::decode(bytes.constData(), bytes.size(), &model, &error));
+    QVERIFY(error.contains(QString::number(ProjectFile::Version + 1)));
+    QCOMPARE(model.nodeCount(), 0);
+}
+
+void TestProjectFile::rejects_truncated_file()
+{
+    const QByteArray bytes = ProjectFile::encode(chainModel(10));
+    // 任何位置截断都要报错，不能越界读取
+    for (qint64 size = 0; size < bytes.size(); size += 7) {
+        DiagramModel model;
+        QString error;
+        QVERIFY2(!ProjectFile::decode(bytes.constData(), size, &model, &error), qPrintable(QString::number(size)));
+        QVERIFY(!error.isEmpty());
+    }
+}
+
+void TestProjectFile::skips_unknown_chunks()
+{
+    const QByteArray bytes = ProjectFile::encode(chainModel(5));
+    // 在文件头之后插入一个 5 字节的未知块（补齐到 8 字节）
+    QByteArray patched = bytes.left(16);
+    qToLittleEndian(qFromLittleEndian<quint32>(patched.constData() + 8) + 1, patched.data() + 8);
+    patched += QByteArray("XTRA", 4);
+    QByteArray size(4, '\0');
+    qToLittleEndian(quint32(5), size.data());
+    patched += size;
+    patched += QByteArray("hello\0\0\0", 8);
+    patched += bytes.mid(16);
+
+    DiagramModel model;
+    QString error;
+    QVERIFY2(ProjectFile::decode(patched.constData(), patched.size(), &model, &error), qPrintable(error));
+    QCOMPARE(model.nodeCount(), 5);
+    QCOMPARE(model.connectorCount(), 4);
+    QCOMPARE(model.nodeText(4), QStringLiteral("节点4"));
+}
+
+void TestProjectFile::save_100000_nodes()
+{
+    const DiagramModel model = chainModel(100000);
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(ProjectFile::write(&buffer, model));
+    }
+}
+
+void TestProjectFile::load_100000_nodes()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QVERIFY(ProjectFile::write(&file, chainModel(100000)));
+    file.close();
+    QVERIFY(file.open());
+    QBENCHMARK {
+        DiagramModel loaded;
+        QVERIFY(ProjectFile::read(file, &loaded));
+        QCOMPARE(loaded.nodeCount(), 100000);
+        QCOMPARE(loaded.connectorCount(), 99999);
+    }
+}
+
+int runProjectFileTests(int argc, char** argv)
+{
+    TestProjectFile tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_project_file.moc"
@@ -0,0 +1,404 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include <limits>
+
+#include "../projectjournal.h"
+#include "../projectloader.h"
+#include "../projectfile.h"
+#include "../diagrammodel.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+#include "test_fixtures.h"
+
+class TestProjectJournal : public QObject
+{
+    Q_OBJECT
+private slots:
+    void save_appends_only_changes();
+    void replays_edits();
+    void loaded_project_keeps_journaling();
+    void drops_torn_tail();
+    void ignores_stale_journal();
+    void compaction_folds_journal();
+    void failed_base_write_is_reported();
+    void undo_rebuild_keeps_keys();
+    void incremental_save_10000_nodes();
+    void full_save_10000_nodes();
+};
+
+static QList<DiagramItem *> nodesOf(const QList<QGraphicsItem *> &items)
+{
+    QList<DiagramItem *> nodes;
+    for (QGraphicsItem *item : items) {
+        if (DiagramItem *node = qgraphicsitem_cast<DiagramItem *>(item))
+            nodes.append(node);
+    }
+    return nodes;
+}
+
+// 文字唯一，按文字找模型下标
+static int indexOf(const DiagramModel &model, const QString &text)
+{
+    const QList<int> found = model.find(text);
+    for (int index : found) {
+        if (model.nodeText(index) == text)
+            return index;
+    }
+    return -1;
+}
+
+static bool openJournal(const QString &path, DiagramModel *model, QString *error = nullptr)
+{
+    ProjectJournal journal(path);
+    return journal.open(model, error);
+}
+
+// 等后台写盘结束，返回是否成功
+static bool saved(QFuture<QString> future)
+{
+    if (!future.isValid())
+        return false;
+    future.waitForFinished();
+    return future.resultCount() > 0 && future.result().isEmpty();
+}
+
+static qint64 fileSize(const QString &path)
+{
+    return QFileInfo(path).size();
+}
+
+// 按文字比较两个模型的图元，以及以文字表示的连线
+static bool sameContent(const DiagramModel &a, const DiagramModel &b)
+{
+    if (a.nodeCount() != b.nodeCount() || a.connectorCount() != b.connectorCount())
+        return false;
+    for (int i = 0; i < a.nodeCount(); ++i) {
+        const int j = indexOf(b, a.nodeText(i));
+        if (j < 0 || a.nodePos(i) != b.nodePos(j) || a.nodeSize(i) != b.nodeSize(j)
+            || a.node(i).fill != b.node(j).fill || !(a.node(i).style == b.node(j).style))
+            return false;
+    }
+    QSet<QString> edges;
+    for (int i = 0; i < a.connectorCount(); ++i)
+        edges.insert(a.nodeText(a.connector(i).from) + QLatin1Char('>') + a.nodeText(a.connector(i).to));
+    for (int i = 0; i < b.connectorCount(); ++i) {
+        if (!edges.contains(b.nodeText(b.connector(i).from) + QLatin1Char('>') + b.nodeText(b.connector(i).to)))
+            return false;
+    }
+    return true;
+}
+
+void TestProjectJournal::save_appends_only_changes()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(2000)));
+    scene.setJournal(new ProjectJournal(path));
+    // 第一次保存写基准
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->waitForWrites());
+    const qint64 baseSize = fileSize(path);
+    const qint64 empty = fileSize(ProjectJournal::journalPath(path));
+    QVERIFY(baseSize > 0);
+
+    nodes.at(7)->setPos(nodes.at(7)->pos() + QPointF(30, 40));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(!scene.journal()->compaction().isValid());
+    // 只追加一条记录，基准不动
+    const qint64 grown = fileSize(ProjectJournal::journalPath(path)) - empty;
+    QVERIFY2(grown > 0 && grown < 200, qPrintable(QString::number(grown)));
+    QCOMPARE(fileSize(path), baseSize);
+
+    // 没有改动时不写
+    QVERIFY(saved(scene.saveJournal()));
+    QCOMPARE(fileSize(ProjectJournal::journalPath(path)) - empty, grown);
+
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QVERIFY(sameContent(model, scene.toModel()));
+}
+
+void TestProjectJournal::replays_edits()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(5)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+
+    // 新加图元和连线、缩放、改颜色和文字、删除带连线的图元
+    DiagramModel::Node node;
+    node.type = DiagramItem::Conditional;
+    node.pos = QPointF(-300, -300);
+    node.size = QSizeF(140, 90);
+    node.text = QStringLiteral("新图元");
+    DiagramItem *added = scene.addModelNode(node);
+    QVERIFY(added);
+    scene.addConnector(nodes.at(0), added, DiagramItem::TF_Bottom, DiagramItem::TF_Top);
+    nodes.at(1)->setFixedSize(QSizeF(180, 120));
+    QColor red(Qt::red);
+    nodes.at(2)->setBrush(red);
+    nodes.at(3)->setLabelText(QStringLiteral("改过的文字"));
+    nodes.at(4)->removePathes();
+    scene.removeItem(nodes.at(4));
+    delete nodes.at(4);
+    QVERIFY(saved(scene.saveJournal()));
+
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QCOMPARE(model.nodeCount(), 5);
+    QCOMPARE(model.connectorCount(), 4);
+    QVERIFY(sameContent(model, scene.toModel()));
+    QCOMPARE(model.nodeType(indexOf(model, QStringLiteral("新图元"))), int(DiagramItem::Conditional));
+    QCOMPARE(model.node(indexOf(model, QStringLiteral("节点2"))).fill, QColor(Qt::red).rgba());
+    QVERIFY(indexOf(model, QStringLiteral("改过的文字")) >= 0);
+    QCOMPARE(indexOf(model, QStringLiteral("节点4")), -1);
+}
+
+void TestProjectJournal::loaded_project_keeps_journaling()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    {
+        DiagramScene scene(nullptr);
+        const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(50)));
+        scene.setJournal(new ProjectJournal(path));
+        QVERIFY(saved(scene.saveJournal()));
+        nodes.at(10)->removePathes();
+        scene.removeItem(nodes.at(10));
+        delete nodes.at(10);
+        QVERIFY(saved(scene.saveJournal()));
+    }
+
+    // 打开时回放日志，图元带上日志中的键，之后的改动接着追加
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    loader->start(path);
+    QTRY_COMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Loaded);
+    QVERIFY(scene.journal());
+    QCOMPARE(scene.graph().nodeCount(), 49);
+    QCOMPARE(scene.graph().edgeCount(), 47);
+
+    const QList<DiagramItem *> nodes = nodesOf(scene.items());
+    DiagramItem *moved = nodes.first();
+    moved->setPos(moved->pos() + QPointF(0, 1000));
+    DiagramItem *removed = nodes.last();
+    removed->removePathes();
+    scene.removeItem(removed);
+    delete removed;
+    const qint64 before = fileSize(ProjectJournal::journalPath(path));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(fileSize(ProjectJournal::journalPath(path)) - before < 400);
+
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QCOMPARE(model.nodeCount(), 48);
+    QVERIFY(sameContent(model, scene.toModel()));
+}
+
+void TestProjectJournal::drops_torn_tail()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(20)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+    nodes.at(0)->setPos(500, 500);
+    QVERIFY(saved(scene.saveJournal()));
+    const DiagramModel saved = scene.toModel();
+
+    // 模拟追加时崩溃：最后一条记录只写了一半
+    QFile journal(ProjectJournal::journalPath(path));
+    QVERIFY(journal.open(QIODevice::Append));
+    journal.write(QByteArray("\x00\x00\x01\x00\x12\x34partial", 13));
+    journal.close();
+    const qint64 torn = fileSize(journal.fileName());
+
+    ProjectJournal reopened(path);
+    DiagramModel model;
+    QVERIFY(reopened.open(&model));
+    QVERIFY(sameContent(model, saved));
+    QCOMPARE(reopened.journalSize(), torn - 13);
+
+    // 接着保存时先截掉残缺部分
+    const int index = indexOf(model, QStringLiteral("节点1"));
+    reopened.setNode(reopened.nodeKeys().at(index), model.node(index));
+    QVERIFY(saved(reopened.save()));
+    QVERIFY(openJournal(path, &model));
+    QVERIFY(sameContent(model, saved));
+}
+
+void TestProjectJournal::ignores_stale_journal()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(10)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+    nodes.at(3)->setPos(900, 900);
+    QVERIFY(saved(scene.saveJournal()));
+
+    // 工程文件被整体重写后，旧日志不再回放
+    QVERIFY(ProjectFile::save(path, chainModel(4)));
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QVERIFY(sameContent(model, chainModel(4)));
+}
+
+void TestProjectJournal::compaction_folds_journal()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(100)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->waitForWrites());
+    const qint64 empty = fileSize(ProjectJournal::journalPath(path));
+    scene.journal()->setCompactionThreshold(300);
+
+    for (int i = 0; i < 10; ++i)
+        nodes.at(i)->setPos(nodes.at(i)->pos() + QPointF(5, 5));
+    QVERIFY(saved(scene.saveJournal()));
+    // 超过阈值，后台写新的基准
+    QFuture<QString> compaction = scene.journal()->compaction();
+    QVERIFY(compaction.isValid());
+    compaction.waitForFinished();
+    QCOMPARE(compaction.result(), QString());
+    QCOMPARE(fileSize(ProjectJournal::journalPath(path)), empty);
+
+    DiagramModel base;
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(ProjectFile::read(file, &base));
+    file.close();
+    QVERIFY(sameContent(base, scene.toModel()));
+
+    // 压缩期间的改动按新的键记录，之后照常追加
+    nodes.at(50)->setPos(-800, -800);
+    nodes.at(51)->removePathes();
+    scene.removeItem(nodes.at(51));
+    delete nodes.at(51);
+    QVERIFY(saved(scene.saveJournal()));
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QCOMPARE(model.nodeCount(), 99);
+    QVERIFY(sameContent(model, scene.toModel()));
+}
+
+void TestProjectJournal::failed_base_write_is_reported()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("missing/a.fcproj"));
+    DiagramScene scene(nullptr);
+    scene.addModel(chainModel(10));
+    scene.setJournal(new ProjectJournal(path));
+
+    // 基准写不进去：保存的结果是错误，不是成功
+    QFuture<QString> future = scene.saveJournal();
+    QVERIFY(future.isValid());
+    future.waitForFinished();
+    QVERIFY(!future.result().isEmpty());
+    QVERIFY(!scene.journal()->hasBase());
+
+    // 目录有了以后，下一次保存重新写基准
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("missing")));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->hasBase());
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QVERIFY(sameContent(model, scene.toModel()));
+}
+
+void TestProjectJournal::undo_rebuild_keeps_keys()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(2000)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->waitForWrites());
+    DiagramScene::JournalKeys keys;
+    const DiagramModel snapshot = scene.toModel(&keys);
+
+    // 一处已保存的移动，一处还没保存的删除
+    nodes.at(7)->setPos(nodes.at(7)->pos() + QPointF(30, 40));
+    QVERIFY(saved(scene.saveJournal()));
+    nodes.at(10)->removePathes();
+    scene.removeItem(nodes.at(10));
+    delete nodes.at(10);
+
+    // 撤销重建后只追加有差别的图元，不是全删全加
+    const qint64 before = fileSize(ProjectJournal::journalPath(path));
+    scene.restoreModel(snapshot, keys);
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(!scene.journal()->compaction().isValid());
+    const qint64 grown = fileSize(ProjectJournal::journalPath(path)) - before;
+    QVERIFY2(grown > 0 && grown < 600, qPrintable(QString::number(grown)));
+    DiagramModel model;
+    QVERIFY(openJournal(path, &model));
+    QCOMPARE(model.nodeCount(), 2000);
+    QCOMPARE(model.connectorCount(), 1999);
+    QVERIFY(sameContent(model, scene.toModel()));
+
+    // 压缩重新编号后快照中的键失效，重建后整体写基准
+    QVERIFY(saved(scene.compactJournal()));
+    QVERIFY(scene.journal()->waitForWrites());
+    scene.restoreModel(snapshot, keys);
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->compaction().isValid());
+    DiagramModel rebuilt;
+    QVERIFY(openJournal(path, &rebuilt));
+    QVERIFY(sameContent(rebuilt, snapshot));
+}
+
+void TestProjectJournal::incremental_save_10000_nodes()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("big.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(10000)));
+    scene.setJournal(new ProjectJournal(path));
+    QVERIFY(saved(scene.saveJournal()));
+    QVERIFY(scene.journal()->waitForWrites());
+    scene.journal()->setCompactionThreshold(std::numeric_limits<qint64>::max());
+    int step = 0;
+    QBENCHMARK {
+        // 每次保存改一个文字
+        nodes.at(step % nodes.size())->setLabelText(QStringLiteral("改%1").arg(step));
+        ++step;
+        QVERIFY(saved(scene.saveJournal()));
+    }
+}
+
+void TestProjectJournal::full_save_10000_nodes()
+{
+    // 对照：每次保存整体取快照并重写
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("big.fcproj"));
+    DiagramScene scene(nullptr);
+    const QList<DiagramItem *> nodes = nodesOf(scene.addModel(chainModel(10000)));
+    int step = 0;
+    QBENCHMARK {
+        nodes.at(step % nodes.size())->setLabelText(QStringLiteral("改%1").arg(step));
+        ++step;
+        QVERIFY(ProjectFile::save(path, scene.toModel()));
+    }
+}
+
+int runProjectJournalTests(int argc, char** argv)
+{
+    TestProjectJournal tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_project_journal.moc"
@@ -0,0 +1,207 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QGraphicsView>
+#include <QPointer>
+
+#include "../projectloader.h"
+#include "../projectfile.h"
+#include "../diagrammodel.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../virtualdiagram.h"
+#include "test_fixtures.h"
+
+class TestProjectLoader : public QObject
+{
+    Q_OBJECT
+private slots:
+    void loads_in_slices();
+    void partial_content_is_visible();
+    void cancel_keeps_partial_content();
+    void cancel_while_parsing();
+    void deleting_scene_mid_load();
+    void reports_failure();
+    void large_file_goes_virtual();
+};
+
+static QString writeProject(const QTemporaryDir &dir, int count)
+{
+    const QString path = dir.filePath(QStringLiteral("chain%1.fcproj").arg(count));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !ProjectFile::write(&file, chainModel(count, 50)))
+        return QString();
+    return path;
+}
+
+void TestProjectLoader::loads_in_slices()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 3000);
+    QVERIFY(!path.isEmpty());
+
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    loader->setSliceDuration(2);
+    QSignalSpy progress(loader, &ProjectLoader::progress);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    loader->start(path);
+    QVERIFY(loader->isRunning());
+    QTRY_COMPARE_WITH_TIMEOUT(finished.size(), 1, 30000);
+
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Loaded);
+    QVERIFY(!loader->isRunning());
+    // 解析阶段一次，构建阶段每片一次
+    QVERIFY2(progress.size() > 2, qPrintable(QString::number(progress.size())));
+    QCOMPARE(progress.last().at(0).toInt(), 3000 + 2999);
+    QCOMPARE(progress.last().at(1).toInt(), 3000 + 2999);
+    QCOMPARE(scene.graph().nodeCount(), 3000);
+    QCOMPARE(scene.graph().edgeCount(), 2999);
+    QVERIFY(!scene.hasDirtyPaths());
+    QVERIFY(!scene.bulkBuilding());
+}
+
+void TestProjectLoader::partial_content_is_visible()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 3000);
+    DiagramScene scene(nullptr);
+    QGraphicsView view(&scene);
+    auto *loader = new ProjectLoader(&scene);
+    loader->setSliceDuration(1);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+
+    int partialSeen = 0;
+    connect(loader, &ProjectLoader::progress, this, [&](int done, int total) {
+        if (total > 0 && done < total && scene.graph().nodeCount() > 0) {
+            ++partialSeen;
+            // 整个加载处于一次批量构建中，但每片结束时已交付：连线已路由，视图可以绘制
+            QVERIFY(scene.bulkBuilding());
+            QVERIFY(!scene.hasDirtyPaths());
+            QVERIFY(view.updatesEnabled());
+            QVERIFY(!view.isInteractive());
+        }
+    });
+    loader->start(path);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.size(), 1, 30000);
+    QVERIFY(partialSeen > 0);
+    QVERIFY(view.isInteractive());
+}
+
+void TestProjectLoader::cancel_keeps_partial_content()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 3000);
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    loader->setSliceDuration(1);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    connect(loader, &ProjectLoader::progress, loader, [loader](int done, int total) {
+        if (total > 0 && done > 0)
+            loader->cancel();
+    });
+    loader->start(path);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.size(), 1, 30000);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Canceled);
+
+    const int built = scene.graph().nodeCount();
+    QVERIFY(built > 0);
+    QVERIFY(built < 3000);
+    QTest::qWait(50);
+    QCOMPARE(scene.graph().nodeCount(), built);
+    QCOMPARE(finished.size(), 1);
+}
+
+void TestProjectLoader::cancel_while_parsing()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 100);
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    loader->start(path);
+    loader->cancel();
+    QCOMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Canceled);
+    // 解析结果到达后被丢弃
+    QTest::qWait(200);
+    QCOMPARE(finished.size(), 1);
+    QCOMPARE(scene.graph().nodeCount(), 0);
+}
+
+void TestProjectLoader::deleting_scene_mid_load()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 3000);
+    auto *scene = new DiagramScene(nullptr);
+    auto *view = new QGraphicsView(scene);
+    QPointer<ProjectLoader> loader = new ProjectLoader(scene);
+    loader->setSliceDuration(1);
+    QSignalSpy finished(loader.data(), &ProjectLoader::finished);
+    bool deleted = false;
+    connect(loader, &ProjectLoader::progress, this, [&](int done, int total) {
+        if (!deleted && total > 0 && done > 0) {
+            deleted = true;
+            scene->deleteLater();   // 关闭标签页
+        }
+    });
+    loader->start(path);
+    QTRY_VERIFY_WITH_TIMEOUT(loader.isNull(), 30000);
+    QTest::qWait(50);
+    QCOMPARE(finished.size(), 0);
+    delete view;
+
+    // 解析中删除场景
+    scene = new DiagramScene(nullptr);
+    loader = new ProjectLoader(scene);
+    loader->start(path);
+    delete scene;
+    QVERIFY(loader.isNull());
+    QTest::qWait(200);
+}
+
+void TestProjectLoader::reports_failure()
+{
+    QTemporaryDir dir;
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    loader->start(dir.filePath(QStringLiteral("missing.fcproj")));
+    QTRY_COMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Failed);
+    QVERIFY(!finished.first().at(1).toString().isEmpty());
+
+    const QString broken = dir.filePath(QStringLiteral("broken.fcproj"));
+    QFile file(broken);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("DT_Size_2\n0 0 1x0\n");
+    file.close();
+    finished.clear();
+    loader->start(broken);
+    QTRY_COMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Failed);
+    QVERIFY(finished.first().at(1).toString().contains(QStringLiteral("第 2 行")));
+    QCOMPARE(scene.graph().nodeCount(), 0);
+}
+
+void TestProjectLoader::large_file_goes_virtual()
+{
+    QTemporaryDir dir;
+    const QString path = writeProject(dir, 500);
+    DiagramScene scene(nullptr);
+    auto *loader = new ProjectLoader(&scene);
+    loader->setVirtualThreshold(200);
+    QSignalSpy finished(loader, &ProjectLoader::finished);
+    loader->start(path);
+    QTRY_COMPARE(finished.size(), 1);
+    QCOMPARE(finished.first().at(0).value<ProjectLoader::Status>(), ProjectLoader::Loaded);
+    QVERIFY(scene.virtualDiagram());
+    QCOMPARE(scene.toModel().nodeCount(), 500);
+}
+
+int runProjectLoaderTests(int argc, char** argv)
+{
+    TestProjectLoader tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_project_loader.moc"
@@ -0,0 +1,121 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include "../projectfile.h"
+#include "../diagrammodel.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "test_fixtures.h"
+
+class TestProjectSave : public QObject
+{
+    Q_OBJECT
+private slots:
+    void replaces_existing_file();
+    void failed_save_keeps_original();
+    void async_save_roundtrip();
+    void snapshot_ignores_later_edits();
+    void save_100000_nodes();
+};
+
+static bool readProject(const QString &path, DiagramModel *model)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) && ProjectFile::read(file, model);
+}
+
+void TestProjectSave::replaces_existing_file()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    QVERIFY(ProjectFile::save(path, chainModel(10)));
+    QVERIFY(ProjectFile::save(path, chainModel(3)));
+
+    DiagramModel model;
+    QVERIFY(readProject(path, &model));
+    QCOMPARE(model.nodeCount(), 3);
+    QCOMPARE(model.connectorCount(), 2);
+    // 临时文件已改名，目录里只剩目标文件
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files), QStringList{ QStringLiteral("a.fcproj") });
+}
+
+void TestProjectSave::failed_save_keeps_original()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    QVERIFY(ProjectFile::save(path, chainModel(5)));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray before = file.readAll();
+    file.close();
+
+    // 目录不存在，打开临时文件就失败
+    QString error;
+    QVERIFY(!ProjectFile::save(dir.filePath(QStringLiteral("missing/a.fcproj")), chainModel(5), &error));
+    QVERIFY(!error.isEmpty());
+
+    // 目标是目录，改名替换失败，临时文件被丢弃
+    QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("sub.fcproj")));
+    error.clear();
+    QVERIFY(!ProjectFile::save(dir.filePath(QStringLiteral("sub.fcproj")), chainModel(5), &error));
+    QVERIFY(!error.isEmpty());
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), before);
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files).size(), 1);
+}
+
+void TestProjectSave::async_save_roundtrip()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    QFuture<QString> future = ProjectFile::saveAsync(path, chainModel(200));
+    future.waitForFinished();
+    QCOMPARE(future.result(), QString());
+
+    DiagramModel model;
+    QVERIFY(readProject(path, &model));
+    QCOMPARE(model.nodeCount(), 200);
+    QCOMPARE(model.nodeText(150), QStringLiteral("节点150"));
+
+    future = ProjectFile::saveAsync(dir.filePath(QStringLiteral("missing/a.fcproj")), model);
+    future.waitForFinished();
+    QVERIFY(!future.result().isEmpty());
+}
+
+void TestProjectSave::snapshot_ignores_later_edits()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("a.fcproj"));
+    DiagramScene scene(nullptr);
+    scene.addModel(chainModel(50));
+
+    QFuture<QString> future = ProjectFile::saveAsync(path, scene.toModel());
+    // 后台写盘期间继续编辑场景
+    scene.addModel(chainModel(20));
+    future.waitForFinished();
+    QCOMPARE(future.result(), QString());
+
+    DiagramModel model;
+    QVERIFY(readProject(path, &model));
+    QCOMPARE(model.nodeCount(), 50);
+    QCOMPARE(model.connectorCount(), 49);
+}
+
+void TestProjectSave::save_100000_nodes()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("big.fcproj"));
+    const DiagramModel model = chainModel(100000);
+    QBENCHMARK {
+        QVERIFY(ProjectFile::save(path, model));
+    }
+}
+
+int runProjectSaveTests(int argc, char** argv)
+{
+    TestProjectSave tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_project_save.moc"
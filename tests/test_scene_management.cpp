@@ -91,6 +91,7 @@ private slots:
     void mode_insertLine_createsArrow_between_two_items();
     void mode_insertPath_createsDiagramPath_between_two_items();
     void mode_moveItem_drag_shouldMoveItem();
+    void mode_moveItem_shiftDrag_selectsItemsInBox();
     void keyboard_shortcut_rotate_selected_item();
 };
 
@@ -237,6 +238,56 @@ void TestSceneManagement::mode_moveItem_drag_shouldMoveItem()
                             .arg(pressScene.x()).arg(pressScene.y())));
 }
 
+void TestSceneManagement::mode_moveItem_shiftDrag_selectsItemsInBox()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    scene.setSceneRect(0, 0, 800, 600);
+
+    auto* a = new DiagramItem(DiagramItem::Step, &menu);
+    auto* b = new DiagramItem(DiagramItem::Step, &menu);
+    auto* outside = new DiagramItem(DiagramItem::Step, &menu);
+    a->setPos(150, 150);
+    b->setPos(350, 200);
+    outside->setPos(650, 480);
+    scene.addItem(a);
+    scene.addItem(b);
+    scene.addItem(outside);
+
+    QGraphicsView view(&scene);
+    view.resize(800, 600);
+    ensureActive(view);
+
+    scene.setMode(DiagramScene::MoveItem);
+    QSignalSpy spy(&scene, &QGraphicsScene::selectionChanged);
+
+    const QPoint start = view.mapFromScene(QPointF(20, 20));
+    const QPoint end   = view.mapFromScene(QPointF(520, 380));
+
+    QTest::mousePress(view.viewport(), Qt::LeftButton, Qt::ShiftModifier, start);
+    const int segments = 8;
+    for (int i = 1; i <= segments; ++i) {
+        QTest::mouseMove(view.viewport(), start + (end - start) * (double(i) / segments));
+        QCoreApplication::processEvents();
+    }
+
+    // 拖动过程中选择实时更新，但框选矩形不作为图元加入场景
+    QVERIFY(a->isSelected());
+    QVERIFY(b->isSelected());
+    QVERIFY(!outside->isSelected());
+    QCOMPARE(countType(scene, QGraphicsRectItem::Type), 0);
+    QCOMPARE(spy.count(), 0);
+
+    QTest::mouseRelease(view.viewport(), Qt::LeftButton, Qt::ShiftModifier, end);
+    QCoreApplication::processEvents();
+
+    // 整批选择只发出一次 selectionChanged
+    QVERIFY(a->isSelected());
+    QVERIFY(b->isSelected());
+    QVERIFY(!outside->isSelected());
+    QCOMPARE(spy.count(), 1);
+}
+
 void TestSceneManagement::keyboard_shortcut_rotate_selected_item()
 {
     QMenu menu;
@@ -0,0 +1,127 @@
+#include <QtTest/QtTest>
+#include <QGraphicsScene>
+#include <QMenu>
+
+#include "../sceneoverlay.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+
+class TestSceneOverlay : public QObject
+{
+    Q_OBJECT
+private slots:
+    void marquee_invalidates_only_old_and_new_rect();
+    void guides_invalidate_only_their_bounds();
+    void showing_ports_is_one_repaint();
+    void ports_are_queried_by_exposed_rect();
+};
+
+// 收集一轮事件循环内场景报告的所有失效区域
+static QRectF collectChanged(QGraphicsScene &scene)
+{
+    QSignalSpy spy(&scene, &QGraphicsScene::changed);
+    QCoreApplication::processEvents();
+    QRectF dirty;
+    for (const QList<QVariant> &args : spy) {
+        const QList<QRectF> rects = args.at(0).value<QList<QRectF>>();
+        for (const QRectF &r : rects)
+            dirty = dirty.united(r);
+    }
+    return dirty;
+}
+
+void TestSceneOverlay::marquee_invalidates_only_old_and_new_rect()
+{
+    QGraphicsScene scene(0, 0, 10000, 10000);
+    SceneOverlay overlay(&scene);
+    QCoreApplication::processEvents();
+
+    overlay.setMarquee(QRectF(100, 100, 50, 40));
+    QRectF dirty = collectChanged(scene);
+    QVERIFY(dirty.contains(QRectF(100, 100, 50, 40)));
+    QVERIFY(dirty.width() < 100 && dirty.height() < 100);
+
+    // 新旧矩形的并集
+    overlay.setMarquee(QRectF(100, 100, 80, 60));
+    dirty = collectChanged(scene);
+    QVERIFY(dirty.contains(QRectF(100, 100, 80, 60)));
+    QVERIFY(dirty.width() < 100 && dirty.height() < 100);
+
+    // 隐藏时只刷新旧矩形
+    overlay.setMarquee(QRectF());
+    dirty = collectChanged(scene);
+    QVERIFY(dirty.contains(QRectF(100, 100, 80, 60)));
+    QVERIFY(dirty.width() < 100);
+}
+
+void TestSceneOverlay::guides_invalidate_only_their_bounds()
+{
+    QGraphicsScene scene(0, 0, 10000, 10000);
+    SceneOverlay overlay(&scene);
+    QCoreApplication::processEvents();
+
+    overlay.setGuides({ QLineF(200, 100, 200, 400) });
+    QRectF dirty = collectChanged(scene);
+    QVERIFY(dirty.contains(QPointF(200, 250)));
+    QVERIFY(dirty.width() < 20);
+    QCOMPARE(overlay.guides().size(), 1);
+
+    // 相同的辅助线不重复刷新
+    overlay.setGuides({ QLineF(200, 100, 200, 400) });
+    QVERIFY(collectChanged(scene).isNull());
+
+    overlay.clearGuides();
+    QVERIFY(collectChanged(scene).contains(QPointF(200, 250)));
+    QVERIFY(overlay.guides().isEmpty());
+}
+
+void TestSceneOverlay::showing_ports_is_one_repaint()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    for (int i = 0; i < 200; ++i) {
+        auto *item = new DiagramItem(DiagramItem::Step, &menu);
+        scene.addItem(item);
+        item->setPos((i % 20) * 250, (i / 20) * 200);
+    }
+    QCoreApplication::processEvents();
+
+    QSignalSpy spy(&scene, &QGraphicsScene::changed);
+    scene.setLinkVisible(true);
+    QVERIFY(scene.linkVisible());
+    QCoreApplication::processEvents();
+    QCOMPARE(spy.count(), 1);
+
+    // 重复设置不会再次刷新
+    scene.setLinkVisible(true);
+    QCoreApplication::processEvents();
+    QCOMPARE(spy.count(), 1);
+}
+
+void TestSceneOverlay::ports_are_queried_by_exposed_rect()
+{
+    QMenu menu;
+    DiagramScene scene(&menu);
+    auto *a = new DiagramItem(DiagramItem::Step, &menu);
+    auto *b = new DiagramItem(DiagramItem::Step, &menu);
+    scene.addItem(a);
+    scene.addItem(b);
+    a->setPos(0, 0);
+    b->setPos(5000, 5000);
+
+    const QList<PortIndex::Port> nearA = scene.portIndex().portsIn(QRectF(-100, -100, 400, 400));
+    QCOMPARE(nearA.size(), 4);
+    for (const PortIndex::Port &port : nearA)
+        QCOMPARE(port.item, a);
+
+    // 覆盖整个场景时两种遍历方式结果一致
+    QCOMPARE(scene.portIndex().portsIn(QRectF(-1e6, -1e6, 2e6, 2e6)).size(), 8);
+}
+
+int runSceneOverlayTests(int argc, char** argv)
+{
+    TestSceneOverlay tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_scene_overlay.moc"
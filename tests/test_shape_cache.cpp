@@ -0,0 +1,124 @@
+#include <QtTest/QtTest>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QMenu>
+#include <QPainter>
+
+#include "../shapecache.h"
+#include "../diagramitem.h"
+
+class TestShapeCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void same_type_and_size_share_geometry();
+    void size_is_normalized_outside_paint();
+    void paint_is_read_only();
+    void every_type_has_fill_polygon();
+    void render_zoomed_out_chart();
+};
+
+static void renderScene(QGraphicsScene &scene, qreal scale)
+{
+    const QRectF source = scene.itemsBoundingRect();
+    QImage image((source.size() * scale).toSize().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    scene.render(&painter, QRectF(QPointF(0, 0), image.size()), source);
+}
+
+void TestShapeCache::same_type_and_size_share_geometry()
+{
+    QMenu menu;
+    DiagramItem a(DiagramItem::StartEnd, &menu);
+    a.setFixedSize(QSizeF(317, 211));
+    DiagramItem b(DiagramItem::StartEnd, &menu);
+    const int builds = ShapeCache::buildCount();
+
+    b.setFixedSize(QSizeF(317, 211));
+    QCOMPARE(ShapeCache::buildCount(), builds);
+
+    // 不同尺寸才需要重新构建
+    b.setFixedSize(QSizeF(318, 211));
+    QCOMPARE(ShapeCache::buildCount(), builds + 1);
+}
+
+void TestShapeCache::size_is_normalized_outside_paint()
+{
+    QMenu menu;
+    DiagramItem hexagon(DiagramItem::Hexagon, &menu);
+    hexagon.setFixedSize(QSizeF(200, 100));
+    QCOMPARE(hexagon.getSize(), QSizeF(120, 100));
+
+    DiagramItem card(DiagramItem::Card, &menu);
+    card.setFixedSize(QSizeF(300, 100));
+    QCOMPARE(card.getSize(), QSizeF(150, 100));
+
+    DiagramItem disk(DiagramItem::Disk, &menu);
+    disk.setHeight(90);
+    QCOMPARE(disk.getSize(), QSizeF(90, 90));
+
+    // Step 不受宽高比约束
+    DiagramItem step(DiagramItem::Step, &menu);
+    step.setFixedSize(QSizeF(250.5, 180.25));
+    QCOMPARE(step.getSize(), QSizeF(250.5, 180.25));
+}
+
+void TestShapeCache::paint_is_read_only()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    QList<DiagramItem *> items;
+    for (int t = DiagramItem::Step; t <= DiagramItem::Hexagon; ++t) {
+        auto *item = new DiagramItem(DiagramItem::DiagramType(t), &menu);
+        item->setPos((t % 5) * 250, (t / 5) * 200);
+        scene.addItem(item);
+        items.append(item);
+    }
+
+    QList<QSizeF> sizes;
+    for (DiagramItem *item : std::as_const(items))
+        sizes.append(item->getSize());
+
+    const int builds = ShapeCache::buildCount();
+    renderScene(scene, 1.0);
+    renderScene(scene, 0.5);
+
+    QCOMPARE(ShapeCache::buildCount(), builds);
+    for (int i = 0; i < items.size(); ++i)
+        QCOMPARE(items[i]->getSize(), sizes[i]);
+}
+
+void TestShapeCache::every_type_has_fill_polygon()
+{
+    QMenu menu;
+    for (int t = DiagramItem::Step; t <= DiagramItem::Hexagon; ++t) {
+        DiagramItem item(DiagramItem::DiagramType(t), &menu);
+        QVERIFY2(item.polygon().size() >= 2, qPrintable(QString("type %1 has no polygon").arg(t)));
+        QVERIFY(!item.outlineShape().isEmpty());
+    }
+}
+
+// 1 万个图元缩小到 10% 渲染一次的耗时
+void TestShapeCache::render_zoomed_out_chart()
+{
+    QMenu menu;
+    QGraphicsScene scene;
+    for (int i = 0; i < 10000; ++i) {
+        auto *item = new DiagramItem(DiagramItem::DiagramType(i % (DiagramItem::Hexagon + 1)), &menu);
+        item->setPos((i % 100) * 220, (i / 100) * 160);
+        scene.addItem(item);
+    }
+
+    QBENCHMARK {
+        renderScene(scene, 0.1);
+    }
+}
+
+int runShapeCacheTests(int argc, char** argv)
+{
+    TestShapeCache tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_shape_cache.moc"
@@ -0,0 +1,114 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../shapeiconatlas.h"
+#include "../diagramitem.h"
+
+class TestShapeIconAtlas : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void every_shape_has_an_icon();
+    void each_icon_decoded_once();
+    void icon_creation_does_not_decode();
+    void pixmaps_follow_device_pixel_ratio();
+    void toolbox_icons_legacy();
+    void toolbox_icons_atlas();
+};
+
+static const int shapeCount = DiagramItem::Hexagon + 1;
+
+void TestShapeIconAtlas::init()
+{
+    ShapeIconAtlas::instance().clear();
+}
+
+void TestShapeIconAtlas::every_shape_has_an_icon()
+{
+    for (int t = 0; t < shapeCount; ++t) {
+        const QImage image = ShapeIconAtlas::instance().image(DiagramItem::DiagramType(t));
+        QVERIFY2(!image.isNull(), qPrintable(ShapeIconAtlas::resourcePath(DiagramItem::DiagramType(t))));
+    }
+}
+
+void TestShapeIconAtlas::each_icon_decoded_once()
+{
+    ShapeIconAtlas &atlas = ShapeIconAtlas::instance();
+    atlas.preload();
+    atlas.waitForPreload();
+    QCOMPARE(atlas.decodeCount(), shapeCount);
+
+    // 预加载后工具箱、拖拽预览、DiagramItem::image() 都不再解码
+    atlas.pixmap(DiagramItem::Step, QSize(70, 70), 1.0);
+    atlas.pixmap(DiagramItem::Step, QSize(70, 70), 2.0);
+    QMenu menu;
+    DiagramItem item(DiagramItem::Disk, &menu);
+    QVERIFY(!item.image().isNull());
+    QCOMPARE(atlas.decodeCount(), shapeCount);
+}
+
+void TestShapeIconAtlas::icon_creation_does_not_decode()
+{
+    ShapeIconAtlas &atlas = ShapeIconAtlas::instance();
+    const QIcon icon = atlas.icon(DiagramItem::Conditional);
+    QVERIFY(!icon.isNull());
+    QCOMPARE(atlas.decodeCount(), 0);
+
+    // 第一次取位图时才解码，而且只解码这一种
+    QVERIFY(!icon.pixmap(QSize(70, 70)).isNull());
+    QCOMPARE(atlas.decodeCount(), 1);
+}
+
+void TestShapeIconAtlas::pixmaps_follow_device_pixel_ratio()
+{
+    ShapeIconAtlas &atlas = ShapeIconAtlas::instance();
+    const QPixmap normal = atlas.pixmap(DiagramItem::Step, QSize(70, 70), 1.0);
+    const QPixmap hiDpi = atlas.pixmap(DiagramItem::Step, QSize(70, 70), 2.0);
+
+    QCOMPARE(normal.devicePixelRatio(), 1.0);
+    QCOMPARE(hiDpi.devicePixelRatio(), 2.0);
+    QVERIFY(normal.width() <= 70 && normal.height() <= 70);
+    QVERIFY(hiDpi.width() <= 140 && hiDpi.height() <= 140);
+    QVERIFY(hiDpi.width() > 70 || hiDpi.height() > 70);
+    QCOMPARE(hiDpi.deviceIndependentSize(), normal.deviceIndependentSize());
+
+    // 同一尺寸和像素比复用同一份位图
+    QCOMPARE(atlas.pixmap(DiagramItem::Step, QSize(70, 70), 2.0).cacheKey(), hiDpi.cacheKey());
+}
+
+// 启动时构建工具箱图标的耗时：旧做法（每种构造一个 DiagramItem 再解码 PNG）
+void TestShapeIconAtlas::toolbox_icons_legacy()
+{
+    QMenu menu;
+    QBENCHMARK {
+        for (int t = 0; t < shapeCount; ++t) {
+            DiagramItem item(DiagramItem::DiagramType(t), &menu);
+            QPixmap pixmap(ShapeIconAtlas::resourcePath(DiagramItem::DiagramType(t)));
+            QIcon icon(pixmap);
+            QVERIFY(!icon.isNull());
+        }
+    }
+}
+
+// 新做法：创建图标不解码，后台预加载，绘制时按像素比取位图
+void TestShapeIconAtlas::toolbox_icons_atlas()
+{
+    QBENCHMARK {
+        ShapeIconAtlas::instance().clear();
+        ShapeIconAtlas::instance().preload();
+        for (int t = 0; t < shapeCount; ++t) {
+            QIcon icon = ShapeIconAtlas::instance().icon(DiagramItem::DiagramType(t));
+            QVERIFY(!icon.isNull());
+        }
+    }
+    ShapeIconAtlas::instance().waitForPreload();
+}
+
+int runShapeIconAtlasTests(int argc, char** argv)
+{
+    TestShapeIconAtlas tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_shape_icon_atlas.moc"
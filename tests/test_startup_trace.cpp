@@ -0,0 +1,153 @@
+#include <QtTest/QtTest>
+#include <QComboBox>
+#include <QTemporaryDir>
+
+#include "../startuptrace.h"
+#include "../mainwindow.h"
+#include "../findreplacedialog.h"
+
+class TestStartupTrace : public QObject
+{
+    Q_OBJECT
+private slots:
+    void cleanup();
+    void disabled_records_nothing();
+    void phases_in_order();
+    void scope_records_duration();
+    void finish_writes_log();
+    void first_frame_after_first_paint();
+    void find_dialog_created_on_first_use();
+    void background_icons_deferred();
+    void mainwindow_construction();
+};
+
+void TestStartupTrace::cleanup()
+{
+    StartupTrace::start(false);
+    StartupTrace::setLogPath(QString());
+}
+
+void TestStartupTrace::disabled_records_nothing()
+{
+    StartupTrace::start(false);
+    StartupTrace::mark("a");
+    {
+        StartupTrace::Scope scope("b");
+    }
+    QVERIFY(StartupTrace::phases().isEmpty());
+    QVERIFY(!StartupTrace::finish());
+}
+
+void TestStartupTrace::phases_in_order()
+{
+    StartupTrace::start(true);
+    StartupTrace::mark("first");
+    StartupTrace::mark("second");
+    StartupTrace::mark("third");
+
+    const QList<StartupTrace::Phase> phases = StartupTrace::phases();
+    QCOMPARE(phases.size(), 3);
+    QCOMPARE(phases[0].name, QString("first"));
+    QCOMPARE(phases[2].name, QString("third"));
+    QVERIFY(phases[0].startNs <= phases[1].startNs);
+    QVERIFY(phases[1].startNs <= phases[2].startNs);
+}
+
+void TestStartupTrace::scope_records_duration()
+{
+    StartupTrace::start(true);
+    {
+        StartupTrace::Scope scope("sleep");
+        QTest::qSleep(5);
+    }
+    const QList<StartupTrace::Phase> phases = StartupTrace::phases();
+    QCOMPARE(phases.size(), 1);
+    QVERIFY(phases[0].elapsedNs >= 4 * 1000 * 1000);
+}
+
+void TestStartupTrace::finish_writes_log()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("trace/startup-trace.log");
+    StartupTrace::setLogPath(path);
+    StartupTrace::start(true);
+    StartupTrace::mark("application");
+    StartupTrace::mark("first-frame");
+    QVERIFY(StartupTrace::finish());
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+    const QString text = QString::fromUtf8(file.readAll());
+    QVERIFY(text.contains("application"));
+    QVERIFY(text.contains("first-frame"));
+}
+
+void TestStartupTrace::first_frame_after_first_paint()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StartupTrace::setLogPath(dir.filePath("startup-trace.log"));
+    StartupTrace::start(true);
+
+    QWidget widget;
+    StartupTrace::finishAfterFirstPaint(&widget);
+    QTest::qWait(20);
+    QVERIFY(StartupTrace::phases().isEmpty());   // 还没显示，不算首帧
+
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_COMPARE(StartupTrace::phases().size(), 1);
+    QCOMPARE(StartupTrace::phases().constFirst().name, QString("first-frame"));
+    QVERIFY(QFile::exists(dir.filePath("startup-trace.log")));
+
+    // 之后的绘制不再记录
+    widget.repaint();
+    QTest::qWait(20);
+    QCOMPARE(StartupTrace::phases().size(), 1);
+}
+
+void TestStartupTrace::find_dialog_created_on_first_use()
+{
+    MainWindow window;
+    QVERIFY(window.findChildren<FindReplaceDialog*>().isEmpty());
+
+    QMetaObject::invokeMethod(&window, "openFindReplaceDialog");
+    QCOMPARE(window.findChildren<FindReplaceDialog*>().size(), 1);
+
+    // 再次打开复用同一个对话框
+    QMetaObject::invokeMethod(&window, "openFindReplaceDialog");
+    QCOMPARE(window.findChildren<FindReplaceDialog*>().size(), 1);
+}
+
+void TestStartupTrace::background_icons_deferred()
+{
+    MainWindow window;
+    QComboBox *background = nullptr;
+    for (QComboBox *combo : window.findChildren<QComboBox*>()) {
+        if (combo->itemData(0).toString() == ":/images/background1.png")
+            background = combo;
+    }
+    QVERIFY(background);
+    QCOMPARE(background->count(), 4);
+    QVERIFY(background->itemIcon(0).isNull());
+
+    // 回到事件循环后补上预览图标
+    QTRY_VERIFY(!background->itemIcon(3).isNull());
+}
+
+// 构造主窗口的耗时（对比时可用 --startup-trace 看各阶段）
+void TestStartupTrace::mainwindow_construction()
+{
+    QBENCHMARK {
+        MainWindow window;
+    }
+}
+
+int runStartupTraceTests(int argc, char** argv)
+{
+    TestStartupTrace tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_startup_trace.moc"
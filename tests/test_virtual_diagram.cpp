@@ -0,0 +1,265 @@
+#include <QtTest/QtTest>
+#include <QMenu>
+
+#include "../virtualdiagram.h"
+#include "../diagrammodel.h"
+#include "../diagramscene.h"
+#include "../diagramitem.h"
+#include "../diagrampath.h"
+
+class TestVirtualDiagram : public QObject
+{
+    Q_OBJECT
+private slots:
+    void creates_only_visible_items();
+    void scrolling_recycles_items();
+    void edits_survive_recycling();
+    void connector_to_offscreen_node();
+    void user_edits_reach_model();
+    void find_and_reveal();
+    void selection_survives_recycling();
+    void rotated_item_is_not_recycled();
+    void reentered_endpoint_keeps_connector();
+    void scroll_100000_nodes();
+};
+
+// columns x rows 的网格，每个节点与右边的节点相连
+static DiagramModel gridModel(int columns, int rows)
+{
+    DiagramModel model;
+    model.reserve(columns * rows, columns * rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            DiagramModel::Node node;
+            node.type = DiagramItem::Step;
+            node.pos = QPointF(x * 200, y * 150);
+            node.size = QSizeF(100, 60);
+            node.text = QStringLiteral("节点%1").arg(y * columns + x);
+            model.addNode(node);
+        }
+    }
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x + 1 < columns; ++x) {
+            const int from = y * columns + x;
+            model.addConnector(DiagramModel::Connector{ from, from + 1, DiagramItem::TF_Right, DiagramItem::TF_Left });
+        }
+    }
+    return model;
+}
+
+static int diagramItemCount(const DiagramScene &scene)
+{
+    int count = 0;
+    for (QGraphicsItem *item : scene.items()) {
+        if (item->type() == DiagramItem::Type)
+            ++count;
+    }
+    return count;
+}
+
+void TestVirtualDiagram::creates_only_visible_items()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+
+    const VirtualDiagram::Stats stats = scene.virtualDiagram()->stats();
+    QVERIFY(stats.live > 0);
+    QVERIFY2(stats.live < 200, qPrintable(QString::number(stats.live)));
+    QCOMPARE(diagramItemCount(scene), stats.live);
+    // 保存仍然是完整的图
+    const DiagramModel saved = scene.toModel();
+    QCOMPARE(saved.nodeCount(), 10000);
+    QCOMPARE(saved.connectorCount(), 9900);
+}
+
+void TestVirtualDiagram::scrolling_recycles_items()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    const int firstLive = scene.virtualDiagram()->stats().live;
+
+    for (int step = 1; step <= 20; ++step)
+        scene.setVisibleRect(QRectF(step * 500, step * 300, 1000, 750));
+    const VirtualDiagram::Stats stats = scene.virtualDiagram()->stats();
+    QVERIFY(stats.reused > 0);
+    QVERIFY(stats.live < firstLive * 2);
+    // 新建的图元数远小于滚动经过的节点数
+    QVERIFY2(stats.created < firstLive * 4, qPrintable(QString::number(stats.created)));
+    QCOMPARE(diagramItemCount(scene), stats.live);
+}
+
+void TestVirtualDiagram::edits_survive_recycling()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+
+    DiagramItem *item = virtualDiagram->itemOf(0);
+    QVERIFY(item);
+    item->setLabelText(QStringLiteral("已修改"));
+    item->setPos(30, 40);
+
+    scene.setVisibleRect(QRectF(10000, 10000, 1000, 750));
+    QVERIFY(!virtualDiagram->itemOf(0));
+    const DiagramModel saved = scene.toModel();
+    QCOMPARE(saved.nodeText(0), QStringLiteral("已修改"));
+    QCOMPARE(saved.nodePos(0), QPointF(30, 40));
+
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    QVERIFY(virtualDiagram->itemOf(0));
+    QCOMPARE(virtualDiagram->itemOf(0)->labelText(), QStringLiteral("已修改"));
+}
+
+void TestVirtualDiagram::connector_to_offscreen_node()
+{
+    DiagramModel model;
+    DiagramModel::Node node;
+    node.size = QSizeF(100, 60);
+    node.pos = QPointF(0, 0);
+    model.addNode(node);
+    node.pos = QPointF(50000, 0);
+    model.addNode(node);
+    node.pos = QPointF(90000, 0);
+    model.addNode(node);
+    model.addConnector(DiagramModel::Connector{ 0, 1, DiagramItem::TF_Right, DiagramItem::TF_Left });
+
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(model);
+    scene.setVisibleRect(QRectF(0, 0, 800, 600));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    // 视口外的另一端也被创建，连线完整
+    QVERIFY(virtualDiagram->itemOf(0));
+    QVERIFY(virtualDiagram->itemOf(1));
+    QVERIFY(!virtualDiagram->itemOf(2));
+    QCOMPARE(virtualDiagram->stats().livePaths, 1);
+    QCOMPARE(virtualDiagram->itemOf(0)->pathes.size(), 1);
+}
+
+void TestVirtualDiagram::user_edits_reach_model()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(10, 10));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+
+    // 删除一个图元：模型中的节点和相连的两条连线一起去掉
+    DiagramItem *item = virtualDiagram->itemOf(1);
+    QVERIFY(item);
+    item->removePathes();
+    scene.removeItem(item);
+    delete item;
+    DiagramModel saved = scene.toModel();
+    QCOMPARE(saved.nodeCount(), 99);
+    QCOMPARE(saved.connectorCount(), 88);
+
+    // 新建图元和连线进入模型
+    auto *added = new DiagramItem(DiagramItem::Conditional);
+    added->setPos(0, 2000);
+    scene.addItem(added);
+    DiagramPath *path = scene.addConnector(virtualDiagram->itemOf(0), added, DiagramItem::TF_Bottom, DiagramItem::TF_Top);
+    QVERIFY(path);
+    saved = scene.toModel();
+    QCOMPARE(saved.nodeCount(), 100);
+    QCOMPARE(saved.connectorCount(), 89);
+    QVERIFY(virtualDiagram->nodeOf(added) >= 0);
+}
+
+void TestVirtualDiagram::find_and_reveal()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+
+    const QList<int> hits = virtualDiagram->find(QStringLiteral("节点9999"));
+    QCOMPARE(hits, QList<int>({ 9999 }));
+    QVERIFY(!virtualDiagram->itemOf(9999));
+    DiagramItem *item = virtualDiagram->reveal(9999);
+    QVERIFY(item);
+    QCOMPARE(item->scene(), &scene);
+    QCOMPARE(item->labelText(), QStringLiteral("节点9999"));
+}
+
+void TestVirtualDiagram::selection_survives_recycling()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    virtualDiagram->itemOf(2)->setSelected(true);
+    virtualDiagram->setNodeSelected(5000, true);   // 没有图元的节点
+
+    scene.setVisibleRect(QRectF(10000, 10000, 1000, 750));
+    QCOMPARE(virtualDiagram->selectedNodes(), QList<int>({ 2, 5000 }));
+
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    QVERIFY(virtualDiagram->itemOf(2)->isSelected());
+}
+
+void TestVirtualDiagram::rotated_item_is_not_recycled()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(100, 100));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    DiagramItem *item = virtualDiagram->itemOf(3);
+    QVERIFY(item);
+    item->setRotationAngle(90);
+
+    // 模型中没有旋转角度，滚出视口后图元仍保留，角度不丢
+    scene.setVisibleRect(QRectF(10000, 10000, 1000, 750));
+    QCOMPARE(virtualDiagram->itemOf(3), item);
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    QCOMPARE(virtualDiagram->itemOf(3)->rotationAngle(), qreal(90));
+}
+
+void TestVirtualDiagram::reentered_endpoint_keeps_connector()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(10, 10));
+    VirtualDiagram *virtualDiagram = scene.virtualDiagram();
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    const int before = virtualDiagram->stats().livePaths;
+
+    // 图元离开场景又加入，连线一直留在场景中
+    DiagramItem *item = virtualDiagram->itemOf(1);
+    QVERIFY(item);
+    scene.removeItem(item);
+    scene.addItem(item);
+    QCOMPARE(virtualDiagram->stats().livePaths, before);
+    DiagramModel saved = scene.toModel();
+    QCOMPARE(saved.nodeCount(), 100);
+    QCOMPARE(saved.connectorCount(), 90);
+
+    // 回收再创建时每条连线只删除、创建一次
+    scene.setVisibleRect(QRectF(10000, 10000, 1000, 750));
+    QCOMPARE(virtualDiagram->stats().livePaths, 0);
+    scene.setVisibleRect(QRectF(0, 0, 1000, 750));
+    QCOMPARE(virtualDiagram->stats().livePaths, before);
+    saved = scene.toModel();
+    QCOMPARE(saved.connectorCount(), 90);
+}
+
+void TestVirtualDiagram::scroll_100000_nodes()
+{
+    DiagramScene scene(nullptr);
+    scene.setVirtualModel(gridModel(400, 250));
+    int step = 0;
+    QBENCHMARK {
+        scene.setVisibleRect(QRectF((step % 100) * 700, (step % 60) * 500, 1600, 900));
+        ++step;
+    }
+    QVERIFY(scene.virtualDiagram()->stats().live < 1000);
+    QCOMPARE(scene.toModel().nodeCount(), 100000);
+}
+
+int runVirtualDiagramTests(int argc, char** argv)
+{
+    TestVirtualDiagram tc;
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "test_virtual_diagram.moc"
@@ -1,4 +1,4 @@
-QT += core testlib widgets svg
+QT += core testlib widgets svg concurrent
 CONFIG += console
 CONFIG -= app_bundle
 
@@ -19,6 +19,29 @@ SOURCES += \
     test_file_io.cpp \
     test_shortcuts.cpp \
     test_undo_redo.cpp \
+    test_alignment_index.cpp \
+    test_port_index.cpp \
+    test_scene_overlay.cpp \
+    test_path_coalescing.cpp \
+    test_shape_cache.cpp \
+    test_level_of_detail.cpp \
+    test_item_render_cache.cpp \
+    test_handle_geometry.cpp \
+    test_label_layout.cpp \
+    test_shape_icon_atlas.cpp \
+    test_startup_trace.cpp \
+    test_orthogonal_router.cpp \
+    test_batch_routing.cpp \
+    test_connector_layer.cpp \
+    test_diagram_graph.cpp \
+    test_diagram_model.cpp \
+    test_virtual_diagram.cpp \
+    test_project_file.cpp \
+    test_fcproj_text_reader.cpp \
+    test_bulk_build.cpp \
+    test_project_loader.cpp \
+    test_project_save.cpp \
+    test_project_journal.cpp \
     ../mainwindow.cpp \
     ../deletecommand.cpp \
     ../diagramitem.cpp \
@@ -27,7 +50,25 @@ SOURCES += \
     ../findreplacedialog.cpp \
     ../arrow.cpp \
     ../diagramtextitem.cpp \
-    ../diagramscene.cpp
+    ../diagramscene.cpp \
+    ../alignmentindex.cpp \
+    ../portindex.cpp \
+    ../sceneoverlay.cpp \
+    ../shapecache.cpp \
+    ../levelofdetail.cpp \
+    ../itemrendercache.cpp \
+    ../shapeiconatlas.cpp \
+    ../startuptrace.cpp \
+    ../orthogonalrouter.cpp \
+    ../pathbatchrouter.cpp \
+    ../connectorlayer.cpp \
+    ../diagramgraph.cpp \
+    ../diagrammodel.cpp \
+    ../virtualdiagram.cpp \
+    ../projectfile.cpp \
+    ../fcprojtextreader.cpp \
+    ../projectloader.cpp \
+    ../projectjournal.cpp
 
 HEADERS += \
     ../mainwindow.h \
@@ -38,7 +79,26 @@ HEADERS += \
     ../diagramscene.h \
     ../arrow.h \
     ../diagramtextitem.h \
-    ../findreplacedialog.h
+    ../findreplacedialog.h \
+    ../alignmentindex.h \
+    ../portindex.h \
+    ../sceneoverlay.h \
+    ../shapecache.h \
+    ../levelofdetail.h \
+    ../itemrendercache.h \
+    ../shapeiconatlas.h \
+    ../startuptrace.h \
+    ../orthogonalrouter.h \
+    ../pathbatchrouter.h \
+    ../connectorlayer.h \
+    ../diagramgraph.h \
+    ../diagrammodel.h \
+    ../virtualdiagram.h \
+    ../projectfile.h \
+    ../fcprojtextreader.h \
+    ../projectloader.h \
+    ../projectjournal.h \
+    test_fixtures.h
 
 RESOURCES += ../diagramscene.qrc
 INCLUDEPATH += ..
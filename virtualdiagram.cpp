@@ -0,0 +1,452 @@
+#include "virtualdiagram.h"
+#include "diagramscene.h"
+#include "diagramitem.h"
+#include "diagrampath.h"
+
+#include <cmath>
+
+VirtualDiagram::VirtualDiagram(DiagramScene *scene, QMenu *itemMenu, qreal margin, int poolLimit)
+    : scene(scene), menu(itemMenu), margin(margin), poolLimit(poolLimit)
+{
+}
+
+VirtualDiagram::~VirtualDiagram()
+{
+    releaseAll();
+}
+
+QPoint VirtualDiagram::cellOf(const QPointF &pos) const
+{
+    return QPoint(int(std::floor(pos.x() / cell)), int(std::floor(pos.y() / cell)));
+}
+
+void VirtualDiagram::indexNode(int node, const QRectF &rect)
+{
+    nodeBounds[node] = rect;
+    const QPoint lo = cellOf(rect.topLeft());
+    const QPoint hi = cellOf(rect.bottomRight());
+    for (int cy = lo.y(); cy <= hi.y(); ++cy) {
+        for (int cx = lo.x(); cx <= hi.x(); ++cx)
+            grid[QPoint(cx, cy)].append(node);
+    }
+}
+
+void VirtualDiagram::unindexNode(int node)
+{
+    const QRectF &rect = nodeBounds.at(node);
+    const QPoint lo = cellOf(rect.topLeft());
+    const QPoint hi = cellOf(rect.bottomRight());
+    for (int cy = lo.y(); cy <= hi.y(); ++cy) {
+        for (int cx = lo.x(); cx <= hi.x(); ++cx) {
+            auto it = grid.find(QPoint(cx, cy));
+            if (it == grid.end())
+                continue;
+            it->removeOne(node);
+            if (it->isEmpty())
+                grid.erase(it);
+        }
+    }
+    nodeBounds[node] = QRectF();
+}
+
+void VirtualDiagram::syncBounds(int node)
+{
+    DiagramItem *item = live.at(node);
+    const QRectF rect(item->scenePos(), item->getSize());
+    if (rect == nodeBounds.at(node))
+        return;
+    unindexNode(node);
+    indexNode(node, rect);
+}
+
+int VirtualDiagram::appendNode(const DiagramModel::Node &node)
+{
+    const int index = model.addNode(node);
+    live.append(nullptr);
+    flags.append(0);
+    nodeBounds.append(QRectF());
+    incident.append(ConnectorList());
+    stamps.append(0);
+    return index;
+}
+
+void VirtualDiagram::setModel(const DiagramModel &source)
+{
+    releaseAll();
+    model = source;
+    const int nodes = model.nodeCount();
+    const int connectors = model.connectorCount();
+    live = QList<DiagramItem *>(nodes, nullptr);
+    flags = QList<quint8>(nodes, 0);
+    nodeBounds = QList<QRectF>(nodes);
+    incident = QList<ConnectorList>(nodes);
+    stamps = QList<quint32>(nodes, 0);
+    livePaths = QList<DiagramPath *>(connectors, nullptr);
+    removedConnectors = QList<bool>(connectors, false);
+    grid.clear();
+    visibleRect = QRectF();
+
+    for (int i = 0; i < nodes; ++i) {
+        const int type = model.nodeType(i);
+        if (type < DiagramItem::Step || type > DiagramItem::Hexagon) {
+            flags[i] = Removed;
+            continue;
+        }
+        indexNode(i, QRectF(model.nodePos(i), model.nodeSize(i)));
+    }
+    for (int c = 0; c < connectors; ++c) {
+        const DiagramModel::Connector &conn = model.connector(c);
+        if (conn.from < 0 || conn.from >= nodes || conn.to < 0 || conn.to >= nodes
+            || (flags.at(conn.from) & Removed) || (flags.at(conn.to) & Removed)) {
+            removedConnectors[c] = true;
+            continue;
+        }
+        incident[conn.from].append(c);
+        if (conn.to != conn.from)
+            incident[conn.to].append(c);
+    }
+}
+
+DiagramModel VirtualDiagram::snapshot() const
+{
+    DiagramModel out;
+    out.reserve(model.nodeCount(), model.connectorCount());
+    QList<int> index(model.nodeCount(), -1);
+    for (int i = 0; i < model.nodeCount(); ++i) {
+        if (flags.at(i) & Removed)
+            continue;
+        index[i] = out.addNode(live.at(i) ? DiagramScene::modelNode(live.at(i)) : model.node(i));
+    }
+    for (int c = 0; c < model.connectorCount(); ++c) {
+        if (removedConnectors.at(c))
+            continue;
+        const DiagramModel::Connector &conn = model.connector(c);
+        const int from = index.at(conn.from);
+        const int to = index.at(conn.to);
+        if (from < 0 || to < 0)
+            continue;
+        out.addConnector(DiagramModel::Connector{ from, to, conn.fromPort, conn.toPort });
+    }
+    return out;
+}
+
+QRectF VirtualDiagram::bounds() const
+{
+    QRectF rect;
+    for (int i = 0; i < nodeBounds.size(); ++i) {
+        if (!(flags.at(i) & Removed))
+            rect |= nodeBounds.at(i);
+    }
+    return rect;
+}
+
+bool VirtualDiagram::canRecycle(DiagramItem *item) const
+{
+    // 正在编辑文字、拖动或放在组合里的图元保持创建状态；模型不记录旋转角度，旋转过的图元也不回收
+    if (item->isEditingLabel() || item->parentItem() || scene->mouseGrabberItem() == item
+        || item->rotationAngle() != 0)
+        return false;
+    for (DiagramPath *path : std::as_const(item->pathes)) {
+        if (!connectorOfPath.contains(path))
+            return false;
+    }
+    return true;
+}
+
+void VirtualDiagram::setViewport(const QRectF &visible)
+{
+    visibleRect = visible;
+    // 已创建的图元可能被拖动过，先更新网格
+    for (auto it = nodeOfItem.cbegin(); it != nodeOfItem.cend(); ++it)
+        syncBounds(it.value());
+
+    const QRectF area = visible.adjusted(-margin, -margin, margin, margin);
+    ++stamp;
+    QList<int> wanted;
+    const QPoint lo = cellOf(area.topLeft());
+    const QPoint hi = cellOf(area.bottomRight());
+    for (int cy = lo.y(); cy <= hi.y(); ++cy) {
+        for (int cx = lo.x(); cx <= hi.x(); ++cx) {
+            const auto it = grid.constFind(QPoint(cx, cy));
+            if (it == grid.cend())
+                continue;
+            for (int node : *it) {
+                if (stamps.at(node) != stamp && nodeBounds.at(node).intersects(area)) {
+                    stamps[node] = stamp;
+                    wanted.append(node);
+                }
+            }
+        }
+    }
+    // 与视口内节点相连的另一端也要创建，否则从视口连出去的连线会缺失
+    const int direct = wanted.size();
+    for (int i = 0; i < direct; ++i) {
+        const int node = wanted.at(i);
+        for (int c : incident.at(node)) {
+            if (removedConnectors.at(c))
+                continue;
+            const DiagramModel::Connector &conn = model.connector(c);
+            const int other = conn.from == node ? conn.to : conn.from;
+            if (stamps.at(other) != stamp && !(flags.at(other) & Removed)) {
+                stamps[other] = stamp;
+                wanted.append(other);
+            }
+        }
+    }
+
+    busy = true;
+    // 先回收，腾出的图元马上可以给新进入视口的节点用
+    QList<int> leaving;
+    for (auto it = nodeOfItem.cbegin(); it != nodeOfItem.cend(); ++it) {
+        if (stamps.at(it.value()) != stamp && canRecycle(it.key()))
+            leaving.append(it.value());
+    }
+    for (int node : std::as_const(leaving))
+        recycle(node);
+
+    QList<int> entering;
+    for (int node : std::as_const(wanted)) {
+        if (!live.at(node)) {
+            materialize(node);
+            entering.append(node);
+        }
+    }
+    QList<DiagramPath *> paths;
+    for (int node : std::as_const(entering))
+        materializePaths(node, paths);
+    busy = false;
+    scene->routePaths(paths);
+}
+
+DiagramItem *VirtualDiagram::reveal(int node)
+{
+    if (node < 0 || node >= live.size() || (flags.at(node) & Removed))
+        return nullptr;
+    if (!live.at(node)) {
+        busy = true;
+        materialize(node);
+        QList<DiagramPath *> paths;
+        materializePaths(node, paths);
+        busy = false;
+        scene->routePaths(paths);
+    }
+    return live.at(node);
+}
+
+void VirtualDiagram::materialize(int node)
+{
+    const DiagramModel::Node data = model.node(node);
+    DiagramItem *item;
+    QList<DiagramItem *> &free = pool[data.type];
+    if (!free.isEmpty()) {
+        item = free.takeLast();   // 回收时已确认没有旋转
+        ++reusedCount;
+    } else {
+        item = new DiagramItem(DiagramItem::DiagramType(data.type), menu);
+        ++createdCount;
+    }
+    DiagramScene::applyModelNode(item, data);
+    scene->addItem(item);
+    item->setSelected(flags.at(node) & Selected);
+    live[node] = item;
+    nodeOfItem.insert(item, node);
+}
+
+void VirtualDiagram::materializePaths(int node, QList<DiagramPath *> &created)
+{
+    for (int c : incident.at(node)) {
+        if (removedConnectors.at(c) || livePaths.at(c))
+            continue;
+        const DiagramModel::Connector &conn = model.connector(c);
+        DiagramItem *startItem = live.at(conn.from);
+        DiagramItem *endItem = live.at(conn.to);
+        if (!startItem || !endItem)
+            continue;
+        DiagramPath *path = scene->addConnector(startItem, endItem, conn.fromPort, conn.toPort);
+        livePaths[c] = path;
+        connectorOfPath.insert(path, c);
+        created.append(path);
+    }
+}
+
+void VirtualDiagram::writeBack(int node)
+{
+    DiagramItem *item = live.at(node);
+    if (item->isSelected())
+        flags[node] |= Selected;
+    else
+        flags[node] &= ~Selected;
+    const DiagramModel::Node current = DiagramScene::modelNode(item);
+    model.setNode(node, current);
+    const QRectF rect(current.pos, current.size);
+    if (rect != nodeBounds.at(node)) {
+        unindexNode(node);
+        indexNode(node, rect);
+    }
+}
+
+void VirtualDiagram::recycle(int node)
+{
+    DiagramItem *item = live.at(node);
+    writeBack(node);
+    const QList<DiagramPath *> paths = item->pathes;
+    for (DiagramPath *path : paths)
+        dropPath(connectorOfPath.value(path));
+    scene->removeItem(item);
+    live[node] = nullptr;
+    nodeOfItem.remove(item);
+
+    QList<DiagramItem *> &free = pool[item->myDiagramType];
+    if (free.size() < poolLimit)
+        free.append(item);
+    else
+        delete item;
+}
+
+void VirtualDiagram::dropPath(int connector)
+{
+    DiagramPath *path = livePaths.at(connector);
+    livePaths[connector] = nullptr;
+    connectorOfPath.remove(path);
+    scene->removeItem(path);
+    delete path;
+}
+
+void VirtualDiagram::releaseAll()
+{
+    busy = true;
+    for (int c = 0; c < livePaths.size(); ++c) {
+        if (livePaths.at(c))
+            dropPath(c);
+    }
+    for (auto it = nodeOfItem.cbegin(); it != nodeOfItem.cend(); ++it) {
+        it.key()->removePathes();   // 没有登记的连线（正在组合中的图元等）
+        scene->removeItem(it.key());
+        delete it.key();
+    }
+    nodeOfItem.clear();
+    connectorOfPath.clear();
+    live.fill(nullptr);
+    for (const QList<DiagramItem *> &free : std::as_const(pool))
+        qDeleteAll(free);
+    pool.clear();
+    busy = false;
+}
+
+QList<int> VirtualDiagram::find(const QString &text, Qt::CaseSensitivity cs) const
+{
+    QList<int> hits;
+    for (int i = 0; i < model.nodeCount(); ++i) {
+        if (flags.at(i) & Removed)
+            continue;
+        const QString content = live.at(i) ? live.at(i)->labelText() : model.nodeText(i);
+        if (content.contains(text, cs))
+            hits.append(i);
+    }
+    return hits;
+}
+
+void VirtualDiagram::setNodeSelected(int node, bool selected)
+{
+    if (selected)
+        flags[node] |= Selected;
+    else
+        flags[node] &= ~Selected;
+    if (DiagramItem *item = live.at(node))
+        item->setSelected(selected);
+}
+
+bool VirtualDiagram::isNodeSelected(int node) const
+{
+    if (DiagramItem *item = live.at(node))
+        return item->isSelected();
+    return flags.at(node) & Selected;
+}
+
+QList<int> VirtualDiagram::selectedNodes() const
+{
+    QList<int> nodes;
+    for (int i = 0; i < flags.size(); ++i) {
+        if (!(flags.at(i) & Removed) && isNodeSelected(i))
+            nodes.append(i);
+    }
+    return nodes;
+}
+
+VirtualDiagram::Stats VirtualDiagram::stats() const
+{
+    Stats s;
+    s.live = nodeOfItem.size();
+    s.livePaths = connectorOfPath.size();
+    for (const QList<DiagramItem *> &free : pool)
+        s.pooled += free.size();
+    s.created = createdCount;
+    s.reused = reusedCount;
+    return s;
+}
+
+void VirtualDiagram::itemEntered(DiagramItem *item)
+{
+    if (busy || nodeOfItem.contains(item))
+        return;
+    // 用户新建、粘贴或撤销删除的图元加入模型
+    const int node = appendNode(DiagramScene::modelNode(item));
+    live[node] = item;
+    nodeOfItem.insert(item, node);
+    indexNode(node, QRectF(item->scenePos(), item->getSize()));
+}
+
+void VirtualDiagram::itemLeft(DiagramItem *item)
+{
+    if (busy)
+        return;
+    const int node = nodeOf(item);
+    if (node < 0)
+        return;
+    // 用户删除的图元：在模型中标记删除，相连的连线在快照中随之去掉
+    nodeOfItem.remove(item);
+    live[node] = nullptr;
+    flags[node] = Removed;
+    unindexNode(node);
+}
+
+void VirtualDiagram::pathEntered(DiagramPath *path)
+{
+    if (busy)
+        return;
+    const int from = nodeOf(path->getStartItem());
+    const int to = nodeOf(path->getEndItem());
+    if (from < 0 || to < 0)
+        return;
+    const DiagramModel::Connector conn{ from, to, int(path->getStartState()), int(path->getEndState()) };
+    int c = connectorOfPath.value(path, -1);
+    if (c >= 0) {
+        // 连线一直留在场景中、端点图元离开后又加入（组合、撤销删除）：端点已是新的节点，
+        // 仍用原来的连线下标。连线自己离开场景时 pathLeft 已去掉对应关系，再加入时按新连线记录
+        model.setConnector(c, conn);
+        removedConnectors[c] = false;
+        livePaths[c] = path;
+    } else {
+        c = model.connectorCount();
+        model.addConnector(conn);
+        livePaths.append(path);
+        removedConnectors.append(false);
+        connectorOfPath.insert(path, c);
+    }
+    if (!incident.at(from).contains(c))
+        incident[from].append(c);
+    if (!incident.at(to).contains(c))
+        incident[to].append(c);
+}
+
+void VirtualDiagram::pathLeft(DiagramPath *path)
+{
+    if (busy)
+        return;
+    const int c = connectorOfPath.value(path, -1);
+    if (c < 0)
+        return;
+    connectorOfPath.remove(path);
+    livePaths[c] = nullptr;
+    removedConnectors[c] = true;
+}
@@ -0,0 +1,107 @@
+#ifndef VIRTUALDIAGRAM_H
+#define VIRTUALDIAGRAM_H
+
+#include "diagrammodel.h"
+
+#include <QHash>
+#include <QList>
+#include <QPoint>
+#include <QRectF>
+#include <QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+class QMenu;
+QT_END_NAMESPACE
+
+class DiagramScene;
+class DiagramItem;
+class DiagramPath;
+
+// 虚拟化场景
+// 完整的图只存在 DiagramModel 里，只有外框落在视口（加边距）内的节点，以及与它们相连的另一端节点
+// 才创建 DiagramItem，两端都已创建的连线才创建 DiagramPath。移出视口的图元先把改动写回模型，
+// 再回收到按图形类型分组的池中，下次需要时套用另一个节点的数据，不再重新构造文本文档。
+// 节点外框登记在均匀网格里，视口变化时只查相交的格子。
+// 查找、保存、选择状态以模型为准；用户新建、删除的图元和连线由场景通知后同步进模型
+class VirtualDiagram
+{
+public:
+    struct Stats {
+        int live = 0;        // 当前已创建的图元
+        int livePaths = 0;   // 当前已创建的连线
+        int pooled = 0;      // 池中等待再用的图元
+        int created = 0;     // 累计新建的图元
+        int reused = 0;      // 累计从池中取出的次数
+    };
+
+    VirtualDiagram(DiagramScene *scene, QMenu *itemMenu, qreal margin = 300, int poolLimit = 512);
+    ~VirtualDiagram();   // 删除已创建的图元、连线和池中的图元
+
+    void setModel(const DiagramModel &model);
+    // 已创建图元的当前状态写入后的模型副本，不含已删除的节点和连线
+    DiagramModel snapshot() const;
+    QRectF bounds() const;   // 所有节点的外框
+
+    // 创建视口附近的图元，回收其余图元；视图滚动、缩放后调用
+    void setViewport(const QRectF &visible);
+    QRectF viewport() const { return visibleRect; }
+    DiagramItem *itemOf(int node) const { return live.value(node); }   // 未创建时为 nullptr
+    int nodeOf(DiagramItem *item) const { return nodeOfItem.value(item, -1); }
+    DiagramItem *reveal(int node);   // 不在视口内也立即创建（查找定位），已删除的节点返回 nullptr
+
+    // 文字包含 text 的节点，已创建的图元按当前文字判断
+    QList<int> find(const QString &text, Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    void setNodeSelected(int node, bool selected);
+    bool isNodeSelected(int node) const;
+    QList<int> selectedNodes() const;
+
+    Stats stats() const;
+
+    // 场景通知：不是由本类增删的图元、连线进出场景时调用
+    void itemEntered(DiagramItem *item);
+    void itemLeft(DiagramItem *item);
+    void pathEntered(DiagramPath *path);
+    void pathLeft(DiagramPath *path);
+
+private:
+    enum NodeFlag : quint8 { Removed = 0x01, Selected = 0x02 };
+    using ConnectorList = QVarLengthArray<int, 4>;
+
+    QPoint cellOf(const QPointF &pos) const;
+    void indexNode(int node, const QRectF &rect);
+    void unindexNode(int node);
+    void syncBounds(int node);   // 图元被拖动、缩放后更新网格
+    int appendNode(const DiagramModel::Node &node);   // 各列同步追加一个节点
+    bool canRecycle(DiagramItem *item) const;
+    void materialize(int node);
+    void materializePaths(int node, QList<DiagramPath *> &created);
+    void recycle(int node);
+    void writeBack(int node);   // 图元的位置、尺寸、文字、选中状态写回模型
+    void dropPath(int connector);
+    void releaseAll();
+
+    DiagramScene *scene;
+    QMenu *menu;
+    qreal margin;
+    int poolLimit;
+    qreal cell = 400;
+    DiagramModel model;
+    QList<DiagramItem *> live;             // 节点下标 -> 图元，未创建为 nullptr
+    QList<quint8> flags;                   // NodeFlag
+    QList<QRectF> nodeBounds;              // 登记在网格中的外框
+    QList<ConnectorList> incident;         // 节点相连的连线下标
+    QList<quint32> stamps;                 // setViewport 中去重
+    quint32 stamp = 0;
+    QList<DiagramPath *> livePaths;        // 连线下标 -> 连线，未创建为 nullptr
+    QList<bool> removedConnectors;
+    QHash<QPoint, QList<int>> grid;        // 网格 -> 外框与该格相交的节点
+    QHash<DiagramItem *, int> nodeOfItem;
+    QHash<DiagramPath *, int> connectorOfPath;
+    QHash<int, QList<DiagramItem *>> pool; // 图形类型 -> 回收的图元
+    QRectF visibleRect;
+    int createdCount = 0;
+    int reusedCount = 0;
+    bool busy = false;                     // 自身增删图元时忽略场景通知
+};
+
+#endif // VIRTUALDIAGRAM_H